@@ -43,6 +43,7 @@
         'process.cc',
         'process_mutex.cc',
         'run_level.cc',
+        'startup_profiler.cc',
         'stopwatch.cc',
       ],
       'dependencies': [
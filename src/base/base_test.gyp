@@ -58,6 +58,7 @@
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
         'process_mutex_test.cc',
+        'startup_profiler_test.cc',
         'stopwatch_test.cc',
       ],
       'conditions': [
@@ -185,6 +186,7 @@
       ],
       'dependencies': [
         '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'absl.gyp:absl_random',
         'absl.gyp:absl_strings',
         'base.gyp:japanese_util',
       ],
@@ -29,6 +29,8 @@
 
 #include "base/hash.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 
@@ -79,68 +81,87 @@ void Mix(T &a, T &b, T &c) {
   c ^= (b >> 15);
 }
 
-}  // namespace
-
-uint32_t Fingerprint32(absl::string_view str) {
-  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
+// Processes one 12 byte block.
+void MixBlock(absl::string_view block, uint32_t &a, uint32_t &b, uint32_t &c) {
+  DCHECK_EQ(block.size(), 12);
+  a += ToUint32(block[0], block[1], block[2], block[3]);
+  b += ToUint32(block[4], block[5], block[6], block[7]);
+  c += ToUint32(block[8], block[9], block[10], block[11]);
+  Mix(a, b, c);
 }
 
-uint32_t Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
-  DCHECK_LE(str.size(), std::numeric_limits<uint32_t>::max());
-  const uint32_t str_len = static_cast<uint32_t>(str.size());
-  uint32_t a = 0x9e3779b9;
-  uint32_t b = a;
-  uint32_t c = seed;
-
-  while (str.size() >= 12) {
-    a += ToUint32(str[0], str[1], str[2], str[3]);
-    b += ToUint32(str[4], str[5], str[6], str[7]);
-    c += ToUint32(str[8], str[9], str[10], str[11]);
-    Mix(a, b, c);
-    str.remove_prefix(12);
-  }
-
-  c += str_len;
-  switch (str.size()) {
+// Processes the last block of less than 12 bytes and returns the hash value.
+uint32_t MixTail(absl::string_view tail, uint32_t total_len, uint32_t a,
+                 uint32_t b, uint32_t c) {
+  DCHECK_LT(tail.size(), 12);
+  c += total_len;
+  switch (tail.size()) {
     case 11:
-      c += uint32_t{str[10]} << 24;
+      c += uint32_t{tail[10]} << 24;
       ABSL_FALLTHROUGH_INTENDED;
     case 10:
-      c += uint32_t{str[9]} << 16;
+      c += uint32_t{tail[9]} << 16;
       ABSL_FALLTHROUGH_INTENDED;
     case 9:
-      c += uint32_t{str[8]} << 8;
+      c += uint32_t{tail[8]} << 8;
       ABSL_FALLTHROUGH_INTENDED;
     case 8:
-      b += uint32_t{str[7]} << 24;
+      b += uint32_t{tail[7]} << 24;
       ABSL_FALLTHROUGH_INTENDED;
     case 7:
-      b += uint32_t{str[6]} << 16;
+      b += uint32_t{tail[6]} << 16;
       ABSL_FALLTHROUGH_INTENDED;
     case 6:
-      b += uint32_t{str[5]} << 8;
+      b += uint32_t{tail[5]} << 8;
       ABSL_FALLTHROUGH_INTENDED;
     case 5:
-      b += uint32_t{str[4]};
+      b += uint32_t{tail[4]};
       ABSL_FALLTHROUGH_INTENDED;
     case 4:
-      a += uint32_t{str[3]} << 24;
+      a += uint32_t{tail[3]} << 24;
       ABSL_FALLTHROUGH_INTENDED;
     case 3:
-      a += uint32_t{str[2]} << 16;
+      a += uint32_t{tail[2]} << 16;
       ABSL_FALLTHROUGH_INTENDED;
     case 2:
-      a += uint32_t{str[1]} << 8;
+      a += uint32_t{tail[1]} << 8;
       ABSL_FALLTHROUGH_INTENDED;
     case 1:
-      a += uint32_t{str[0]};
+      a += uint32_t{tail[0]};
       break;
   }
   Mix(a, b, c);
-
   return c;
 }
 
+uint64_t Combine(uint32_t hi, uint32_t lo) {
+  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= 0x130f9bef94a0a928uLL;
+  }
+  return result;
+}
+
+}  // namespace
+
+uint32_t Fingerprint32(absl::string_view str) {
+  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
+}
+
+uint32_t Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
+  DCHECK_LE(str.size(), std::numeric_limits<uint32_t>::max());
+  const uint32_t str_len = static_cast<uint32_t>(str.size());
+  uint32_t a = 0x9e3779b9;
+  uint32_t b = a;
+  uint32_t c = seed;
+
+  while (str.size() >= 12) {
+    MixBlock(str.substr(0, 12), a, b, c);
+    str.remove_prefix(12);
+  }
+  return MixTail(str, str_len, a, b, c);
+}
+
 uint64_t Fingerprint(absl::string_view str) {
   return FingerprintWithSeed(str, kFingerPrintSeed0);
 }
@@ -148,11 +169,52 @@ uint64_t Fingerprint(absl::string_view str) {
 uint64_t FingerprintWithSeed(absl::string_view str, uint32_t seed) {
   const uint32_t hi = Fingerprint32WithSeed(str, seed);
   const uint32_t lo = Fingerprint32WithSeed(str, kFingerPrintSeed1);
-  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
-  if ((hi == 0) && (lo < 2)) {
-    result ^= 0x130f9bef94a0a928uLL;
+  return Combine(hi, lo);
+}
+
+FingerprintBuilder::FingerprintBuilder()
+    : FingerprintBuilder(kFingerPrintSeed0) {}
+
+FingerprintBuilder::FingerprintBuilder(uint32_t seed)
+    : hi_{0x9e3779b9, 0x9e3779b9, seed},
+      lo_{0x9e3779b9, 0x9e3779b9, kFingerPrintSeed1} {}
+
+FingerprintBuilder &FingerprintBuilder::Append(absl::string_view str) {
+  DCHECK_LE(length_ + str.size(), std::numeric_limits<uint32_t>::max());
+  length_ += static_cast<uint32_t>(str.size());
+
+  // Fills the pending block first.
+  if (pending_size_ > 0) {
+    const size_t n = std::min(str.size(), sizeof(pending_) - pending_size_);
+    std::copy_n(str.data(), n, pending_ + pending_size_);
+    pending_size_ += n;
+    str.remove_prefix(n);
+    if (pending_size_ < sizeof(pending_)) {
+      return *this;
+    }
+    MixPending(absl::string_view(pending_, sizeof(pending_)));
+    pending_size_ = 0;
   }
-  return result;
+
+  while (str.size() >= sizeof(pending_)) {
+    MixPending(str.substr(0, sizeof(pending_)));
+    str.remove_prefix(sizeof(pending_));
+  }
+  std::copy(str.begin(), str.end(), pending_);
+  pending_size_ = str.size();
+  return *this;
+}
+
+uint64_t FingerprintBuilder::Finish() const {
+  const absl::string_view tail(pending_, pending_size_);
+  const uint32_t hi = MixTail(tail, length_, hi_.a, hi_.b, hi_.c);
+  const uint32_t lo = MixTail(tail, length_, lo_.a, lo_.b, lo_.c);
+  return Combine(hi, lo);
+}
+
+void FingerprintBuilder::MixPending(absl::string_view block) {
+  MixBlock(block, hi_.a, hi_.b, hi_.c);
+  MixBlock(block, lo_.a, lo_.b, lo_.c);
 }
 
 }  // namespace mozc
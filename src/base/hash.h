@@ -76,6 +76,49 @@ uint32_t Fingerprint32WithSeed(T num, uint32_t seed) {
       seed);
 }
 
+// Computes Fingerprint() or FingerprintWithSeed() of the concatenation of
+// the strings passed to Append() without building the concatenated string.
+// The builder is copyable, so the state after a common prefix can be reused
+// for many suffixes:
+//
+//   FingerprintBuilder prefix;
+//   prefix.Append(left);
+//   for (absl::string_view right : rights) {
+//     // Same as Fingerprint(absl::StrCat(left, right)).
+//     const uint64_t fp = FingerprintBuilder(prefix).Append(right).Finish();
+//   }
+class FingerprintBuilder {
+ public:
+  FingerprintBuilder();
+  explicit FingerprintBuilder(uint32_t seed);
+
+  FingerprintBuilder(const FingerprintBuilder&) = default;
+  FingerprintBuilder& operator=(const FingerprintBuilder&) = default;
+
+  FingerprintBuilder& Append(absl::string_view str);
+
+  // Returns the fingerprint of the strings appended so far. The builder can
+  // still be appended to after this call.
+  uint64_t Finish() const;
+
+ private:
+  struct State {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+  };
+
+  void MixPending(absl::string_view block);
+
+  // Fingerprint() is made of two 32-bit hashes with different seeds.
+  State hi_;
+  State lo_;
+  uint32_t length_ = 0;
+  // The bytes not yet mixed since the hash consumes 12 bytes at a time.
+  char pending_[12] = {};
+  size_t pending_size_ = 0;
+};
+
 }  // namespace mozc
 
 #endif  // MOZC_BASE_HASH_H_
@@ -29,9 +29,12 @@
 
 #include "base/hash.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "testing/gunit.h"
 
 namespace mozc {
@@ -97,5 +100,35 @@ TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   }
 }
 
+TEST(HashTest, FingerprintBuilder) {
+  const std::string s =
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.";
+  for (size_t len = 0; len <= s.size(); ++len) {
+    const absl::string_view str = absl::string_view(s).substr(0, len);
+    EXPECT_EQ(FingerprintBuilder().Finish(), Fingerprint(""));
+    EXPECT_EQ(FingerprintBuilder().Append(str).Finish(), Fingerprint(str));
+    EXPECT_EQ(FingerprintBuilder(0xdeadbeef).Append(str).Finish(),
+              FingerprintWithSeed(str, 0xdeadbeef));
+
+    // Every split point must give the same result.
+    for (size_t pos = 0; pos <= len; ++pos) {
+      FingerprintBuilder builder;
+      builder.Append(str.substr(0, pos));
+      builder.Append(str.substr(pos));
+      EXPECT_EQ(builder.Finish(), Fingerprint(str)) << len << " " << pos;
+    }
+  }
+}
+
+TEST(HashTest, FingerprintBuilderReusePrefix) {
+  FingerprintBuilder prefix;
+  prefix.Append("collocation");
+  for (const absl::string_view suffix : {"", "a", "rewriter", "0123456789ab"}) {
+    EXPECT_EQ(FingerprintBuilder(prefix).Append(suffix).Finish(),
+              Fingerprint(absl::StrCat("collocation", suffix)));
+  }
+  EXPECT_EQ(prefix.Finish(), Fingerprint("collocation"));
+}
+
 }  // namespace
 }  // namespace mozc
@@ -30,6 +30,7 @@
 #include "base/mmap.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <utility>
 
@@ -76,6 +77,7 @@ namespace {
 //      GetPageSize(): Gets the number satisfying mmap alignment.
 //          MapFile(): Performs mmap.
 //            Unmap(): Releases a mmap.
+//     FlushMapping(): Writes the modified pages back to the file.
 #ifdef _WIN32
 
 struct SyscallParams {
@@ -182,6 +184,14 @@ void Unmap(void *ptr, size_t /*unused_size*/) {
   }
 }
 
+absl::Status FlushMapping(void *ptr, size_t size) {
+  if (::FlushViewOfFile(ptr, size) == 0) {
+    return absl::UnknownError(
+        absl::StrFormat("Error %d: FlushViewOfFile failed", GetLastError()));
+  }
+  return absl::OkStatus();
+}
+
 #else  // _WIN32
 
 struct SyscallParams {
@@ -272,6 +282,13 @@ void Unmap(void *ptr, size_t size) {
   }
 }
 
+absl::Status FlushMapping(void *ptr, size_t size) {
+  if (msync(ptr, size, MS_SYNC) == -1) {
+    return absl::ErrnoToStatus(errno, "msync() failed");
+  }
+  return absl::OkStatus();
+}
+
 #endif  // _WIN32
 
 }  // namespace
@@ -355,6 +372,13 @@ void Mmap::Close() {
   adjust_ = 0;
 }
 
+absl::Status Mmap::Flush() {
+  if (data_.data() == nullptr) {
+    return absl::OkStatus();
+  }
+  return FlushMapping(data_.data() - adjust_, data_.size() + adjust_);
+}
+
 // Define a macro (MOZC_HAVE_MLOCK) to indicate mlock support.
 
 #if defined(__ANDROID__) || (defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE) || \
@@ -389,4 +413,46 @@ int Mmap::MaybeMUnlock(const void *addr, size_t len) { return -1; }
 
 #undef MOZC_HAVE_MLOCK
 
+#ifdef _WIN32
+
+int Mmap::MaybeAdvise(const void *addr, size_t len, Advice advice) {
+  return -1;
+}
+
+#else  // _WIN32
+
+int Mmap::MaybeAdvise(const void *addr, size_t len, Advice advice) {
+  if (addr == nullptr || len == 0) {
+    return -1;
+  }
+  absl::StatusOr<size_t> page_size = GetPageSize();
+  if (!page_size.ok()) {
+    return -1;
+  }
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t aligned_begin = begin - begin % *page_size;
+  int native_advice = MADV_NORMAL;
+  switch (advice) {
+    case NORMAL:
+      native_advice = MADV_NORMAL;
+      break;
+    case RANDOM:
+      native_advice = MADV_RANDOM;
+      break;
+    case SEQUENTIAL:
+      native_advice = MADV_SEQUENTIAL;
+      break;
+    case WILLNEED:
+      native_advice = MADV_WILLNEED;
+      break;
+    case DONTNEED:
+      native_advice = MADV_DONTNEED;
+      break;
+  }
+  return madvise(reinterpret_cast<void *>(aligned_begin),
+                 len + (begin - aligned_begin), native_advice);
+}
+
+#endif  // _WIN32
+
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <cstddef>
 #include <optional>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "base/strings/zstring_view.h"
@@ -87,6 +88,26 @@ class Mmap final {
   static int MaybeMLock(const void *addr, size_t len);
   static int MaybeMUnlock(const void *addr, size_t len);
 
+  // Access pattern hints passed to madvise().
+  enum Advice {
+    NORMAL,
+    RANDOM,
+    SEQUENTIAL,
+    WILLNEED,
+    DONTNEED,
+  };
+
+  // Gives the kernel a hint about the expected access pattern of the region
+  // `[addr, addr + len)`, which must lie inside a mapping. The start address is
+  // rounded down to the page boundary. Like MaybeMLock(), this is a no-op that
+  // returns -1 on platforms without madvise (Windows and Native Client).
+  static int MaybeAdvise(const void *addr, size_t len, Advice advice);
+
+  // Writes the modified pages of a READ_WRITE mapping back to the file and
+  // waits for the writes to complete (msync with MS_SYNC). On Windows, this
+  // flushes the view with FlushViewOfFile().
+  absl::Status Flush();
+
   constexpr char &operator[](size_t i) { return data_[i]; }
   constexpr char operator[](size_t i) const { return data_[i]; }
   constexpr char *begin() { return data_.begin(); }
@@ -62,6 +62,11 @@ TEST(MmapTest, DefaultCtor) {
   EXPECT_TRUE(mmap.empty());
 }
 
+TEST(MmapTest, FlushEmpty) {
+  Mmap mmap;
+  EXPECT_OK(mmap.Flush());
+}
+
 TEST(MmapTest, MoveCtor) {
   constexpr absl::string_view kTestContents = "mmap test";
 
@@ -148,6 +153,31 @@ TEST(MmapTest, MaybeMLockTest) {
   }
 }
 
+TEST(MmapTest, MaybeAdvise) {
+  const std::vector<char> data = GetRandomContents(10000);
+  const absl::StatusOr<TempFile> temp_file =
+      TempDirectory::Default().CreateTempFile();
+  ASSERT_OK(temp_file);
+  ASSERT_OK(FileUtil::SetContents(temp_file->path(),
+                                  absl::string_view(data.data(), data.size())));
+  const absl::StatusOr<Mmap> mmap =
+      Mmap::Map(temp_file->path(), Mmap::READ_ONLY);
+  ASSERT_OK(mmap);
+
+#ifdef _WIN32
+  EXPECT_EQ(Mmap::MaybeAdvise(mmap->data(), mmap->size(), Mmap::WILLNEED), -1);
+#else   // _WIN32
+  // Unaligned sub-regions are accepted as well.
+  EXPECT_EQ(Mmap::MaybeAdvise(mmap->data(), mmap->size(), Mmap::WILLNEED), 0);
+  EXPECT_EQ(Mmap::MaybeAdvise(mmap->data() + 5000, 100, Mmap::RANDOM), 0);
+  EXPECT_EQ(Mmap::MaybeAdvise(mmap->data() + 1, 1, Mmap::NORMAL), 0);
+#endif  // _WIN32
+  EXPECT_EQ(Mmap::MaybeAdvise(nullptr, 0, Mmap::NORMAL), -1);
+
+  // Advice must not change the contents.
+  EXPECT_EQ(mmap->span(), data);
+}
+
 class MmapEntireFileTest : public ::testing::TestWithParam<size_t> {};
 
 TEST_P(MmapEntireFileTest, Read) {
@@ -192,6 +222,27 @@ TEST_P(MmapEntireFileTest, Write) {
   EXPECT_EQ(*contents, absl::string_view(data.data(), data.size()));
 }
 
+TEST_P(MmapEntireFileTest, Flush) {
+  const size_t filesize = GetParam();
+  const absl::StatusOr<TempFile> temp_file =
+      TempDirectory::Default().CreateTempFile();
+  ASSERT_OK(temp_file);
+  ASSERT_OK(
+      FileUtil::SetContents(temp_file->path(), std::string(filesize, 'a')));
+
+  const std::vector<char> data = GetRandomContents(filesize);
+  absl::StatusOr<Mmap> mmap = Mmap::Map(temp_file->path(), Mmap::READ_WRITE);
+  ASSERT_OK(mmap);
+  absl::c_copy(data, mmap->begin());
+  EXPECT_OK(mmap->Flush());
+
+  // The contents are visible through the file before unmapping.
+  absl::StatusOr<std::string> contents =
+      FileUtil::GetContents(temp_file->path());
+  ASSERT_OK(contents);
+  EXPECT_EQ(*contents, absl::string_view(data.data(), data.size()));
+}
+
 INSTANTIATE_TEST_SUITE_P(MmapTestSuite, MmapEntireFileTest,
                          ::testing::Values(1, 8, 1024, 4096, 7777, 8192));
 
@@ -0,0 +1,84 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/startup_profiler.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/no_destructor.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/log/log.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+struct ProfileData {
+  absl::Mutex mutex;
+  std::vector<StartupProfiler::Phase> phases ABSL_GUARDED_BY(mutex);
+};
+
+ProfileData &GetProfileData() {
+  static absl::NoDestructor<ProfileData> data;
+  return *data;
+}
+
+}  // namespace
+
+void StartupProfiler::Record(absl::string_view name, absl::Duration duration) {
+  ProfileData &data = GetProfileData();
+  {
+    absl::MutexLock lock(&data.mutex);
+    if (absl::c_any_of(data.phases, [name](const Phase &phase) {
+          return phase.name == name;
+        })) {
+      return;
+    }
+    data.phases.push_back(Phase{std::string(name), duration});
+  }
+  LOG(INFO) << "Startup phase " << name << " took " << duration;
+}
+
+std::vector<StartupProfiler::Phase> StartupProfiler::GetPhases() {
+  ProfileData &data = GetProfileData();
+  absl::MutexLock lock(&data.mutex);
+  return data.phases;
+}
+
+void StartupProfiler::ResetForTesting() {
+  ProfileData &data = GetProfileData();
+  absl::MutexLock lock(&data.mutex);
+  data.phases.clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,86 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_BASE_STARTUP_PROFILER_H_
+#define MOZC_BASE_STARTUP_PROFILER_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/stopwatch.h"
+
+namespace mozc {
+
+// Process-wide trace of the server startup phases, e.g., building the engine
+// modules or loading the user history. Each phase is logged when it finishes
+// and can be read back through the GET_STARTUP_PROFILE session command.
+//
+// Only the first record of each phase is kept so that later reloads of the
+// same component don't overwrite the startup numbers. All the methods are
+// thread-safe; some phases finish on background loader threads.
+class StartupProfiler {
+ public:
+  struct Phase {
+    std::string name;
+    absl::Duration duration;
+  };
+
+  // Measures the lifetime of the instance as the phase |name|.
+  class ScopedPhase {
+   public:
+    explicit ScopedPhase(absl::string_view name)
+        : name_(name), stopwatch_(Stopwatch::StartNew()) {}
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+    ~ScopedPhase() { Record(name_, stopwatch_.GetElapsed()); }
+
+   private:
+    const std::string name_;
+    const Stopwatch stopwatch_;
+  };
+
+  StartupProfiler() = delete;
+
+  // Records |duration| for the phase |name|. Does nothing if the phase has
+  // already been recorded.
+  static void Record(absl::string_view name, absl::Duration duration);
+
+  // Returns the recorded phases in the order they finished.
+  static std::vector<Phase> GetPhases();
+
+  static void ResetForTesting();
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_STARTUP_PROFILER_H_
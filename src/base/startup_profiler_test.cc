@@ -0,0 +1,99 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "base/startup_profiler.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "base/clock.h"
+#include "base/clock_mock.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Field;
+
+class StartupProfilerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock_mock_ = std::make_unique<ClockMock>(absl::UnixEpoch());
+    Clock::SetClockForUnitTest(clock_mock_.get());
+    StartupProfiler::ResetForTesting();
+  }
+
+  void TearDown() override {
+    StartupProfiler::ResetForTesting();
+    Clock::SetClockForUnitTest(nullptr);
+  }
+
+  std::unique_ptr<ClockMock> clock_mock_;
+};
+
+TEST_F(StartupProfilerTest, ScopedPhase) {
+  {
+    StartupProfiler::ScopedPhase outer("outer");
+    {
+      StartupProfiler::ScopedPhase inner("inner");
+      clock_mock_->Advance(absl::Milliseconds(30));
+    }
+    clock_mock_->Advance(absl::Milliseconds(20));
+  }
+
+  const std::vector<StartupProfiler::Phase> phases =
+      StartupProfiler::GetPhases();
+  ASSERT_EQ(phases.size(), 2);
+  // Phases are ordered by completion.
+  EXPECT_EQ(phases[0].name, "inner");
+  EXPECT_EQ(phases[0].duration, absl::Milliseconds(30));
+  EXPECT_EQ(phases[1].name, "outer");
+  EXPECT_EQ(phases[1].duration, absl::Milliseconds(50));
+}
+
+TEST_F(StartupProfilerTest, KeepsFirstRecord) {
+  StartupProfiler::Record("load", absl::Seconds(1));
+  StartupProfiler::Record("init", absl::Seconds(2));
+  // A reload doesn't overwrite the startup number.
+  StartupProfiler::Record("load", absl::Seconds(3));
+
+  EXPECT_THAT(
+      StartupProfiler::GetPhases(),
+      ElementsAre(Field(&StartupProfiler::Phase::duration, absl::Seconds(1)),
+                  Field(&StartupProfiler::Phase::duration, absl::Seconds(2))));
+
+  StartupProfiler::ResetForTesting();
+  EXPECT_TRUE(StartupProfiler::GetPhases().empty());
+}
+
+}  // namespace
+}  // namespace mozc
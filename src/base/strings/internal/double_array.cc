@@ -31,12 +31,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/strings/internal/utf8_internal.h"
 #include "base/strings/unicode.h"
 
@@ -86,26 +88,128 @@ inline int AdvanceInputBy(const char *ctable, const LookupResult result,
   return result.seekto - ctable[result.index + len + 1];
 }
 
+// Converts the character at `input[pos]` and appends the result to
+// `output`. Returns the number of bytes to advance.
+int ConvertOneUsingDoubleArray(const DoubleArray *da, const char *ctable,
+                               const absl::string_view input, const size_t pos,
+                               std::string *output) {
+  const LookupResult result = LookupDoubleArray(da, input.substr(pos));
+  if (result.seekto > 0) {
+    // Each entry in ctable consists of:
+    // - null-terminated string
+    // - one byte offset to rewind the input
+    const absl::string_view s(ctable + result.index);
+    absl::StrAppend(output, s);
+    return AdvanceInputBy(ctable, result, s.size());
+  }
+  // Not found in the table. Copy from input.
+  const int mblen = OneCharLen(input[pos]);
+  absl::StrAppend(output, input.substr(pos, mblen));
+  return mblen;
+}
+
+// Returns the length of the leading ASCII characters in `str`, checking eight
+// bytes at a time.
+size_t AsciiPrefixLength(const absl::string_view str) {
+  constexpr uint64_t kHighBits = 0x8080808080808080;
+  size_t i = 0;
+  for (uint64_t chunk; i + sizeof(chunk) <= str.size(); i += sizeof(chunk)) {
+    std::memcpy(&chunk, str.data() + i, sizeof(chunk));
+    if ((chunk & kHighBits) != 0) {
+      break;
+    }
+  }
+  while (i < str.size() && static_cast<uint8_t>(str[i]) < 0x80) {
+    ++i;
+  }
+  return i;
+}
+
+// Decodes the character at `ptr` if it is encoded in one or three bytes,
+// which covers all the offset ranges. Returns 0 with `*len` = 0 otherwise.
+inline char32_t DecodeShortChar(const char *ptr, const char *last,
+                                int *len) {
+  const uint8_t b0 = static_cast<uint8_t>(ptr[0]);
+  if (b0 < 0x80) {
+    *len = 1;
+    return b0;
+  }
+  *len = 0;
+  if ((b0 & 0xF0) != 0xE0 || last - ptr < 3) {
+    return 0;
+  }
+  const uint8_t b1 = static_cast<uint8_t>(ptr[1]);
+  const uint8_t b2 = static_cast<uint8_t>(ptr[2]);
+  if ((b1 & 0xC0) != 0x80 || (b2 & 0xC0) != 0x80) {
+    return 0;
+  }
+  const char32_t cp = ((b0 & 0x0F) << 12) | ((b1 & 0x3F) << 6) | (b2 & 0x3F);
+  // Rejects overlong forms. Surrogates are not in any range.
+  if (cp < 0x800) {
+    return 0;
+  }
+  *len = 3;
+  return cp;
+}
+
+inline void AppendChar(const char32_t cp, std::string *output) {
+  if (cp < 0x80) {
+    output->push_back(static_cast<char>(cp));
+  } else if (cp >= 0x800 && cp < 0x10000) {
+    const char bytes[] = {static_cast<char>(0xE0 | (cp >> 12)),
+                          static_cast<char>(0x80 | ((cp >> 6) & 0x3F)),
+                          static_cast<char>(0x80 | (cp & 0x3F))};
+    output->append(bytes, sizeof(bytes));
+  } else {
+    strings::StrAppendChar32(output, cp);
+  }
+}
+
+const OffsetRange *FindOffsetRange(const absl::Span<const OffsetRange> ranges,
+                                   const char32_t codepoint) {
+  for (const OffsetRange &range : ranges) {
+    if (range.first <= codepoint && codepoint <= range.last) {
+      return &range;
+    }
+  }
+  return nullptr;
+}
+
 }  // namespace
 
 std::string ConvertUsingDoubleArray(const DoubleArray *da, const char *ctable,
                                     const absl::string_view input) {
-  int mblen = 0;
   std::string output;
-  for (size_t i = 0; i < input.size(); i += mblen) {
-    const LookupResult result = LookupDoubleArray(da, input.substr(i));
-    if (result.seekto > 0) {
-      // Each entry in ctable consists of:
-      // - null-terminated string
-      // - one byte offset to rewind the input
-      const absl::string_view s(ctable + result.index);
-      absl::StrAppend(&output, s);
-      mblen = AdvanceInputBy(ctable, result, s.size());
-    } else {
-      // Not found in the table. Copy from input.
-      mblen = OneCharLen(input[i]);
-      absl::StrAppend(&output, input.substr(i, mblen));
+  for (size_t i = 0; i < input.size();) {
+    i += ConvertOneUsingDoubleArray(da, ctable, input, i, &output);
+  }
+  return output;
+}
+
+std::string ConvertUsingOffsetsAndDoubleArray(
+    const absl::Span<const OffsetRange> ranges, const bool keep_ascii,
+    const DoubleArray *da, const char *ctable, const absl::string_view input) {
+  std::string output;
+  output.reserve(input.size());
+  const char *const last = input.data() + input.size();
+  for (size_t i = 0; i < input.size();) {
+    if (keep_ascii && static_cast<uint8_t>(input[i]) < 0x80) {
+      const size_t len = AsciiPrefixLength(input.substr(i));
+      output.append(input.data() + i, len);
+      i += len;
+      continue;
+    }
+    int len = 0;
+    const char32_t cp = DecodeShortChar(input.data() + i, last, &len);
+    if (len > 0) {
+      if (const OffsetRange *range = FindOffsetRange(ranges, cp);
+          range != nullptr) {
+        AppendChar(cp + range->offset, &output);
+        i += len;
+        continue;
+      }
     }
+    i += ConvertOneUsingDoubleArray(da, ctable, input, i, &output);
   }
   return output;
 }
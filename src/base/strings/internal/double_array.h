@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc::japanese::internal {
 
@@ -47,6 +48,26 @@ struct DoubleArray {
 std::string ConvertUsingDoubleArray(const DoubleArray *da, const char *table,
                                     absl::string_view input);
 
+// Characters in [first, last] that are converted to the code point plus
+// `offset`.
+struct OffsetRange {
+  char32_t first;
+  char32_t last;
+  int32_t offset;
+};
+
+// Same as ConvertUsingDoubleArray(), but converts the characters in `ranges`
+// by their offsets without looking up `da`. If `keep_ascii` is true, runs of
+// ASCII characters are also copied as they are.
+//
+// REQUIRES: Each character in `ranges` is encoded in one or three bytes, is a
+// key of `da`, is converted to the code point plus the offset, and is not a
+// prefix of any other key. No key
+// starts with an ASCII character if `keep_ascii` is true.
+std::string ConvertUsingOffsetsAndDoubleArray(
+    absl::Span<const OffsetRange> ranges, bool keep_ascii,
+    const DoubleArray *da, const char *table, absl::string_view input);
+
 std::vector<std::pair<absl::string_view, absl::string_view>>
 AlignUsingDoubleArray(const DoubleArray *da, const char *ctable,
                       absl::string_view input);
@@ -34,16 +34,55 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/strings/internal/double_array.h"
 #include "base/strings/internal/japanese_rules.h"
 
 namespace mozc::japanese {
 
 using ::mozc::japanese::internal::ConvertUsingDoubleArray;
+using ::mozc::japanese::internal::ConvertUsingOffsetsAndDoubleArray;
+using ::mozc::japanese::internal::OffsetRange;
+
+namespace {
+
+// Characters converted by a fixed offset in data/preedit/*.tsv. Characters
+// that start a longer rule, such as "う" of "う゛", are left to the double
+// array.
+constexpr OffsetRange kHiraganaToKatakanaRanges[] = {
+    {U'ぁ', U'ぅ', 0x60},  // U+3046 "う" is followed by "゛" in a rule.
+    {U'ぇ', U'ゔ', 0x60},
+};
+
+constexpr OffsetRange kKatakanaToHiraganaRanges[] = {
+    {U'ァ', U'ヴ', -0x60},
+};
+
+// " ' - \ ~ and the space are converted to other characters.
+constexpr OffsetRange kHalfWidthAsciiToFullWidthAsciiRanges[] = {
+    {U'!', U'!', 0xFEE0},
+    {U'#', U'&', 0xFEE0},
+    {U'(', U',', 0xFEE0},
+    {U'.', U'[', 0xFEE0},
+    {U']', U'}', 0xFEE0},
+};
+
+// ＂ ＇ － ＼ ～ are not converted.
+constexpr OffsetRange kFullWidthAsciiToHalfWidthAsciiRanges[] = {
+    {U'！', U'！', -0xFEE0},
+    {U'＃', U'＆', -0xFEE0},
+    {U'（', U'，', -0xFEE0},
+    {U'．', U'［', -0xFEE0},
+    {U'］', U'｝', -0xFEE0},
+};
+
+}  // namespace
 
 std::string HiraganaToKatakana(const absl::string_view input) {
-  return ConvertUsingDoubleArray(internal::hiragana_to_katakana_da,
-                                 internal::hiragana_to_katakana_table, input);
+  return ConvertUsingOffsetsAndDoubleArray(
+      kHiraganaToKatakanaRanges, /*keep_ascii=*/true,
+      internal::hiragana_to_katakana_da, internal::hiragana_to_katakana_table,
+      input);
 }
 
 std::string HiraganaToHalfwidthKatakana(const absl::string_view input) {
@@ -57,13 +96,15 @@ std::string HiraganaToRomanji(const absl::string_view input) {
 }
 
 std::string HalfWidthAsciiToFullWidthAscii(const absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingOffsetsAndDoubleArray(
+      kHalfWidthAsciiToFullWidthAsciiRanges, /*keep_ascii=*/false,
       internal::halfwidthascii_to_fullwidthascii_da,
       internal::halfwidthascii_to_fullwidthascii_table, input);
 }
 
 std::string FullWidthAsciiToHalfWidthAscii(const absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingOffsetsAndDoubleArray(
+      kFullWidthAsciiToHalfWidthAsciiRanges, /*keep_ascii=*/true,
       internal::fullwidthascii_to_halfwidthascii_da,
       internal::fullwidthascii_to_halfwidthascii_table, input);
 }
@@ -78,18 +119,24 @@ std::string RomanjiToHiragana(const absl::string_view input) {
 }
 
 std::string KatakanaToHiragana(absl::string_view input) {
-  return ConvertUsingDoubleArray(internal::katakana_to_hiragana_da,
-                                 internal::katakana_to_hiragana_table, input);
+  return ConvertUsingOffsetsAndDoubleArray(
+      kKatakanaToHiraganaRanges, /*keep_ascii=*/true,
+      internal::katakana_to_hiragana_da, internal::katakana_to_hiragana_table,
+      input);
 }
 
+// Half-width katakana with voiced sound marks are irregular, so only ASCII is
+// copied without the double array.
 std::string HalfWidthKatakanaToFullWidthKatakana(absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingOffsetsAndDoubleArray(
+      {}, /*keep_ascii=*/true,
       internal::halfwidthkatakana_to_fullwidthkatakana_da,
       internal::halfwidthkatakana_to_fullwidthkatakana_table, input);
 }
 
 std::string FullWidthKatakanaToHalfWidthKatakana(absl::string_view input) {
-  return ConvertUsingDoubleArray(
+  return ConvertUsingOffsetsAndDoubleArray(
+      {}, /*keep_ascii=*/true,
       internal::fullwidthkatakana_to_halfwidthkatakana_da,
       internal::fullwidthkatakana_to_halfwidthkatakana_table, input);
 }
@@ -108,8 +155,9 @@ std::string HalfWidthToFullWidth(const absl::string_view input) {
 // of some UNICODE only characters (required to display
 // and commit for old clients)
 std::string NormalizeVoicedSoundMark(const absl::string_view input) {
-  return ConvertUsingDoubleArray(internal::normalize_voiced_sound_da,
-                                 internal::normalize_voiced_sound_table, input);
+  return ConvertUsingOffsetsAndDoubleArray(
+      {}, /*keep_ascii=*/true, internal::normalize_voiced_sound_da,
+      internal::normalize_voiced_sound_table, input);
 }
 
 std::vector<std::pair<absl::string_view, absl::string_view>>
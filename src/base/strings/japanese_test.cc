@@ -29,11 +29,16 @@
 
 #include "base/strings/japanese.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "base/strings/internal/double_array.h"
+#include "base/strings/internal/japanese_rules.h"
+#include "base/strings/unicode.h"
 #include "testing/gunit.h"
 
 namespace mozc::japanese {
@@ -206,5 +211,94 @@ TEST(JapaneseUtilTest, AlignTest) {
             AlignRomanjiToHiragana("resipinokalzenn"));
 }
 
+struct ConverterAndRule {
+  const char *name;
+  std::string (*convert)(absl::string_view);
+  const internal::DoubleArray *da;
+  const char *table;
+};
+
+// Converters with fast paths and the rules they must be identical to.
+constexpr ConverterAndRule kConvertersWithFastPaths[] = {
+    {"HiraganaToKatakana", HiraganaToKatakana,
+     internal::hiragana_to_katakana_da, internal::hiragana_to_katakana_table},
+    {"KatakanaToHiragana", KatakanaToHiragana,
+     internal::katakana_to_hiragana_da, internal::katakana_to_hiragana_table},
+    {"HalfWidthAsciiToFullWidthAscii", HalfWidthAsciiToFullWidthAscii,
+     internal::halfwidthascii_to_fullwidthascii_da,
+     internal::halfwidthascii_to_fullwidthascii_table},
+    {"FullWidthAsciiToHalfWidthAscii", FullWidthAsciiToHalfWidthAscii,
+     internal::fullwidthascii_to_halfwidthascii_da,
+     internal::fullwidthascii_to_halfwidthascii_table},
+    {"HalfWidthKatakanaToFullWidthKatakana",
+     HalfWidthKatakanaToFullWidthKatakana,
+     internal::halfwidthkatakana_to_fullwidthkatakana_da,
+     internal::halfwidthkatakana_to_fullwidthkatakana_table},
+    {"FullWidthKatakanaToHalfWidthKatakana",
+     FullWidthKatakanaToHalfWidthKatakana,
+     internal::fullwidthkatakana_to_halfwidthkatakana_da,
+     internal::fullwidthkatakana_to_halfwidthkatakana_table},
+    {"NormalizeVoicedSoundMark", NormalizeVoicedSoundMark,
+     internal::normalize_voiced_sound_da,
+     internal::normalize_voiced_sound_table},
+};
+
+TEST(JapaneseUtilTest, FastPathsMatchDoubleArrayForEachCharacter) {
+  // Each character alone and followed by voiced sound marks, which some rules
+  // combine with the preceding character.
+  constexpr absl::string_view kSuffixes[] = {"", "゛", "゜", "ﾞ", "ﾟ", "a"};
+  for (const ConverterAndRule &converter : kConvertersWithFastPaths) {
+    SCOPED_TRACE(converter.name);
+    for (char32_t c = 0; c < 0x10000; ++c) {
+      for (const absl::string_view suffix : kSuffixes) {
+        const std::string input = strings::Char32ToUtf8(c) + std::string(suffix);
+        ASSERT_EQ(converter.convert(input),
+                  internal::ConvertUsingDoubleArray(converter.da,
+                                                    converter.table, input))
+            << static_cast<uint32_t>(c);
+      }
+    }
+  }
+}
+
+TEST(JapaneseUtilTest, FastPathsMatchDoubleArrayForRandomStrings) {
+  absl::BitGen gen;
+  // Picks characters around the converted ranges, and sometimes broken
+  // UTF-8 sequences.
+  const auto random_char = [&gen]() -> std::string {
+    switch (absl::Uniform(gen, 0, 8)) {
+      case 0:
+        return std::string(1, absl::Uniform<char>(gen, 0, 0x80));
+      case 1:
+        return std::string(1, absl::Uniform<uint8_t>(gen, 0x80, 0xFF));
+      case 2:
+        return std::string("\xE3\x81");
+      case 3:
+        return strings::Char32ToUtf8(absl::Uniform<char32_t>(gen, 0x3000, 0x3100));
+      case 4:
+        return strings::Char32ToUtf8(absl::Uniform<char32_t>(gen, 0xFF00, 0xFFF0));
+      case 5:
+        return strings::Char32ToUtf8(absl::Uniform<char32_t>(gen, 0x2010, 0x2220));
+      case 6:
+        return "ー";
+      default:
+        return strings::Char32ToUtf8(absl::Uniform<char32_t>(gen, 0x4E00, 0x4E10));
+    }
+  };
+  for (int i = 0; i < 10000; ++i) {
+    std::string input;
+    const int size = absl::Uniform(gen, 0, 32);
+    for (int j = 0; j < size; ++j) {
+      input += random_char();
+    }
+    for (const ConverterAndRule &converter : kConvertersWithFastPaths) {
+      ASSERT_EQ(converter.convert(input),
+                internal::ConvertUsingDoubleArray(converter.da,
+                                                  converter.table, input))
+          << converter.name << ": " << input;
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mozc::japanese
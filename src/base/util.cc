@@ -806,34 +806,30 @@ bool Util::IsEnglishTransliteration(absl::string_view value) {
   return true;
 }
 
-#define INRANGE(w, a, b) ((w) >= (a) && (w) <= (b))
+namespace {
+
+// Character classes of GetScriptType() and GetFormType() are looked up from a
+// two-level table generated at compile time from the ranges below. The first
+// level maps each block of 128 code points to a block of the second level,
+// and blocks with the same contents share one entry. Each entry packs the
+// ScriptType into the low nibble and the FormType into the high nibble.
+struct CharRange {
+  char32_t first;
+  char32_t last;
+  uint8_t value;
+};
 
 // script type
 // TODO(yukawa, team): Make a mechanism to keep this classifier up-to-date
 //   based on the original data from Unicode.org.
-Util::ScriptType Util::GetScriptType(char32_t codepoint) {
-  if (INRANGE(codepoint, 0x0030, 0x0039) ||  // ascii number
-      INRANGE(codepoint, 0xFF10, 0xFF19)) {  // full width number
-    return NUMBER;
-  } else if (INRANGE(codepoint, 0x0041, 0x005A) ||  // ascii upper
-             INRANGE(codepoint, 0x0061, 0x007A) ||  // ascii lower
-             INRANGE(codepoint, 0xFF21, 0xFF3A) ||  // fullwidth ascii upper
-             INRANGE(codepoint, 0xFF41, 0xFF5A)) {  // fullwidth ascii lower
-    return ALPHABET;
-  } else if (codepoint == 0x3005 ||  // IDEOGRAPHIC ITERATION MARK "々"
-             INRANGE(codepoint, 0x3400,
-                     0x4DBF) ||  // CJK Unified Ideographs Extension A
-             INRANGE(codepoint, 0x4E00, 0x9FFF) ||  // CJK Unified Ideographs
-             INRANGE(codepoint, 0xF900,
-                     0xFAFF) ||  // CJK Compatibility Ideographs
-             INRANGE(codepoint, 0x20000,
-                     0x2A6DF) ||  // CJK Unified Ideographs Extension B
-             INRANGE(codepoint, 0x2A700,
-                     0x2B73F) ||  // CJK Unified Ideographs Extension C
-             INRANGE(codepoint, 0x2B740,
-                     0x2B81F) ||  // CJK Unified Ideographs Extension D
-             INRANGE(codepoint, 0x2F800,
-                     0x2FA1F)) {  // CJK Compatibility Ideographs
+// The first matching range wins.
+constexpr CharRange kScriptRanges[] = {
+    {0x0030, 0x0039, Util::NUMBER},    // ascii number
+    {0xFF10, 0xFF19, Util::NUMBER},    // full width number
+    {0x0041, 0x005A, Util::ALPHABET},  // ascii upper
+    {0x0061, 0x007A, Util::ALPHABET},  // ascii lower
+    {0xFF21, 0xFF3A, Util::ALPHABET},  // fullwidth ascii upper
+    {0xFF41, 0xFF5A, Util::ALPHABET},  // fullwidth ascii lower
     // As of Unicode 6.0.2, each block has the following characters assigned.
     // [U+3400, U+4DB5]:   CJK Unified Ideographs Extension A
     // [U+4E00, U+9FCB]:   CJK Unified Ideographs
@@ -842,80 +838,180 @@ Util::ScriptType Util::GetScriptType(char32_t codepoint) {
     // [U+2A700, U+2B734]: CJK Unified Ideographs Extension C
     // [U+2B740, U+2B81D]: CJK Unified Ideographs Extension D
     // [U+2F800, U+2FA1D]: CJK Compatibility Ideographs
-    return KANJI;
-  } else if (INRANGE(codepoint, 0x3041, 0x309F) ||  // hiragana
-             codepoint == 0x1B001) {  // HIRAGANA LETTER ARCHAIC YE
-    return HIRAGANA;
-  } else if (INRANGE(codepoint, 0x30A1, 0x30FF) ||  // full width katakana
-             INRANGE(codepoint, 0x31F0,
-                     0x31FF) ||  // Katakana Phonetic Extensions for Ainu
-             INRANGE(codepoint, 0xFF65, 0xFF9F) ||  // half width katakana
-             codepoint == 0x1B000) {                // KATAKANA LETTER ARCHAIC E
-    return KATAKANA;
-  } else if (INRANGE(codepoint, 0x02300, 0x023F3) ||  // Miscellaneous Technical
-             INRANGE(codepoint, 0x02700, 0x027BF) ||  // Dingbats
-             INRANGE(codepoint, 0x1F000, 0x1F02F) ||  // Mahjong tiles
-             INRANGE(codepoint, 0x1F030, 0x1F09F) ||  // Domino tiles
-             INRANGE(codepoint, 0x1F0A0, 0x1F0FF) ||  // Playing cards
-             INRANGE(codepoint, 0x1F100,
-                     0x1F2FF) ||  // Enclosed Alphanumeric Supplement
-             INRANGE(codepoint, 0x1F200,
-                     0x1F2FF) ||  // Enclosed Ideographic Supplement
-             INRANGE(codepoint, 0x1F300,
-                     0x1F5FF) ||  // Miscellaneous Symbols And Pictographs
-             INRANGE(codepoint, 0x1F600, 0x1F64F) ||  // Emoticons
-             INRANGE(codepoint, 0x1F680,
-                     0x1F6FF) ||  // Transport And Map Symbols
-             INRANGE(codepoint, 0x1F700, 0x1F77F) ||  // Alchemical Symbols
-             codepoint == 0x26CE) {                   // Ophiuchus
-    return EMOJI;
-  }
-
-  return UNKNOWN_SCRIPT;
+    {0x3005, 0x3005, Util::KANJI},    // IDEOGRAPHIC ITERATION MARK "々"
+    {0x3400, 0x4DBF, Util::KANJI},    // CJK Unified Ideographs Extension A
+    {0x4E00, 0x9FFF, Util::KANJI},    // CJK Unified Ideographs
+    {0xF900, 0xFAFF, Util::KANJI},    // CJK Compatibility Ideographs
+    {0x20000, 0x2A6DF, Util::KANJI},  // CJK Unified Ideographs Extension B
+    {0x2A700, 0x2B73F, Util::KANJI},  // CJK Unified Ideographs Extension C
+    {0x2B740, 0x2B81F, Util::KANJI},  // CJK Unified Ideographs Extension D
+    {0x2F800, 0x2FA1F, Util::KANJI},  // CJK Compatibility Ideographs
+    {0x3041, 0x309F, Util::HIRAGANA},    // hiragana
+    {0x1B001, 0x1B001, Util::HIRAGANA},  // HIRAGANA LETTER ARCHAIC YE
+    {0x30A1, 0x30FF, Util::KATAKANA},    // full width katakana
+    {0x31F0, 0x31FF, Util::KATAKANA},  // Katakana Phonetic Extensions for Ainu
+    {0xFF65, 0xFF9F, Util::KATAKANA},    // half width katakana
+    {0x1B000, 0x1B000, Util::KATAKANA},  // KATAKANA LETTER ARCHAIC E
+    {0x02300, 0x023F3, Util::EMOJI},  // Miscellaneous Technical
+    {0x02700, 0x027BF, Util::EMOJI},  // Dingbats
+    {0x1F000, 0x1F02F, Util::EMOJI},  // Mahjong tiles
+    {0x1F030, 0x1F09F, Util::EMOJI},  // Domino tiles
+    {0x1F0A0, 0x1F0FF, Util::EMOJI},  // Playing cards
+    {0x1F100, 0x1F2FF, Util::EMOJI},  // Enclosed Alphanumeric Supplement
+    {0x1F200, 0x1F2FF, Util::EMOJI},  // Enclosed Ideographic Supplement
+    {0x1F300, 0x1F5FF, Util::EMOJI},  // Miscellaneous Symbols And Pictographs
+    {0x1F600, 0x1F64F, Util::EMOJI},  // Emoticons
+    {0x1F680, 0x1F6FF, Util::EMOJI},  // Transport And Map Symbols
+    {0x1F700, 0x1F77F, Util::EMOJI},  // Alchemical Symbols
+    {0x026CE, 0x026CE, Util::EMOJI},  // Ophiuchus
+};
+
+// 'Unicode Standard Annex #11: EAST ASIAN WIDTH'
+// http://www.unicode.org/reports/tr11/
+// Characters marked as 'Na' and 'H' in
+// http://www.unicode.org/Public/UNIDATA/EastAsianWidth.txt
+// Any other characters are FULL_WIDTH.
+constexpr CharRange kHalfWidthRanges[] = {
+    // 'Na'
+    {0x0020, 0x007F, Util::HALF_WIDTH},  // ascii
+    {0x27E6, 0x27ED, Util::HALF_WIDTH},  // narrow mathematical symbols
+    {0x2985, 0x2986, Util::HALF_WIDTH},  // narrow white parentheses
+    {0x00A2, 0x00A3, Util::HALF_WIDTH},  // CENT SIGN, POUND SIGN
+    {0x00A5, 0x00A6, Util::HALF_WIDTH},  // YEN SIGN, BROKEN BAR
+    {0x00AC, 0x00AC, Util::HALF_WIDTH},  // NOT SIGN
+    {0x00AF, 0x00AF, Util::HALF_WIDTH},  // MACRON
+    // 'H'
+    {0x20A9, 0x20A9, Util::HALF_WIDTH},  // WON SIGN
+    {0xFF61, 0xFF9F, Util::HALF_WIDTH},  // half-width katakana
+    {0xFFA0, 0xFFBE, Util::HALF_WIDTH},  // half-width hangul
+    {0xFFC2, 0xFFCF, Util::HALF_WIDTH},  // half-width hangul
+    {0xFFD2, 0xFFD7, Util::HALF_WIDTH},  // half-width hangul
+    {0xFFDA, 0xFFDC, Util::HALF_WIDTH},  // half-width hangul
+    {0xFFE8, 0xFFEE, Util::HALF_WIDTH},  // half-width symbols
+};
+
+constexpr int kCharClassBlockBits = 7;
+constexpr char32_t kCharClassBlockSize = 1 << kCharClassBlockBits;
+// All the code points at or above this are UNKNOWN_SCRIPT and FULL_WIDTH.
+constexpr char32_t kCharClassTableEnd = 0x30000;
+constexpr size_t kNumCharClassBlocks =
+    kCharClassTableEnd >> kCharClassBlockBits;
+constexpr uint8_t kDefaultCharClass = Util::UNKNOWN_SCRIPT |
+                                      (Util::FULL_WIDTH << 4);
+
+using CharClassBlock = std::array<uint8_t, kCharClassBlockSize>;
+
+template <size_t NumBlocks>
+struct CharClassTable {
+  std::array<uint8_t, kNumCharClassBlocks> index = {};
+  std::array<CharClassBlock, NumBlocks> blocks = {};
+  size_t num_blocks = 0;
+};
+
+// Paints `ranges` over `block`, which starts at `start`. `mask` selects the
+// nibble of the entries to update.
+template <size_t N>
+constexpr void PaintCharRanges(const CharRange (&ranges)[N], uint8_t mask,
+                               int shift, char32_t start,
+                               CharClassBlock &block) {
+  // Iterates in reverse order so that the first matching range wins.
+  for (size_t i = N; i > 0; --i) {
+    const CharRange &range = ranges[i - 1];
+    const char32_t end = start + kCharClassBlockSize - 1;
+    if (range.last < start || range.first > end) {
+      continue;
+    }
+    const char32_t first = std::max(range.first, start);
+    const char32_t last = std::min(range.last, end);
+    for (char32_t c = first; c <= last; ++c) {
+      uint8_t &entry = block[c - start];
+      entry = (entry & ~mask) | (range.value << shift);
+    }
+  }
 }
 
-Util::FormType Util::GetFormType(char32_t codepoint) {
-  // 'Unicode Standard Annex #11: EAST ASIAN WIDTH'
-  // http://www.unicode.org/reports/tr11/
-
-  // Characters marked as 'Na' in
-  // http://www.unicode.org/Public/UNIDATA/EastAsianWidth.txt
-  if (INRANGE(codepoint, 0x0020, 0x007F) ||  // ascii
-      INRANGE(codepoint, 0x27E6, 0x27ED) ||  // narrow mathematical symbols
-      INRANGE(codepoint, 0x2985, 0x2986)) {  // narrow white parentheses
-    return HALF_WIDTH;
-  }
-
-  // Other characters marked as 'Na' in
-  // http://www.unicode.org/Public/UNIDATA/EastAsianWidth.txt
-  if (INRANGE(codepoint, 0x00A2, 0x00AF)) {
-    switch (codepoint) {
-      case 0x00A2:  // CENT SIGN
-      case 0x00A3:  // POUND SIGN
-      case 0x00A5:  // YEN SIGN
-      case 0x00A6:  // BROKEN BAR
-      case 0x00AC:  // NOT SIGN
-      case 0x00AF:  // MACRON
-        return HALF_WIDTH;
+// Marks the blocks where `ranges` start or end.
+template <size_t N>
+constexpr void MarkCharRangeBoundaries(
+    const CharRange (&ranges)[N],
+    std::array<bool, kNumCharClassBlocks> &boundary) {
+  for (const CharRange &range : ranges) {
+    boundary[range.first >> kCharClassBlockBits] = true;
+    if (range.last + 1 < kCharClassTableEnd) {
+      boundary[(range.last + 1) >> kCharClassBlockBits] = true;
     }
   }
+}
 
-  // Characters marked as 'H' in
-  // http://www.unicode.org/Public/UNIDATA/EastAsianWidth.txt
-  if (codepoint == 0x20A9 ||                 // WON SIGN
-      INRANGE(codepoint, 0xFF61, 0xFF9F) ||  // half-width katakana
-      INRANGE(codepoint, 0xFFA0, 0xFFBE) ||  // half-width hangul
-      INRANGE(codepoint, 0xFFC2, 0xFFCF) ||  // half-width hangul
-      INRANGE(codepoint, 0xFFD2, 0xFFD7) ||  // half-width hangul
-      INRANGE(codepoint, 0xFFDA, 0xFFDC) ||  // half-width hangul
-      INRANGE(codepoint, 0xFFE8, 0xFFEE)) {  // half-width symbols
-    return HALF_WIDTH;
+// Builds the table. Only the blocks containing a range boundary are painted;
+// the others are filled with the last entry of the previous block. Blocks
+// with a single value are shared.
+template <size_t NumBlocks>
+constexpr CharClassTable<NumBlocks> BuildCharClassTable() {
+  std::array<bool, kNumCharClassBlocks> boundary = {};
+  MarkCharRangeBoundaries(kScriptRanges, boundary);
+  MarkCharRangeBoundaries(kHalfWidthRanges, boundary);
+
+  CharClassTable<NumBlocks> table;
+  // Index of the block filled with each value, or -1.
+  std::array<int, 256> uniform_blocks = {};
+  uniform_blocks.fill(-1);
+  uint8_t last_value = kDefaultCharClass;
+  for (size_t i = 0; i < kNumCharClassBlocks; ++i) {
+    bool uniform = true;
+    CharClassBlock block = {};
+    if (boundary[i]) {
+      const char32_t start = i << kCharClassBlockBits;
+      block.fill(kDefaultCharClass);
+      PaintCharRanges(kScriptRanges, 0x0F, 0, start, block);
+      PaintCharRanges(kHalfWidthRanges, 0xF0, 4, start, block);
+      for (const uint8_t value : block) {
+        uniform = uniform && value == block[0];
+      }
+      last_value = block[kCharClassBlockSize - 1];
+    }
+
+    if (uniform && uniform_blocks[last_value] >= 0) {
+      table.index[i] = uniform_blocks[last_value];
+      continue;
+    }
+    if (uniform) {
+      block.fill(last_value);
+      uniform_blocks[last_value] = table.num_blocks;
+    }
+    if (table.num_blocks < NumBlocks) {
+      table.blocks[table.num_blocks] = block;
+    }
+    table.index[i] = table.num_blocks++;
   }
+  return table;
+}
 
-  return FULL_WIDTH;
+constexpr size_t kNumCharClassTableBlocks =
+    BuildCharClassTable<0>().num_blocks;
+static_assert(kNumCharClassTableBlocks <= 256);
+
+constexpr CharClassTable<kNumCharClassTableBlocks> kCharClassTable =
+    BuildCharClassTable<kNumCharClassTableBlocks>();
+
+inline uint8_t GetCharClass(char32_t codepoint) {
+  if (codepoint >= kCharClassTableEnd) {
+    return kDefaultCharClass;
+  }
+  return kCharClassTable.blocks[kCharClassTable
+                                    .index[codepoint >> kCharClassBlockBits]]
+                               [codepoint & (kCharClassBlockSize - 1)];
 }
 
-#undef INRANGE
+}  // namespace
+
+Util::ScriptType Util::GetScriptType(char32_t codepoint) {
+  return static_cast<ScriptType>(GetCharClass(codepoint) & 0x0F);
+}
+
+Util::FormType Util::GetFormType(char32_t codepoint) {
+  return static_cast<FormType>(GetCharClass(codepoint) >> 4);
+}
 
 // Returns the script type of the first character in `str`.
 Util::ScriptType Util::GetFirstScriptType(absl::string_view str,
@@ -939,39 +1035,79 @@ constexpr ScriptTypeBitSet kNumBs(1 << Util::NUMBER);
 constexpr ScriptTypeBitSet kKanaBs((1 << Util::HIRAGANA) |
                                    (1 << Util::KATAKANA));
 
+constexpr uint64_t kAsciiChunkHighBits = 0x8080808080808080;
+
+constexpr bool IsAsciiByte(char c) { return static_cast<uint8_t>(c) < 0x80; }
+
+uint64_t LoadAsciiChunk(const char *ptr) {
+  uint64_t chunk;
+  std::memcpy(&chunk, ptr, sizeof(chunk));
+  return chunk;
+}
+
+// Returns the length of the leading ASCII characters in `str`, checking eight
+// bytes at a time. Callers classify those bytes without UTF-8 decoding.
+size_t AsciiPrefixLength(absl::string_view str) {
+  size_t i = 0;
+  while (i + sizeof(uint64_t) <= str.size() &&
+         (LoadAsciiChunk(str.data() + i) & kAsciiChunkHighBits) == 0) {
+    i += sizeof(uint64_t);
+  }
+  while (i < str.size() && IsAsciiByte(str[i])) {
+    ++i;
+  }
+  return i;
+}
+
+// Returns true if none of the eight ASCII bytes in `chunk` is a control
+// character (U+00 - U+1F), i.e. they are all HALF_WIDTH.
+constexpr bool IsHalfWidthAsciiChunk(uint64_t chunk) {
+  return ((chunk - 0x2020202020202020) & kAsciiChunkHighBits) == 0;
+}
+
 Util::ScriptType GetScriptTypeInternal(absl::string_view str,
                                        bool ignore_symbols) {
   ScriptTypeBitSet bs(-1);
   DCHECK(bs.all());
 
-  for (const char32_t codepoint : Utf8AsChars32(str)) {
-    if (bs.count() == 0) {
-      return Util::UNKNOWN_SCRIPT;
-    }
-
+  const auto update = [&bs, ignore_symbols](const char32_t codepoint) {
     // PROLONGED SOUND MARK|MIDLE_DOT|VOICED_SOUND_MARKS
     // are HIRAGANA or KATAKANA as well.
     if (codepoint == U'ー' || codepoint == U'・' ||
         (codepoint >= 0x3099 && codepoint <= 0x309C)) {
       bs &= kKanaBs;
-      continue;
+      return;
     }
 
     // Periods ('．' U+FF0E and '.' U+002E) are NUMBER as well, if they are not
     // the first character.
     if ((codepoint == U'．' || codepoint == U'.') && bs == kNumBs) {
-      continue;
+      return;
     }
 
     Util::ScriptType type = Util::GetScriptType(codepoint);
     // Ignore symbols
     // Regard UNKNOWN_SCRIPT as symbols here
     if (ignore_symbols && type == Util::UNKNOWN_SCRIPT) {
-      continue;
+      return;
     }
 
     ScriptTypeBitSet type_bs(1 << type);
     bs &= type_bs;
+  };
+
+  while (!str.empty() && bs.any()) {
+    if (IsAsciiByte(str.front())) {
+      const size_t ascii_len = AsciiPrefixLength(str);
+      for (size_t i = 0; i < ascii_len && bs.any(); ++i) {
+        update(static_cast<uint8_t>(str[i]));
+      }
+      str.remove_prefix(ascii_len);
+      continue;
+    }
+    const Utf8AsChars32::const_iterator it = Utf8AsChars32(str).begin();
+    update(*it);
+    str.remove_prefix(it.size());
   }
 
   if (bs.count() != 1) {
@@ -993,8 +1129,21 @@ Util::ScriptType Util::GetScriptTypeWithoutSymbols(absl::string_view str) {
 
 // return true if all script_type in str is "type"
 bool Util::IsScriptType(absl::string_view str, Util::ScriptType type) {
-  for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    const char32_t codepoint = iter.Get();
+  char32_t codepoint = 0;
+  while (!str.empty()) {
+    if (IsAsciiByte(str.front())) {
+      const size_t ascii_len = AsciiPrefixLength(str);
+      for (size_t i = 0; i < ascii_len; ++i) {
+        if (type != GetScriptType(static_cast<uint8_t>(str[i]))) {
+          return false;
+        }
+      }
+      str.remove_prefix(ascii_len);
+      continue;
+    }
+    if (!SplitFirstChar32(str, &codepoint, &str)) {
+      break;
+    }
     // Exception: 30FC (PROLONGEDSOUND MARK is categorized as HIRAGANA as well)
     if (type != GetScriptType(codepoint) &&
         (codepoint != 0x30FC || type != HIRAGANA)) {
@@ -1006,8 +1155,22 @@ bool Util::IsScriptType(absl::string_view str, Util::ScriptType type) {
 
 // return true if the string contains script_type char
 bool Util::ContainsScriptType(absl::string_view str, ScriptType type) {
-  for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    if (type == GetScriptType(iter.Get())) {
+  char32_t codepoint = 0;
+  while (!str.empty()) {
+    if (IsAsciiByte(str.front())) {
+      const size_t ascii_len = AsciiPrefixLength(str);
+      for (size_t i = 0; i < ascii_len; ++i) {
+        if (type == GetScriptType(static_cast<uint8_t>(str[i]))) {
+          return true;
+        }
+      }
+      str.remove_prefix(ascii_len);
+      continue;
+    }
+    if (!SplitFirstChar32(str, &codepoint, &str)) {
+      break;
+    }
+    if (type == GetScriptType(codepoint)) {
       return true;
     }
   }
@@ -1019,12 +1182,39 @@ Util::FormType Util::GetFormType(absl::string_view str) {
   // TODO(hidehiko): get rid of using FORM_TYPE_SIZE.
   FormType result = FORM_TYPE_SIZE;
 
-  for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
-    const FormType type = GetFormType(iter.Get());
+  const auto update = [&result](const FormType type) {
     if (type == UNKNOWN_FORM || (result != FORM_TYPE_SIZE && type != result)) {
-      return UNKNOWN_FORM;
+      return false;
     }
     result = type;
+    return true;
+  };
+
+  char32_t codepoint = 0;
+  while (!str.empty()) {
+    // Printable ASCII characters are HALF_WIDTH.
+    size_t i = 0;
+    while (IsAsciiByte(str.front()) && i + sizeof(uint64_t) <= str.size()) {
+      const uint64_t chunk = LoadAsciiChunk(str.data() + i);
+      if ((chunk & kAsciiChunkHighBits) != 0 ||
+          !IsHalfWidthAsciiChunk(chunk)) {
+        break;
+      }
+      i += sizeof(uint64_t);
+    }
+    if (i > 0) {
+      if (!update(HALF_WIDTH)) {
+        return UNKNOWN_FORM;
+      }
+      str.remove_prefix(i);
+      continue;
+    }
+    if (!SplitFirstChar32(str, &codepoint, &str)) {
+      break;
+    }
+    if (!update(GetFormType(codepoint))) {
+      return UNKNOWN_FORM;
+    }
   }
 
   return result;
@@ -43,8 +43,10 @@
 #include <vector>
 
 #include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "base/strings/unicode.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 
@@ -863,6 +865,144 @@ TEST(UtilTest, FormType) {
   EXPECT_EQ(Util::GetFormType("@!#"), Util::HALF_WIDTH);
 }
 
+// The classifier implemented with comparisons, which the lookup tables must
+// reproduce.
+Util::ScriptType ReferenceScriptType(char32_t c) {
+  if ((c >= 0x0030 && c <= 0x0039) || (c >= 0xFF10 && c <= 0xFF19)) {
+    return Util::NUMBER;
+  }
+  if ((c >= 0x0041 && c <= 0x005A) || (c >= 0x0061 && c <= 0x007A) ||
+      (c >= 0xFF21 && c <= 0xFF3A) || (c >= 0xFF41 && c <= 0xFF5A)) {
+    return Util::ALPHABET;
+  }
+  if (c == 0x3005 || (c >= 0x3400 && c <= 0x4DBF) ||
+      (c >= 0x4E00 && c <= 0x9FFF) || (c >= 0xF900 && c <= 0xFAFF) ||
+      (c >= 0x20000 && c <= 0x2A6DF) || (c >= 0x2A700 && c <= 0x2B73F) ||
+      (c >= 0x2B740 && c <= 0x2B81F) || (c >= 0x2F800 && c <= 0x2FA1F)) {
+    return Util::KANJI;
+  }
+  if ((c >= 0x3041 && c <= 0x309F) || c == 0x1B001) {
+    return Util::HIRAGANA;
+  }
+  if ((c >= 0x30A1 && c <= 0x30FF) || (c >= 0x31F0 && c <= 0x31FF) ||
+      (c >= 0xFF65 && c <= 0xFF9F) || c == 0x1B000) {
+    return Util::KATAKANA;
+  }
+  if ((c >= 0x2300 && c <= 0x23F3) || (c >= 0x2700 && c <= 0x27BF) ||
+      (c >= 0x1F000 && c <= 0x1F2FF) || (c >= 0x1F300 && c <= 0x1F64F) ||
+      (c >= 0x1F680 && c <= 0x1F6FF) || (c >= 0x1F700 && c <= 0x1F77F) ||
+      c == 0x26CE) {
+    return Util::EMOJI;
+  }
+  return Util::UNKNOWN_SCRIPT;
+}
+
+Util::FormType ReferenceFormType(char32_t c) {
+  if ((c >= 0x0020 && c <= 0x007F) || (c >= 0x27E6 && c <= 0x27ED) ||
+      (c >= 0x2985 && c <= 0x2986) || c == 0x00A2 || c == 0x00A3 ||
+      c == 0x00A5 || c == 0x00A6 || c == 0x00AC || c == 0x00AF ||
+      c == 0x20A9 || (c >= 0xFF61 && c <= 0xFFBE) ||
+      (c >= 0xFFC2 && c <= 0xFFCF) || (c >= 0xFFD2 && c <= 0xFFD7) ||
+      (c >= 0xFFDA && c <= 0xFFDC) || (c >= 0xFFE8 && c <= 0xFFEE)) {
+    return Util::HALF_WIDTH;
+  }
+  return Util::FULL_WIDTH;
+}
+
+TEST(UtilTest, ScriptTypeAndFormTypeOfAllCodepoints) {
+  for (char32_t c = 0; c <= 0x110000; ++c) {
+    ASSERT_EQ(Util::GetScriptType(c), ReferenceScriptType(c))
+        << static_cast<uint32_t>(c);
+    ASSERT_EQ(Util::GetFormType(c), ReferenceFormType(c))
+        << static_cast<uint32_t>(c);
+  }
+  EXPECT_EQ(Util::GetScriptType(0xFFFFFFFF), Util::UNKNOWN_SCRIPT);
+  EXPECT_EQ(Util::GetFormType(0xFFFFFFFF), Util::FULL_WIDTH);
+}
+
+TEST(UtilTest, StringClassificationMatchesCharacterClassification) {
+  // Includes runs of eight ASCII characters, control characters, and
+  // malformed UTF-8 sequences.
+  constexpr absl::string_view kFragments[] = {
+      "",  "a", "1", ".", " ",  "\x01", "abcdefgh", "01234567", "A\tB CDEF",
+      "あ", "ア", "ｱ", "ー", "・", "．", "漢", "１", "\xFF", "\xE3\x81"};
+
+  // Same as the string functions, but classifies each character with the
+  // functions tested above.
+  const auto is_script_type = [](absl::string_view str, Util::ScriptType type) {
+    for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
+      if (type != Util::GetScriptType(iter.Get()) &&
+          (iter.Get() != 0x30FC || type != Util::HIRAGANA)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  const auto contains_script_type = [](absl::string_view str,
+                                       Util::ScriptType type) {
+    for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
+      if (type == Util::GetScriptType(iter.Get())) {
+        return true;
+      }
+    }
+    return false;
+  };
+  const auto form_type = [](absl::string_view str) {
+    Util::FormType result = Util::FORM_TYPE_SIZE;
+    for (ConstChar32Iterator iter(str); !iter.Done(); iter.Next()) {
+      const Util::FormType type = Util::GetFormType(iter.Get());
+      if (result != Util::FORM_TYPE_SIZE && type != result) {
+        return Util::UNKNOWN_FORM;
+      }
+      result = type;
+    }
+    return result;
+  };
+  const auto script_type = [](absl::string_view str, bool ignore_symbols) {
+    uint32_t bits = (1 << Util::SCRIPT_TYPE_SIZE) - 1;
+    for (const char32_t c : Utf8AsChars32(str)) {
+      if (c == U'ー' || c == U'・' || (c >= 0x3099 && c <= 0x309C)) {
+        bits &= (1 << Util::HIRAGANA) | (1 << Util::KATAKANA);
+        continue;
+      }
+      if ((c == U'．' || c == U'.') && bits == (1 << Util::NUMBER)) {
+        continue;
+      }
+      const Util::ScriptType type = Util::GetScriptType(c);
+      if (ignore_symbols && type == Util::UNKNOWN_SCRIPT) {
+        continue;
+      }
+      bits &= 1 << type;
+    }
+    for (int type = 0; type < Util::SCRIPT_TYPE_SIZE; ++type) {
+      if (bits == (1u << type)) {
+        return static_cast<Util::ScriptType>(type);
+      }
+    }
+    return Util::UNKNOWN_SCRIPT;
+  };
+
+  for (const absl::string_view a : kFragments) {
+    for (const absl::string_view b : kFragments) {
+      for (const absl::string_view c : kFragments) {
+        const std::string str = absl::StrCat(a, b, c);
+        SCOPED_TRACE(str);
+        EXPECT_EQ(Util::GetScriptType(str), script_type(str, false));
+        EXPECT_EQ(Util::GetScriptTypeWithoutSymbols(str),
+                  script_type(str, true));
+        EXPECT_EQ(Util::GetFormType(str), form_type(str));
+        for (int type = 0; type < Util::SCRIPT_TYPE_SIZE; ++type) {
+          const Util::ScriptType script = static_cast<Util::ScriptType>(type);
+          EXPECT_EQ(Util::IsScriptType(str, script),
+                    is_script_type(str, script));
+          EXPECT_EQ(Util::ContainsScriptType(str, script),
+                    contains_script_type(str, script));
+        }
+      }
+    }
+  }
+}
+
 TEST(UtilTest, IsAscii) {
   EXPECT_FALSE(Util::IsAscii("あいうえお"));
   EXPECT_TRUE(Util::IsAscii("abc"));
@@ -62,29 +62,33 @@ bool None(uint32_t modifiers_to_be_tested, uint32_t modifiers_to_be_queried) {
   return !Any(modifiers_to_be_tested, modifiers_to_be_queried);
 }
 
-}  // namespace
-
-uint32_t KeyEventUtil::GetModifiers(const KeyEvent &key_event) {
-  uint32_t modifiers = 0;
+// CTRL (or ALT, SHIFT) should be set on modifier_keys when
+// LEFT (or RIGHT) ctrl is set.
+// LEFT_CTRL (or others) is not handled on Japanese, so we remove these.
+constexpr uint32_t kIgnorableModifierMask =
+    (KeyEvent::CAPS | KeyEvent::LEFT_ALT | KeyEvent::RIGHT_ALT |
+     KeyEvent::LEFT_CTRL | KeyEvent::RIGHT_CTRL | KeyEvent::LEFT_SHIFT |
+     KeyEvent::RIGHT_SHIFT);
+
+// Returns the modifiers of the key event normalized by NormalizeModifiers().
+// It only rewrites modifier_keys, so the modifiers field is kept as is.
+uint32_t GetNormalizedModifiers(const KeyEvent &key_event) {
   if (key_event.has_modifiers()) {
-    modifiers = key_event.modifiers();
-  } else {
-    for (const int key : key_event.modifier_keys()) {
-      modifiers |= key;
-    }
+    return key_event.modifiers();
   }
-  return modifiers;
+  uint32_t modifiers = 0;
+  for (const int key : key_event.modifier_keys()) {
+    modifiers |= key;
+  }
+  return Ignore(modifiers, kIgnorableModifierMask);
 }
 
-bool KeyEventUtil::GetKeyInformation(const KeyEvent &key_event,
-                                     KeyInformation *key) {
-  DCHECK(key);
-
-  const uint16_t modifier_keys = static_cast<uint16_t>(GetModifiers(key_event));
+bool ComposeKeyInformation(uint32_t modifiers, const KeyEvent &key_event,
+                           uint32_t key_code, KeyInformation *key) {
+  const uint16_t modifier_keys = static_cast<uint16_t>(modifiers);
   const uint16_t special_key = key_event.has_special_key()
                                    ? key_event.special_key()
                                    : KeyEvent::NO_SPECIALKEY;
-  const uint32_t key_code = key_event.has_key_code() ? key_event.key_code() : 0;
 
   // Make sure the translation from the obsolete specification.
   // key_code should no longer contain control characters.
@@ -95,22 +99,74 @@ bool KeyEventUtil::GetKeyInformation(const KeyEvent &key_event,
   *key = (static_cast<KeyInformation>(modifier_keys) << 48) |
          (static_cast<KeyInformation>(special_key) << 32) |
          (static_cast<KeyInformation>(key_code));
+  return true;
+}
+
+bool IsStubTarget(uint32_t modifiers, const KeyEvent &key_event) {
+  // If any modifier keys were pressed, no stub is used.
+  if (modifiers != 0) {
+    return false;
+  }
+
+  // No stub rule is supported for special keys yet.
+  if (key_event.has_special_key()) {
+    return false;
+  }
 
+  // Check if both key_code and key_string are invalid.
+  if ((!key_event.has_key_code() || key_event.key_code() <= 32) &&
+      (!key_event.has_key_string() || key_event.key_string().empty())) {
+    return false;
+  }
   return true;
 }
 
+// The key information of a key event with only TEXT_INPUT special key.
+constexpr KeyInformation kTextInputKey =
+    static_cast<KeyInformation>(KeyEvent::TEXT_INPUT) << 32;
+
+}  // namespace
+
+uint32_t KeyEventUtil::GetModifiers(const KeyEvent &key_event) {
+  uint32_t modifiers = 0;
+  if (key_event.has_modifiers()) {
+    modifiers = key_event.modifiers();
+  } else {
+    for (const int key : key_event.modifier_keys()) {
+      modifiers |= key;
+    }
+  }
+  return modifiers;
+}
+
+bool KeyEventUtil::GetKeyInformation(const KeyEvent &key_event,
+                                     KeyInformation *key) {
+  DCHECK(key);
+  return ComposeKeyInformation(
+      GetModifiers(key_event), key_event,
+      key_event.has_key_code() ? key_event.key_code() : 0, key);
+}
+
+bool KeyEventUtil::GetNormalizedKeyInformation(const KeyEvent &key_event,
+                                               KeyInformation *key) {
+  DCHECK(key);
+  uint32_t key_code = key_event.has_key_code() ? key_event.key_code() : 0;
+  // Reverts the flip of alphabetical key events caused by CapsLock.
+  if (HasCaps(GetModifiers(key_event))) {
+    if ('A' <= key_code && key_code <= 'Z') {
+      key_code += 'a' - 'A';
+    } else if ('a' <= key_code && key_code <= 'z') {
+      key_code += 'A' - 'a';
+    }
+  }
+  return ComposeKeyInformation(GetNormalizedModifiers(key_event), key_event,
+                               key_code, key);
+}
+
 void KeyEventUtil::NormalizeModifiers(const KeyEvent &key_event,
                                       KeyEvent *new_key_event) {
   DCHECK(new_key_event);
 
-  // CTRL (or ALT, SHIFT) should be set on modifier_keys when
-  // LEFT (or RIGHT) ctrl is set.
-  // LEFT_CTRL (or others) is not handled on Japanese, so we remove these.
-  constexpr uint32_t kIgnorableModifierMask =
-      (KeyEvent::CAPS | KeyEvent::LEFT_ALT | KeyEvent::RIGHT_ALT |
-       KeyEvent::LEFT_CTRL | KeyEvent::RIGHT_CTRL | KeyEvent::LEFT_SHIFT |
-       KeyEvent::RIGHT_SHIFT);
-
   RemoveModifiers(key_event, kIgnorableModifierMask, new_key_event);
 
   // Reverts the flip of alphabetical key events caused by CapsLock.
@@ -209,29 +265,20 @@ void KeyEventUtil::RemoveModifiers(const KeyEvent &key_event,
 bool KeyEventUtil::MaybeGetKeyStub(const KeyEvent &key_event,
                                    KeyInformation *key) {
   DCHECK(key);
-
-  // If any modifier keys were pressed, this function does nothing.
-  if (KeyEventUtil::GetModifiers(key_event) != 0) {
-    return false;
-  }
-
-  // No stub rule is supported for special keys yet.
-  if (key_event.has_special_key()) {
-    return false;
-  }
-
-  // Check if both key_code and key_string are invalid.
-  if ((!key_event.has_key_code() || key_event.key_code() <= 32) &&
-      (!key_event.has_key_string() || key_event.key_string().empty())) {
+  if (!IsStubTarget(GetModifiers(key_event), key_event)) {
     return false;
   }
+  *key = kTextInputKey;
+  return true;
+}
 
-  KeyEvent stub_key_event;
-  stub_key_event.set_special_key(KeyEvent::TEXT_INPUT);
-  if (!GetKeyInformation(stub_key_event, key)) {
+bool KeyEventUtil::MaybeGetNormalizedKeyStub(const KeyEvent &key_event,
+                                             KeyInformation *key) {
+  DCHECK(key);
+  if (!IsStubTarget(GetNormalizedModifiers(key_event), key_event)) {
     return false;
   }
-
+  *key = kTextInputKey;
   return true;
 }
 
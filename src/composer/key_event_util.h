@@ -61,6 +61,12 @@ class KeyEventUtil {
   static void NormalizeModifiers(const commands::KeyEvent &key_event,
                                  commands::KeyEvent *new_key_event);
 
+  // Same as NormalizeModifiers() followed by GetKeyInformation(), but computes
+  // the key directly from |key_event| without copying it. This runs on every
+  // key stroke to look up the keymap.
+  static bool GetNormalizedKeyInformation(const commands::KeyEvent &key_event,
+                                          KeyInformation *key);
+
   // Normalizes a numpad key to a normal key (e.g. NUMPAD0 => '0')
   static void NormalizeNumpadKey(const commands::KeyEvent &key_event,
                                  commands::KeyEvent *new_key_event);
@@ -77,6 +83,10 @@ class KeyEventUtil {
   static bool MaybeGetKeyStub(const commands::KeyEvent &key_event,
                               KeyInformation *key);
 
+  // Same as NormalizeModifiers() followed by MaybeGetKeyStub().
+  static bool MaybeGetNormalizedKeyStub(const commands::KeyEvent &key_event,
+                                        KeyInformation *key);
+
   static bool HasAlt(uint32_t modifiers);
   static bool HasCtrl(uint32_t modifiers);
   static bool HasShift(uint32_t modifiers);
@@ -34,6 +34,7 @@
 #include <iterator>
 #include <string>
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "composer/key_parser.h"
@@ -266,6 +267,42 @@ TEST(KeyEventUtilTest, MaybeGetKeyStub) {
   EXPECT_EQ(key, static_cast<KeyInformation>(KeyEvent::TEXT_INPUT) << 32);
 }
 
+TEST(KeyEventUtilTest, GetNormalizedKeyInformation) {
+  constexpr absl::string_view kModifiers[] = {
+      "",      "Shift ", "LeftShift ", "Ctrl ",      "RightCtrl Alt ",
+      "Caps ", "Caps Shift ", "Caps Ctrl ", "Caps LeftShift Ctrl ",
+  };
+  constexpr absl::string_view kKeys[] = {
+      "a", "A", "z", "Z", "1", "!", "Space", "Enter", "Left", "F6", "Henkan",
+      "Hankaku/Zenkaku", "Numpad0", "",
+  };
+  for (const absl::string_view modifiers : kModifiers) {
+    for (const absl::string_view key_string : kKeys) {
+      const std::string name = absl::StrCat(modifiers, key_string);
+      KeyEvent key_event;
+      if (!KeyParser::ParseKey(name, &key_event)) {
+        continue;
+      }
+      KeyEvent normalized_key_event;
+      KeyEventUtil::NormalizeModifiers(key_event, &normalized_key_event);
+
+      KeyInformation expected = 0, actual = 0;
+      EXPECT_EQ(
+          KeyEventUtil::GetNormalizedKeyInformation(key_event, &actual),
+          KeyEventUtil::GetKeyInformation(normalized_key_event, &expected))
+          << name;
+      EXPECT_EQ(actual, expected) << name;
+
+      expected = actual = 0;
+      EXPECT_EQ(
+          KeyEventUtil::MaybeGetNormalizedKeyStub(key_event, &actual),
+          KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &expected))
+          << name;
+      EXPECT_EQ(actual, expected) << name;
+    }
+  }
+}
+
 TEST(KeyEventUtilTest, RemoveModifiers) {
   constexpr struct RemoveModifiersTestData {
     absl::string_view input;
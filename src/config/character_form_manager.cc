@@ -43,6 +43,7 @@
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "base/config_file_stream.h"
 #include "base/number_util.h"
@@ -625,25 +626,26 @@ CharacterFormManager *CharacterFormManager::GetCharacterFormManager() {
 }
 
 CharacterFormManager::CharacterFormManager() : data_(std::make_unique<Data>()) {
-  Config config;
-  ConfigHandler::GetConfig(&config);
-  ReloadConfig(config);
+  ReloadConfig(*ConfigHandler::GetSharedConfig());
 }
 
 void CharacterFormManager::ReloadConfig(const Config &config) {
-  Clear();
+  absl::MutexLock lock(&mutex_);
+  CharacterFormManagerImpl *preedit = data_->GetPreeditManager();
+  CharacterFormManagerImpl *conversion = data_->GetConversionManager();
+  preedit->Clear();
+  conversion->Clear();
   if (config.character_form_rules_size() > 0) {
     for (size_t i = 0; i < config.character_form_rules_size(); ++i) {
       const absl::string_view group = config.character_form_rules(i).group();
-      const Config::CharacterForm preedit_form =
-          config.character_form_rules(i).preedit_character_form();
-      const Config::CharacterForm conversion_form =
-          config.character_form_rules(i).conversion_character_form();
-      AddPreeditRule(group, preedit_form);
-      AddConversionRule(group, conversion_form);
+      preedit->AddRule(group,
+                       config.character_form_rules(i).preedit_character_form());
+      conversion->AddRule(
+          group, config.character_form_rules(i).conversion_character_form());
     }
   } else {
-    SetDefaultRule();
+    preedit->SetDefaultRule();
+    conversion->SetDefaultRule();
   }
 }
 
@@ -661,17 +663,20 @@ std::string CharacterFormManager::ConvertWidth(std::string input,
 
 void CharacterFormManager::ConvertPreeditString(const absl::string_view input,
                                                 std::string *output) const {
+  absl::ReaderMutexLock lock(&mutex_);
   data_->GetPreeditManager()->ConvertString(input, output);
 }
 
 void CharacterFormManager::ConvertConversionString(
     const absl::string_view input, std::string *output) const {
+  absl::ReaderMutexLock lock(&mutex_);
   data_->GetConversionManager()->ConvertString(input, output);
 }
 
 bool CharacterFormManager::ConvertPreeditStringWithAlternative(
     const absl::string_view input, std::string *output,
     std::string *alternative_output) const {
+  absl::ReaderMutexLock lock(&mutex_);
   return data_->GetPreeditManager()->ConvertStringWithAlternative(
       input, output, alternative_output);
 }
@@ -679,21 +684,25 @@ bool CharacterFormManager::ConvertPreeditStringWithAlternative(
 bool CharacterFormManager::ConvertConversionStringWithAlternative(
     const absl::string_view input, std::string *output,
     std::string *alternative_output) const {
+  absl::ReaderMutexLock lock(&mutex_);
   return data_->GetConversionManager()->ConvertStringWithAlternative(
       input, output, alternative_output);
 }
 
 Config::CharacterForm CharacterFormManager::GetPreeditCharacterForm(
     const absl::string_view input) const {
+  absl::ReaderMutexLock lock(&mutex_);
   return data_->GetPreeditManager()->GetCharacterForm(input);
 }
 
 Config::CharacterForm CharacterFormManager::GetConversionCharacterForm(
     const absl::string_view input) const {
+  absl::ReaderMutexLock lock(&mutex_);
   return data_->GetConversionManager()->GetCharacterForm(input);
 }
 
 void CharacterFormManager::ClearHistory() {
+  absl::MutexLock lock(&mutex_);
   // no need to call, as storage is shared
   // GetPreeditManager()->ClearHistory();
   MOZC_VLOG(1) << "CharacterFormManager::ClearHistory() is called";
@@ -701,6 +710,7 @@ void CharacterFormManager::ClearHistory() {
 }
 
 void CharacterFormManager::Clear() {
+  absl::MutexLock lock(&mutex_);
   MOZC_VLOG(1) << "CharacterFormManager::Clear() is called";
   data_->GetConversionManager()->Clear();
   data_->GetPreeditManager()->Clear();
@@ -708,6 +718,7 @@ void CharacterFormManager::Clear() {
 
 void CharacterFormManager::SetCharacterForm(const absl::string_view input,
                                             Config::CharacterForm form) {
+  absl::MutexLock lock(&mutex_);
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->SetCharacterForm(input, form);
@@ -715,6 +726,7 @@ void CharacterFormManager::SetCharacterForm(const absl::string_view input,
 
 void CharacterFormManager::GuessAndSetCharacterForm(
     const absl::string_view input) {
+  absl::MutexLock lock(&mutex_);
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->GuessAndSetCharacterForm(input);
@@ -722,25 +734,30 @@ void CharacterFormManager::GuessAndSetCharacterForm(
 
 void CharacterFormManager::SetLastNumberStyle(
     const NumberFormStyle &form_style) {
+  absl::MutexLock lock(&mutex_);
   data_->GetNumberStyleManager()->SetNumberStyle(form_style);
 }
 
 std::optional<const CharacterFormManager::NumberFormStyle>
 CharacterFormManager::GetLastNumberStyle() const {
+  absl::ReaderMutexLock lock(&mutex_);
   return data_->GetNumberStyleManager()->GetNumberStyle();
 }
 
 void CharacterFormManager::AddPreeditRule(const absl::string_view input,
                                           Config::CharacterForm form) {
+  absl::MutexLock lock(&mutex_);
   data_->GetPreeditManager()->AddRule(input, form);
 }
 
 void CharacterFormManager::AddConversionRule(const absl::string_view input,
                                              Config::CharacterForm form) {
+  absl::MutexLock lock(&mutex_);
   data_->GetConversionManager()->AddRule(input, form);
 }
 
 void CharacterFormManager::SetDefaultRule() {
+  absl::MutexLock lock(&mutex_);
   data_->GetPreeditManager()->SetDefaultRule();
   data_->GetConversionManager()->SetDefaultRule();
 }
@@ -34,7 +34,9 @@
 #include <optional>
 #include <string>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "base/number_util.h"
 #include "base/singleton.h"
 #include "protocol/config.pb.h"
@@ -45,6 +47,8 @@ namespace config {
 
 // TODO(hidehiko): Move some methods which don't depend on "config" to the
 //   mozc::Util class.
+//
+// This class is thread-safe. The const methods can run concurrently.
 class CharacterFormManager {
  public:
   enum FormType { UNKNOWN_FORM, HALF_WIDTH, FULL_WIDTH };
@@ -169,7 +173,8 @@ class CharacterFormManager {
   CharacterFormManager();
   ~CharacterFormManager() = default;
 
-  std::unique_ptr<Data> data_;
+  mutable absl::Mutex mutex_;
+  std::unique_ptr<Data> data_ ABSL_PT_GUARDED_BY(mutex_);
 };
 
 }  // namespace config
@@ -30,6 +30,7 @@
 // Handler of mozc configuration.
 #include "config/config_handler.h"
 
+#include <atomic>
 #include <cstdint>
 #include <istream>
 #include <memory>
@@ -64,6 +65,11 @@ namespace {
 
 constexpr absl::string_view kFileNamePrefix = "user://config";
 
+// Generation of the published config. Not a member of ConfigHandlerImpl so
+// that the per-thread snapshot caches stay valid even if the singleton is
+// recreated.
+ABSL_CONST_INIT std::atomic<uint64_t> g_config_generation = 0;
+
 void AddCharacterFormRule(const absl::string_view group,
                           const Config::CharacterForm preedit_form,
                           const Config::CharacterForm conversion_form,
@@ -94,6 +100,8 @@ class ConfigHandlerImpl final {
 
   void GetConfig(Config *config) const ABSL_LOCKS_EXCLUDED(mutex_);
   std::unique_ptr<config::Config> GetConfig() const ABSL_LOCKS_EXCLUDED(mutex_);
+  std::shared_ptr<const Config> GetSharedConfig() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
   const Config &DefaultConfig() const;
   void SetConfig(const Config &config) ABSL_LOCKS_EXCLUDED(mutex_);
   void Reload() ABSL_LOCKS_EXCLUDED(mutex_);
@@ -108,7 +116,8 @@ class ConfigHandlerImpl final {
   void ReloadUnlocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   std::string filename_ ABSL_GUARDED_BY(mutex_);
-  Config config_ ABSL_GUARDED_BY(mutex_);
+  // Replaced, never modified, when the config changes.
+  std::shared_ptr<const Config> config_ ABSL_GUARDED_BY(mutex_);
   Config default_config_;
   mutable absl::Mutex mutex_;
   uint64_t stored_config_hash_ ABSL_GUARDED_BY(mutex_) = 0;
@@ -120,14 +129,32 @@ ConfigHandlerImpl *GetConfigHandlerImpl() {
 
 // return current Config
 void ConfigHandlerImpl::GetConfig(Config *config) const {
-  absl::MutexLock lock(&mutex_);
-  *config = config_;
+  *config = *GetSharedConfig();
 }
 
 // return current Config as a unique_ptr.
 std::unique_ptr<config::Config> ConfigHandlerImpl::GetConfig() const {
+  return std::make_unique<config::Config>(*GetSharedConfig());
+}
+
+std::shared_ptr<const Config> ConfigHandlerImpl::GetSharedConfig() const {
+  // Each thread remembers the last snapshot it has seen and only takes the
+  // lock when a newer one has been published. The cache is a weak_ptr so that
+  // an idle thread doesn't keep a replaced config alive. The current snapshot
+  // is always owned by config_, so lock() succeeds while the generation
+  // matches.
+  thread_local std::weak_ptr<const Config> cached_config;
+  thread_local uint64_t cached_generation = 0;
+  if (cached_generation ==
+      g_config_generation.load(std::memory_order_acquire)) {
+    if (std::shared_ptr<const Config> config = cached_config.lock()) {
+      return config;
+    }
+  }
   absl::MutexLock lock(&mutex_);
-  return std::make_unique<config::Config>(config_);
+  cached_config = config_;
+  cached_generation = g_config_generation.load(std::memory_order_relaxed);
+  return config_;
 }
 
 const Config &ConfigHandlerImpl::DefaultConfig() const {
@@ -136,32 +163,37 @@ const Config &ConfigHandlerImpl::DefaultConfig() const {
 
 // set config and rewrite internal data
 void ConfigHandlerImpl::SetConfigInternal(Config config) {
-  config_ = std::move(config);
-
 #ifdef NDEBUG
   // Delete the optional field from the config.
-  config_.clear_verbose_level();
+  config.clear_verbose_level();
   // Fall back if the default value is not the expected value.
-  if (config_.verbose_level() != 0) {
-    config_.set_verbose_level(0);
+  if (config.verbose_level() != 0) {
+    config.set_verbose_level(0);
   }
 #endif  // NDEBUG
 
-  mozc::internal::SetConfigVLogLevel(config_.verbose_level());
+  mozc::internal::SetConfigVLogLevel(config.verbose_level());
 
   // Initialize platform specific configuration.
-  if (config_.session_keymap() == Config::NONE) {
-    config_.set_session_keymap(ConfigHandler::GetDefaultKeyMap());
+  if (config.session_keymap() == Config::NONE) {
+    config.set_session_keymap(ConfigHandler::GetDefaultKeyMap());
   }
 
 #if defined(__ANDROID__) && defined(CHANNEL_DEV)
-  stored_config_.mutable_general_config()->set_upload_usage_stats(true);
+  config.mutable_general_config()->set_upload_usage_stats(true);
 #endif  // CHANNEL_DEV && __ANDROID__
 
   if (GetPlatformSpecificDefaultEmojiSetting() &&
-      !config_.has_use_emoji_conversion()) {
-    config_.set_use_emoji_conversion(true);
+      !config.has_use_emoji_conversion()) {
+    config.set_use_emoji_conversion(true);
   }
+
+  // Publishes the new snapshot. The generation is incremented while the lock
+  // is held, so a reader never pairs a new generation with an old snapshot.
+  // Not make_shared(), which would keep the memory of a replaced config until
+  // the weak_ptrs cached by GetSharedConfig() are gone too.
+  config_ = std::shared_ptr<const Config>(new Config(std::move(config)));
+  g_config_generation.fetch_add(1, std::memory_order_release);
 }
 
 void ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -244,6 +276,10 @@ std::unique_ptr<config::Config> ConfigHandler::GetConfig() {
   return GetConfigHandlerImpl()->GetConfig();
 }
 
+std::shared_ptr<const Config> ConfigHandler::GetSharedConfig() {
+  return GetConfigHandlerImpl()->GetSharedConfig();
+}
+
 void ConfigHandler::SetConfig(const Config &config) {
   GetConfigHandlerImpl()->SetConfig(config);
 }
@@ -60,6 +60,14 @@ class ConfigHandler {
   // The same performance note as GetConfig(Config*) applies.
   static std::unique_ptr<config::Config> GetConfig();
 
+  // Returns current config as an immutable snapshot without copying it.
+  // A new snapshot is published whenever the config changes, so the returned
+  // one stays valid and unchanged while it is held. This doesn't take a lock
+  // unless the config has changed since the calling thread last called it.
+  // A replaced config is freed once the callers release it; threads don't
+  // keep it alive by having called this.
+  static std::shared_ptr<const Config> GetSharedConfig();
+
   // Sets config.
   static void SetConfig(const Config &config);
 
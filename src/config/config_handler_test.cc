@@ -194,6 +194,54 @@ TEST_F(ConfigHandlerTest, SetConfig_IdentityCheck) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(ConfigHandlerTest, SharedConfig) {
+  TempDirectory temp_dir = testing::MakeTempDirectoryOrDie();
+  const std::string config_file =
+      FileUtil::JoinPath(temp_dir.path(), "mozc_config_test_tmp");
+  ASSERT_OK(FileUtil::UnlinkIfExists(config_file));
+  ConfigHandler::SetConfigFileName(config_file);
+
+  Config input;
+  ConfigHandler::GetDefaultConfig(&input);
+  input.set_incognito_mode(true);
+  ConfigHandler::SetConfig(input);
+  const std::shared_ptr<const Config> config1 =
+      ConfigHandler::GetSharedConfig();
+  EXPECT_TRUE(config1->incognito_mode());
+  EXPECT_EQ(ConfigHandler::GetSharedConfig(), config1);
+
+  // Setting the identical config doesn't publish a new snapshot.
+  ConfigHandler::SetConfig(input);
+  EXPECT_EQ(ConfigHandler::GetSharedConfig(), config1);
+
+  input.set_incognito_mode(false);
+  ConfigHandler::SetConfig(input);
+  std::shared_ptr<const Config> config2 = ConfigHandler::GetSharedConfig();
+  EXPECT_NE(config2, config1);
+  EXPECT_FALSE(config2->incognito_mode());
+  // The old snapshot is not modified.
+  EXPECT_TRUE(config1->incognito_mode());
+
+  // Other threads see the same snapshot.
+  std::shared_ptr<const Config> config_in_thread;
+  Thread thread([&config_in_thread] {
+    config_in_thread = ConfigHandler::GetSharedConfig();
+  });
+  thread.Join();
+  EXPECT_EQ(config_in_thread, config2);
+
+  // A replaced snapshot is freed once the callers release it, even though
+  // this thread has seen it.
+  const std::weak_ptr<const Config> weak_config2 = config2;
+  config_in_thread.reset();
+  input.set_incognito_mode(true);
+  ConfigHandler::SetConfig(input);
+  EXPECT_FALSE(weak_config2.expired());
+  config2.reset();
+  EXPECT_TRUE(weak_config2.expired());
+  EXPECT_TRUE(ConfigHandler::GetSharedConfig()->incognito_mode());
+}
+
 TEST_F(ConfigHandlerTest, ConfigFileNameConfig) {
   const std::string config_file = absl::StrCat("config", kConfigVersion, ".db");
   const std::string filename =
@@ -406,6 +454,16 @@ TEST_F(ConfigHandlerTest, ConcurrentAccess) {
         }
       }));
     }
+    for (int i = 0; i < 2; ++i) {
+      get_threads.push_back(Thread([&cancel, &character_form_rules_set] {
+        while (!cancel.HasBeenNotified()) {
+          const std::shared_ptr<const Config> config =
+              ConfigHandler::GetSharedConfig();
+          const auto &rules = ExtractCharacterFormRules(*config);
+          EXPECT_TRUE(character_form_rules_set.contains(rules));
+        }
+      }));
+    }
 
     // Wait for a while to see if everything goes well.
     // 250 msec is good enough to crash the code if it is not guarded by
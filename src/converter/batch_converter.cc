@@ -0,0 +1,112 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/batch_converter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/check.h"
+#include "absl/types/span.h"
+#include "base/thread.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+
+namespace mozc {
+
+BatchConverter::BatchConverter(
+    std::vector<const ConverterInterface *> converters)
+    : converters_(std::move(converters)) {
+  CHECK(!converters_.empty());
+  for (const ConverterInterface *converter : converters_) {
+    CHECK(converter);
+  }
+}
+
+std::vector<Segments> BatchConverter::ConvertBatch(
+    absl::Span<const std::string> keys, const commands::Request &request,
+    const config::Config &config) const {
+  std::vector<Segments> results(keys.size());
+  // Each thread has its own table as composer::Table is not thread-safe.
+  std::vector<composer::Table> tables(converters_.size());
+  ParallelFor(converters_.size(), keys.size(),
+              [&](size_t worker, size_t index) {
+                composer::Composer composer(&tables[worker], &request,
+                                            &config);
+                composer.SetPreeditTextForTestOnly(keys[index]);
+                const ConversionRequest conversion_request(&composer, &request,
+                                                           &config);
+                Segments *segments = &results[index];
+                if (!converters_[worker]->StartConversion(conversion_request,
+                                                          segments)) {
+                  segments->Clear();
+                }
+              });
+  return results;
+}
+
+// static
+void BatchConverter::ParallelFor(size_t num_workers, size_t size,
+                                 absl::FunctionRef<void(size_t, size_t)> func) {
+  CHECK_GT(num_workers, 0);
+  if (num_workers == 1) {
+    for (size_t i = 0; i < size; ++i) {
+      func(0, i);
+    }
+    return;
+  }
+
+  // The items are handed out one by one rather than in fixed shards, so a
+  // thread stuck on long keys doesn't keep the others waiting.
+  std::atomic<size_t> next = 0;
+  std::vector<Thread> threads;
+  threads.reserve(num_workers);
+  for (size_t worker = 0; worker < num_workers; ++worker) {
+    threads.emplace_back([&next, size, func, worker] {
+      for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < size;
+           i = next.fetch_add(1, std::memory_order_relaxed)) {
+        func(worker, i);
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+}
+
+}  // namespace mozc
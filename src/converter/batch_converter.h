@@ -0,0 +1,90 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Converts many keys at once on several converters in parallel, e.g., to
+// evaluate a corpus offline.
+
+#ifndef MOZC_CONVERTER_BATCH_CONVERTER_H_
+#define MOZC_CONVERTER_BATCH_CONVERTER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/types/span.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+
+namespace mozc {
+
+// BatchConverter runs one thread per converter. Every converter is used by
+// only one thread, so they don't need to be thread-safe; the converters of
+// engines sharing one engine::Modules (see
+// Engine::CreateEngineWithSharedModules()) convert in parallel. The keys are
+// handed out one by one, and the results are stored in the order of the
+// keys, so the output doesn't depend on the number of threads.
+//
+// Example:
+//   BatchConverter batch_converter({engine1->GetConverter(),
+//                                   engine2->GetConverter()});
+//   std::vector<Segments> results =
+//       batch_converter.ConvertBatch(keys, request, config);
+class BatchConverter {
+ public:
+  explicit BatchConverter(std::vector<const ConverterInterface *> converters);
+
+  BatchConverter(const BatchConverter &) = delete;
+  BatchConverter &operator=(const BatchConverter &) = delete;
+
+  // Converts each of |keys| with StartConversion() and returns the segments in
+  // the order of |keys|. The segments of a key which fails to convert are
+  // empty.
+  std::vector<Segments> ConvertBatch(absl::Span<const std::string> keys,
+                                     const commands::Request &request,
+                                     const config::Config &config) const;
+
+  // Calls |func(worker, index)| for each index in [0, size) on |num_workers|
+  // threads, and returns when all the calls finish. Calls with the same
+  // |worker| run on the same thread one by one, so |worker| can select the
+  // state owned by the thread.
+  static void ParallelFor(size_t num_workers, size_t size,
+                          absl::FunctionRef<void(size_t, size_t)> func);
+
+  size_t size() const { return converters_.size(); }
+
+ private:
+  std::vector<const ConverterInterface *> converters_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_CONVERTER_BATCH_CONVERTER_H_
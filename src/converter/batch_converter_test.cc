@@ -0,0 +1,135 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/batch_converter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "converter/converter_interface.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+// Converts the key to a single candidate with the upper-cased key, and fails
+// for the key "fail".
+bool FakeConversion(const ConversionRequest &request, Segments *segments) {
+  const std::string key = request.composer().GetQueryForConversion();
+  if (key == "fail") {
+    return false;
+  }
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->key = key;
+  candidate->value = absl::AsciiStrToUpper(key);
+  return true;
+}
+
+class BatchConverterTest : public ::testing::Test {
+ protected:
+  static constexpr int kNumConverters = 4;
+
+  void SetUp() override {
+    for (int i = 0; i < kNumConverters; ++i) {
+      auto converter = std::make_unique<MockConverter>();
+      EXPECT_CALL(*converter, StartConversion(_, _))
+          .WillRepeatedly(Invoke(FakeConversion));
+      converters_.push_back(converter.get());
+      owned_converters_.push_back(std::move(converter));
+    }
+  }
+
+  std::vector<std::unique_ptr<MockConverter>> owned_converters_;
+  std::vector<const ConverterInterface *> converters_;
+};
+
+TEST_F(BatchConverterTest, ConvertBatchKeepsOrderOfKeys) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 500; ++i) {
+    keys.push_back(i % 7 == 0 ? "fail" : absl::StrCat("key", i));
+  }
+
+  const BatchConverter batch_converter(converters_);
+  EXPECT_EQ(batch_converter.size(), kNumConverters);
+  const std::vector<Segments> results = batch_converter.ConvertBatch(
+      keys, commands::Request(), config::Config());
+  ASSERT_EQ(results.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] == "fail") {
+      EXPECT_EQ(results[i].segments_size(), 0);
+      continue;
+    }
+    ASSERT_EQ(results[i].segments_size(), 1);
+    EXPECT_EQ(results[i].segment(0).key(), keys[i]);
+    EXPECT_EQ(results[i].segment(0).candidate(0).value,
+              absl::AsciiStrToUpper(keys[i]));
+  }
+}
+
+TEST_F(BatchConverterTest, ConvertBatchEmpty) {
+  const BatchConverter batch_converter(converters_);
+  EXPECT_TRUE(
+      batch_converter.ConvertBatch({}, commands::Request(), config::Config())
+          .empty());
+}
+
+TEST(BatchConverterParallelForTest, VisitsEachIndexOnce) {
+  constexpr size_t kNumWorkers = 3;
+  constexpr size_t kSize = 1000;
+  std::vector<std::atomic<int>> visits(kSize);
+  std::vector<size_t> workers(kSize);
+  BatchConverter::ParallelFor(kNumWorkers, kSize,
+                              [&](size_t worker, size_t index) {
+                                visits[index].fetch_add(1);
+                                workers[index] = worker;
+                              });
+  for (size_t i = 0; i < kSize; ++i) {
+    EXPECT_EQ(visits[i].load(), 1);
+    EXPECT_LT(workers[i], kNumWorkers);
+  }
+}
+
+}  // namespace
+}  // namespace mozc
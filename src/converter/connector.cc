@@ -29,16 +29,17 @@
 
 #include "converter/connector.h"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
 #include <new>
 #include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
 #include "absl/status/status.h"
@@ -70,6 +71,10 @@ inline uint32_t EncodeKey(uint16_t rid, uint16_t lid) {
   return (static_cast<uint32_t>(rid) << 16) | lid;
 }
 
+inline uint64_t EncodeCacheEntry(uint32_t key, int value) {
+  return (static_cast<uint64_t>(key) << 32) | static_cast<uint32_t>(value);
+}
+
 absl::Status IsMemoryAligned32(const void *ptr) {
   const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
   const auto alignment = addr % 4;
@@ -205,8 +210,7 @@ absl::Status Connector::Init(const char *connection_data,
         "connector.cc: Cache size must be 2^n: size=", cache_size));
   }
   cache_hash_mask_ = cache_size - 1;
-  cache_key_.resize(cache_size);
-  cache_value_.resize(cache_size);
+  cache_ = std::make_unique<std::atomic<uint64_t>[]>(cache_size);
 
   absl::StatusOr<Metadata> metadata =
       ParseMetadata(connection_data, connection_size);
@@ -312,17 +316,25 @@ absl::Status Connector::Init(const char *connection_data,
 
 int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
   const uint32_t index = EncodeKey(rid, lid);
-  const uint32_t bucket = GetHashValue(rid, lid, cache_hash_mask_);
-  if (cache_key_[bucket] == index) {
-    return cache_value_[bucket];
+  std::atomic<uint64_t> &entry =
+      cache_[GetHashValue(rid, lid, cache_hash_mask_)];
+  // Relaxed ordering is enough as the entry is self-contained and the costs
+  // never change.
+  const uint64_t cached = entry.load(std::memory_order_relaxed);
+  if (static_cast<uint32_t>(cached >> 32) == index) {
+    return static_cast<int>(static_cast<uint32_t>(cached));
   }
   const int value = LookupCost(rid, lid);
-  cache_key_[bucket] = index;
-  cache_value_[bucket] = value;
+  entry.store(EncodeCacheEntry(index, value), std::memory_order_relaxed);
   return value;
 }
 
-void Connector::ClearCache() { absl::c_fill(cache_key_, kInvalidCacheKey); }
+void Connector::ClearCache() {
+  const uint64_t invalid = EncodeCacheEntry(kInvalidCacheKey, 0);
+  for (uint32_t i = 0; i <= cache_hash_mask_; ++i) {
+    cache_[i].store(invalid, std::memory_order_relaxed);
+  }
+}
 
 int Connector::LookupCost(uint16_t rid, uint16_t lid) const {
   std::optional<uint16_t> value = rows_[rid].GetValue(lid);
@@ -30,8 +30,10 @@
 #ifndef MOZC_CONVERTER_CONNECTOR_H_
 #define MOZC_CONVERTER_CONNECTOR_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -42,6 +44,8 @@
 
 namespace mozc {
 
+// Connector is immutable except for the cache of transition costs, which is
+// lock-free. GetTransitionCost() can be called from multiple threads.
 class Connector final {
  public:
   static constexpr int16_t kInvalidCost = 30000;
@@ -70,8 +74,9 @@ class Connector final {
   const uint16_t *default_cost_ = nullptr;
   int resolution_ = 0;
   uint32_t cache_hash_mask_ = 0;
-  mutable std::vector<uint32_t> cache_key_;
-  mutable std::vector<int> cache_value_;
+  // Each entry holds the key in the upper 32 bits and the cost in the lower
+  // 32 bits so that the threads never see a key with the cost of another.
+  std::unique_ptr<std::atomic<uint64_t>[]> cache_;
 };
 
 class Connector::Row final {
@@ -39,6 +39,7 @@
 #include "absl/random/random.h"
 #include "absl/status/statusor.h"
 #include "base/mmap.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "data_manager/connection_file_reader.h"
 #include "testing/gmock.h"
@@ -93,6 +94,50 @@ TEST(ConnectorTest, CompareWithRawData) {
   }
 }
 
+TEST(ConnectorTest, ConcurrentLookup) {
+  const std::string path = testing::GetSourceFileOrDie(
+      {MOZC_SRC_COMPONENTS("data_manager"), "testing", "connection.data"});
+  absl::StatusOr<Mmap> cmmap = Mmap::Map(path);
+  ASSERT_OK(cmmap) << cmmap.status();
+  // A small cache to make the threads compete for the entries.
+  absl::StatusOr<Connector> connector =
+      Connector::Create(cmmap->begin(), cmmap->size(), 16);
+  ASSERT_OK(connector);
+
+  const std::string connection_text_path = testing::GetSourceFileOrDie(
+      {MOZC_DICT_DIR_COMPONENTS, "test", "dictionary",
+       "connection_single_column.txt"});
+  std::vector<ConnectionDataEntry> data;
+  for (ConnectionFileReader reader(connection_text_path); !reader.done();
+       reader.Next()) {
+    data.push_back(
+        {reader.rid_of_left_node(), reader.lid_of_right_node(), reader.cost()});
+  }
+
+  constexpr int kNumThreads = 4;
+  constexpr size_t kNumLookups = 100000;
+  std::vector<Thread> threads;
+  std::vector<size_t> mismatches(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      absl::BitGen urbg;
+      for (size_t n = 0; n < kNumLookups; ++n) {
+        const ConnectionDataEntry &entry =
+            data[absl::Uniform<size_t>(urbg, 0, data.size())];
+        if (connector->GetTransitionCost(entry.rid, entry.lid) != entry.cost) {
+          ++mismatches[i];
+        }
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(mismatches[i], 0) << "thread " << i;
+  }
+}
+
 TEST(ConnectorTest, BrokenData) {
   const std::string path = testing::GetSourceFileOrDie(
       {MOZC_SRC_COMPONENTS("data_manager"), "testing", "connection.data"});
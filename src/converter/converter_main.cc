@@ -47,16 +47,20 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/init_mozc.h"
 #include "base/number_util.h"
 #include "base/protobuf/text_format.h"
 #include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
 #include "config/config_handler.h"
+#include "converter/batch_converter.h"
 #include "converter/converter_interface.h"
 #include "converter/lattice.h"
 #include "converter/pos_id_printer.h"
@@ -64,6 +68,7 @@
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
 #include "engine/engine_interface.h"
+#include "engine/modules.h"
 #include "engine/supplemental_model_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
@@ -86,6 +91,12 @@ ABSL_FLAG(bool, output_debug_string, true,
 ABSL_FLAG(size_t, max_candidates_to_show, 100,
           "Max number of candidates to show per segment");
 ABSL_FLAG(bool, show_meta_candidates, false, "if true, show meta candidates");
+ABSL_FLAG(std::string, batch_input, "",
+          "If nonempty, converts the keys in this file, one per line, in "
+          "parallel instead of running the interactive commands.");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "Number of threads for --batch_input. The engines of the threads "
+          "share the loaded data.");
 
 // Advanced options for data files.  These are automatically set when --engine
 // is used but they can be overridden by specifying these flags.
@@ -465,6 +476,55 @@ void RunLoop(std::unique_ptr<EngineInterface> engine,
   }
 }
 
+// Converts the keys in |batch_input|, one per line, on the converters of
+// |engines| in parallel. The results are printed in the order of the keys.
+void RunBatch(const std::string &batch_input,
+              absl::Span<const std::unique_ptr<Engine>> engines,
+              const commands::Request &request, const config::Config &config) {
+  std::vector<std::string> keys;
+  {
+    InputFileStream ifs(batch_input);
+    CHECK(ifs.good()) << "Failed to read: " << batch_input;
+    std::string line;
+    while (!std::getline(ifs, line).fail()) {
+      if (!line.empty()) {
+        keys.push_back(std::move(line));
+      }
+    }
+  }
+
+  std::vector<const ConverterInterface *> converters;
+  for (const std::unique_ptr<Engine> &engine : engines) {
+    converters.push_back(engine->GetConverter());
+  }
+  const BatchConverter batch_converter(std::move(converters));
+
+  const Stopwatch stopwatch = Stopwatch::StartNew();
+  const std::vector<Segments> results =
+      batch_converter.ConvertBatch(keys, request, config);
+  const absl::Duration elapsed = stopwatch.GetElapsed();
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (absl::GetFlag(FLAGS_output_debug_string)) {
+      std::cout << "========== " << keys[i] << " ==========" << std::endl;
+      PrintSegments(results[i], &std::cout);
+      continue;
+    }
+    std::string value;
+    for (const Segment &segment : results[i]) {
+      if (segment.candidates_size() > 0) {
+        value += segment.candidate(0).value;
+      }
+    }
+    std::cout << keys[i] << "\t" << value << std::endl;
+  }
+  std::cout << absl::StreamFormat(
+                   "%d sentences in %s with %d threads: %.1f sentences/s",
+                   keys.size(), absl::FormatDuration(elapsed), engines.size(),
+                   keys.size() / absl::ToDoubleSeconds(elapsed))
+            << std::endl;
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -510,12 +570,11 @@ int main(int argc, char **argv) {
 
   mozc::config::Config config = mozc::config::ConfigHandler::DefaultConfig();
   mozc::commands::Request request;
-  std::unique_ptr<mozc::EngineInterface> engine;
+  bool is_mobile = false;
   if (absl::GetFlag(FLAGS_engine_type) == "desktop") {
-    engine =
-        mozc::Engine::CreateDesktopEngine(*std::move(data_manager)).value();
+    is_mobile = false;
   } else if (absl::GetFlag(FLAGS_engine_type) == "mobile") {
-    engine = mozc::Engine::CreateMobileEngine(*std::move(data_manager)).value();
+    is_mobile = true;
     mozc::request_test_util::FillMobileRequest(&request);
     config.set_use_kana_modifier_insensitive_conversion(true);
   } else {
@@ -539,6 +598,25 @@ int main(int argc, char **argv) {
     LOG(WARNING) << "Engine name and type do not match.";
   }
 
+  if (const std::string &batch_input = absl::GetFlag(FLAGS_batch_input);
+      !batch_input.empty()) {
+    // The engines share the modules so that the data is loaded only once.
+    auto modules = std::make_shared<mozc::engine::Modules>();
+    CHECK_OK(modules->Init(*std::move(data_manager)));
+    std::vector<std::unique_ptr<mozc::Engine>> engines;
+    for (int i = 0; i < std::max(absl::GetFlag(FLAGS_num_threads), 1); ++i) {
+      engines.push_back(
+          mozc::Engine::CreateEngineWithSharedModules(modules, is_mobile)
+              .value());
+    }
+    mozc::RunBatch(batch_input, engines, request, config);
+    return 0;
+  }
+
+  std::unique_ptr<mozc::EngineInterface> engine =
+      is_mobile
+          ? mozc::Engine::CreateMobileEngine(*std::move(data_manager)).value()
+          : mozc::Engine::CreateDesktopEngine(*std::move(data_manager)).value();
   mozc::RunLoop(std::move(engine), std::move(request), std::move(config));
   return 0;
 }
@@ -261,16 +261,20 @@ Lattice *GetLattice(Segments *segments, bool is_prediction) {
 
   const size_t lattice_history_end_pos = lattice->history_end_pos();
 
-  if (!is_prediction || Util::CharsLen(conversion_key) <= 1 ||
+  if (!is_prediction || !lattice->is_prediction() ||
+      Util::CharsLen(conversion_key) <= 1 ||
       lattice_history_end_pos != history_key.size()) {
     // Do not cache if conversion is not prediction.  In addition, if a user
     // input the key right after the finish of conversion, reset the lattice to
     // erase old nodes.  Even if the lattice key is not changed, we should reset
     // the lattice when the history size is changed.  When we submit the
     // candidate partially, the entire key will not changed, but the history
-    // position will be changed.
+    // position will be changed.  The lattice may be shared between conversion
+    // and prediction (see Segments::ShareCachedLattice()), so the nodes made
+    // for conversion are not reused for prediction either.
     lattice->Clear();
   }
+  lattice->set_is_prediction(is_prediction);
 
   return lattice;
 }
@@ -1154,6 +1158,7 @@ bool ImmutableConverter::PredictionViterbi(const Segments &segments,
   }
   PredictionViterbiInternal(0, history_length, lattice);
   PredictionViterbiInternal(history_length, key_length, lattice);
+  lattice->MarkViterbiCacheClean();
 
   Node *node = lattice->eos_nodes();
   CHECK(node->bnext == nullptr);
@@ -1189,6 +1194,17 @@ BestMap::iterator LowerBound(BestMap &best_map,
          const std::pair<int, CostAndNode> &r) { return l.first < r.first; });
 }
 
+// Returns true if |best_map| has the same ids and costs as |costs|.
+bool HasSameCosts(const BestMap &best_map,
+                  absl::Span<const std::pair<int, int>> costs) {
+  return std::equal(best_map.begin(), best_map.end(), costs.begin(),
+                    costs.end(),
+                    [](const std::pair<int, CostAndNode> &l,
+                       const std::pair<int, int> &r) {
+                      return l.first == r.first && l.second.first == r.second;
+                    });
+}
+
 }  // namespace
 
 void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
@@ -1239,16 +1255,42 @@ void ImmutableConverter::PredictionViterbiInternal(int calc_begin_pos,
       continue;
     }
 
-    for (BestMap::iterator liter = lbest.begin(); liter != lbest.end();
-         ++liter) {
-      for (BestMap::iterator riter = rbest.begin(); riter != rbest.end();
-           ++riter) {
-        const int cost = liter->second.first + connector_.GetTransitionCost(
-                                                   liter->first, riter->first);
-        if (cost < riter->second.first) {
-          riter->second.first = cost;
-          riter->second.second = liter->second.second;
+    // The best costs for the lids depend only on the costs in |lbest|, so the
+    // cached ones are reused as long as |lbest| is unchanged.
+    Lattice::ViterbiCache &cache = lattice->mutable_viterbi_cache(pos);
+    if (pos >= lattice->viterbi_dirty_pos() ||
+        !HasSameCosts(lbest, cache.left_costs)) {
+      cache.left_costs.clear();
+      for (const auto &[rid, cost_and_node] : lbest) {
+        cache.left_costs.emplace_back(rid, cost_and_node.first);
+      }
+      cache.right_costs.clear();
+    }
+
+    for (BestMap::iterator riter = rbest.begin(); riter != rbest.end();
+         ++riter) {
+      const int lid = riter->first;
+      auto cache_iter = std::lower_bound(
+          cache.right_costs.begin(), cache.right_costs.end(), lid,
+          [](const auto &entry, int id) { return entry.first < id; });
+      if (cache_iter == cache.right_costs.end() || cache_iter->first != lid) {
+        int best_cost = INT_MAX;
+        int best_index = -1;
+        for (size_t i = 0; i < lbest.size(); ++i) {
+          const int cost = lbest[i].second.first +
+                           connector_.GetTransitionCost(lbest[i].first, lid);
+          if (cost < best_cost) {
+            best_cost = cost;
+            best_index = static_cast<int>(i);
+          }
         }
+        cache_iter = cache.right_costs.emplace(
+            cache_iter, lid, std::make_pair(best_cost, best_index));
+      }
+      const auto [best_cost, best_index] = cache_iter->second;
+      if (best_index >= 0) {
+        riter->second.first = best_cost;
+        riter->second.second = lbest[best_index].second.second;
       }
     }
 
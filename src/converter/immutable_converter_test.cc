@@ -38,8 +38,13 @@
 #include <vector>
 
 #include "absl/log/check.h"
+#include "absl/log/log.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "converter/lattice.h"
 #include "converter/node.h"
@@ -131,6 +136,107 @@ TEST(ImmutableConverterTest, KeepKeyForPrediction) {
   EXPECT_EQ(segments.segment(0).key(), kRequestKey);
 }
 
+TEST(ImmutableConverterTest, SharedCachedLattice) {
+  auto data_and_converter = std::make_unique<MockDataAndImmutableConverter>();
+  ImmutableConverter *converter = data_and_converter->GetConverter();
+  Segments segments;
+  segments.add_segment()->set_key("よろしく");
+  const Lattice *lattice = segments.mutable_cached_lattice();
+
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+
+  // A temporary copy converted on behalf of |segments| fills its cache.
+  {
+    Segments tmp_segments = segments;
+    tmp_segments.ShareCachedLattice(segments);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &tmp_segments));
+  }
+  EXPECT_EQ(lattice->key(), "よろしく");
+  EXPECT_TRUE(lattice->is_prediction());
+  EXPECT_GT(lattice->cache_info(0), 0);
+
+  // The next key stroke extends the cached lattice.
+  segments.mutable_conversion_segment(0)->set_key("よろしくお");
+  {
+    Segments tmp_segments = segments;
+    tmp_segments.ShareCachedLattice(segments);
+    ASSERT_TRUE(converter->ConvertForRequest(request, &tmp_segments));
+  }
+  EXPECT_EQ(lattice->key(), "よろしくお");
+  EXPECT_TRUE(lattice->is_prediction());
+
+  // Conversion rebuilds the lattice without the cache.
+  request.set_request_type(ConversionRequest::CONVERSION);
+  ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+  EXPECT_FALSE(lattice->is_prediction());
+  EXPECT_EQ(lattice->cache_info(0), 0);
+}
+
+TEST(ImmutableConverterTest, IncrementalPredictionViterbi) {
+  auto data_and_converter = std::make_unique<MockDataAndImmutableConverter>();
+  ImmutableConverter *converter = data_and_converter->GetConverter();
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+
+  constexpr absl::string_view kKey = "きょうはとてもいいてんきですね";
+  Segments segments;
+  segments.add_segment();
+  Lattice *lattice = segments.mutable_cached_lattice();
+  for (size_t len = 2; len <= Util::CharsLen(kKey); ++len) {
+    Segment *segment = segments.mutable_conversion_segment(0);
+    segment->set_key(Util::Utf8SubString(kKey, 0, len));
+    segment->clear_candidates();
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+    const Segment incremental = segments.conversion_segment(0);
+
+    // The result must be the same as the one from scratch on the same lattice.
+    lattice->InvalidateViterbiCache();
+    segments.mutable_conversion_segment(0)->clear_candidates();
+    ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+    EXPECT_THAT(segments.conversion_segment(0), EqualsSegment(incremental));
+  }
+}
+
+// Logs the latency of prediction for each key length with and without the
+// Viterbi cache. Run with --gtest_also_run_disabled_tests.
+TEST(ImmutableConverterTest, DISABLED_IncrementalPredictionViterbiLatency) {
+  auto data_and_converter = std::make_unique<MockDataAndImmutableConverter>();
+  ImmutableConverter *converter = data_and_converter->GetConverter();
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::PREDICTION);
+  request.set_max_conversion_candidates_size(10);
+
+  constexpr absl::string_view kKey =
+      "きょうはとてもいいてんきなのでこうえんまでさんぽにいきました";
+  constexpr int kNumRepeats = 20;
+  for (const bool incremental : {false, true}) {
+    std::vector<absl::Duration> durations(Util::CharsLen(kKey) + 1);
+    for (int i = 0; i < kNumRepeats; ++i) {
+      Segments segments;
+      segments.add_segment();
+      for (size_t len = 2; len < durations.size(); ++len) {
+        Segment *segment = segments.mutable_conversion_segment(0);
+        segment->set_key(Util::Utf8SubString(kKey, 0, len));
+        segment->clear_candidates();
+        if (!incremental) {
+          segments.mutable_cached_lattice()->InvalidateViterbiCache();
+        }
+        Stopwatch stopwatch = Stopwatch::StartNew();
+        ASSERT_TRUE(converter->ConvertForRequest(request, &segments));
+        durations[len] += stopwatch.GetElapsed();
+      }
+    }
+    for (size_t len = 2; len < durations.size(); ++len) {
+      LOG(INFO) << (incremental ? "incremental" : "from scratch")
+                << " length: " << len
+                << " latency: " << durations[len] / kNumRepeats;
+    }
+  }
+}
+
 TEST(ImmutableConverterTest, DummyCandidatesCost) {
   std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
       new MockDataAndImmutableConverter);
@@ -641,4 +747,71 @@ TEST(ImmutableConverterTest, FirstInnerSegmentFilteringParams) {
   }
 }
 
+// One set of modules is shared by the converters running on different
+// threads. Build with --config=tsan to check the data races.
+TEST(ImmutableConverterTest, ConcurrentConversionOverSharedModules) {
+  engine::Modules modules;
+  modules.PresetUserDictionary(std::make_unique<UserDictionaryStub>());
+  ASSERT_OK(modules.Init(std::make_unique<testing::MockDataManager>()));
+
+  struct Query {
+    ConversionRequest::RequestType type;
+    absl::string_view key;
+  };
+  constexpr Query kQueries[] = {
+      {ConversionRequest::CONVERSION, "きょうはいいてんきです"},
+      {ConversionRequest::CONVERSION, "わたしのなまえはなかのです"},
+      {ConversionRequest::CONVERSION, "しょうめいできる"},
+      {ConversionRequest::PREDICTION, "よろしくおねがいしま"},
+      {ConversionRequest::REVERSE_CONVERSION, "今日はいい天気です"},
+      {ConversionRequest::REVERSE_CONVERSION, "私の名前は中野です"},
+  };
+  // Returns the top candidates of each query.
+  const auto convert_all = [&](const ImmutableConverter &converter) {
+    std::vector<std::string> results;
+    for (const Query &query : kQueries) {
+      ConversionRequest request;
+      request.set_request_type(query.type);
+      request.set_max_conversion_candidates_size(10);
+      Segments segments;
+      segments.add_segment()->set_key(query.key);
+      std::string result;
+      if (converter.ConvertForRequest(request, &segments)) {
+        for (const Segment &segment : segments.conversion_segments()) {
+          if (segment.candidates_size() > 0) {
+            absl::StrAppend(&result, segment.candidate(0).value, "|");
+          }
+        }
+      }
+      results.push_back(std::move(result));
+    }
+    return results;
+  };
+
+  const std::vector<std::string> expected =
+      convert_all(ImmutableConverter(modules));
+
+  constexpr int kNumThreads = 4;
+  constexpr int kNumRounds = 10;
+  std::vector<std::vector<std::string>> results(kNumThreads);
+  std::vector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      const ImmutableConverter converter(modules);
+      for (int round = 0; round < kNumRounds; ++round) {
+        results[i] = convert_all(converter);
+        if (results[i] != expected) {
+          return;
+        }
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(results[i], expected) << "thread " << i;
+  }
+}
+
 }  // namespace mozc
@@ -157,6 +157,7 @@ void Lattice::SetKey(std::string key) {
   begin_nodes_.resize(size + 4, nullptr);
   end_nodes_.resize(size + 4, nullptr);
   cache_info_.resize(size + 4, 0);
+  viterbi_cache_.resize(size + 4);
 
   end_nodes_[0] = InitBOSNode(this, static_cast<uint16_t>(0));
   begin_nodes_[key_.size()] =
@@ -195,6 +196,8 @@ void Lattice::Clear() {
   node_allocator_->Free();
   cache_info_.clear();
   history_end_pos_ = 0;
+  is_prediction_ = false;
+  viterbi_dirty_pos_ = 0;
 }
 
 void Lattice::SetDebugDisplayNode(size_t begin_pos, size_t end_pos,
@@ -254,6 +257,10 @@ void Lattice::AddSuffix(const absl::string_view suffix_key) {
   // update cache_info
   cache_info_.resize(new_size + 4, 0);
 
+  // The nodes ending at |old_size| are no longer the last ones.
+  viterbi_cache_.resize(new_size + 4);
+  viterbi_dirty_pos_ = std::min(viterbi_dirty_pos_, old_size);
+
   // update key
   absl::StrAppend(&key_, suffix_key);
 }
@@ -300,6 +307,8 @@ void Lattice::ShrinkKey(const size_t new_len) {
   }
   std::fill(cache_info_.begin() + new_len, cache_info_.end(), 0);
 
+  viterbi_dirty_pos_ = std::min(viterbi_dirty_pos_, new_len);
+
   // update key
   key_.erase(new_len);
 }
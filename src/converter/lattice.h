@@ -33,6 +33,7 @@
 #include <cstddef>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/log/check.h"
@@ -44,6 +45,19 @@ namespace mozc {
 
 class Lattice {
  public:
+  // Forward costs of ImmutableConverter::PredictionViterbi() kept for a
+  // position so that the costs for the unchanged prefix of the key are not
+  // recomputed on the next key stroke.
+  struct ViterbiCache {
+    // (rid, best cost) of the nodes ending at the position, sorted by rid.
+    // The cache is valid only while these costs don't change.
+    std::vector<std::pair<int, int>> left_costs;
+    // (lid, (best cost, index into left_costs)) for the nodes beginning at the
+    // position, sorted by lid. The index is the back-pointer of the best path
+    // and is -1 if no path reaches the lid.
+    std::vector<std::pair<int, std::pair<int, int>>> right_costs;
+  };
+
   Lattice()
       : history_end_pos_(0),
         node_allocator_(std::make_unique<NodeAllocator>()) {}
@@ -62,6 +76,13 @@ class Lattice {
 
   size_t history_end_pos() const { return history_end_pos_; }
 
+  // Set whether the nodes are looked up for prediction.
+  // A lattice made for conversion lacks the predictive nodes, so it cannot be
+  // reused for prediction and vice versa.
+  void set_is_prediction(bool is_prediction) { is_prediction_ = is_prediction; }
+
+  bool is_prediction() const { return is_prediction_; }
+
   // allocate new node.
   Node *NewNode() { return node_allocator_->NewNode(); }
 
@@ -111,6 +132,22 @@ class Lattice {
     cache_info_[pos] = len;
   }
 
+  // Returns the Viterbi cache for |pos|.
+  ViterbiCache &mutable_viterbi_cache(size_t pos) {
+    CHECK_LE(pos, key_.size());
+    return viterbi_cache_[pos];
+  }
+
+  // The Viterbi cache of positions at or after viterbi_dirty_pos() is stale
+  // because the key was changed there.
+  size_t viterbi_dirty_pos() const { return viterbi_dirty_pos_; }
+
+  // Marks the Viterbi cache of all the positions up to date.
+  void MarkViterbiCacheClean() { viterbi_dirty_pos_ = key_.size() + 1; }
+
+  // Discards the Viterbi cache so that the next Viterbi runs from scratch.
+  void InvalidateViterbiCache() { viterbi_dirty_pos_ = 0; }
+
   // revert the wcost of nodes if it has ENABLE_CACHE attribute.
   // This function is needed for wcost may be changed during conversion
   // process for some heuristic methods.
@@ -130,6 +167,7 @@ class Lattice {
   // TODO(team): Splitting the cache module may make this module simpler.
   std::string key_;
   size_t history_end_pos_;
+  bool is_prediction_ = false;
   std::vector<Node *> begin_nodes_;
   std::vector<Node *> end_nodes_;
   std::unique_ptr<NodeAllocator> node_allocator_;
@@ -138,6 +176,9 @@ class Lattice {
   // If cache_info_[pos] equals to len, it means key.substr(pos, k)
   // (1 <= k <= len) is already looked up.
   std::vector<size_t> cache_info_;
+
+  std::vector<ViterbiCache> viterbi_cache_;
+  size_t viterbi_dirty_pos_ = 0;
 };
 
 }  // namespace mozc
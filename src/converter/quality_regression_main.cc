@@ -27,6 +27,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -39,9 +41,12 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "base/file/temp_dir.h"
 #include "base/init_mozc.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
 #include "converter/quality_regression_util.h"
 #include "engine/engine.h"
@@ -52,30 +57,53 @@ ABSL_FLAG(std::string, data_file, "", "engine data file");
 ABSL_FLAG(std::string, data_type, "", "engine data type");
 ABSL_FLAG(std::string, engine_type, "desktop", "engine type");
 ABSL_FLAG(std::string, output, "", "output file");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "number of threads to run the tests. The engines of the threads "
+          "share the loaded data.");
 
 namespace {
 
 using ::mozc::Engine;
+using ::mozc::Stopwatch;
 using ::mozc::TempDirectory;
 using ::mozc::quality_regression::QualityRegressionUtil;
 
-absl::Status Run(std::ostream &out, const Engine &engine,
+absl::Status Run(std::ostream &out,
+                 absl::Span<const std::unique_ptr<Engine>> engines,
                  absl::Span<const QualityRegressionUtil::TestItem> items) {
-  QualityRegressionUtil util(engine.GetConverter());
-  for (const QualityRegressionUtil::TestItem &item : items) {
-    std::string actual_value;
-    const absl::StatusOr<bool> result =
-        util.ConvertAndTest(item, &actual_value);
-    if (!result.ok()) {
-      return result.status();
+  std::vector<std::unique_ptr<QualityRegressionUtil>> utils;
+  std::vector<QualityRegressionUtil *> util_ptrs;
+  for (const std::unique_ptr<Engine> &engine : engines) {
+    utils.push_back(
+        std::make_unique<QualityRegressionUtil>(engine->GetConverter()));
+    util_ptrs.push_back(utils.back().get());
+  }
+
+  const Stopwatch stopwatch = Stopwatch::StartNew();
+  const std::vector<QualityRegressionUtil::TestResult> results =
+      QualityRegressionUtil::ConvertAndTestAll(util_ptrs, items);
+  const absl::Duration elapsed = stopwatch.GetElapsed();
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    const QualityRegressionUtil::TestItem &item = items[i];
+    const QualityRegressionUtil::TestResult &result = results[i];
+    if (!result.result.ok()) {
+      return result.result.status();
     }
-    out << (result.value() ? "OK:\t" : "FAILED:\t") << item.key << "\t"
-        << actual_value << "\t" << item.command;
+    out << (result.result.value() ? "OK:\t" : "FAILED:\t") << item.key << "\t"
+        << result.actual_value << "\t" << item.command;
     if (item.expected_rank != 0) {
       out << " " << item.expected_rank;
     }
     out << "\t" << item.expected_value << "\t" << std::endl;
   }
+
+  // Reported separately so that the output stays comparable between runs.
+  std::cerr << absl::StreamFormat(
+                   "%d sentences in %s with %d threads: %.1f sentences/s",
+                   items.size(), absl::FormatDuration(elapsed), engines.size(),
+                   items.size() / absl::ToDoubleSeconds(elapsed))
+            << std::endl;
   return absl::OkStatus();
 }
 
@@ -88,10 +116,11 @@ int main(int argc, char **argv) {
   CHECK_OK(temp_dir);
   mozc::SystemUtil::SetUserProfileDirectory(temp_dir->path());
 
-  absl::StatusOr<std::unique_ptr<Engine>> create_result =
-      mozc::CreateEvalEngine(absl::GetFlag(FLAGS_data_file),
-                             absl::GetFlag(FLAGS_data_type),
-                             absl::GetFlag(FLAGS_engine_type));
+  absl::StatusOr<std::vector<std::unique_ptr<Engine>>> create_result =
+      mozc::CreateEvalEngines(absl::GetFlag(FLAGS_data_file),
+                              absl::GetFlag(FLAGS_data_type),
+                              absl::GetFlag(FLAGS_engine_type),
+                              absl::GetFlag(FLAGS_num_threads));
   if (!create_result.ok()) {
     LOG(ERROR) << create_result.status();
     return static_cast<int>(create_result.status().code());
@@ -108,9 +137,9 @@ int main(int argc, char **argv) {
   absl::Status status;
   if (!absl::GetFlag(FLAGS_output).empty()) {
     std::ofstream out(absl::GetFlag(FLAGS_output));
-    status = Run(out, *create_result.value(), items);
+    status = Run(out, *create_result, items);
   } else {
-    status = Run(std::cout, *create_result.value(), items);
+    status = Run(std::cout, *create_result, items);
   }
   if (!status.ok()) {
     LOG(ERROR) << status;
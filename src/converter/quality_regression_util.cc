@@ -53,6 +53,7 @@
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
+#include "converter/batch_converter.h"
 #include "converter/converter_interface.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
@@ -125,6 +126,11 @@ absl::StatusOr<uint32_t> GetPlatformFromString(absl::string_view str) {
   return absl::InvalidArgumentError(
       absl::StrCat("Unknown platform name: ", str));
 }
+
+// ZeroQuery commits the top candidate, so the user history learns from it.
+bool LearnsHistory(absl::string_view command) {
+  return command == kZeroQueryExpect || command == kZeroQueryNotExpect;
+}
 }  // namespace
 
 std::string QualityRegressionUtil::TestItem::OutputAsTSV() const {
@@ -348,6 +354,46 @@ absl::StatusOr<bool> QualityRegressionUtil::ConvertAndTest(
   return result;
 }
 
+// static
+std::vector<QualityRegressionUtil::TestResult>
+QualityRegressionUtil::ConvertAndTestAll(
+    absl::Span<QualityRegressionUtil *const> utils,
+    absl::Span<const TestItem> items) {
+  std::vector<TestResult> results(items.size());
+  size_t begin = 0;
+  while (begin < items.size()) {
+    // The items which don't learn run in parallel up to the next learning
+    // item, so that they see the same history as they do in order.
+    size_t end = begin;
+    while (end < items.size() && !LearnsHistory(items[end].command)) {
+      ++end;
+    }
+    BatchConverter::ParallelFor(
+        utils.size(), end - begin, [&](size_t worker, size_t i) {
+          TestResult &result = results[begin + i];
+          result.result = utils[worker]->ConvertAndTest(items[begin + i],
+                                                        &result.actual_value);
+        });
+    if (end == items.size()) {
+      break;
+    }
+    // Every util learns the item, so that the following items see the history
+    // regardless of the util they run on. The utils learn one by one as their
+    // engines share the files of the user profile. The result is taken from
+    // the first.
+    for (size_t i = 0; i < utils.size(); ++i) {
+      TestResult learned;
+      learned.result =
+          utils[i]->ConvertAndTest(items[end], &learned.actual_value);
+      if (i == 0) {
+        results[end] = std::move(learned);
+      }
+    }
+    begin = end + 1;
+  }
+  return results;
+}
+
 void QualityRegressionUtil::SetRequest(const commands::Request &request) {
   request_ = request;
 }
@@ -73,6 +73,11 @@ class QualityRegressionUtil {
     absl::Status ParseFromTSV(const std::string &tsv_line);
   };
 
+  struct TestResult {
+    absl::StatusOr<bool> result;
+    std::string actual_value;
+  };
+
   explicit QualityRegressionUtil(ConverterInterface *converter);
   QualityRegressionUtil(const QualityRegressionUtil &) = delete;
   QualityRegressionUtil &operator=(const QualityRegressionUtil &) = delete;
@@ -87,6 +92,16 @@ class QualityRegressionUtil {
   absl::StatusOr<bool> ConvertAndTest(const TestItem &item,
                                       std::string *actual_value);
 
+  // Runs ConvertAndTest() for |items| on |utils| and returns the results in
+  // the order of |items|. Each util needs its own converter, e.g., from engines
+  // sharing one engine::Modules. The items keep their order: the items between
+  // two items which learn the user history (ZeroQuery) run in parallel, one
+  // thread per util, and each learning item runs on all the utils one by one
+  // at its position. The results don't depend on the number of utils.
+  static std::vector<TestResult> ConvertAndTestAll(
+      absl::Span<QualityRegressionUtil *const> utils,
+      absl::Span<const TestItem> items);
+
   void SetRequest(const commands::Request &request);
   void SetConfig(const config::Config &config);
   static std::string GetPlatformString(uint32_t platform_bitfiled);
@@ -0,0 +1,149 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "converter/quality_regression_util.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/statusor.h"
+#include "base/file/temp_dir.h"
+#include "base/system_util.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "engine/engine.h"
+#include "engine/modules.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+
+namespace mozc {
+namespace quality_regression {
+namespace {
+
+QualityRegressionUtil::TestItem MakeItem(const std::string &key,
+                                         const std::string &expected_value,
+                                         const std::string &command) {
+  QualityRegressionUtil::TestItem item;
+  item.label = "test";
+  item.key = key;
+  item.expected_value = expected_value;
+  item.command = command;
+  item.accuracy = 1.0;
+  item.expected_rank = 0;
+  item.platform = QualityRegressionUtil::DESKTOP;
+  return item;
+}
+
+// Runs |items| on |num_utils| engines sharing one modules, with a fresh user
+// profile.
+std::vector<QualityRegressionUtil::TestResult> RunAll(
+    size_t num_utils, const std::vector<QualityRegressionUtil::TestItem> &items) {
+  const TempDirectory profile = testing::MakeTempDirectoryOrDie();
+  SystemUtil::SetUserProfileDirectory(profile.path());
+
+  auto modules = std::make_shared<engine::Modules>();
+  CHECK_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+  std::vector<std::unique_ptr<Engine>> engines;
+  std::vector<std::unique_ptr<QualityRegressionUtil>> utils;
+  std::vector<QualityRegressionUtil *> util_ptrs;
+  for (size_t i = 0; i < num_utils; ++i) {
+    absl::StatusOr<std::unique_ptr<Engine>> engine =
+        Engine::CreateEngineWithSharedModules(modules, /*is_mobile=*/false);
+    CHECK_OK(engine);
+    engines.push_back(*std::move(engine));
+    utils.push_back(std::make_unique<QualityRegressionUtil>(
+        engines.back()->GetConverter()));
+    util_ptrs.push_back(utils.back().get());
+  }
+  return QualityRegressionUtil::ConvertAndTestAll(util_ptrs, items);
+}
+
+TEST(QualityRegressionUtilTest, ConvertAndTestAllDoesNotDependOnUtils) {
+  // ZeroQuery items learn the committed candidate, and the other items may
+  // read what has been learned.
+  const std::vector<QualityRegressionUtil::TestItem> items = {
+      MakeItem("わたしのなまえはなかのです", "私の名前は中野です",
+               "Conversion Expected"),
+      MakeItem("ありがとう", "ございます", "ZeroQuery Expected"),
+      MakeItem("ありがと", "ありがとう", "Suggestion Expected"),
+      MakeItem("かいぎ", "会議", "Conversion Expected"),
+      MakeItem("きょう", "は", "ZeroQuery Expected"),
+      MakeItem("きょうは", "今日は", "Prediction Expected"),
+      MakeItem("ありがとう", "ございます", "ZeroQuery Not Expected"),
+      MakeItem("なかの", "中野", "Conversion Expected"),
+      MakeItem("きょう", "今日", "Suggestion Expected"),
+  };
+
+  const std::vector<QualityRegressionUtil::TestResult> serial =
+      RunAll(1, items);
+  const std::vector<QualityRegressionUtil::TestResult> parallel =
+      RunAll(4, items);
+  ASSERT_EQ(serial.size(), items.size());
+  ASSERT_EQ(parallel.size(), items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    SCOPED_TRACE(items[i].OutputAsTSV());
+    // An item without candidates fails the same way.
+    ASSERT_EQ(parallel[i].result.ok(), serial[i].result.ok());
+    if (serial[i].result.ok()) {
+      EXPECT_EQ(*parallel[i].result, *serial[i].result);
+    }
+    EXPECT_EQ(parallel[i].actual_value, serial[i].actual_value);
+  }
+}
+
+TEST(QualityRegressionUtilTest, ConvertAndTestAllKeepsOrder) {
+  // The sentence is suggested only after the ZeroQuery item commits it.
+  QualityRegressionUtil::TestItem suggestion =
+      MakeItem("わたしのなま", "私の名前は中野です", "Suggestion Expected");
+  suggestion.expected_rank = 10;
+  const std::vector<QualityRegressionUtil::TestItem> items = {
+      suggestion,
+      MakeItem("わたしのなまえはなかのです", "ございます",
+               "ZeroQuery Not Expected"),
+      suggestion,
+  };
+
+  for (const size_t num_utils : {1, 4}) {
+    SCOPED_TRACE(num_utils);
+    const std::vector<QualityRegressionUtil::TestResult> results =
+        RunAll(num_utils, items);
+    ASSERT_EQ(results.size(), items.size());
+    ASSERT_TRUE(results[0].result.ok());
+    EXPECT_FALSE(*results[0].result);
+    ASSERT_TRUE(results[2].result.ok());
+    EXPECT_TRUE(*results[2].result);
+  }
+}
+
+}  // namespace
+}  // namespace quality_regression
+}  // namespace mozc
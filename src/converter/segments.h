@@ -712,7 +712,25 @@ class Segments final {
   RevertEntry *mutable_revert_entry(size_t i) { return &revert_entries_[i]; }
 
   // setter
-  Lattice *mutable_cached_lattice() { return &cached_lattice_; }
+  // The lattice is allocated on the first call.
+  Lattice *mutable_cached_lattice() { return GetOrCreateCachedLattice(); }
+
+  // Makes this instance share the lattice cache of |segments|. The cache is
+  // not copied by the copy constructor, so a temporary copy converted on
+  // behalf of |segments| would otherwise rebuild the lattice from scratch on
+  // every key stroke. The cache isn't a logical part of Segments, so this
+  // takes a const reference, though it allocates the cache of |segments| if
+  // it has none yet. Like the rest of Segments, this isn't thread-safe, and
+  // instances sharing a cache must not be converted concurrently.
+  void ShareCachedLattice(const Segments &segments) {
+    segments.GetOrCreateCachedLattice();
+    cached_lattice_ = segments.cached_lattice_;
+  }
+
+  // Exchanges the lattice cache with |segments|.
+  void SwapCachedLattice(Segments *segments) {
+    cached_lattice_.swap(segments->cached_lattice_);
+  }
 
  private:
   FRIEND_TEST(SegmentsTest, BasicTest);
@@ -720,6 +738,13 @@ class Segments final {
   iterator history_segments_end();
   const_iterator history_segments_end() const;
 
+  Lattice *GetOrCreateCachedLattice() const {
+    if (cached_lattice_ == nullptr) {
+      cached_lattice_ = std::make_shared<Lattice>();
+    }
+    return cached_lattice_.get();
+  }
+
   // LINT.IfChange
   size_t max_history_segments_size_;
   bool resized_;
@@ -727,7 +752,9 @@ class Segments final {
   ObjectPool<Segment> pool_;
   std::deque<Segment *> segments_;
   std::vector<RevertEntry> revert_entries_;
-  Lattice cached_lattice_;
+  // Mutable because ShareCachedLattice() may allocate it on a const source.
+  // Null until the lattice is first used.
+  mutable std::shared_ptr<Lattice> cached_lattice_;
   // LINT.ThenChange(//converter/segments_matchers.h)
 };
 
@@ -40,6 +40,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/number_util.h"
+#include "converter/lattice.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 
@@ -402,6 +403,33 @@ TEST(SegmentsTest, CopyTest) {
   }
 }
 
+TEST(SegmentsTest, ShareCachedLattice) {
+  Segments src;
+  Segments copy = src;
+  EXPECT_NE(copy.mutable_cached_lattice(), src.mutable_cached_lattice());
+
+  copy.ShareCachedLattice(src);
+  EXPECT_EQ(copy.mutable_cached_lattice(), src.mutable_cached_lattice());
+
+  // The shared lattice outlives the source.
+  auto tmp = std::make_unique<Segments>();
+  copy.ShareCachedLattice(*tmp);
+  Lattice *lattice = tmp->mutable_cached_lattice();
+  tmp.reset();
+  EXPECT_EQ(copy.mutable_cached_lattice(), lattice);
+  lattice->SetKey("test");
+  EXPECT_EQ(copy.mutable_cached_lattice()->key(), "test");
+}
+
+TEST(SegmentsTest, SwapCachedLattice) {
+  Segments segments1, segments2;
+  Lattice *lattice1 = segments1.mutable_cached_lattice();
+  Lattice *lattice2 = segments2.mutable_cached_lattice();
+  segments1.SwapCachedLattice(&segments2);
+  EXPECT_EQ(segments1.mutable_cached_lattice(), lattice2);
+  EXPECT_EQ(segments2.mutable_cached_lattice(), lattice1);
+}
+
 TEST(CandidateTest, functional_key) {
   Segment::Candidate candidate;
 
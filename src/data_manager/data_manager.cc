@@ -407,6 +407,7 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
                     &usage_conjugation_suffix_data_) ||
         !reader.Get("usage_conjugation_index",
                     &usage_conjugation_index_data_) ||
+        !reader.Get("usage_index", &usage_index_data_) ||
         !reader.Get("usage_string_array", &usage_string_array_data_)) {
       LOG(ERROR) << "Cannot find some usage dictionary data components";
       return Status::DATA_MISSING;
@@ -452,7 +453,49 @@ DataManager::Status DataManager::InitFromFile(const std::string &path,
   filename_ = path;
   mmap_ = *std::move(mmap);
   const absl::string_view data(mmap_.begin(), mmap_.size());
-  return InitFromArray(data, magic);
+  const Status status = InitFromArray(data, magic);
+  if (status == Status::OK) {
+    AdviseAccessPatterns();
+  }
+  return status;
+}
+
+void DataManager::AdviseAccessPatterns() const {
+  // The rewriter and prediction tables are large and only probed by binary
+  // search or by index, so read-ahead around each probe is mostly wasted.
+  // Mark them first, then prefetch the dictionary and the connector, which
+  // every conversion touches.  Failures are harmless and ignored.
+  const absl::string_view random_sections[] = {
+      suggestion_filter_data_,
+      collocation_data_,
+      collocation_suppression_data_,
+      symbol_token_array_data_,
+      symbol_string_array_data_,
+      emoticon_token_array_data_,
+      emoticon_string_array_data_,
+      emoji_token_array_data_,
+      emoji_string_array_data_,
+      single_kanji_token_array_data_,
+      single_kanji_string_array_data_,
+      single_kanji_variant_token_array_data_,
+      single_kanji_variant_string_array_data_,
+      single_kanji_noun_prefix_token_array_data_,
+      single_kanji_noun_prefix_string_array_data_,
+      a11y_description_token_array_data_,
+      a11y_description_string_array_data_,
+      zero_query_token_array_data_,
+      zero_query_string_array_data_,
+      usage_items_data_,
+      usage_index_data_,
+      usage_string_array_data_,
+  };
+  for (const absl::string_view section : random_sections) {
+    Mmap::MaybeAdvise(section.data(), section.size(), Mmap::RANDOM);
+  }
+  Mmap::MaybeAdvise(dictionary_data_.data(), dictionary_data_.size(),
+                    Mmap::WILLNEED);
+  Mmap::MaybeAdvise(connection_data_.data(), connection_data_.size(),
+                    Mmap::WILLNEED);
 }
 
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
@@ -614,11 +657,13 @@ void DataManager::GetUsageRewriterData(
     absl::string_view *conjugation_suffix_data,
     absl::string_view *conjugation_index_data,
     absl::string_view *usage_items_data,
+    absl::string_view *usage_index_data,
     absl::string_view *string_array_data) const {
   *base_conjugation_suffix_data = usage_base_conjugation_suffix_data_;
   *conjugation_suffix_data = usage_conjugation_suffix_data_;
   *conjugation_index_data = usage_conjugation_index_data_;
   *usage_items_data = usage_items_data_;
+  *usage_index_data = usage_index_data_;
   *string_array_data = usage_string_array_data_;
 }
 #endif  // NO_USAGE_REWRITER
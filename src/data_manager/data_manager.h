@@ -89,7 +89,9 @@ class DataManager : public DataManagerInterface {
   Status InitFromArray(absl::string_view array, size_t magic_length);
 
   // The same as above InitFromArray() but the data is loaded using mmap, which
-  // is owned in this instance.
+  // is owned in this instance.  Pages are faulted in on first use; the
+  // dictionary and the connector, which are read by every conversion, are
+  // prefetched and the other large tables are marked for random access.
   Status InitFromFile(const std::string &path);
   Status InitFromFile(const std::string &path, absl::string_view magic);
 
@@ -157,6 +159,7 @@ class DataManager : public DataManagerInterface {
       absl::string_view *conjugation_suffix_data,
       absl::string_view *conjugation_index_data,
       absl::string_view *usage_items_data,
+      absl::string_view *usage_index_data,
       absl::string_view *string_array_data) const override;
 #endif  // NO_USAGE_REWRITER
 
@@ -168,6 +171,9 @@ class DataManager : public DataManagerInterface {
  private:
   Status InitFromReader(const DataSetReader &reader);
 
+  // Gives madvise() hints for the sections in |mmap_|.
+  void AdviseAccessPatterns() const;
+
   std::optional<std::string> filename_ = std::nullopt;
   Mmap mmap_;
   absl::string_view pos_matcher_data_;
@@ -215,6 +221,7 @@ class DataManager : public DataManagerInterface {
   absl::string_view usage_conjugation_suffix_data_;
   absl::string_view usage_conjugation_index_data_;
   absl::string_view usage_items_data_;
+  absl::string_view usage_index_data_;
   absl::string_view usage_string_array_data_;
   absl::string_view data_version_;
   absl::flat_hash_map<std::string, std::pair<size_t, size_t>> offset_and_size_;
@@ -135,6 +135,7 @@ class DataManagerInterface {
       absl::string_view *conjugation_suffix_data,
       absl::string_view *conjugation_suffix_index_data,
       absl::string_view *usage_items_data,
+      absl::string_view *usage_index_data,
       absl::string_view *string_array_data) const = 0;
 #endif  // NO_USAGE_REWRITER
 
@@ -166,11 +166,11 @@ def mozc_dataset(
         "pos_matcher:32:$(@D)/pos_matcher.data " +
         "user_pos_token:32:$(@D)/user_pos_token_array.data " +
         "user_pos_string:32:$(@D)/user_pos_string_array.data " +
-        "coll:32:$(location :" + name + "@collocation) " +
-        "cols:32:$(location :" + name + "@collocation_suppression) " +
+        "coll:512:$(location :" + name + "@collocation) " +
+        "cols:512:$(location :" + name + "@collocation_suppression) " +
         "conn:32:$(location :" + name + "@connection) " +
         "dict:32:$(location :" + name + "@dictionary) " +
-        "sugg:32:$(location :" + name + "@suggestion_filter) " +
+        "sugg:512:$(location :" + name + "@suggestion_filter) " +
         "posg:32:$(location :" + name + "@pos_group) " +
         "bdry:32:$(location :" + name + "@boundary) " +
         "segmenter_sizeinfo:32:$(@D)/segmenter_sizeinfo.data " +
@@ -212,6 +212,7 @@ def mozc_dataset(
             "usage_conjugation_suffix:32:$(@D)/usage_conj_suffix.data " +
             "usage_conjugation_index:32:$(@D)/usage_conj_index.data " +
             "usage_item_array:32:$(@D)/usage_item_array.data " +
+            "usage_index:32:$(@D)/usage_index.data " +
             "usage_string_array:32:$(@D)/usage_string_array.data "
         )
 
@@ -695,6 +696,7 @@ def mozc_dataset(
                 "usage_base_conj_suffix.data",
                 "usage_conj_index.data",
                 "usage_conj_suffix.data",
+                "usage_index.data",
                 "usage_item_array.data",
                 "usage_string_array.data",
             ],
@@ -706,6 +708,7 @@ def mozc_dataset(
                 "--output_conjugation_suffix=$(location :usage_conj_suffix.data) " +
                 "--output_conjugation_index=$(location :usage_conj_index.data) " +
                 "--output_usage_item_array=$(location :usage_item_array.data) " +
+                "--output_usage_index=$(location :usage_index.data) " +
                 "--output_string_array=$(location :usage_string_array.data) "
             ),
             tools = ["//rewriter:gen_usage_rewriter_dictionary_main"],
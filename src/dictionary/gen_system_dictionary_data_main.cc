@@ -44,12 +44,14 @@
 
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
+#include "absl/log/log.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "base/file_stream.h"
 #include "base/init_mozc.h"
+#include "base/stopwatch.h"
 #include "data_manager/data_manager.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/system/system_dictionary_builder.h"
@@ -114,11 +116,17 @@ int main(int argc, char **argv) {
   const mozc::dictionary::PosMatcher pos_matcher(
       data_manager.GetPosMatcherData());
 
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
   mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
   loader.Load(system_dictionary_input, reading_correction_input);
+  LOG(INFO) << "Loaded " << loader.tokens().size() << " tokens in "
+            << stopwatch.GetElapsed();
 
+  stopwatch.Reset();
+  stopwatch.Start();
   mozc::dictionary::SystemDictionaryBuilder builder;
   builder.BuildFromTokens(loader.tokens());
+  LOG(INFO) << "Built system dictionary in " << stopwatch.GetElapsed();
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
       absl::GetFlag(FLAGS_output), std::ios::out | std::ios::binary));
@@ -36,14 +36,13 @@
 #include <memory>
 #include <string>
 #include <utility>
-#include <vector>
 
 #include "absl/log/check.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/container/serialized_string_array.h"
 #include "base/text_normalizer.h"
-#include "base/util.h"
 #include "data_manager/data_manager_interface.h"
 #include "data_manager/serialized_dictionary.h"
 
@@ -161,24 +160,70 @@ class Uint32ArrayIterator {
 
 }  // namespace
 
+// The underlying token array of the single kanji data has the following
+// format:
+//
+// +---------------------------+
+// | number of readings: N     |
+// +---------------------------+
+// | begin of reading 0        |
+// +---------------------------+
+// | end of reading 0          |
+// +---------------------------+
+// | ...                       |
+// +---------------------------+
+// | end of reading N - 1      |
+// +---------------------------+
+// | index of kanji 0          |
+// +---------------------------+
+// | index of kanji 1          |
+// +---------------------------+
+// | ...                       |
+//
+// Here, each element is of uint32_t type.  The kanji of the i-th reading are
+// at [begin of reading i, end of reading i) of the kanji indices, which point
+// to |single_kanji_string_array_|.  The string array has the N readings in
+// sorted order first, followed by each kanji once.  See
+// rewriter/gen_single_kanji_rewriter_data.py.
 SingleKanjiDictionary::SingleKanjiDictionary(
     const DataManagerInterface &data_manager) {
+  absl::string_view token_array_data;
   absl::string_view string_array_data;
   absl::string_view variant_type_array_data;
   absl::string_view variant_string_array_data;
   absl::string_view noun_prefix_token_array_data;
   absl::string_view noun_prefix_string_array_data;
   data_manager.GetSingleKanjiRewriterData(
-      &single_kanji_token_array_, &string_array_data, &variant_type_array_data,
+      &token_array_data, &string_array_data, &variant_type_array_data,
       &variant_token_array_, &variant_string_array_data,
       &noun_prefix_token_array_data, &noun_prefix_string_array_data);
 
-  // Single Kanji token array is an array of uint32_t.  Its size must be
-  // multiple of 2; see the comment above LookupKanjiEntries.
-  DCHECK_EQ(0, single_kanji_token_array_.size() % (2 * sizeof(uint32_t)));
   DCHECK(SerializedStringArray::VerifyData(string_array_data));
   single_kanji_string_array_.Set(string_array_data);
 
+  DCHECK_EQ(0, token_array_data.size() % sizeof(uint32_t));
+  const absl::Span<const uint32_t> token_array(
+      reinterpret_cast<const uint32_t *>(token_array_data.data()),
+      token_array_data.size() / sizeof(uint32_t));
+  if (!token_array.empty()) {
+    num_readings_ = token_array[0];
+    DCHECK_LE(1 + 2 * num_readings_, token_array.size());
+    DCHECK_LE(num_readings_, single_kanji_string_array_.size());
+    reading_ranges_ = token_array.subspan(1, 2 * num_readings_);
+    kanji_indices_ = token_array.subspan(1 + 2 * num_readings_);
+  }
+
+  // Kanji are stored once after the readings, so each of them is normalized
+  // to SVS only once.
+  for (uint32_t i = num_readings_; i < single_kanji_string_array_.size();
+       ++i) {
+    std::string svs;
+    if (TextNormalizer::NormalizeTextToSvs(single_kanji_string_array_[i],
+                                           &svs)) {
+      svs_kanji_.emplace(i, std::move(svs));
+    }
+  }
+
   DCHECK(SerializedStringArray::VerifyData(variant_type_array_data));
   variant_type_array_.Set(variant_type_array_data);
 
@@ -194,51 +239,20 @@ SingleKanjiDictionary::SingleKanjiDictionary(
       noun_prefix_token_array_data, noun_prefix_string_array_data);
 }
 
-// The underlying token array, |single_kanji_token_array_|, has the following
-// format:
-//
-// +------------------+
-// | index of key 0   |
-// +------------------+
-// | index of value 0 |
-// +------------------+
-// | index of key 1   |
-// +------------------+
-// | index of value 1 |
-// +------------------+
-// | ...              |
-//
-// Here, each element is of uint32_t type.  Each of actual string values are
-// stored in |single_kanji_string_array_| at its index.
-bool SingleKanjiDictionary::LookupKanjiEntries(
-    absl::string_view key, bool use_svs,
-    std::vector<std::string> *kanji_list) const {
-  DCHECK(kanji_list);
-  const uint32_t *token_array =
-      reinterpret_cast<const uint32_t *>(single_kanji_token_array_.data());
-  const size_t token_array_size =
-      single_kanji_token_array_.size() / sizeof(uint32_t);
-
-  const Uint32ArrayIterator<2> end(token_array + token_array_size);
-  const auto iter = std::lower_bound(
-      Uint32ArrayIterator<2>(token_array), end, key,
-      [this](uint32_t index, const absl::string_view target_key) {
-        return this->single_kanji_string_array_[index] < target_key;
-      });
-  if (iter == end || single_kanji_string_array_[iter[0]] != key) {
-    return false;
-  }
-  const absl::string_view values = single_kanji_string_array_[iter[1]];
-  if (use_svs) {
-    std::string svs_values;
-    if (TextNormalizer::NormalizeTextToSvs(values, &svs_values)) {
-      Util::SplitStringToUtf8Graphemes(svs_values, kanji_list);
-      return true;
-    }
+SingleKanjiDictionary::KanjiList SingleKanjiDictionary::LookupKanjiEntries(
+    absl::string_view key, bool use_svs) const {
+  const auto begin = single_kanji_string_array_.begin();
+  const auto end = begin + num_readings_;
+  const auto iter = std::lower_bound(begin, end, key);
+  if (iter == end || *iter != key) {
+    return KanjiList();
   }
-
-  Util::SplitStringToUtf8Graphemes(values, kanji_list);
-  return true;
+  const size_t i = iter - begin;
+  const uint32_t first = reading_ranges_[2 * i];
+  const uint32_t last = reading_ranges_[2 * i + 1];
+  DCHECK_LE(first, last);
+  DCHECK_LE(last, kanji_indices_.size());
+  return KanjiList(this, kanji_indices_.subspan(first, last - first), use_svs);
 }
 
 // The underlying token array, |variant_token_array_|, has the following
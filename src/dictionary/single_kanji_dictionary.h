@@ -30,12 +30,16 @@
 #ifndef MOZC_DICTIONARY_SINGLE_KANJI_DICTIONARY_H_
 #define MOZC_DICTIONARY_SINGLE_KANJI_DICTIONARY_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
-#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "base/container/serialized_string_array.h"
 #include "data_manager/data_manager_interface.h"
 #include "data_manager/serialized_dictionary.h"
@@ -45,6 +49,68 @@ namespace dictionary {
 
 class SingleKanjiDictionary {
  public:
+  // Kanji for a reading in the order of the data. Each kanji is a view into
+  // the data set, or into the SVS form kept by the dictionary, so the list is
+  // valid as long as the dictionary is.
+  class KanjiList {
+   public:
+    class const_iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = absl::string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const absl::string_view *;
+      using reference = absl::string_view;
+
+      const_iterator(const KanjiList *list, size_t index)
+          : list_(list), index_(index) {}
+
+      absl::string_view operator*() const { return (*list_)[index_]; }
+
+      const_iterator &operator++() {
+        ++index_;
+        return *this;
+      }
+      const_iterator operator++(int) {
+        const const_iterator tmp = *this;
+        ++index_;
+        return tmp;
+      }
+
+      friend bool operator==(const_iterator x, const_iterator y) {
+        return x.index_ == y.index_;
+      }
+      friend bool operator!=(const_iterator x, const_iterator y) {
+        return x.index_ != y.index_;
+      }
+
+     private:
+      const KanjiList *list_;
+      size_t index_;
+    };
+
+    KanjiList() = default;
+
+    size_t size() const { return indices_.size(); }
+    bool empty() const { return indices_.empty(); }
+    absl::string_view operator[](size_t i) const {
+      return dictionary_->GetKanji(indices_[i], use_svs_);
+    }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+   private:
+    friend class SingleKanjiDictionary;
+
+    KanjiList(const SingleKanjiDictionary *dictionary,
+              absl::Span<const uint32_t> indices, bool use_svs)
+        : dictionary_(dictionary), indices_(indices), use_svs_(use_svs) {}
+
+    const SingleKanjiDictionary *dictionary_ = nullptr;
+    absl::Span<const uint32_t> indices_;
+    bool use_svs_ = false;
+  };
+
   explicit SingleKanjiDictionary(const DataManagerInterface &data_manager);
 
   SingleKanjiDictionary(const SingleKanjiDictionary &) = delete;
@@ -52,9 +118,9 @@ class SingleKanjiDictionary {
 
   ~SingleKanjiDictionary() = default;
 
-  // Looks up single kanji list from key (reading).  Returns false if not found.
-  bool LookupKanjiEntries(absl::string_view key, bool use_svs,
-                          std::vector<std::string> *kanji_list) const;
+  // Looks up single kanji list from key (reading).  Returns an empty list if
+  // not found.  Neither splits nor copies the kanji.
+  KanjiList LookupKanjiEntries(absl::string_view key, bool use_svs) const;
 
   // Returns the iterator range for noun prefix kanji entries
   // whose keys match the given key.
@@ -72,8 +138,27 @@ class SingleKanjiDictionary {
                            std::string *desc) const;
 
  private:
-  absl::string_view single_kanji_token_array_;
+  absl::string_view GetKanji(uint32_t index, bool use_svs) const {
+    if (use_svs) {
+      if (const auto it = svs_kanji_.find(index); it != svs_kanji_.end()) {
+        return it->second;
+      }
+    }
+    return single_kanji_string_array_[index];
+  }
+
+  // The readings are the first num_readings_ strings of
+  // single_kanji_string_array_, and reading_ranges_[2 * i] and
+  // reading_ranges_[2 * i + 1] are the range of kanji_indices_ for the i-th
+  // reading.
+  size_t num_readings_ = 0;
+  absl::Span<const uint32_t> reading_ranges_;
+  absl::Span<const uint32_t> kanji_indices_;
   SerializedStringArray single_kanji_string_array_;
+  // The SVS forms of the kanji which are CJK compatibility ideographs, keyed
+  // by their indices in single_kanji_string_array_.  They are computed once
+  // here instead of on every lookup.
+  absl::flat_hash_map<uint32_t, std::string> svs_kanji_;
   SerializedStringArray variant_type_array_;
   absl::string_view variant_token_array_;
   SerializedStringArray variant_string_array_;
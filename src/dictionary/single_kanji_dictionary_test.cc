@@ -33,7 +33,6 @@
 #include <memory>
 #include <string>
 #include <tuple>
-#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "data_manager/testing/mock_data_manager.h"
@@ -87,16 +86,15 @@ TEST_F(SingleKanjiDictionaryTest, LookupNounPrefixEntries) {
 TEST_F(SingleKanjiDictionaryTest, LookupKanjiEntries) {
   SingleKanjiDictionary dictionary(*data_manager_);
 
-  auto contains = [](std::vector<std::string> entries,
+  auto contains = [](const SingleKanjiDictionary::KanjiList &entries,
                      absl::string_view value) {
     auto it = std::find(entries.begin(), entries.end(), value);
     return it != entries.end();
   };
 
   {
-    std::vector<std::string> entries;
-    dictionary.LookupKanjiEntries("かみ",
-                                  /* use_svs = */ true, &entries);
+    const SingleKanjiDictionary::KanjiList entries =
+        dictionary.LookupKanjiEntries("かみ", /* use_svs = */ true);
     EXPECT_FALSE(entries.empty());
     EXPECT_TRUE(contains(entries, "神"));
     // 神︀ SVS character.
@@ -105,9 +103,8 @@ TEST_F(SingleKanjiDictionaryTest, LookupKanjiEntries) {
     EXPECT_FALSE(contains(entries, "\uFA19"));
   }
   {
-    std::vector<std::string> entries;
-    dictionary.LookupKanjiEntries("かみ",
-                                  /* use_svs = */ false, &entries);
+    const SingleKanjiDictionary::KanjiList entries =
+        dictionary.LookupKanjiEntries("かみ", /* use_svs = */ false);
     EXPECT_FALSE(entries.empty());
     EXPECT_TRUE(contains(entries, "神"));
     // 神︀ SVS character.
@@ -116,16 +113,45 @@ TEST_F(SingleKanjiDictionaryTest, LookupKanjiEntries) {
     EXPECT_TRUE(contains(entries, "\uFA19"));
   }
   {
-    std::vector<std::string> entries;
-    dictionary.LookupKanjiEntries("",
-                                  /* use_svs = */ false, &entries);
-    EXPECT_TRUE(entries.empty());
-    dictionary.LookupKanjiEntries("unknown reading",
-                                  /* use_svs = */ false, &entries);
-    EXPECT_TRUE(entries.empty());
+    EXPECT_TRUE(
+        dictionary.LookupKanjiEntries("", /* use_svs = */ false).empty());
+    EXPECT_TRUE(
+        dictionary.LookupKanjiEntries("unknown reading", /* use_svs = */ false)
+            .empty());
   }
 }
 
+TEST_F(SingleKanjiDictionaryTest, LookupKanjiEntriesSharesStorage) {
+  SingleKanjiDictionary dictionary(*data_manager_);
+
+  auto find = [](const SingleKanjiDictionary::KanjiList &entries,
+                 absl::string_view value) -> absl::string_view {
+    auto it = std::find(entries.begin(), entries.end(), value);
+    return it == entries.end() ? absl::string_view() : *it;
+  };
+
+  // The same kanji of different readings is a view into the same storage.
+  for (const bool use_svs : {false, true}) {
+    const absl::string_view kami =
+        find(dictionary.LookupKanjiEntries("かみ", use_svs), "神");
+    const absl::string_view shin =
+        find(dictionary.LookupKanjiEntries("しん", use_svs), "神");
+    ASSERT_EQ(kami, "神");
+    ASSERT_EQ(shin, "神");
+    EXPECT_EQ(kami.data(), shin.data());
+  }
+
+  // Repeated lookups return the same views, including the SVS forms.
+  const absl::string_view svs1 = find(
+      dictionary.LookupKanjiEntries("かみ", /* use_svs = */ true),
+      "\u795E\uFE00");
+  const absl::string_view svs2 = find(
+      dictionary.LookupKanjiEntries("かみ", /* use_svs = */ true),
+      "\u795E\uFE00");
+  ASSERT_FALSE(svs1.empty());
+  EXPECT_EQ(svs1.data(), svs2.data());
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
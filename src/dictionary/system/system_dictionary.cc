@@ -76,6 +76,7 @@
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/key_expansion_table.h"
 #include "dictionary/system/token_decode_iterator.h"
+#include "dictionary/system/value_cache.h"
 #include "dictionary/system/words_info.h"
 #include "request/conversion_request.h"
 #include "storage/louds/bit_vector_based_array.h"
@@ -106,6 +107,9 @@ constexpr size_t kValueTrieSelect0CacheSize = 1 * 1024;
 constexpr size_t kValueTrieSelect1CacheSize = 16 * 1024;
 constexpr size_t kValueTrieTermvecCacheSize = 4 * 1024;
 
+// Number of decoded values kept by ENABLE_VALUE_CACHE, 64 bytes each.
+constexpr size_t kValueCacheSize = 4 * 1024;
+
 // Expansion table format:
 // "<Character to expand>[<Expanded character 1><Expanded character 2>...]"
 //
@@ -256,7 +260,7 @@ struct ReverseLookupResult {
 
 class SystemDictionary::ReverseLookupCache {
  public:
-  ReverseLookupCache() = default;
+  explicit ReverseLookupCache(const SystemDictionary *owner) : owner(owner) {}
   ReverseLookupCache(const ReverseLookupCache &) = delete;
   ReverseLookupCache &operator=(const ReverseLookupCache &) = delete;
 
@@ -270,6 +274,8 @@ class SystemDictionary::ReverseLookupCache {
     return true;
   }
 
+  // The dictionary which populated this cache.
+  const SystemDictionary *owner;
   std::multimap<int, ReverseLookupResult> results;
 };
 
@@ -438,6 +444,9 @@ SystemDictionary::Builder::Build() {
           (spec_->options & ENABLE_REVERSE_LOOKUP_INDEX) != 0)) {
     return absl::UnknownError("Failed to create system dictionary");
   }
+  if ((spec_->options & ENABLE_VALUE_CACHE) != 0) {
+    instance->value_cache_ = std::make_unique<ValueCache>(kValueCacheSize);
+  }
 
   return instance;
 }
@@ -449,7 +458,10 @@ SystemDictionary::SystemDictionary(
       codec_(codec),
       dictionary_file_(new DictionaryFile(file_codec)) {}
 
-SystemDictionary::~SystemDictionary() = default;
+SystemDictionary::~SystemDictionary() {
+  // Don't leave a cache which a new dictionary at the same address could see.
+  ClearReverseLookupCache();
+}
 
 bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
   int len;
@@ -546,8 +558,8 @@ bool SystemDictionary::HasValue(absl::string_view value) const {
   const uint8_t *encoded_tokens_ptr = GetTokenArrayPtr(token_array_, key_id);
 
   // Check tokens.
-  for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
-                                encoded_tokens_ptr);
+  for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                frequent_pos_, key, encoded_tokens_ptr);
        !iter.Done(); iter.Next()) {
     const Token *token = iter.Get().token;
     if (value == token->value) {
@@ -705,8 +717,8 @@ void SystemDictionary::LookupPredictive(
     }
 
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(state.node);
-    for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
-                                  actual_key,
+    for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                  frequent_pos_, actual_key,
                                   GetTokenArrayPtr(token_array_, key_id));
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
@@ -728,7 +740,7 @@ namespace {
 // An implementation of prefix search without key expansion.  Runs |callback|
 // for prefixes of |encoded_key| in |key_trie|.
 // Args:
-//   key_trie, value_trie, token_array, codec, frequent_pos:
+//   key_trie, value_trie, value_cache, token_array, codec, frequent_pos:
 //     Members in SystemDictionary.
 //   key:
 //     The head address of the original key before applying codec.
@@ -742,6 +754,7 @@ namespace {
 template <typename Func>
 void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
                              const LoudsTrie &value_trie,
+                             ValueCache *value_cache,
                              const BitVectorBasedArray &token_array,
                              const SystemDictionaryCodecInterface *codec,
                              const uint32_t *frequent_pos, const char *key,
@@ -783,7 +796,8 @@ void RunCallbackOnEachPrefix(const LoudsTrie &key_trie,
     }
 
     const int key_id = key_trie.GetKeyIdOfTerminalNode(node);
-    for (TokenDecodeIterator iter(codec, value_trie, frequent_pos, prefix,
+    for (TokenDecodeIterator iter(codec, value_trie, value_cache, frequent_pos,
+                                  prefix,
                                   GetTokenArrayPtr(token_array, key_id));
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
@@ -887,8 +901,8 @@ SystemDictionary::LookupPrefixWithKeyExpansionImpl(
     }
 
     const int key_id = key_trie_.GetKeyIdOfTerminalNode(node);
-    for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_,
-                                  *actual_prefix,
+    for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                  frequent_pos_, *actual_prefix,
                                   GetTokenArrayPtr(token_array_, key_id));
          !iter.Done(); iter.Next()) {
       const TokenInfo &token_info = iter.Get();
@@ -935,9 +949,9 @@ void SystemDictionary::LookupPrefix(absl::string_view key,
   codec_->EncodeKey(key, &encoded_key);
 
   if (!conversion_request.IsKanaModifierInsensitiveConversion()) {
-    RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                            frequent_pos_, key.data(), encoded_key, callback,
-                            SelectAllTokens());
+    RunCallbackOnEachPrefix(key_trie_, value_trie_, value_cache_.get(),
+                            token_array_, codec_, frequent_pos_, key.data(),
+                            encoded_key, callback, SelectAllTokens());
     return;
   }
 
@@ -967,7 +981,8 @@ void SystemDictionary::LookupExact(absl::string_view key,
     return;
   }
   // Callback on each token.
-  for (TokenDecodeIterator iter(codec_, value_trie_, frequent_pos_, key,
+  for (TokenDecodeIterator iter(codec_, value_trie_, value_cache_.get(),
+                                frequent_pos_, key,
                                 GetTokenArrayPtr(token_array_, key_id));
        !iter.Done(); iter.Next()) {
     if (callback->OnToken(key, key, *iter.Get().token) !=
@@ -1015,8 +1030,8 @@ void SystemDictionary::PopulateReverseLookupCache(absl::string_view str) const {
     // as we have already built the index for reverse lookup.
     return;
   }
-  reverse_lookup_cache_ = std::make_unique<ReverseLookupCache>();
-  DCHECK(reverse_lookup_cache_.get());
+  ClearReverseLookupCache();
+  auto cache = std::make_unique<ReverseLookupCache>(this);
 
   // Iterate each suffix and collect IDs of all substrings.
   absl::btree_set<int> id_set;
@@ -1031,11 +1046,35 @@ void SystemDictionary::PopulateReverseLookupCache(absl::string_view str) const {
     pos += strings::OneCharLen(suffix.data());
   }
   // Collect tokens for all IDs.
-  ScanTokens(id_set, reverse_lookup_cache_.get());
+  ScanTokens(id_set, cache.get());
+  GetThreadReverseLookupCaches().push_back(std::move(cache));
 }
 
 void SystemDictionary::ClearReverseLookupCache() const {
-  reverse_lookup_cache_.reset();
+  std::vector<std::unique_ptr<ReverseLookupCache>> &caches =
+      GetThreadReverseLookupCaches();
+  std::erase_if(caches, [this](const std::unique_ptr<ReverseLookupCache> &c) {
+    return c->owner == this;
+  });
+}
+
+// static
+std::vector<std::unique_ptr<SystemDictionary::ReverseLookupCache>> &
+SystemDictionary::GetThreadReverseLookupCaches() {
+  // Usually empty, or has one cache during a reverse conversion.
+  thread_local std::vector<std::unique_ptr<ReverseLookupCache>> caches;
+  return caches;
+}
+
+const SystemDictionary::ReverseLookupCache *
+SystemDictionary::FindThreadReverseLookupCache() const {
+  for (const std::unique_ptr<ReverseLookupCache> &cache :
+       GetThreadReverseLookupCaches()) {
+    if (cache->owner == this) {
+      return cache.get();
+    }
+  }
+  return nullptr;
 }
 
 namespace {
@@ -1073,9 +1112,9 @@ void SystemDictionary::RegisterReverseLookupTokensForT13N(
   std::string hiragana_value = japanese_util::KatakanaToHiragana(value);
   std::string encoded_key;
   codec_->EncodeKey(hiragana_value, &encoded_key);
-  RunCallbackOnEachPrefix(key_trie_, value_trie_, token_array_, codec_,
-                          frequent_pos_, hiragana_value.data(), encoded_key,
-                          callback,
+  RunCallbackOnEachPrefix(key_trie_, value_trie_, value_cache_.get(),
+                          token_array_, codec_, frequent_pos_,
+                          hiragana_value.data(), encoded_key, callback,
                           FilterTokenForRegisterReverseLookupTokensForT13N());
 }
 
@@ -1087,14 +1126,14 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
   absl::btree_set<int> id_set;
   AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
 
-  ReverseLookupCache *results = nullptr;
-  ReverseLookupCache non_cached_results;
+  const ReverseLookupCache *results = nullptr;
+  ReverseLookupCache non_cached_results(this);
+  const ReverseLookupCache *cache = FindThreadReverseLookupCache();
   if (reverse_lookup_index_ != nullptr) {
     reverse_lookup_index_->FillResultMap(id_set, &non_cached_results.results);
     results = &non_cached_results;
-  } else if (reverse_lookup_cache_ != nullptr &&
-             reverse_lookup_cache_->IsAvailable(id_set)) {
-    results = reverse_lookup_cache_.get();
+  } else if (cache != nullptr && cache->IsAvailable(id_set)) {
+    results = cache;
   } else {
     // Cache is not available. Get token for each ID.
     ScanTokens(id_set, &non_cached_results);
@@ -1141,8 +1180,8 @@ void SystemDictionary::RegisterReverseLookupResults(
         continue;
       }
       for (TokenDecodeIterator iter(
-               codec_, value_trie_, frequent_pos_, tokens_key,
-               encoded_tokens_ptr + reverse_result.tokens_offset);
+               codec_, value_trie_, value_cache_.get(), frequent_pos_,
+               tokens_key, encoded_tokens_ptr + reverse_result.tokens_offset);
            !iter.Done(); iter.Next()) {
         const TokenInfo &token_info = iter.Get();
         if (token_info.token->attributes & Token::SPELLING_CORRECTION ||
@@ -54,6 +54,7 @@
       'type': 'static_library',
       'sources': [
         'system_dictionary.cc',
+        'value_cache.cc',
       ],
       'dependencies': [
         '<(mozc_oss_src_dir)/base/absl.gyp:absl_status',
@@ -44,6 +44,7 @@
 #include "dictionary/file/dictionary_file.h"
 #include "dictionary/system/codec_interface.h"
 #include "dictionary/system/key_expansion_table.h"
+#include "dictionary/system/value_cache.h"
 #include "request/conversion_request.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
@@ -60,6 +61,10 @@ class SystemDictionary : public DictionaryInterface {
     // from the id in value trie to the id in key trie.
     // That consumes more memory but we can perform reverse lookup more quickly.
     ENABLE_REVERSE_LOOKUP_INDEX = 1,
+    // If ENABLE_VALUE_CACHE is set, values decoded from the value trie are
+    // cached in a small table, which speeds up lookups of frequent words.
+    // engine::Modules sets this.
+    ENABLE_VALUE_CACHE = 2,
   };
 
   // Builder class for system dictionary
@@ -132,6 +137,8 @@ class SystemDictionary : public DictionaryInterface {
   ~SystemDictionary() override;
 
   const storage::louds::LoudsTrie &value_trie() const { return value_trie_; }
+  // Returns nullptr unless ENABLE_VALUE_CACHE is set.
+  const ValueCache *value_cache() const { return value_cache_.get(); }
 
   // Implementation of DictionaryInterface.
   bool HasKey(absl::string_view key) const override;
@@ -153,6 +160,8 @@ class SystemDictionary : public DictionaryInterface {
                      const ConversionRequest &conversion_request,
                      Callback *callback) const override;
 
+  // The reverse lookup cache is kept per thread, so the other threads can
+  // convert with this dictionary in the meantime.
   void PopulateReverseLookupCache(absl::string_view str) const override;
   void ClearReverseLookupCache() const override;
 
@@ -177,6 +186,11 @@ class SystemDictionary : public DictionaryInterface {
                                     Callback *callback) const;
   void InitReverseLookupIndex();
 
+  // Returns the caches populated by the calling thread.
+  static std::vector<std::unique_ptr<ReverseLookupCache>> &
+  GetThreadReverseLookupCaches();
+  const ReverseLookupCache *FindThreadReverseLookupCache() const;
+
   Callback::ResultType LookupPrefixWithKeyExpansionImpl(
       const char *key, absl::string_view encoded_key,
       const KeyExpansionTable &table, Callback *callback,
@@ -195,8 +209,8 @@ class SystemDictionary : public DictionaryInterface {
   const SystemDictionaryCodecInterface *codec_;
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
-  mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
+  std::unique_ptr<ValueCache> value_cache_;
 };
 
 }  // namespace dictionary
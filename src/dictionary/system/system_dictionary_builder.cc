@@ -35,7 +35,6 @@
 #include <cstring>
 #include <ios>
 #include <map>
-#include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -45,15 +44,18 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "base/cpu_stats.h"
 #include "base/file_stream.h"
 #include "base/file_util.h"
 #include "base/japanese_util.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "dictionary/dictionary_token.h"
@@ -68,6 +70,9 @@ ABSL_FLAG(bool, preserve_intermediate_dictionary, false,
           "preserve inetemediate dictionary file.");
 ABSL_FLAG(int32_t, min_key_length_to_use_small_cost_encoding, 6,
           "minimum key length to use 1 byte cost encoding.");
+ABSL_FLAG(int32_t, system_dictionary_build_threads, 0,
+          "number of threads to build system dictionary. 0 means the number "
+          "of processors. The output does not depend on this value.");
 
 namespace mozc {
 namespace dictionary {
@@ -88,6 +93,82 @@ struct TokenGreaterThan {
   }
 };
 
+int GetNumBuildThreads() {
+  const int num_threads = absl::GetFlag(FLAGS_system_dictionary_build_threads);
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max<int>(1, CPUStats().GetNumberOfProcessors());
+}
+
+// Splits [0, size) into at most |num_threads| contiguous ranges and calls
+// |func(begin, end)| for each of them in parallel. |func| must not touch the
+// elements outside of the given range.
+void ParallelFor(size_t size, int num_threads,
+                 absl::FunctionRef<void(size_t, size_t)> func) {
+  const size_t num_shards =
+      std::min<size_t>(std::max(num_threads, 1), std::max<size_t>(size, 1));
+  if (num_shards <= 1) {
+    func(0, size);
+    return;
+  }
+  const size_t shard_size = (size + num_shards - 1) / num_shards;
+  std::vector<Thread> threads;
+  threads.reserve(num_shards - 1);
+  for (size_t begin = shard_size; begin < size; begin += shard_size) {
+    const size_t end = std::min(begin + shard_size, size);
+    threads.emplace_back([&func, begin, end] { func(begin, end); });
+  }
+  func(0, std::min(shard_size, size));
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+}
+
+// Equivalent to std::stable_sort(). Each shard is sorted in parallel and then
+// merged pairwise. Since the result of stable sort is unique, the result is
+// independent of |num_threads|.
+template <typename T, typename Compare>
+void ParallelStableSort(std::vector<T> &v, int num_threads, Compare comp) {
+  const size_t num_shards = std::min<size_t>(std::max(num_threads, 1),
+                                             std::max<size_t>(v.size(), 1));
+  if (num_shards <= 1) {
+    std::stable_sort(v.begin(), v.end(), comp);
+    return;
+  }
+  const size_t shard_size = (v.size() + num_shards - 1) / num_shards;
+  std::vector<size_t> bounds;
+  for (size_t begin = 0; begin < v.size(); begin += shard_size) {
+    bounds.push_back(begin);
+  }
+  bounds.push_back(v.size());
+  ParallelFor(bounds.size() - 1, num_threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::stable_sort(v.begin() + bounds[i], v.begin() + bounds[i + 1], comp);
+    }
+  });
+  // Merge adjacent runs until a single run remains. inplace_merge is stable
+  // and the runs of each level are disjoint, so they are merged in parallel.
+  while (bounds.size() > 2) {
+    const size_t num_pairs = (bounds.size() - 1) / 2;
+    ParallelFor(num_pairs, num_threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        std::inplace_merge(v.begin() + bounds[2 * i],
+                           v.begin() + bounds[2 * i + 1],
+                           v.begin() + bounds[2 * i + 2], comp);
+      }
+    });
+    std::vector<size_t> next_bounds;
+    for (size_t i = 0; i < bounds.size(); i += 2) {
+      next_bounds.push_back(bounds[i]);
+    }
+    if (next_bounds.back() != v.size()) {
+      next_bounds.push_back(v.size());
+    }
+    bounds = std::move(next_bounds);
+  }
+}
+
 void WriteSectionToFile(const DictionaryFileSection &section,
                         const std::string &filename) {
   if (absl::Status s = FileUtil::SetContents(
@@ -99,30 +180,43 @@ void WriteSectionToFile(const DictionaryFileSection &section,
 
 }  // namespace
 
-void SystemDictionaryBuilder::BuildFromTokens(
-    absl::Span<const std::unique_ptr<Token>> tokens) {
+void SystemDictionaryBuilder::BuildFromTokens(absl::Span<Token> tokens) {
   std::vector<Token *> ptrs;
   ptrs.reserve(tokens.size());
-  for (const std::unique_ptr<Token> &token : tokens) {
-    ptrs.push_back(token.get());
+  for (Token &token : tokens) {
+    ptrs.push_back(&token);
   }
   BuildFromTokensInternal(std::move(ptrs));
 }
 
 void SystemDictionaryBuilder::BuildFromTokensInternal(
     std::vector<Token *> tokens) {
+  num_threads_ = GetNumBuildThreads();
   KeyInfoList key_info_list = ReadTokens(std::move(tokens));
 
-  BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+  {
+    // The key trie is independent of the other steps and is built in
+    // background while the value trie is built.
+    BackgroundFuture<void> key_trie(
+        [this, &key_info_list] { BuildKeyTrie(key_info_list); });
+    BuildFrequentPos(key_info_list);
+    BuildValueTrie(key_info_list);
+    key_trie.Wait();
+  }
 
-  SetIdForValue(&key_info_list);
-  SetIdForKey(&key_info_list);
-  SortTokenInfo(&key_info_list);
+  // The following steps modify each KeyInfo independently.
+  ParallelFor(key_info_list.size(), num_threads_,
+              [this, &key_info_list](size_t begin, size_t end) {
+                SetIdForValue(key_info_list, begin, end);
+                SetIdForKey(key_info_list, begin, end);
+                SortTokenInfo(key_info_list, begin, end);
+              });
   SetCostType(&key_info_list);
-  SetPosType(&key_info_list);
-  SetValueType(&key_info_list);
+  ParallelFor(key_info_list.size(), num_threads_,
+              [this, &key_info_list](size_t begin, size_t end) {
+                SetPosType(key_info_list, begin, end);
+                SetValueType(key_info_list, begin, end);
+              });
 
   BuildTokenArray(key_info_list);
 }
@@ -244,8 +338,8 @@ SystemDictionaryBuilder::KeyInfoList SystemDictionaryBuilder::ReadTokens(
   //    [KeyInfo(key:aaa)[Token 1][Token 2]][KeyInfo(key:abc)[Token 3]][...]
 
   // Step 1.
-  std::stable_sort(
-      tokens.begin(), tokens.end(),
+  ParallelStableSort(
+      tokens, num_threads_,
       [](const Token *l, const Token *r) { return l->key < r->key; });
 
   // Step 2.
@@ -332,18 +426,22 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
   value_trie_builder_.Build();
 }
 
-void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
-    for (TokenInfo &token_info : key_info.tokens) {
-      std::string value_str;
+void SystemDictionaryBuilder::SetIdForValue(KeyInfoList &key_info_list,
+                                            size_t begin, size_t end) const {
+  std::string value_str;
+  for (size_t i = begin; i < end; ++i) {
+    for (TokenInfo &token_info : key_info_list[i].tokens) {
+      value_str.clear();
       codec_->EncodeValue(token_info.token->value, &value_str);
       token_info.id_in_value_trie = value_trie_builder_.GetId(value_str);
     }
   }
 }
 
-void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList &key_info_list,
+                                            size_t begin, size_t end) const {
+  for (size_t i = begin; i < end; ++i) {
+    KeyInfo &key_info = key_info_list[i];
     std::stable_sort(key_info.tokens.begin(), key_info.tokens.end(),
                      TokenGreaterThan());
   }
@@ -376,31 +474,37 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
 
   const int min_key_len =
       absl::GetFlag(FLAGS_min_key_length_to_use_small_cost_encoding);
-  for (KeyInfo &key_info : *key_info_list) {
-    if (Util::CharsLen(key_info.key) < min_key_len) {
-      // Do not use small cost encoding for short keys.
-      continue;
-    }
-    if (HasHomonymsInSamePos(key_info)) {
-      continue;
-    }
-    if (HasHeterophones(key_info, heterophone_values)) {
-      // We want to keep the cost order for LookupReverse().
-      continue;
-    }
-
-    for (TokenInfo &token_info : key_info.tokens) {
-      if (token_info.token->cost < 0x100) {
-        // Small cost encoding ignores lower 8 bits.
+  auto set_cost_type = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      KeyInfo &key_info = (*key_info_list)[i];
+      if (Util::CharsLen(key_info.key) < min_key_len) {
+        // Do not use small cost encoding for short keys.
+        continue;
+      }
+      if (HasHomonymsInSamePos(key_info)) {
         continue;
       }
-      token_info.cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
+      if (HasHeterophones(key_info, heterophone_values)) {
+        // We want to keep the cost order for LookupReverse().
+        continue;
+      }
+
+      for (TokenInfo &token_info : key_info.tokens) {
+        if (token_info.token->cost < 0x100) {
+          // Small cost encoding ignores lower 8 bits.
+          continue;
+        }
+        token_info.cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
+      }
     }
-  }
+  };
+  ParallelFor(key_info_list->size(), num_threads_, set_cost_type);
 }
 
-void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+void SystemDictionaryBuilder::SetPosType(KeyInfoList &key_info_list,
+                                         size_t begin, size_t end) const {
+  for (size_t k = begin; k < end; ++k) {
+    KeyInfo &key_info = key_info_list[k];
     for (size_t i = 0; i < key_info.tokens.size(); ++i) {
       TokenInfo *token_info = &(key_info.tokens[i]);
       const uint32_t pos =
@@ -422,8 +526,10 @@ void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
   }
 }
 
-void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+void SystemDictionaryBuilder::SetValueType(KeyInfoList &key_info_list,
+                                           size_t begin, size_t end) const {
+  for (size_t k = begin; k < end; ++k) {
+    KeyInfo &key_info = key_info_list[k];
     for (size_t i = 1; i < key_info.tokens.size(); ++i) {
       const TokenInfo &prev_token_info = key_info.tokens[i - 1];
       TokenInfo *token_info = &(key_info.tokens[i]);
@@ -445,9 +551,12 @@ void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
   key_trie_builder_.Build();
 }
 
-void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
-    std::string key_str;
+void SystemDictionaryBuilder::SetIdForKey(KeyInfoList &key_info_list,
+                                          size_t begin, size_t end) const {
+  std::string key_str;
+  for (size_t i = begin; i < end; ++i) {
+    KeyInfo &key_info = key_info_list[i];
+    key_str.clear();
     codec_->EncodeKey(key_info.key, &key_str);
     key_info.id_in_key_trie = key_trie_builder_.GetId(key_str);
   }
@@ -465,9 +574,16 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (const KeyInfo *key_info : id_to_keyinfo_table) {
-      std::string tokens_str;
-      codec_->EncodeTokens(key_info->tokens, &tokens_str);
+    // Tokens are encoded in parallel and added in the order of the id.
+    std::vector<std::string> encoded_tokens(id_to_keyinfo_table.size());
+    ParallelFor(encoded_tokens.size(), num_threads_,
+                [&](size_t begin, size_t end) {
+                  for (size_t i = begin; i < end; ++i) {
+                    codec_->EncodeTokens(id_to_keyinfo_table[i]->tokens,
+                                         &encoded_tokens[i]);
+                  }
+                });
+    for (const std::string &tokens_str : encoded_tokens) {
       token_array_builder_.Add(tokens_str);
     }
   }
@@ -30,10 +30,10 @@
 #ifndef MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_BUILDER_H_
 #define MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_BUILDER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <map>
-#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -75,7 +75,7 @@ class SystemDictionaryBuilder final {
   void BuildFromTokens(absl::Span<Token *const> tokens) {
     BuildFromTokensInternal(std::vector<Token *>(tokens.begin(), tokens.end()));
   }
-  void BuildFromTokens(absl::Span<const std::unique_ptr<Token>> token);
+  void BuildFromTokens(absl::Span<Token> tokens);
 
   void WriteToFile(const std::string &output_file) const;
   void WriteToStream(absl::string_view intermediate_output_file_base_path,
@@ -96,13 +96,18 @@ class SystemDictionaryBuilder final {
   void BuildKeyTrie(const KeyInfoList &key_info_list);
   void BuildTokenArray(const KeyInfoList &key_info_list);
 
-  void SetIdForValue(KeyInfoList *key_info_list) const;
-  void SetIdForKey(KeyInfoList *key_info_list) const;
-  void SortTokenInfo(KeyInfoList *key_info_list) const;
+  // The following methods update key_info_list[begin, end) and are called
+  // concurrently for disjoint ranges.
+  void SetIdForValue(KeyInfoList &key_info_list, size_t begin,
+                     size_t end) const;
+  void SetIdForKey(KeyInfoList &key_info_list, size_t begin, size_t end) const;
+  void SortTokenInfo(KeyInfoList &key_info_list, size_t begin,
+                     size_t end) const;
+  void SetPosType(KeyInfoList &key_info_list, size_t begin, size_t end) const;
+  void SetValueType(KeyInfoList &key_info_list, size_t begin,
+                    size_t end) const;
 
   void SetCostType(KeyInfoList *key_info_list) const;
-  void SetPosType(KeyInfoList *key_info_list) const;
-  void SetValueType(KeyInfoList *key_info_list) const;
 
   storage::louds::LoudsTrieBuilder value_trie_builder_;
   storage::louds::LoudsTrieBuilder key_trie_builder_;
@@ -111,6 +116,10 @@ class SystemDictionaryBuilder final {
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32_t, int> frequent_pos_;
 
+  // The number of threads used by the current build. The output does not
+  // depend on this value.
+  int num_threads_ = 1;
+
   const SystemDictionaryCodecInterface *codec_ =
       SystemDictionaryCodecFactory::GetCodec();
   const DictionaryFileCodecInterface *file_codec_ =
@@ -36,6 +36,7 @@
 #include <limits>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -49,6 +50,7 @@
 #include "absl/types/span.h"
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
+#include "base/thread.h"
 #include "config/config_handler.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_interface.h"
@@ -70,6 +72,7 @@ ABSL_FLAG(int32_t, dictionary_test_size, 100000,
 ABSL_FLAG(int32_t, dictionary_reverse_lookup_test_size, 1000,
           "Number of tokens to run reverse lookup test.");
 ABSL_DECLARE_FLAG(int32_t, min_key_length_to_use_small_cost_encoding);
+ABSL_DECLARE_FLAG(int32_t, system_dictionary_build_threads);
 
 namespace mozc {
 namespace dictionary {
@@ -140,9 +143,6 @@ class SystemDictionaryTest : public testing::TestWithTempUserProfile {
 };
 
 Token *GetTokenPointer(Token &token) { return &token; }
-Token *GetTokenPointer(const std::unique_ptr<Token> &token) {
-  return token.get();
-}
 
 // Get pointers to the Tokens contained in `token_container`. Since the returned
 // vector contains mutable pointers to the elements of `token_container`, it
@@ -174,7 +174,11 @@ void SystemDictionaryTest::BuildAndWriteSystemDictionary(
 std::unique_ptr<SystemDictionary> SystemDictionaryTest::BuildSystemDictionary(
     absl::Span<Token *const> source, size_t num_tokens) {
   BuildAndWriteSystemDictionary(source, num_tokens, dic_fn_);
-  return SystemDictionary::Builder(dic_fn_).Build().value();
+  // Like engine::Modules, so that the tests run against the value cache.
+  return SystemDictionary::Builder(dic_fn_)
+      .SetOptions(SystemDictionary::ENABLE_VALUE_CACHE)
+      .Build()
+      .value();
 }
 
 // Returns true if they seem to be same
@@ -380,7 +384,7 @@ TEST_F(SystemDictionaryTest, SameWord) {
 }
 
 TEST_F(SystemDictionaryTest, LookupAllWords) {
-  absl::Span<const std::unique_ptr<Token>> source_tokens = text_dict_.tokens();
+  absl::Span<Token> source_tokens = text_dict_.tokens();
   std::unique_ptr<SystemDictionary> system_dic =
       BuildSystemDictionary(MakeTokenPointers(&source_tokens),
                             absl::GetFlag(FLAGS_dictionary_test_size));
@@ -388,10 +392,10 @@ TEST_F(SystemDictionaryTest, LookupAllWords) {
 
   // All the tokens should be looked up.
   for (size_t i = 0; i < source_tokens.size(); ++i) {
-    CheckTokenExistenceCallback callback(source_tokens[i].get());
-    system_dic->LookupPrefix(source_tokens[i]->key, convreq_, &callback);
+    CheckTokenExistenceCallback callback(&source_tokens[i]);
+    system_dic->LookupPrefix(source_tokens[i].key, convreq_, &callback);
     EXPECT_TRUE(callback.found())
-        << "Token was not found: " << PrintToken(*source_tokens[i]);
+        << "Token was not found: " << PrintToken(source_tokens[i]);
   }
 }
 
@@ -721,7 +725,7 @@ TEST_F(SystemDictionaryTest, LookupReverse) {
 }
 
 TEST_F(SystemDictionaryTest, LookupReverseIndex) {
-  absl::Span<const std::unique_ptr<Token>> source_tokens = text_dict_.tokens();
+  absl::Span<Token> source_tokens = text_dict_.tokens();
   BuildAndWriteSystemDictionary(MakeTokenPointers(&source_tokens),
                                 absl::GetFlag(FLAGS_dictionary_test_size),
                                 dic_fn_);
@@ -744,7 +748,7 @@ TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   int size = absl::GetFlag(FLAGS_dictionary_reverse_lookup_test_size);
   for (auto it = source_tokens.begin(); size > 0 && it != source_tokens.end();
        ++it, --size) {
-    const Token &t = **it;
+    const Token &t = *it;
     CollectTokenCallback callback1, callback2;
     system_dic_without_index->LookupReverse(t.value, convreq_, &callback1);
     system_dic_with_index->LookupReverse(t.value, convreq_, &callback2);
@@ -758,6 +762,42 @@ TEST_F(SystemDictionaryTest, LookupReverseIndex) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupPrefixWithValueCache) {
+  absl::Span<Token> source_tokens = text_dict_.tokens();
+  BuildAndWriteSystemDictionary(MakeTokenPointers(&source_tokens),
+                                absl::GetFlag(FLAGS_dictionary_test_size),
+                                dic_fn_);
+
+  std::unique_ptr<SystemDictionary> system_dic =
+      SystemDictionary::Builder(dic_fn_).Build().value();
+  ASSERT_TRUE(system_dic);
+  EXPECT_EQ(system_dic->value_cache(), nullptr);
+  std::unique_ptr<SystemDictionary> system_dic_with_cache =
+      SystemDictionary::Builder(dic_fn_)
+          .SetOptions(SystemDictionary::ENABLE_VALUE_CACHE)
+          .Build()
+          .value();
+  ASSERT_TRUE(system_dic_with_cache);
+  ASSERT_NE(system_dic_with_cache->value_cache(), nullptr);
+
+  // Looks up twice so that the second round hits the cache.
+  for (int round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < source_tokens.size(); i += 10) {
+      CollectTokenCallback callback1, callback2;
+      system_dic->LookupPrefix(source_tokens[i].key, convreq_, &callback1);
+      system_dic_with_cache->LookupPrefix(source_tokens[i].key, convreq_,
+                                          &callback2);
+      absl::Span<const Token> tokens1 = callback1.tokens();
+      absl::Span<const Token> tokens2 = callback2.tokens();
+      ASSERT_EQ(tokens1.size(), tokens2.size());
+      for (size_t j = 0; j < tokens1.size(); ++j) {
+        EXPECT_TOKEN_EQ(tokens1[j], tokens2[j]);
+      }
+    }
+  }
+  EXPECT_GT(system_dic_with_cache->value_cache()->hits(), 0);
+}
+
 TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   const std::string kDoraemon = "ドラえもん";
 
@@ -784,6 +824,48 @@ TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   system_dic->ClearReverseLookupCache();
 }
 
+TEST_F(SystemDictionaryTest, ConcurrentLookupReverseWithCache) {
+  const std::string kDoraemon = "ドラえもん";
+
+  Token source_token;
+  source_token.key = "どらえもん";
+  source_token.value = kDoraemon;
+  source_token.cost = 1;
+  source_token.lid = 2;
+  source_token.rid = 3;
+  std::vector<Token *> source_tokens = {&source_token};
+  text_dict_.CollectTokens(&source_tokens);
+  std::unique_ptr<SystemDictionary> system_dic =
+      BuildSystemDictionary(source_tokens, source_tokens.size());
+  ASSERT_TRUE(system_dic);
+
+  Token target_token = source_token;
+  target_token.key.swap(target_token.value);
+
+  // Each thread populates and clears its own cache while the others use
+  // theirs.
+  constexpr int kNumThreads = 4;
+  std::vector<Thread> threads;
+  std::vector<int> found(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int n = 0; n < 20; ++n) {
+        system_dic->PopulateReverseLookupCache(kDoraemon);
+        CheckTokenExistenceCallback callback(&target_token);
+        system_dic->LookupReverse(kDoraemon, convreq_, &callback);
+        found[i] += callback.found();
+        system_dic->ClearReverseLookupCache();
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(found[i], 20) << "thread " << i;
+  }
+}
+
 TEST_F(SystemDictionaryTest, SpellingCorrectionTokens) {
   std::vector<Token> tokens = {
       {"あぼがど", "アボカド", 1, 0, 2, Token::SPELLING_CORRECTION},
@@ -962,6 +1044,31 @@ TEST_F(SystemDictionaryTest, ShouldNotUseSmallCostEncodingForHeteronyms) {
   }
 }
 
+TEST_F(SystemDictionaryTest, ParallelBuildIsDeterministic) {
+  // Enables small cost encoding to cover all the build steps.
+  absl::SetFlag(&FLAGS_min_key_length_to_use_small_cost_encoding,
+                original_flags_min_key_length_to_use_small_cost_encoding_);
+  const int32_t original_num_threads =
+      absl::GetFlag(FLAGS_system_dictionary_build_threads);
+
+  absl::Span<Token> source_tokens = text_dict_.tokens();
+  auto build = [&source_tokens](int32_t num_threads) {
+    absl::SetFlag(&FLAGS_system_dictionary_build_threads, num_threads);
+    SystemDictionaryBuilder builder;
+    builder.BuildFromTokens(source_tokens);
+    std::ostringstream os;
+    builder.WriteToStream("", &os);
+    return os.str();
+  };
+  const std::string serial = build(1);
+  EXPECT_FALSE(serial.empty());
+  for (const int32_t num_threads : {2, 3, 8}) {
+    EXPECT_EQ(build(num_threads), serial) << "num_threads: " << num_threads;
+  }
+
+  absl::SetFlag(&FLAGS_system_dictionary_build_threads, original_num_threads);
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
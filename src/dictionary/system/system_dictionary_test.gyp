@@ -59,6 +59,23 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'value_cache_test',
+      'type': 'executable',
+      'sources': [
+        'value_cache_test.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_random',
+        '<(mozc_oss_src_dir)/base/absl.gyp:absl_strings',
+        '<(mozc_oss_src_dir)/base/base.gyp:base',
+        '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'system_dictionary.gyp:system_dictionary',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'system_dictionary_test',
       'type': 'executable',
@@ -111,6 +128,7 @@
         'key_expansion_table_test',
         'system_dictionary_codec_test',
         'system_dictionary_test',
+        'value_cache_test',
         'value_dictionary_test',
       ],
     },
@@ -40,6 +40,7 @@
 #include "base/japanese_util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/system/codec_interface.h"
+#include "dictionary/system/value_cache.h"
 #include "dictionary/system/words_info.h"
 #include "storage/louds/louds_trie.h"
 
@@ -50,10 +51,11 @@ class TokenDecodeIterator {
  public:
   TokenDecodeIterator(const TokenDecodeIterator &) = delete;
   TokenDecodeIterator &operator=(const TokenDecodeIterator &) = delete;
+  // `value_cache` may be nullptr.
   TokenDecodeIterator(const SystemDictionaryCodecInterface *codec,
                       const storage::louds::LoudsTrie &value_trie,
-                      const uint32_t *frequent_pos, absl::string_view key,
-                      const uint8_t *ptr);
+                      ValueCache *value_cache, const uint32_t *frequent_pos,
+                      absl::string_view key, const uint8_t *ptr);
   ~TokenDecodeIterator() = default;
 
   const TokenInfo &Get() const { return token_info_; }
@@ -70,14 +72,21 @@ class TokenDecodeIterator {
   void NextInternal();
 
   void LookupValue(int id, std::string *value) const {
+    if (value_cache_ != nullptr && value_cache_->Lookup(id, value)) {
+      return;
+    }
     char buffer[storage::louds::LoudsTrie::kMaxDepth + 1];
     const absl::string_view encoded_value =
         value_trie_->RestoreKeyString(id, buffer);
     codec_->DecodeValue(encoded_value, value);
+    if (value_cache_ != nullptr) {
+      value_cache_->Insert(id, *value);
+    }
   }
 
   const SystemDictionaryCodecInterface *codec_;
   const storage::louds::LoudsTrie *value_trie_;
+  ValueCache *value_cache_;
   const uint32_t *frequent_pos_;
 
   const absl::string_view key_;
@@ -95,10 +104,11 @@ class TokenDecodeIterator {
 
 inline TokenDecodeIterator::TokenDecodeIterator(
     const SystemDictionaryCodecInterface *codec,
-    const storage::louds::LoudsTrie &value_trie, const uint32_t *frequent_pos,
-    absl::string_view key, const uint8_t *ptr)
+    const storage::louds::LoudsTrie &value_trie, ValueCache *value_cache,
+    const uint32_t *frequent_pos, absl::string_view key, const uint8_t *ptr)
     : codec_(codec),
       value_trie_(&value_trie),
+      value_cache_(value_cache),
       frequent_pos_(frequent_pos),
       key_(key),
       state_(HAS_NEXT),
@@ -0,0 +1,136 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/system/value_cache.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+
+ValueCache::ValueCache(size_t num_slots) : num_sets_(1) {
+  while (num_sets_ * kWays < num_slots) {
+    num_sets_ <<= 1;
+  }
+  slots_ = std::make_unique<Slot[]>(num_sets_ * kWays);
+}
+
+ValueCache::Slot *ValueCache::GetSet(int id) const {
+  // Fibonacci hashing spreads neighboring ids, which are often looked up
+  // together, over different sets.
+  const uint64_t hash =
+      (static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15) >>
+      32;
+  return &slots_[(hash & (num_sets_ - 1)) * kWays];
+}
+
+bool ValueCache::Lookup(int id, std::string *value) {
+  Slot *set = GetSet(id);
+  for (size_t i = 0; i < kWays; ++i) {
+    Slot &slot = set[i];
+    const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if ((seq & 1) != 0 || slot.id.load(std::memory_order_relaxed) != id) {
+      continue;
+    }
+    uint64_t data[Slot::kNumWords];
+    for (size_t j = 0; j < Slot::kNumWords; ++j) {
+      data[j] = slot.data[j].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      // Overwritten while reading.
+      break;
+    }
+    if (!slot.referenced.load(std::memory_order_relaxed)) {
+      slot.referenced.store(true, std::memory_order_relaxed);
+    }
+    const char *bytes = reinterpret_cast<const char *>(data);
+    value->assign(bytes + 1, static_cast<uint8_t>(bytes[0]));
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void ValueCache::Insert(int id, absl::string_view value) {
+  if (value.size() > kMaxValueSize) {
+    return;
+  }
+
+  // Advances the hand until it finds a slot not referenced since it passed
+  // last time. Two rounds are enough as the first one clears all the bits.
+  Slot *set = GetSet(id);
+  size_t hand = set[0].hand.load(std::memory_order_relaxed);
+  Slot *victim = nullptr;
+  for (size_t n = 0; n < 2 * kWays; ++n, hand = (hand + 1) % kWays) {
+    if (set[hand].id.load(std::memory_order_relaxed) == id) {
+      return;  // Inserted by another thread.
+    }
+    if (!set[hand].referenced.exchange(false, std::memory_order_relaxed)) {
+      victim = &set[hand];
+      hand = (hand + 1) % kWays;
+      break;
+    }
+  }
+  set[0].hand.store(hand, std::memory_order_relaxed);
+  if (victim == nullptr) {
+    // Other threads referenced the slots again while the hand was passing.
+    return;
+  }
+
+  uint32_t seq = victim->seq.load(std::memory_order_relaxed);
+  if ((seq & 1) != 0 ||
+      !victim->seq.compare_exchange_strong(seq, seq + 1,
+                                           std::memory_order_acquire)) {
+    return;  // Another thread is writing it.
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint64_t data[Slot::kNumWords] = {};
+  char *bytes = reinterpret_cast<char *>(data);
+  bytes[0] = static_cast<char>(value.size());
+  memcpy(bytes + 1, value.data(), value.size());
+  victim->id.store(id, std::memory_order_relaxed);
+  for (size_t j = 0; j < Slot::kNumWords; ++j) {
+    victim->data[j].store(data[j], std::memory_order_relaxed);
+  }
+  victim->referenced.store(false, std::memory_order_relaxed);
+  victim->seq.store(seq + 2, std::memory_order_release);
+}
+
+}  // namespace dictionary
+}  // namespace mozc
@@ -0,0 +1,101 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DICTIONARY_SYSTEM_VALUE_CACHE_H_
+#define MOZC_DICTIONARY_SYSTEM_VALUE_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Bounded cache from ids in the value trie to decoded values, so that frequent
+// words don't have to be restored from the trie every time.
+//
+// Lookup() and Insert() are lock-free and can be called from multiple threads.
+// Each slot is guarded by a sequence lock. A slot being written is a miss for
+// readers, and a writer gives up if another one is writing the same slot.
+// Slots are grouped in sets of kWays, and a CLOCK (second chance) policy picks
+// the slot to evict from a set.
+class ValueCache {
+ public:
+  // Values longer than this are not cached.
+  static constexpr size_t kMaxValueSize = 47;
+  static constexpr size_t kWays = 4;
+
+  // `num_slots` is rounded up to a power of two, kWays at least.
+  explicit ValueCache(size_t num_slots);
+
+  ValueCache(const ValueCache &) = delete;
+  ValueCache &operator=(const ValueCache &) = delete;
+
+  // Stores the value of `id` to `value` and returns true if it's cached.
+  bool Lookup(int id, std::string *value);
+  void Insert(int id, absl::string_view value);
+
+  size_t num_slots() const { return num_sets_ * kWays; }
+  // Statistics for tuning. Updated with relaxed atomics, so they are only
+  // approximate while other threads use the cache.
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+ private:
+  // One cache line. The first byte of `data` is the length of the value.
+  struct alignas(64) Slot {
+    static constexpr size_t kNumWords = 6;
+    static_assert(kMaxValueSize + 1 == kNumWords * sizeof(uint64_t));
+
+    // Odd while being written.
+    std::atomic<uint32_t> seq = 0;
+    std::atomic<int32_t> id = -1;
+    std::atomic<uint64_t> data[kNumWords] = {};
+    // Set on every hit and cleared when the CLOCK hand passes.
+    std::atomic<bool> referenced = false;
+    // The CLOCK hand of the set. Used only in the first slot of a set.
+    std::atomic<uint8_t> hand = 0;
+  };
+
+  Slot *GetSet(int id) const;
+
+  size_t num_sets_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> hits_ = 0;
+  std::atomic<uint64_t> misses_ = 0;
+};
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_SYSTEM_VALUE_CACHE_H_
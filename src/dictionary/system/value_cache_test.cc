@@ -0,0 +1,173 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dictionary/system/value_cache.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "base/thread.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+TEST(ValueCacheTest, LookupAfterInsert) {
+  ValueCache cache(64);
+  std::string value = "unchanged";
+  EXPECT_FALSE(cache.Lookup(1, &value));
+  EXPECT_EQ(value, "unchanged");
+
+  cache.Insert(1, "変換");
+  cache.Insert(2, "");
+  EXPECT_TRUE(cache.Lookup(1, &value));
+  EXPECT_EQ(value, "変換");
+  EXPECT_TRUE(cache.Lookup(2, &value));
+  EXPECT_EQ(value, "");
+  EXPECT_FALSE(cache.Lookup(3, &value));
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(ValueCacheTest, DoesNotCacheLongValues) {
+  ValueCache cache(64);
+  const std::string longest(ValueCache::kMaxValueSize, 'a');
+  cache.Insert(1, longest);
+  cache.Insert(2, longest + "a");
+
+  std::string value;
+  EXPECT_TRUE(cache.Lookup(1, &value));
+  EXPECT_EQ(value, longest);
+  EXPECT_FALSE(cache.Lookup(2, &value));
+}
+
+TEST(ValueCacheTest, EvictsUnreferencedValuesFirst) {
+  // A single set.
+  ValueCache cache(ValueCache::kWays);
+  ASSERT_EQ(cache.num_slots(), ValueCache::kWays);
+  for (int id = 0; id < ValueCache::kWays; ++id) {
+    cache.Insert(id, absl::StrCat(id));
+  }
+
+  // All but the last one get a second chance.
+  std::string value;
+  for (int id = 0; id < ValueCache::kWays - 1; ++id) {
+    ASSERT_TRUE(cache.Lookup(id, &value));
+  }
+  cache.Insert(100, "100");
+  EXPECT_TRUE(cache.Lookup(100, &value));
+  EXPECT_FALSE(cache.Lookup(ValueCache::kWays - 1, &value));
+  for (int id = 0; id < ValueCache::kWays - 1; ++id) {
+    EXPECT_TRUE(cache.Lookup(id, &value));
+    EXPECT_EQ(value, absl::StrCat(id));
+  }
+}
+
+TEST(ValueCacheTest, KeepsLatestValuesWhenFull) {
+  ValueCache cache(256);
+  std::string value;
+  for (int id = 0; id < 10000; ++id) {
+    cache.Insert(id, absl::StrCat("value", id));
+  }
+  int hits = 0;
+  for (int id = 0; id < 10000; ++id) {
+    if (cache.Lookup(id, &value)) {
+      EXPECT_EQ(value, absl::StrCat("value", id));
+      ++hits;
+    }
+  }
+  EXPECT_GT(hits, 0);
+  EXPECT_LE(hits, cache.num_slots());
+}
+
+TEST(ValueCacheTest, ConcurrentAccess) {
+  ValueCache cache(128);
+  std::vector<Thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&cache] {
+      absl::BitGen gen;
+      std::string value;
+      for (int n = 0; n < 100000; ++n) {
+        const int id = absl::Uniform(gen, 0, 1000);
+        // The length varies with the id, so that a torn read would show.
+        const std::string expected(id % (ValueCache::kMaxValueSize + 1),
+                                   static_cast<char>('a' + id % 26));
+        if (cache.Lookup(id, &value)) {
+          ASSERT_EQ(value, expected);
+        } else {
+          cache.Insert(id, expected);
+        }
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_GT(cache.hits(), 0);
+}
+
+TEST(ValueCacheTest, InsertWhileAllSlotsAreReferenced) {
+  // A single set, whose slots are referenced again by the other threads right
+  // after the CLOCK hand clears them. Insert() gives up rather than evicting.
+  ValueCache cache(ValueCache::kWays);
+  std::atomic<bool> done = false;
+  std::vector<Thread> threads;
+  for (int id = 0; id < ValueCache::kWays; ++id) {
+    threads.emplace_back([&cache, &done, id] {
+      const std::string expected = absl::StrCat(id);
+      std::string value;
+      while (!done.load(std::memory_order_relaxed)) {
+        if (cache.Lookup(id, &value)) {
+          ASSERT_EQ(value, expected);
+        } else {
+          cache.Insert(id, expected);
+        }
+      }
+    });
+  }
+  std::string value;
+  for (int id = 100; id < 100000; ++id) {
+    cache.Insert(id, absl::StrCat(id));
+    if (cache.Lookup(id, &value)) {
+      EXPECT_EQ(value, absl::StrCat(id));
+    }
+  }
+  done = true;
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
@@ -34,71 +34,69 @@
 #include "dictionary/text_dictionary_loader.h"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <ios>
 #include <iterator>
 #include <limits>
-#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/base/attributes.h"
-#include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
 #include "absl/types/span.h"
+#include "base/file_stream.h"
 #include "base/japanese_util.h"
+#include "base/mmap.h"
 #include "base/multifile.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 
-ABSL_FLAG(int32_t, tokens_reserve_size, 1400000,
-          "Reserve the specified size of token buffer in advance.");
-
 namespace mozc {
 namespace dictionary {
 namespace {
 
 using ValueAndKey = std::pair<absl::string_view, absl::string_view>;
 
-ValueAndKey ToValueAndKey(const std::unique_ptr<Token> &token) {
-  return ValueAndKey(token->value, token->key);
+ValueAndKey ToValueAndKey(const Token &token) {
+  return ValueAndKey(token.value, token.key);
 }
 
 // Functor to sort a sequence of Tokens first by value and then by key.
 struct OrderByValueThenByKey {
-  bool operator()(const std::unique_ptr<Token> &l,
-                  const std::unique_ptr<Token> &r) const {
+  bool operator()(const Token &l, const Token &r) const {
     return ToValueAndKey(l) < ToValueAndKey(r);
   }
 
-  bool operator()(const std::unique_ptr<Token> &token,
-                  const ValueAndKey &value_key) const {
+  bool operator()(const Token &token, const ValueAndKey &value_key) const {
     return ToValueAndKey(token) < value_key;
   }
 
-  bool operator()(const ValueAndKey &value_key,
-                  const std::unique_ptr<Token> &token) const {
+  bool operator()(const ValueAndKey &value_key, const Token &token) const {
     return value_key < ToValueAndKey(token);
   }
 };
 
 // Functor to sort a sequence of Tokens by value.
 struct OrderByValue {
-  bool operator()(const std::unique_ptr<Token> &token,
-                  absl::string_view value) const {
-    return token->value < value;
+  bool operator()(const Token &token, absl::string_view value) const {
+    return token.value < value;
   }
 
-  bool operator()(absl::string_view value,
-                  const std::unique_ptr<Token> &token) const {
-    return value < token->value;
+  bool operator()(absl::string_view value, const Token &token) const {
+    return value < token.value;
   }
 };
 
@@ -158,26 +156,49 @@ void TextDictionaryLoader::LoadWithLineLimit(
     const absl::string_view reading_correction_filename, int limit) {
   tokens_.clear();
 
-  // Roughly allocate buffers for Token pointers.
-  if (limit < 0) {
-    tokens_.reserve(absl::GetFlag(FLAGS_tokens_reserve_size));
+  const bool has_limit = limit >= 0;
+  if (!has_limit) {
     limit = std::numeric_limits<int>::max();
-  } else {
-    tokens_.reserve(limit);
   }
 
   // Read system dictionary.
   {
-    InputMultiFile file(dictionary_filename);
-    std::string line;
-    while (limit > 0 && file.ReadLine(&line)) {
-      Util::ChopReturns(&line);
-      std::unique_ptr<Token> token = ParseTSVLine(line);
-      if (token) {
-        tokens_.push_back(std::move(token));
-        --limit;
+    const std::vector<std::string> filenames =
+        absl::StrSplit(dictionary_filename, ',', absl::SkipEmpty());
+    std::vector<std::vector<Token>> file_tokens(filenames.size());
+    if (has_limit) {
+      // The limit applies to the concatenation of the files, so they are
+      // loaded one by one.
+      for (size_t i = 0; i < filenames.size() && limit > 0; ++i) {
+        file_tokens[i] = LoadTokensFromFile(filenames[i], limit);
+        limit -= static_cast<int>(file_tokens[i].size());
+      }
+    } else {
+      std::vector<Thread> threads;
+      threads.reserve(filenames.size());
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        threads.emplace_back([this, &filenames, &file_tokens, i, limit] {
+          file_tokens[i] = LoadTokensFromFile(filenames[i], limit);
+        });
+      }
+      for (Thread &thread : threads) {
+        thread.Join();
       }
     }
+
+    size_t total_size = 0;
+    for (const std::vector<Token> &tokens : file_tokens) {
+      total_size += tokens.size();
+    }
+    tokens_.reserve(total_size);
+    for (std::vector<Token> &tokens : file_tokens) {
+      tokens_.insert(tokens_.end(), std::make_move_iterator(tokens.begin()),
+                     std::make_move_iterator(tokens.end()));
+      std::vector<Token>().swap(tokens);  // Releases the memory early.
+    }
+    if (!has_limit) {
+      limit -= std::min(static_cast<int>(total_size), limit);
+    }
     LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
   }
 
@@ -195,23 +216,51 @@ void TextDictionaryLoader::LoadWithLineLimit(
   //      tokens that have the same value.
   std::stable_sort(tokens_.begin(), tokens_.end(), OrderByValueThenByKey());
 
-  std::vector<std::unique_ptr<Token>> reading_correction_tokens =
+  std::vector<Token> reading_correction_tokens =
       LoadReadingCorrectionTokens(reading_correction_filename, tokens_, &limit);
   tokens_.insert(tokens_.end(),
                  std::make_move_iterator(reading_correction_tokens.begin()),
                  std::make_move_iterator(reading_correction_tokens.end()));
 }
 
+std::vector<Token> TextDictionaryLoader::LoadTokensFromFile(
+    const std::string &filename, int limit) const {
+  std::vector<Token> tokens;
+  // Mmap rejects an empty file, which simply has no tokens.
+  if (InputFileStream ifs(filename, std::ios_base::in | std::ios_base::ate);
+      ifs && ifs.tellg() == 0) {
+    return tokens;
+  }
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename, Mmap::READ_ONLY);
+  if (!mmap.ok()) {
+    LOG(ERROR) << "Cannot open " << filename << ": " << mmap.status();
+    return tokens;
+  }
+  absl::string_view contents(mmap->data(), mmap->size());
+  // Like std::getline(), doesn't make an empty line after the last newline.
+  // Other empty lines are rejected by ParseTSVLine().
+  absl::ConsumeSuffix(&contents, "\n");
+  // Roughly estimates the number of lines to avoid reallocation.
+  tokens.reserve(std::min(limit, static_cast<int>(contents.size() / 32)));
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    if (limit <= 0) {
+      break;
+    }
+    absl::ConsumeSuffix(&line, "\r");
+    tokens.push_back(ParseTSVLine(line));
+    --limit;
+  }
+  return tokens;
+}
+
 // Loads reading correction data into |tokens|.  The second argument is used to
 // determine costs of reading correction tokens and must be sorted by
-// OrderByValueThenByKey().  The output tokens are newly allocated and the
-// caller is responsible to delete them.
-std::vector<std::unique_ptr<Token>>
-TextDictionaryLoader::LoadReadingCorrectionTokens(
+// OrderByValueThenByKey().
+std::vector<Token> TextDictionaryLoader::LoadReadingCorrectionTokens(
     const absl::string_view reading_correction_filename,
-    absl::Span<const std::unique_ptr<Token>> ref_sorted_tokens, int *limit) {
+    absl::Span<const Token> ref_sorted_tokens, int *limit) {
   // Load reading correction entries.
-  std::vector<std::unique_ptr<Token>> tokens;
+  std::vector<Token> tokens;
   int reading_correction_size = 0;
   InputMultiFile file(reading_correction_filename);
   std::string line;
@@ -249,10 +298,10 @@ TextDictionaryLoader::LoadReadingCorrectionTokens(
     // this reading correction entry.  Next, find the token that has the
     // maximum cost in [begin, end).  Note that linear search is sufficiently
     // fast here because the size of the range is small.
-    const Token *max_cost_token = begin->get();
+    const Token *max_cost_token = &*begin;
     for (++begin; begin != end; ++begin) {
-      if ((*begin)->cost > max_cost_token->cost) {
-        max_cost_token = begin->get();
+      if (begin->cost > max_cost_token->cost) {
+        max_cost_token = &*begin;
       }
     }
 
@@ -260,18 +309,13 @@ TextDictionaryLoader::LoadReadingCorrectionTokens(
     // We here assume that the wrong reading appear with 1/100 probability
     // of the original (correct) reading.
     constexpr int kCostPenalty = 2302;  // -log(1/100) * 500;
-    auto token = std::make_unique<Token>();
-    token->key.assign(value_key.second.data(), value_key.second.size());
-    token->value = max_cost_token->value;
-    token->lid = max_cost_token->lid;
-    token->rid = max_cost_token->rid;
-    token->cost = max_cost_token->cost + kCostPenalty;
     // We don't set SPELLING_CORRECTION. The entries in reading_correction
     // data are also stored in rewriter/correction_rewriter.cc.
     // reading_correction_rewriter annotates the spelling correction
     // notations.
-    token->attributes = Token::NONE;
-    tokens.push_back(std::move(token));
+    tokens.emplace_back(value_key.second, max_cost_token->value,
+                        max_cost_token->cost + kCostPenalty,
+                        max_cost_token->lid, max_cost_token->rid, Token::NONE);
     ++reading_correction_size;
     if (--*limit <= 0) {
       break;
@@ -282,41 +326,43 @@ TextDictionaryLoader::LoadReadingCorrectionTokens(
   return tokens;
 }
 
-void TextDictionaryLoader::CollectTokens(std::vector<Token *> *res) const {
+void TextDictionaryLoader::CollectTokens(std::vector<Token *> *res) {
   DCHECK(res);
   res->reserve(res->size() + tokens_.size());
-  for (const std::unique_ptr<Token> &token : tokens_) {
-    res->push_back(token.get());
+  for (Token &token : tokens_) {
+    res->push_back(&token);
   }
 }
 
-std::unique_ptr<Token> TextDictionaryLoader::ParseTSVLine(
-    absl::string_view line) const {
-  const std::vector<absl::string_view> columns =
-      absl::StrSplit(line, '\t', absl::SkipEmpty());
-  return ParseTSV(columns);
-}
-
-std::unique_ptr<Token> TextDictionaryLoader::ParseTSV(
-    absl::Span<const absl::string_view> columns) const {
-  CHECK_LE(5, columns.size()) << "Lack of columns: " << columns.size();
+Token TextDictionaryLoader::ParseTSVLine(absl::string_view line) const {
+  // Splits the line without allocating a vector. Empty columns are skipped.
+  std::array<absl::string_view, 6> columns;
+  size_t num_columns = 0;
+  for (const absl::string_view column :
+       absl::StrSplit(line, '\t', absl::SkipEmpty())) {
+    if (num_columns == columns.size()) {
+      break;
+    }
+    columns[num_columns++] = column;
+  }
+  CHECK_LE(5, num_columns) << "Lack of columns: " << num_columns;
 
-  auto token = std::make_unique<Token>();
+  Token token;
 
   // Parse key, lid, rid, cost, value.
-  token->key = japanese_util::NormalizeVoicedSoundMark(columns[0]);
-  CHECK(absl::SimpleAtoi(columns[1], &token->lid))
+  token.key = japanese_util::NormalizeVoicedSoundMark(columns[0]);
+  CHECK(absl::SimpleAtoi(columns[1], &token.lid))
       << "Wrong lid: " << columns[1];
-  CHECK(absl::SimpleAtoi(columns[2], &token->rid))
+  CHECK(absl::SimpleAtoi(columns[2], &token.rid))
       << "Wrong rid: " << columns[2];
-  CHECK(absl::SimpleAtoi(columns[3], &token->cost))
+  CHECK(absl::SimpleAtoi(columns[3], &token.cost))
       << "Wrong cost: " << columns[3];
-  token->value = japanese_util::NormalizeVoicedSoundMark(columns[4]);
+  token.value = japanese_util::NormalizeVoicedSoundMark(columns[4]);
 
   // Optionally, label (SPELLING_CORRECTION, ZIP_CODE, etc.) may be provided in
   // column 6.
-  if (columns.size() > 5) {
-    CHECK(RewriteSpecialToken(token.get(), columns[5]))
+  if (num_columns > 5) {
+    CHECK(RewriteSpecialToken(&token, columns[5]))
         << "Invalid label: " << columns[5];
   }
   return token;
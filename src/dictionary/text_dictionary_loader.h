@@ -31,7 +31,7 @@
 #define MOZC_DICTIONARY_TEXT_DICTIONARY_LOADER_H_
 
 #include <cstdint>
-#include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -62,6 +62,9 @@ class TextDictionaryLoader {
   // that the tokens loaded so far are all cleared and that this class takes the
   // ownership of the loaded tokens, i.e., they are deleted on destruction of
   // this loader instance.
+  //
+  // System dictionary files are memory-mapped and parsed in parallel, one
+  // thread per file. The order of the tokens is the same as the input.
   void Load(absl::string_view dictionary_filename,
             absl::string_view reading_correction_filename);
 
@@ -74,21 +77,26 @@ class TextDictionaryLoader {
   // Clears the loaded tokens.
   void Clear() { tokens_.clear(); }
 
-  void AddToken(std::unique_ptr<Token> token) {
-    tokens_.push_back(std::move(token));
-  }
+  void AddToken(Token token) { tokens_.push_back(std::move(token)); }
 
-  absl::Span<const std::unique_ptr<Token>> tokens() const { return tokens_; }
+  // Tokens are stored contiguously. The returned span and the pointers to its
+  // elements are invalidated by Load(), Clear() and AddToken().
+  absl::Span<const Token> tokens() const { return tokens_; }
+  absl::Span<Token> tokens() { return absl::MakeSpan(tokens_); }
 
-  // Appends the tokens owned by this instance to |res|.  Note that the appended
-  // tokens are still owned by this instance and deleted on destruction of this
-  // instance or when Clear() is called.
-  void CollectTokens(std::vector<Token *> *res) const;
+  // Appends the pointers to the tokens owned by this instance to |res|. Note
+  // that the tokens are still owned by this instance and the pointers are
+  // invalidated in the same way as tokens().
+  void CollectTokens(std::vector<Token *> *res);
 
  private:
-  static std::vector<std::unique_ptr<Token>> LoadReadingCorrectionTokens(
+  static std::vector<Token> LoadReadingCorrectionTokens(
       absl::string_view reading_correction_filename,
-      absl::Span<const std::unique_ptr<Token>> ref_sorted_tokens, int *limit);
+      absl::Span<const Token> ref_sorted_tokens, int *limit);
+
+  // Parses the first |limit| lines of a system dictionary file.
+  std::vector<Token> LoadTokensFromFile(const std::string &filename,
+                                        int limit) const;
 
   // Encodes special information into |token| with the |label|.
   // Currently, label must be:
@@ -99,13 +107,11 @@ class TextDictionaryLoader {
   // Otherwise, the method returns false.
   bool RewriteSpecialToken(Token *token, absl::string_view label) const;
 
-  std::unique_ptr<Token> ParseTSVLine(absl::string_view line) const;
-  std::unique_ptr<Token> ParseTSV(
-      absl::Span<const absl::string_view> columns) const;
+  Token ParseTSVLine(absl::string_view line) const;
 
   const uint16_t zipcode_id_;
   const uint16_t isolated_word_id_;
-  std::vector<std::unique_ptr<Token>> tokens_;
+  std::vector<Token> tokens_;
 
   FRIEND_TEST(TextDictionaryLoaderTest, RewriteSpecialTokenTest);
 };
@@ -87,27 +87,27 @@ TEST_F(TextDictionaryLoaderTest, BasicTest) {
   {
     std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
     loader->Load(filename, "");
-    absl::Span<const std::unique_ptr<Token>> tokens = loader->tokens();
+    absl::Span<const Token> tokens = loader->tokens();
 
     EXPECT_EQ(tokens.size(), 3);
 
-    EXPECT_EQ(tokens[0]->key, "key_test1");
-    EXPECT_EQ(tokens[0]->value, "value_test1");
-    EXPECT_EQ(tokens[0]->lid, 0);
-    EXPECT_EQ(tokens[0]->rid, 0);
-    EXPECT_EQ(tokens[0]->cost, 1);
+    EXPECT_EQ(tokens[0].key, "key_test1");
+    EXPECT_EQ(tokens[0].value, "value_test1");
+    EXPECT_EQ(tokens[0].lid, 0);
+    EXPECT_EQ(tokens[0].rid, 0);
+    EXPECT_EQ(tokens[0].cost, 1);
 
-    EXPECT_EQ(tokens[1]->key, "foo");
-    EXPECT_EQ(tokens[1]->value, "bar");
-    EXPECT_EQ(tokens[1]->lid, 1);
-    EXPECT_EQ(tokens[1]->rid, 2);
-    EXPECT_EQ(tokens[1]->cost, 3);
+    EXPECT_EQ(tokens[1].key, "foo");
+    EXPECT_EQ(tokens[1].value, "bar");
+    EXPECT_EQ(tokens[1].lid, 1);
+    EXPECT_EQ(tokens[1].rid, 2);
+    EXPECT_EQ(tokens[1].cost, 3);
 
-    EXPECT_EQ(tokens[2]->key, "buz");
-    EXPECT_EQ(tokens[2]->value, "foobar");
-    EXPECT_EQ(tokens[2]->lid, 10);
-    EXPECT_EQ(tokens[2]->rid, 20);
-    EXPECT_EQ(tokens[2]->cost, 30);
+    EXPECT_EQ(tokens[2].key, "buz");
+    EXPECT_EQ(tokens[2].value, "foobar");
+    EXPECT_EQ(tokens[2].lid, 10);
+    EXPECT_EQ(tokens[2].rid, 20);
+    EXPECT_EQ(tokens[2].cost, 30);
 
     loader->Clear();
     EXPECT_TRUE(loader->tokens().empty());
@@ -116,21 +116,21 @@ TEST_F(TextDictionaryLoaderTest, BasicTest) {
   {
     std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
     loader->LoadWithLineLimit(filename, "", 2);
-    absl::Span<const std::unique_ptr<Token>> tokens = loader->tokens();
+    absl::Span<const Token> tokens = loader->tokens();
 
     EXPECT_EQ(tokens.size(), 2);
 
-    EXPECT_EQ(tokens[0]->key, "key_test1");
-    EXPECT_EQ(tokens[0]->value, "value_test1");
-    EXPECT_EQ(tokens[0]->lid, 0);
-    EXPECT_EQ(tokens[0]->rid, 0);
-    EXPECT_EQ(tokens[0]->cost, 1);
+    EXPECT_EQ(tokens[0].key, "key_test1");
+    EXPECT_EQ(tokens[0].value, "value_test1");
+    EXPECT_EQ(tokens[0].lid, 0);
+    EXPECT_EQ(tokens[0].rid, 0);
+    EXPECT_EQ(tokens[0].cost, 1);
 
-    EXPECT_EQ(tokens[1]->key, "foo");
-    EXPECT_EQ(tokens[1]->value, "bar");
-    EXPECT_EQ(tokens[1]->lid, 1);
-    EXPECT_EQ(tokens[1]->rid, 2);
-    EXPECT_EQ(tokens[1]->cost, 3);
+    EXPECT_EQ(tokens[1].key, "foo");
+    EXPECT_EQ(tokens[1].value, "bar");
+    EXPECT_EQ(tokens[1].lid, 1);
+    EXPECT_EQ(tokens[1].rid, 2);
+    EXPECT_EQ(tokens[1].cost, 3);
 
     loader->Clear();
     EXPECT_TRUE(loader->tokens().empty());
@@ -141,7 +141,7 @@ TEST_F(TextDictionaryLoaderTest, BasicTest) {
     // open twice -- tokens are cleared everytime
     loader->Load(filename, "");
     loader->Load(filename, "");
-    absl::Span<const std::unique_ptr<Token>> tokens = loader->tokens();
+    absl::Span<const Token> tokens = loader->tokens();
     EXPECT_EQ(tokens.size(), 3);
   }
 
@@ -216,8 +216,58 @@ TEST_F(TextDictionaryLoaderTest, LoadMultipleFilesTest) {
   {
     std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
     loader->Load(filename, "");
-    EXPECT_EQ(loader->tokens().size(), 6);
+    absl::Span<const Token> tokens = loader->tokens();
+    ASSERT_EQ(tokens.size(), 6);
+    // The files are loaded in parallel but the order is kept.
+    EXPECT_EQ(tokens[0].key, "key_test1");
+    EXPECT_EQ(tokens[2].key, "buz");
+    EXPECT_EQ(tokens[3].key, "key_test1");
+    EXPECT_EQ(tokens[5].key, "buz");
   }
+  {
+    // The limit applies to the concatenation of the files.
+    std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
+    loader->LoadWithLineLimit(filename, "", 4);
+    absl::Span<const Token> tokens = loader->tokens();
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[3].key, "key_test1");
+  }
+}
+
+TEST_F(TextDictionaryLoaderTest, EmptyFileTest) {
+  const std::string empty_filename =
+      FileUtil::JoinPath(temp_dir_.path(), "empty.tsv");
+  const std::string filename =
+      FileUtil::JoinPath(temp_dir_.path(), "test.tsv");
+  ASSERT_OK(FileUtil::SetContents(empty_filename, ""));
+  FileUnlinker empty_unlinker(empty_filename);
+  ASSERT_OK(FileUtil::SetContents(filename, kTextLines));
+  FileUnlinker unlinker(filename);
+
+  std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
+  loader->Load(empty_filename, "");
+  EXPECT_TRUE(loader->tokens().empty());
+
+  // An empty file doesn't affect the others.
+  loader->Clear();
+  loader->Load(empty_filename + "," + filename, "");
+  EXPECT_EQ(loader->tokens().size(), 3);
+}
+
+TEST_F(TextDictionaryLoaderTest, CrLfTest) {
+  const std::string filename = FileUtil::JoinPath(temp_dir_.path(), "test.tsv");
+  ASSERT_OK(FileUtil::SetContents(filename,
+                                  "foo\t1\t2\t3\tbar\r\n"
+                                  "buz\t10\t20\t30\tfoobar\tZIP_CODE\r\n"));
+  FileUnlinker unlinker(filename);
+
+  std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
+  loader->Load(filename, "");
+  absl::Span<const Token> tokens = loader->tokens();
+  ASSERT_EQ(tokens.size(), 2);
+  EXPECT_EQ(tokens[0].value, "bar");
+  EXPECT_EQ(tokens[1].value, "foobar");
+  EXPECT_EQ(tokens[1].lid, pos_matcher_.GetZipcodeId());
 }
 
 TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
@@ -235,13 +285,13 @@ TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   FileUnlinker reading_correction_unlinker(reading_correction_filename);
 
   loader->Load(dic_filename, reading_correction_filename);
-  absl::Span<const std::unique_ptr<Token>> tokens = loader->tokens();
+  absl::Span<const Token> tokens = loader->tokens();
   ASSERT_EQ(tokens.size(), 4);
-  EXPECT_EQ(tokens[3]->key, "foobar_error");
-  EXPECT_EQ(tokens[3]->value, "foobar");
-  EXPECT_EQ(tokens[3]->lid, 10);
-  EXPECT_EQ(tokens[3]->rid, 20);
-  EXPECT_EQ(tokens[3]->cost, 30 + 2302);
+  EXPECT_EQ(tokens[3].key, "foobar_error");
+  EXPECT_EQ(tokens[3].value, "foobar");
+  EXPECT_EQ(tokens[3].lid, 10);
+  EXPECT_EQ(tokens[3].rid, 20);
+  EXPECT_EQ(tokens[3].cost, 30 + 2302);
 }
 
 }  // namespace dictionary
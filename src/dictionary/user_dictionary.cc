@@ -53,6 +53,7 @@
 #include "base/file_util.h"
 #include "base/hash.h"
 #include "base/singleton.h"
+#include "base/startup_profiler.h"
 #include "base/strings/assign.h"
 #include "base/strings/japanese.h"
 #include "base/strings/unicode.h"
@@ -299,6 +300,7 @@ class UserDictionary::UserDictionaryReloader {
 
  private:
   void ThreadMain() {
+    StartupProfiler::ScopedPhase phase("UserDictionary::Load");
     UserDictionaryStorage storage(
         Singleton<UserDictionaryFileManager>::get()->GetFileName());
 
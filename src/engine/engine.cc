@@ -30,6 +30,7 @@
 #include "engine/engine.h"
 
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "absl/base/optimization.h"
@@ -39,9 +40,11 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "base/startup_profiler.h"
 #include "base/vlog.h"
 #include "converter/converter.h"
 #include "converter/immutable_converter.h"
+#include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
 #include "engine/data_loader.h"
 #include "engine/modules.h"
@@ -52,6 +55,7 @@
 #include "prediction/predictor_interface.h"
 #include "prediction/user_history_predictor.h"
 #include "protocol/engine_builder.pb.h"
+#include "request/conversion_request.h"
 #include "rewriter/rewriter.h"
 #include "rewriter/rewriter_interface.h"
 
@@ -109,6 +113,21 @@ bool UserDataManager::ClearUnusedUserPrediction() {
 
 bool UserDataManager::Wait() { return predictor_->Wait(); }
 
+// Takes the place of the user history predictor in an engine without the user
+// history.
+class NoUserHistoryPredictor final : public PredictorInterface {
+ public:
+  bool PredictForRequest(const ConversionRequest &request,
+                         Segments *segments) const override {
+    return false;
+  }
+
+  const std::string &GetPredictorName() const override { return name_; }
+
+ private:
+  const std::string name_ = "NoUserHistoryPredictor";
+};
+
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateDesktopEngine(
@@ -116,7 +135,11 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateDesktopEngine(
   constexpr bool kIsMobile = false;
 
   auto modules = std::make_unique<engine::Modules>();
-  absl::Status modules_status = modules->Init(std::move(data_manager));
+  absl::Status modules_status;
+  {
+    StartupProfiler::ScopedPhase phase("Modules::Init");
+    modules_status = modules->Init(std::move(data_manager));
+  }
   if (!modules_status.ok()) {
     return modules_status;
   }
@@ -129,7 +152,11 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateMobileEngine(
   constexpr bool kIsMobile = true;
 
   auto modules = std::make_unique<engine::Modules>();
-  absl::Status modules_status = modules->Init(std::move(data_manager));
+  absl::Status modules_status;
+  {
+    StartupProfiler::ScopedPhase phase("Modules::Init");
+    modules_status = modules->Init(std::move(data_manager));
+  }
   if (!modules_status.ok()) {
     return modules_status;
   }
@@ -141,7 +168,41 @@ absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngine(
     std::unique_ptr<engine::Modules> modules, bool is_mobile) {
   // Since Engine() is a private function, std::make_unique does not work.
   auto engine = absl::WrapUnique(new Engine());
-  absl::Status engine_status = engine->Init(std::move(modules), is_mobile);
+  absl::Status engine_status;
+  {
+    StartupProfiler::ScopedPhase phase("Engine::Init");
+    engine_status = engine->Init(std::move(modules), is_mobile);
+  }
+  if (!engine_status.ok()) {
+    return engine_status;
+  }
+  return engine;
+}
+
+absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngineWithSharedModules(
+    std::shared_ptr<engine::Modules> modules, bool is_mobile) {
+  auto engine = absl::WrapUnique(new Engine());
+  absl::Status engine_status;
+  {
+    StartupProfiler::ScopedPhase phase("Engine::Init");
+    engine_status = engine->InitConverter(std::move(modules), is_mobile,
+                                          /*use_user_history=*/true);
+  }
+  if (!engine_status.ok()) {
+    return engine_status;
+  }
+  return engine;
+}
+
+absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateEngineWithoutUserHistory(
+    std::shared_ptr<engine::Modules> modules, bool is_mobile) {
+  auto engine = absl::WrapUnique(new Engine());
+  absl::Status engine_status;
+  {
+    StartupProfiler::ScopedPhase phase("Engine::Init");
+    engine_status = engine->InitConverter(std::move(modules), is_mobile,
+                                          /*use_user_history=*/false);
+  }
   if (!engine_status.ok()) {
     return engine_status;
   }
@@ -164,6 +225,18 @@ absl::Status Engine::ReloadModules(std::unique_ptr<engine::Modules> modules,
 
 absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
                           bool is_mobile) {
+  if (!modules) {
+    return absl::ResourceExhaustedError("engine.cc: modules is null");
+  }
+
+  // Keeps the previous supplemental_model if exists.
+  modules->SetSupplementalModel(modules_->GetSupplementalModel());
+  return InitConverter(std::move(modules), is_mobile,
+                       /*use_user_history=*/true);
+}
+
+absl::Status Engine::InitConverter(std::shared_ptr<engine::Modules> modules,
+                                   bool is_mobile, bool use_user_history) {
 #define RETURN_IF_NULL(ptr)                                               \
   do {                                                                    \
     if (!(ptr))                                                           \
@@ -171,13 +244,7 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
   } while (false)
 
   RETURN_IF_NULL(modules);
-
-  // Keeps the previous supplemental_model if exists.
-  const engine::SupplementalModelInterface *supplemental_model =
-      modules_->GetSupplementalModel();
-
   modules_ = std::move(modules);
-  modules_->SetSupplementalModel(supplemental_model);
 
   immutable_converter_ = std::make_unique<ImmutableConverter>(*modules_);
   RETURN_IF_NULL(immutable_converter_);
@@ -200,10 +267,15 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
             *modules_, converter_.get(), immutable_converter_.get());
     RETURN_IF_NULL(dictionary_predictor);
 
-    const bool enable_content_word_learning = is_mobile;
-    auto user_history_predictor =
-        std::make_unique<prediction::UserHistoryPredictor>(
-            *modules_, enable_content_word_learning);
+    std::unique_ptr<PredictorInterface> user_history_predictor;
+    if (use_user_history) {
+      const bool enable_content_word_learning = is_mobile;
+      user_history_predictor =
+          std::make_unique<prediction::UserHistoryPredictor>(
+              *modules_, enable_content_word_learning);
+    } else {
+      user_history_predictor = std::make_unique<NoUserHistoryPredictor>();
+    }
     RETURN_IF_NULL(user_history_predictor);
 
     if (is_mobile) {
@@ -219,7 +291,8 @@ absl::Status Engine::Init(std::unique_ptr<engine::Modules> modules,
   }
   predictor_ = predictor.get();  // Keep the reference
 
-  auto rewriter = std::make_unique<Rewriter>(*modules_, *converter_);
+  auto rewriter =
+      std::make_unique<Rewriter>(*modules_, *converter_, use_user_history);
   RETURN_IF_NULL(rewriter);
   rewriter_ = rewriter.get();  // Keep the reference
 
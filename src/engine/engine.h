@@ -90,6 +90,20 @@ class Engine : public EngineInterface {
   static absl::StatusOr<std::unique_ptr<Engine>> CreateEngine(
       std::unique_ptr<engine::Modules> modules, bool is_mobile);
 
+  // Creates an instance over |modules| which may be shared with other engines,
+  // e.g., one engine per thread of an offline evaluation. |modules| must be
+  // initialized. Each engine has its own converter, predictor and rewriter,
+  // while the modules are used concurrently as described in engine::Modules.
+  static absl::StatusOr<std::unique_ptr<Engine>> CreateEngineWithSharedModules(
+      std::shared_ptr<engine::Modules> modules, bool is_mobile);
+
+  // Same as above, but the engine has neither the user history predictor nor
+  // the history rewriters, so it neither reads nor writes the files of the
+  // user history. Used next to an engine which owns them, e.g., by the workers
+  // of a server other than the one which learns.
+  static absl::StatusOr<std::unique_ptr<Engine>> CreateEngineWithoutUserHistory(
+      std::shared_ptr<engine::Modules> modules, bool is_mobile);
+
   // Creates an engine with no initialization.
   static std::unique_ptr<Engine> CreateEngine();
 
@@ -169,12 +183,18 @@ class Engine : public EngineInterface {
   // The is_mobile flag is used to select DefaultPredictor and MobilePredictor.
   absl::Status Init(std::unique_ptr<engine::Modules> modules, bool is_mobile);
 
+  // Builds the converter over |modules| without touching their state.
+  absl::Status InitConverter(std::shared_ptr<engine::Modules> modules,
+                             bool is_mobile, bool use_user_history);
+
   // If initialized_ is false, minimal_engine_ is used as a fallback engine.
   bool initialized_ = false;
   MinimalEngine minimal_engine_;
 
   std::unique_ptr<DataLoader> loader_;
-  std::unique_ptr<engine::Modules> modules_;
+  // Shared with other engines only if created by
+  // CreateEngineWithSharedModules().
+  std::shared_ptr<engine::Modules> modules_;
   std::unique_ptr<ImmutableConverterInterface> immutable_converter_;
 
   // TODO(noriyukit): Currently predictor and rewriter are created by this class
@@ -47,6 +47,7 @@
         '<(mozc_oss_src_dir)/converter/converter_base.gyp:connector',
         '<(mozc_oss_src_dir)/converter/converter_base.gyp:segmenter',
         '<(mozc_oss_src_dir)/dictionary/dictionary.gyp:dictionary_impl',
+        '<(mozc_oss_src_dir)/dictionary/dictionary.gyp:single_kanji_dictionary',
         '<(mozc_oss_src_dir)/dictionary/dictionary.gyp:suffix_dictionary',
         '<(mozc_oss_src_dir)/dictionary/dictionary_base.gyp:pos_matcher',
         '<(mozc_oss_src_dir)/dictionary/dictionary_base.gyp:suppression_dictionary',
@@ -34,12 +34,18 @@
 #include <utility>
 
 #include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "base/file_util.h"
+#include "base/system_util.h"
+#include "converter/segments.h"
 #include "data_manager/data_manager.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "engine/modules.h"
 #include "engine/supplemental_model_interface.h"
 #include "protocol/engine_builder.pb.h"
+#include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 
@@ -128,6 +134,60 @@ TEST_F(EngineTest, ReloadModulesTest) {
             &supplemental_model);
 }
 
+TEST_F(EngineTest, CreateEngineWithSharedModules) {
+  auto modules = std::make_shared<engine::Modules>();
+  CHECK_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+
+  const bool is_mobile = false;
+  absl::StatusOr<std::unique_ptr<Engine>> engine1 =
+      Engine::CreateEngineWithSharedModules(modules, is_mobile);
+  ASSERT_OK(engine1);
+  absl::StatusOr<std::unique_ptr<Engine>> engine2 =
+      Engine::CreateEngineWithSharedModules(modules, is_mobile);
+  ASSERT_OK(engine2);
+
+  // The engines have their own converters over the same modules.
+  EXPECT_EQ((*engine1)->GetModulesForTesting(), modules.get());
+  EXPECT_EQ((*engine2)->GetModulesForTesting(), modules.get());
+  EXPECT_NE((*engine1)->GetConverter(), (*engine2)->GetConverter());
+  EXPECT_EQ((*engine1)->GetDataVersion(), mock_version_);
+
+  // The modules outlive the caller's reference.
+  modules.reset();
+  Segments segments;
+  EXPECT_TRUE((*engine2)->GetConverter()->StartConversionWithKey(
+      &segments, "わたしのなまえはなかのです"));
+  EXPECT_GT(segments.segments_size(), 0);
+}
+
+class EngineWithoutUserHistoryTest : public testing::TestWithTempUserProfile {
+};
+
+TEST_F(EngineWithoutUserHistoryTest, LeavesHistoryFilesToOwner) {
+  auto modules = std::make_shared<engine::Modules>();
+  CHECK_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+  const std::string segment_db = FileUtil::JoinPath(
+      SystemUtil::GetUserProfileDirectory(), "segment.db");
+
+  const bool is_mobile = false;
+  absl::StatusOr<std::unique_ptr<Engine>> engine =
+      Engine::CreateEngineWithoutUserHistory(modules, is_mobile);
+  ASSERT_OK(engine);
+  Segments segments;
+  EXPECT_TRUE((*engine)->GetConverter()->StartConversionWithKey(
+      &segments, "わたしのなまえはなかのです"));
+  EXPECT_GT(segments.segments_size(), 0);
+  EXPECT_TRUE((*engine)->Sync());
+  EXPECT_TRUE((*engine)->Wait());
+  EXPECT_TRUE(absl::IsNotFound(FileUtil::FileExists(segment_db)));
+
+  // The engine with the user history opens the files.
+  absl::StatusOr<std::unique_ptr<Engine>> owner =
+      Engine::CreateEngineWithSharedModules(modules, is_mobile);
+  ASSERT_OK(owner);
+  EXPECT_OK(FileUtil::FileExists(segment_db));
+}
+
 // Tests the interaction with DataLoader for successful Engine
 // reload event.
 TEST_F(EngineTest, DataLoadSuccessfulScenarioTest) {
@@ -32,6 +32,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -39,6 +40,7 @@
 #include "absl/strings/string_view.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
+#include "engine/modules.h"
 
 namespace mozc {
 
@@ -62,4 +64,42 @@ absl::StatusOr<std::unique_ptr<Engine>> CreateEvalEngine(
       absl::StrCat("Invalid engine type: ", engine_type));
 }
 
+absl::StatusOr<std::vector<std::unique_ptr<Engine>>> CreateEvalEngines(
+    absl::string_view data_file_path, absl::string_view data_type,
+    absl::string_view engine_type, int num_engines) {
+  if (engine_type != "desktop" && engine_type != "mobile") {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid engine type: ", engine_type));
+  }
+  if (num_engines < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid number of engines: ", num_engines));
+  }
+  const absl::string_view magic_number =
+      DataManager::GetDataSetMagicNumber(data_type);
+  absl::StatusOr<std::unique_ptr<DataManager>> data_manager =
+      DataManager::CreateFromFile(std::string(data_file_path), magic_number);
+  if (!data_manager.ok()) {
+    return std::move(data_manager).status();
+  }
+  auto modules = std::make_shared<engine::Modules>();
+  if (absl::Status status = modules->Init(*std::move(data_manager));
+      !status.ok()) {
+    return status;
+  }
+
+  const bool is_mobile = engine_type == "mobile";
+  std::vector<std::unique_ptr<Engine>> engines;
+  engines.reserve(num_engines);
+  for (int i = 0; i < num_engines; ++i) {
+    absl::StatusOr<std::unique_ptr<Engine>> engine =
+        Engine::CreateEngineWithSharedModules(modules, is_mobile);
+    if (!engine.ok()) {
+      return std::move(engine).status();
+    }
+    engines.push_back(*std::move(engine));
+  }
+  return engines;
+}
+
 }  // namespace mozc
@@ -31,6 +31,7 @@
 #define MOZC_ENGINE_EVAL_ENGINE_FACTORY_H_
 
 #include <memory>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
@@ -42,6 +43,13 @@ absl::StatusOr<std::unique_ptr<Engine>> CreateEvalEngine(
     absl::string_view data_file_path, absl::string_view data_type,
     absl::string_view engine_type);
 
+// Creates |num_engines| engines sharing the modules loaded from one data file.
+// Each engine is meant to be used by one thread, e.g., to evaluate a corpus in
+// parallel.
+absl::StatusOr<std::vector<std::unique_ptr<Engine>>> CreateEvalEngines(
+    absl::string_view data_file_path, absl::string_view data_type,
+    absl::string_view engine_type, int num_engines);
+
 }  // namespace mozc
 
 #endif  // MOZC_ENGINE_EVAL_ENGINE_FACTORY_H_
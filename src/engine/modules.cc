@@ -48,6 +48,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/single_kanji_dictionary.h"
 #include "dictionary/suffix_dictionary.h"
 #include "dictionary/suppression_dictionary.h"
 #include "dictionary/system/system_dictionary.h"
@@ -59,6 +60,7 @@
 
 using ::mozc::dictionary::DictionaryImpl;
 using ::mozc::dictionary::PosGroup;
+using ::mozc::dictionary::SingleKanjiDictionary;
 using ::mozc::dictionary::SuffixDictionary;
 using ::mozc::dictionary::SuppressionDictionary;
 using ::mozc::dictionary::SystemDictionary;
@@ -109,7 +111,9 @@ absl::Status Modules::Init(
     data_manager_->GetSystemDictionaryData(&dictionary_data, &dictionary_size);
 
     absl::StatusOr<std::unique_ptr<SystemDictionary>> sysdic =
-        SystemDictionary::Builder(dictionary_data, dictionary_size).Build();
+        SystemDictionary::Builder(dictionary_data, dictionary_size)
+            .SetOptions(SystemDictionary::ENABLE_VALUE_CACHE)
+            .Build();
     if (!sysdic.ok()) {
       return std::move(sysdic).status();
     }
@@ -152,10 +156,14 @@ absl::Status Modules::Init(
     suggestion_filter_ = *std::move(status_or_suggestion_filter);
   }
 
+  single_kanji_dictionary_ =
+      std::make_unique<SingleKanjiDictionary>(*data_manager_);
+  RETURN_IF_NULL(single_kanji_dictionary_);
+
   if (!single_kanji_prediction_aggregator_) {
     single_kanji_prediction_aggregator_ =
         std::make_unique<prediction::SingleKanjiPredictionAggregator>(
-            *data_manager_);
+            *data_manager_, *single_kanji_dictionary_);
     RETURN_IF_NULL(single_kanji_prediction_aggregator_);
   }
 
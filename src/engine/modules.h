@@ -41,6 +41,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_group.h"
 #include "dictionary/pos_matcher.h"
+#include "dictionary/single_kanji_dictionary.h"
 #include "dictionary/suppression_dictionary.h"
 #include "engine/supplemental_model_interface.h"
 #include "prediction/single_kanji_prediction_aggregator.h"
@@ -50,6 +51,17 @@
 namespace mozc {
 namespace engine {
 
+// Modules holds the data loaded from a data set.
+//
+// Thread-safety: Init() and the Preset/Set functions must finish before the
+// modules are shared. After that, the const accessors and the modules they
+// return can be used from multiple threads, e.g., by an ImmutableConverter per
+// thread. The modules keep no hidden per-request state. Connector caches
+// transition costs in atomic buckets, each holding both the key and the cost.
+// SystemDictionary guards each slot of its ValueCache with a sequence lock and
+// keeps its reverse lookup cache per thread. The mutable modules synchronize by
+// themselves; UserDictionary and SuppressionDictionary are guarded by their own
+// mutexes.
 class Modules {
  public:
   Modules() = default;
@@ -104,6 +116,11 @@ class Modules {
   const SuggestionFilter &GetSuggestionFilter() const {
     return suggestion_filter_;
   }
+  // Shared by the single kanji rewriter and predictors so that the data set
+  // is parsed once per engine.
+  const dictionary::SingleKanjiDictionary *GetSingleKanjiDictionary() const {
+    return single_kanji_dictionary_.get();
+  }
   const prediction::SingleKanjiPredictionAggregator *
   GetSingleKanjiPredictionAggregator() const {
     return single_kanji_prediction_aggregator_.get();
@@ -133,6 +150,8 @@ class Modules {
   std::unique_ptr<dictionary::DictionaryInterface> dictionary_;
   std::unique_ptr<const dictionary::PosGroup> pos_group_;
   SuggestionFilter suggestion_filter_;
+  std::unique_ptr<const dictionary::SingleKanjiDictionary>
+      single_kanji_dictionary_;
   std::unique_ptr<const prediction::SingleKanjiPredictionAggregator>
       single_kanji_prediction_aggregator_;
   ZeroQueryDict zero_query_dict_;
@@ -903,6 +903,9 @@ void DictionaryPredictionAggregator::AggregateRealtimeConversion(
       GetConversionRequestForRealtimeCandidates(request,
                                                 realtime_candidates_size);
   Segments tmp_segments = GetSegmentsForRealtimeCandidatesGeneration(segments);
+  // Reuse the lattice of |segments| across key strokes so that only the nodes
+  // for the changed suffix of the key are looked up.
+  tmp_segments.ShareCachedLattice(segments);
 
   if (!immutable_converter_->ConvertForRequest(request_for_realtime,
                                                &tmp_segments) ||
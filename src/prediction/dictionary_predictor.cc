@@ -224,9 +224,7 @@ DictionaryPredictor::DictionaryPredictor(
       connector_(modules.GetConnector()),
       segmenter_(modules.GetSegmenter()),
       suggestion_filter_(modules.GetSuggestionFilter()),
-      single_kanji_dictionary_(
-          std::make_unique<dictionary::SingleKanjiDictionary>(
-              modules.GetDataManager())),
+      single_kanji_dictionary_(*modules.GetSingleKanjiDictionary()),
       pos_matcher_(*modules.GetPosMatcher()),
       general_symbol_id_(pos_matcher_.GetGeneralSymbolId()),
       predictor_name_(std::move(predictor_name)),
@@ -855,8 +853,8 @@ void DictionaryPredictor::FillCandidate(
 void DictionaryPredictor::SetDescription(PredictionTypes types,
                                          Segment::Candidate *candidate) const {
   if (candidate->description.empty()) {
-    single_kanji_dictionary_->GenerateDescription(candidate->value,
-                                                  &candidate->description);
+    single_kanji_dictionary_.GenerateDescription(candidate->value,
+                                                 &candidate->description);
   }
 }
 
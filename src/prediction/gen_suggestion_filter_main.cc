@@ -95,8 +95,8 @@ ExistenceFilterBuilder GetFilter(const size_t num_bytes,
                                  absl::Span<const uint64_t> hash_list) {
   LOG(INFO) << "num_bytes: " << num_bytes;
 
-  ExistenceFilterBuilder filter(
-      ExistenceFilterBuilder::CreateOptimal(num_bytes, hash_list.size()));
+  ExistenceFilterBuilder filter(ExistenceFilterBuilder::CreateOptimalBlocked(
+      num_bytes, hash_list.size()));
   for (uint64_t hash : hash_list) {
     filter.Insert(hash);
   }
@@ -120,7 +120,8 @@ ExistenceFilterBuilder SetupFilter(
     const size_t num_bytes, absl::Span<const uint64_t> hash_list,
     absl::Span<const std::string> safe_word_list) {
   constexpr int kNumRetryMax = 10;
-  constexpr int kSizeOffset = 8;
+  // The blocked filter is sized in 64 byte blocks, so grow by one block.
+  constexpr int kSizeOffset = 64;
   // Prevent filtering of common words by false positive.
   for (int i = 0; i < kNumRetryMax; ++i) {
     ExistenceFilterBuilder filter =
@@ -153,7 +154,7 @@ int main(int argc, char **argv) {
 
   static constexpr float kErrorRate = 0.00001;
   const size_t num_bytes =
-      std::max(ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+      std::max(ExistenceFilterBuilder::MinBlockedFilterSizeInBytesForErrorRate(
                    kErrorRate, hash_list.size()),
                kMinimumFilterBytes);
 
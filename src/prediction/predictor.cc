@@ -31,16 +31,22 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "converter/converter_interface.h"
 #include "converter/segments.h"
@@ -49,6 +55,9 @@
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
 
+ABSL_FLAG(bool, concurrent_prediction, false,
+          "Run the user history and dictionary predictions concurrently.");
+
 namespace mozc::prediction {
 namespace {
 
@@ -210,13 +219,105 @@ std::unique_ptr<PredictorInterface> DefaultPredictor::CreateDefaultPredictor(
                                             converter);
 }
 
+// A single background thread that runs submitted jobs in order. A job which
+// has not started yet can be taken back with Cancel(), so the submitter never
+// waits behind a job of another request.
+class DefaultPredictor::Worker {
+ public:
+  class Job {
+   private:
+    friend class Worker;
+    enum State { PENDING, RUNNING, DONE, CANCELLED };
+
+    explicit Job(std::function<void()> fn) : fn_(std::move(fn)) {}
+
+    std::function<void()> fn_;
+    State state_ = PENDING;
+  };
+
+  Worker() : thread_([this] { Run(); }) {}
+
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+
+  ~Worker() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    thread_.Join();
+  }
+
+  std::shared_ptr<Job> Submit(std::function<void()> fn) {
+    std::shared_ptr<Job> job(new Job(std::move(fn)));
+    absl::MutexLock lock(&mutex_);
+    queue_.push_back(job);
+    return job;
+  }
+
+  // Returns true if `job` had not started and will never run.
+  bool Cancel(Job &job) {
+    absl::MutexLock lock(&mutex_);
+    if (job.state_ != Job::PENDING) {
+      return false;
+    }
+    job.state_ = Job::CANCELLED;
+    return true;
+  }
+
+  // Blocks until `job` finishes. `job` must not be cancelled.
+  void Wait(const Job &job) {
+    absl::MutexLock lock(
+        &mutex_, absl::Condition(
+                     +[](const Job *job) { return job->state_ == Job::DONE; },
+                     &job));
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::shared_ptr<Job> job;
+      {
+        absl::MutexLock lock(
+            &mutex_, absl::Condition(
+                         +[](Worker *w) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                              w->mutex_) {
+                           return w->stopped_ || !w->queue_.empty();
+                         },
+                         this));
+        if (stopped_) {
+          return;
+        }
+        job = std::move(queue_.front());
+        queue_.pop_front();
+        if (job->state_ == Job::CANCELLED) {
+          continue;
+        }
+        job->state_ = Job::RUNNING;
+      }
+      job->fn_();
+      absl::MutexLock lock(&mutex_);
+      job->state_ = Job::DONE;
+    }
+  }
+
+  absl::Mutex mutex_;
+  std::deque<std::shared_ptr<Job>> queue_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Thread thread_;
+};
+
 DefaultPredictor::DefaultPredictor(
     std::unique_ptr<PredictorInterface> dictionary_predictor,
     std::unique_ptr<PredictorInterface> user_history_predictor,
     const ConverterInterface *converter)
     : BasePredictor(std::move(dictionary_predictor),
                     std::move(user_history_predictor), converter),
-      predictor_name_("DefaultPredictor") {}
+      predictor_name_("DefaultPredictor") {
+  if (absl::GetFlag(FLAGS_concurrent_prediction)) {
+    worker_ = std::make_unique<Worker>();
+  }
+}
 
 DefaultPredictor::~DefaultPredictor() = default;
 
@@ -236,26 +337,87 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
     size = std::clamp<int>(request.config().suggestions_size(), 1, 9);
   }
 
-  bool result = false;
-  int remained_size = size;
   ConversionRequest request_for_prediction = request;
   request_for_prediction.set_max_user_history_prediction_candidates_size(size);
   request_for_prediction
       .set_max_user_history_prediction_candidates_size_for_zero_query(size);
-  result |= user_history_predictor_->PredictForRequest(request_for_prediction,
-                                                       segments);
-  remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
+  // The dictionary predictor remembers the previous top result when the
+  // candidate consistency is enabled, so a discarded speculative run would
+  // change the next output.
+  if (worker_ != nullptr && request.request()
+                                    .decoder_experiment_params()
+                                    .candidate_consistency_cost_max_diff() ==
+                                0) {
+    return PredictConcurrently(request_for_prediction, size, segments);
+  }
+
+  bool result = user_history_predictor_->PredictForRequest(
+      request_for_prediction, segments);
+  result |= PredictWithDictionary(size, &request_for_prediction, segments);
+  return result;
+}
+
+bool DefaultPredictor::PredictWithDictionary(
+    int size, ConversionRequest *request_for_prediction,
+    Segments *segments) const {
+  const int remained_size =
+      size - static_cast<size_t>(GetCandidatesSize(*segments));
 
   // Do not call dictionary_predictor if the size of candidates get
   // >= suggestions_size.
   if (remained_size <= 0) {
-    return result;
+    return false;
   }
 
-  request_for_prediction.set_max_dictionary_prediction_candidates_size(
+  request_for_prediction->set_max_dictionary_prediction_candidates_size(
       remained_size);
-  result |= dictionary_predictor_->PredictForRequest(request_for_prediction,
-                                                     segments);
+  return dictionary_predictor_->PredictForRequest(*request_for_prediction,
+                                                  segments);
+}
+
+bool DefaultPredictor::PredictConcurrently(
+    const ConversionRequest &request_for_prediction, int size,
+    Segments *segments) const {
+  // The dictionary predictor is started with the input it would see if the
+  // user history predictor added nothing, which is the common case. The
+  // history predictor doesn't use the lattice, so the speculative run takes
+  // the cached lattice for itself until it finishes.
+  const size_t candidates_size = GetCandidatesSize(*segments);
+  Segments speculative_segments = *segments;
+  speculative_segments.SwapCachedLattice(segments);
+  ConversionRequest request_for_dictionary = request_for_prediction;
+  bool dictionary_result = false;
+  std::shared_ptr<Worker::Job> job = worker_->Submit([&]() {
+    dictionary_result = PredictWithDictionary(size, &request_for_dictionary,
+                                              &speculative_segments);
+  });
+
+  bool result = user_history_predictor_->PredictForRequest(
+      request_for_prediction, segments);
+
+  // The job borrows the request, the segments and the predictors, so it
+  // cannot be abandoned once it has started: only a job still queued behind
+  // another request's job is cancelled, and it is run here instead. A
+  // started job is always waited for.
+  const bool cancelled = worker_->Cancel(*job);
+  if (!cancelled) {
+    worker_->Wait(*job);
+  }
+  segments->SwapCachedLattice(&speculative_segments);
+
+  if (!cancelled && GetCandidatesSize(*segments) == candidates_size) {
+    for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+      *segments->mutable_conversion_segment(i) =
+          speculative_segments.conversion_segment(i);
+    }
+    result |= dictionary_result;
+    return result;
+  }
+
+  // The user history predictor added candidates, so the serial path asks the
+  // dictionary predictor for fewer of them. Its ranking depends on that size,
+  // so the speculative result is discarded and the serial path is taken.
+  result |= PredictWithDictionary(size, &request_for_dictionary, segments);
   return result;
 }
 
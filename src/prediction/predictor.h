@@ -110,7 +110,24 @@ class DefaultPredictor : public BasePredictor {
   }
 
  private:
+  class Worker;
+
+  // Calls the dictionary predictor for the candidates remaining after the
+  // ones already in `segments`.
+  bool PredictWithDictionary(int size,
+                             ConversionRequest *request_for_prediction,
+                             Segments *segments) const;
+
+  // Runs the dictionary predictor on `worker_` while the user history
+  // predictor runs on the calling thread. The dictionary result is used only
+  // when the user history predictor adds no candidates. Otherwise the
+  // dictionary predictor is run again, so the result equals the serial one.
+  bool PredictConcurrently(const ConversionRequest &request_for_prediction,
+                           int size, Segments *segments) const;
+
   const std::string predictor_name_;
+  // Null unless --concurrent_prediction is set.
+  std::unique_ptr<Worker> worker_;
 };
 
 class MobilePredictor : public BasePredictor {
@@ -29,12 +29,23 @@
 
 #include "prediction/predictor.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
 #include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/stopwatch.h"
 #include "composer/composer.h"
 #include "config/config_handler.h"
 #include "converter/converter_mock.h"
@@ -51,6 +62,8 @@
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 
+ABSL_DECLARE_FLAG(bool, concurrent_prediction);
+
 namespace mozc::prediction {
 namespace {
 
@@ -140,6 +153,46 @@ class NullPredictor : public PredictorInterface {
   const std::string predictor_name_;
 };
 
+// Adds up to the requested number of candidates. If `keys` is not empty,
+// candidates are added only for the keys in it, like the user history
+// predictor.
+class FakePredictor : public PredictorInterface {
+ public:
+  explicit FakePredictor(bool is_history,
+                         absl::flat_hash_set<std::string> keys = {})
+      : is_history_(is_history),
+        keys_(std::move(keys)),
+        predictor_name_(is_history ? "FakeHistoryPredictor"
+                                   : "FakeDictionaryPredictor") {}
+
+  bool PredictForRequest(const ConversionRequest &request,
+                         Segments *segments) const override {
+    Segment *segment = segments->mutable_conversion_segment(0);
+    if (is_history_ && !keys_.contains(segment->key())) {
+      return false;
+    }
+    const size_t size =
+        is_history_ ? 2 : request.max_dictionary_prediction_candidates_size();
+    for (size_t i = 0; i < size; ++i) {
+      Segment::Candidate *candidate = segment->add_candidate();
+      candidate->key = segment->key();
+      // Like the real ranking, the candidates depend on the requested size.
+      candidate->value =
+          absl::StrCat(predictor_name_, segment->key(), i, "/", size);
+    }
+    return true;
+  }
+
+  const std::string &GetPredictorName() const override {
+    return predictor_name_;
+  }
+
+ private:
+  const bool is_history_;
+  const absl::flat_hash_set<std::string> keys_;
+  const std::string predictor_name_;
+};
+
 class MockPredictor : public PredictorInterface {
  public:
   MockPredictor() = default;
@@ -416,6 +469,74 @@ TEST_F(PredictorTest, DisableAllSuggestion) {
   EXPECT_TRUE(pred2->predict_called());
 }
 
+TEST_F(PredictorTest, ConcurrentPredictionMatchesSerial) {
+  const absl::flat_hash_set<std::string> history_keys = {"か", "かな"};
+  MockConverter converter;
+  auto create_predictor = [&](bool concurrent) {
+    absl::FlagSaver flag_saver;
+    absl::SetFlag(&FLAGS_concurrent_prediction, concurrent);
+    return std::make_unique<DefaultPredictor>(
+        std::make_unique<FakePredictor>(false),
+        std::make_unique<FakePredictor>(true, history_keys),
+        &converter);
+  };
+  std::unique_ptr<DefaultPredictor> serial = create_predictor(false);
+  std::unique_ptr<DefaultPredictor> concurrent = create_predictor(true);
+
+  for (const ConversionRequest::RequestType type :
+       {ConversionRequest::SUGGESTION, ConversionRequest::PREDICTION}) {
+    // "か" and "かな" hit the user history, and "かん" and "かなか" don't.
+    for (const absl::string_view key : {"か", "かん", "かな", "かなか"}) {
+      SCOPED_TRACE(key);
+      ConversionRequest convreq = CreateConversionRequest();
+      convreq.set_request_type(type);
+      Segments expected, actual;
+      expected.add_segment()->set_key(key);
+      actual.add_segment()->set_key(key);
+      EXPECT_EQ(concurrent->PredictForRequest(convreq, &actual),
+                serial->PredictForRequest(convreq, &expected));
+      EXPECT_EQ(actual.DebugString(), expected.DebugString());
+    }
+  }
+}
+
+// Logs the latencies. Run with --gtest_also_run_disabled_tests.
+TEST_F(PredictorTest, DISABLED_ConcurrentPredictionLatency) {
+  constexpr int kIterations = 50;
+  MockConverter converter;
+  auto measure = [&](bool concurrent, absl::string_view key) {
+    absl::FlagSaver flag_saver;
+    absl::SetFlag(&FLAGS_concurrent_prediction, concurrent);
+    DefaultPredictor predictor(
+        std::make_unique<FakePredictor>(false),
+        std::make_unique<FakePredictor>(true,
+                                        absl::flat_hash_set<std::string>{"か"}),
+        &converter);
+    ConversionRequest convreq = CreateConversionRequest();
+    convreq.set_request_type(ConversionRequest::SUGGESTION);
+    std::vector<absl::Duration> latencies;
+    for (int i = 0; i < kIterations; ++i) {
+      Segments segments;
+      segments.add_segment()->set_key(key);
+      Stopwatch stopwatch = Stopwatch::StartNew();
+      EXPECT_TRUE(predictor.PredictForRequest(convreq, &segments));
+      latencies.push_back(stopwatch.GetElapsed());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    LOG(INFO) << (concurrent ? "concurrent" : "serial") << " key=" << key
+              << ": p50=" << latencies[kIterations / 2]
+              << " p99=" << latencies[kIterations * 99 / 100];
+  };
+
+  // Wall-clock timings depend on the machine, so they are only logged. The
+  // user history predictor has no candidates for "かな" and has some for
+  // "か".
+  measure(false, "かな");
+  measure(true, "かな");
+  measure(false, "か");
+  measure(true, "か");
+}
+
 TEST_F(PredictorTest, PopulateReadingOfCommittedCandidateIfMissing) {
   MockConverter converter;
   auto predictor = std::make_unique<MobilePredictor>(
@@ -35,7 +35,6 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
-#include "absl/types/span.h"
 #include "base/strings/assign.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -82,8 +81,17 @@ void StripLastChar(std::string *key) {
 
 SingleKanjiPredictionAggregator::SingleKanjiPredictionAggregator(
     const DataManagerInterface &data_manager)
-    : single_kanji_dictionary_(
-          new dictionary::SingleKanjiDictionary(data_manager)),
+    : owned_single_kanji_dictionary_(
+          std::make_unique<dictionary::SingleKanjiDictionary>(data_manager)),
+      single_kanji_dictionary_(owned_single_kanji_dictionary_.get()),
+      pos_matcher_(std::make_unique<dictionary::PosMatcher>(
+          data_manager.GetPosMatcherData())),
+      general_symbol_id_(pos_matcher_->GetGeneralSymbolId()) {}
+
+SingleKanjiPredictionAggregator::SingleKanjiPredictionAggregator(
+    const DataManagerInterface &data_manager,
+    const dictionary::SingleKanjiDictionary &single_kanji_dictionary)
+    : single_kanji_dictionary_(&single_kanji_dictionary),
       pos_matcher_(std::make_unique<dictionary::PosMatcher>(
           data_manager.GetPosMatcherData())),
       general_symbol_id_(pos_matcher_->GetGeneralSymbolId()) {}
@@ -106,9 +114,9 @@ std::vector<Result> SingleKanjiPredictionAggregator::AggregateResults(
       // Do not include partial results
       break;
     }
-    std::vector<std::string> kanji_list;
-    if (!single_kanji_dictionary_->LookupKanjiEntries(key, use_svs,
-                                                      &kanji_list)) {
+    const dictionary::SingleKanjiDictionary::KanjiList kanji_list =
+        single_kanji_dictionary_->LookupKanjiEntries(key, use_svs);
+    if (kanji_list.empty()) {
       continue;
     }
     AppendResults(key, original_input_key, kanji_list, offset, &results);
@@ -125,15 +133,15 @@ std::vector<Result> SingleKanjiPredictionAggregator::AggregateResults(
 
 void SingleKanjiPredictionAggregator::AppendResults(
     absl::string_view kanji_key, absl::string_view original_input_key,
-    absl::Span<const std::string> kanji_list, const int offset,
-    std::vector<Result> *results) const {
-  for (const std::string &kanji : kanji_list) {
+    const dictionary::SingleKanjiDictionary::KanjiList &kanji_list,
+    const int offset, std::vector<Result> *results) const {
+  for (const absl::string_view kanji : kanji_list) {
     Result result;
     // Set the wcost to keep the `kanji_list` order.
     result.wcost = offset + results->size();
     result.types = SINGLE_KANJI;
     strings::Assign(result.key, kanji_key);
-    result.value = kanji;
+    strings::Assign(result.value, kanji);
     result.lid = general_symbol_id_;
     result.rid = general_symbol_id_;
     if (kanji_key.size() < original_input_key.size()) {
@@ -32,11 +32,9 @@
 
 #include <cstdint>
 #include <memory>
-#include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
-#include "absl/types/span.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -51,18 +49,26 @@ class SingleKanjiPredictionAggregator : public PredictionAggregatorInterface {
  public:
   explicit SingleKanjiPredictionAggregator(
       const DataManagerInterface &data_manager);
+  // Uses |single_kanji_dictionary| shared with the other modules of the
+  // engine, which must outlive this aggregator.
+  SingleKanjiPredictionAggregator(
+      const DataManagerInterface &data_manager,
+      const dictionary::SingleKanjiDictionary &single_kanji_dictionary);
   ~SingleKanjiPredictionAggregator() override;
 
   std::vector<Result> AggregateResults(const ConversionRequest &request,
                                        const Segments &Segments) const override;
 
  private:
-  void AppendResults(absl::string_view kanji_key,
-                     absl::string_view original_input_key,
-                     absl::Span<const std::string> kanji_list, int offset,
-                     std::vector<Result> *results) const;
+  void AppendResults(
+      absl::string_view kanji_key, absl::string_view original_input_key,
+      const dictionary::SingleKanjiDictionary::KanjiList &kanji_list,
+      int offset, std::vector<Result> *results) const;
 
-  std::unique_ptr<dictionary::SingleKanjiDictionary> single_kanji_dictionary_;
+  // Set only if the dictionary is not shared.
+  std::unique_ptr<const dictionary::SingleKanjiDictionary>
+      owned_single_kanji_dictionary_;
+  const dictionary::SingleKanjiDictionary *single_kanji_dictionary_;
   std::unique_ptr<dictionary::PosMatcher> pos_matcher_;
   const uint16_t general_symbol_id_;
 };
@@ -44,6 +44,7 @@
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/log/check.h"
@@ -53,6 +54,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "base/bits.h"
@@ -62,6 +64,7 @@
 #include "base/container/trie.h"
 #include "base/hash.h"
 #include "base/japanese_util.h"
+#include "base/startup_profiler.h"
 #include "base/thread.h"
 #include "base/util.h"
 #include "base/vlog.h"
@@ -341,6 +344,84 @@ UserHistoryPredictor::EntryPriorityQueue::NewEntry() {
   return pool_.Alloc();
 }
 
+// Writes snapshots on a long-lived thread. Every snapshot contains the whole
+// history, so a snapshot still waiting to be written is simply replaced by a
+// newer one.
+class UserHistoryPredictor::Saver {
+ public:
+  Saver() : thread_([this] { Run(); }) {}
+
+  Saver(const Saver &) = delete;
+  Saver &operator=(const Saver &) = delete;
+
+  // Writes the pending snapshot, if any, before stopping.
+  ~Saver() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    thread_.Join();
+  }
+
+  void Schedule(std::unique_ptr<UserHistoryStorage> history) {
+    absl::MutexLock lock(&mutex_);
+    pending_ = std::move(history);
+  }
+
+  // Blocks until all the scheduled snapshots are written.
+  void Wait() {
+    absl::MutexLock lock(
+        &mutex_,
+        absl::Condition(
+            +[](Saver *s) ABSL_EXCLUSIVE_LOCKS_REQUIRED(s->mutex_) {
+              return s->pending_ == nullptr && !s->running_;
+            },
+            this));
+  }
+
+  static bool Write(UserHistoryStorage &history) {
+    // Updates usage stats here.
+    UsageStats::SetInteger("UserHistoryPredictorEntrySize",
+                           static_cast<int>(history.GetProto().entries_size()));
+    if (!history.Save()) {
+      LOG(ERROR) << "UserHistoryStorage::Save() failed";
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::unique_ptr<UserHistoryStorage> history;
+      {
+        absl::MutexLock lock(
+            &mutex_,
+            absl::Condition(
+                +[](Saver *s) ABSL_EXCLUSIVE_LOCKS_REQUIRED(s->mutex_) {
+                  return s->stopped_ || s->pending_ != nullptr;
+                },
+                this));
+        if (pending_ == nullptr) {
+          return;
+        }
+        history = std::move(pending_);
+        running_ = true;
+      }
+      MOZC_VLOG(1) << "Executing Sync method";
+      Write(*history);
+      absl::MutexLock lock(&mutex_);
+      running_ = false;
+    }
+  }
+
+  absl::Mutex mutex_;
+  std::unique_ptr<UserHistoryStorage> pending_ ABSL_GUARDED_BY(mutex_);
+  bool running_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Thread thread_;
+};
+
 UserHistoryPredictor::UserHistoryPredictor(const engine::Modules &modules,
                                            bool enable_content_word_learning)
     : dictionary_(modules.GetDictionary()),
@@ -350,6 +431,7 @@ UserHistoryPredictor::UserHistoryPredictor(const engine::Modules &modules,
       content_word_learning_enabled_(enable_content_word_learning),
       updated_(false),
       dic_(new DicCache(UserHistoryPredictor::cache_size())),
+      saver_(std::make_unique<Saver>()),
       modules_(modules) {
   AsyncLoad();  // non-blocking
   // Load()  blocking version can be used if any
@@ -374,6 +456,7 @@ void UserHistoryPredictor::WaitForSyncer() {
     sync_->Wait();
     sync_.reset();
   }
+  saver_->Wait();
 }
 
 bool UserHistoryPredictor::Wait() {
@@ -420,19 +503,21 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  if (!CheckSyncerAndDelete()) {  // now loading/saving
+  if (!CheckSyncerAndDelete()) {  // now loading
     return true;
   }
 
-  sync_.emplace([this] {
-    MOZC_VLOG(1) << "Executing Sync method";
-    Save();
-  });
+  std::unique_ptr<UserHistoryStorage> history = TakeSnapshot();
+  if (history != nullptr) {
+    saver_->Schedule(std::move(history));
+  }
+  updated_ = false;
 
   return true;
 }
 
 bool UserHistoryPredictor::Load() {
+  StartupProfiler::ScopedPhase phase("UserHistoryPredictor::Load");
   const std::string filename = GetUserHistoryFileName();
 
   UserHistoryStorage history(filename);
@@ -466,34 +551,51 @@ bool UserHistoryPredictor::Save() {
     return true;
   }
 
-  // Do not check incognito_mode or use_history_suggest in Config here.
-  // The input data should not have been inserted when those flags are on.
-
-  const DicElement *tail = dic_->Tail();
-  if (tail == nullptr) {
+  std::unique_ptr<UserHistoryStorage> history = TakeSnapshot();
+  if (history == nullptr) {
     return true;
   }
+  if (!Saver::Write(*history)) {
+    return false;
+  }
 
-  const std::string filename = GetUserHistoryFileName();
+  updated_ = false;
 
-  UserHistoryStorage history(filename);
-  for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
-    *history.GetProto().add_entries() = elm->value;
-  }
+  return true;
+}
 
-  // Updates usage stats here.
-  UsageStats::SetInteger("UserHistoryPredictorEntrySize",
-                         static_cast<int>(history.GetProto().entries_size()));
+std::unique_ptr<UserHistoryStorage> UserHistoryPredictor::TakeSnapshot() {
+  // Do not check incognito_mode or use_history_suggest in Config here.
+  // The input data should not have been inserted when those flags are on.
 
-  if (!history.Save()) {
-    LOG(ERROR) << "UserHistoryStorage::Save() failed";
-    return false;
+  // Removes the entries that UserHistoryStorage::Save() would drop, so that
+  // the on-memory LRU matches the file without reloading it.
+  const absl::Time now = Clock::GetAbslTime();
+  const uint64_t timestamp =
+      absl::ToUnixSeconds(std::max(now - k62Days, absl::UnixEpoch()));
+  std::vector<uint32_t> expired;
+  for (const DicElement &elm : *dic_) {
+    if (elm.value.entry_type() == Entry::DEFAULT_ENTRY &&
+        elm.value.last_access_time() < timestamp) {
+      expired.push_back(elm.key);
+    }
+  }
+  for (const uint32_t key : expired) {
+    dic_->Erase(key);
   }
-  Load(history);
 
-  updated_ = false;
+  const DicElement *tail = dic_->Tail();
+  if (tail == nullptr) {
+    return nullptr;
+  }
 
-  return true;
+  auto history = std::make_unique<UserHistoryStorage>(GetUserHistoryFileName());
+  auto &entries = *history->GetProto().mutable_entries();
+  entries.Reserve(dic_->Size());
+  for (const DicElement *elm = tail; elm != nullptr; elm = elm->prev) {
+    *entries.Add() = elm->value;
+  }
+  return history;
 }
 
 bool UserHistoryPredictor::ClearAllHistory() {
@@ -94,7 +94,9 @@ class UserHistoryStorage {
 // Currently, all methods of UserHistoryPredictor is called
 // by single thread. Although AsyncSave() and AsyncLoad() make
 // worker threads internally, these two functions won't be
-// called by multiple-threads at the same time
+// called by multiple-threads at the same time.
+// AsyncSave() copies the entries on the calling thread and only the copy is
+// written in the background, so learning continues while saving.
 class UserHistoryPredictor : public PredictorInterface {
  public:
   UserHistoryPredictor(const engine::Modules &modules,
@@ -266,17 +268,21 @@ class UserHistoryPredictor : public PredictorInterface {
   // Saves user history data in LRU to local file
   bool Save();
 
-  // non-blocking version of Load
-  // This makes a new thread and call Load()
+  // non-blocking version of Save
+  // This takes a snapshot of LRU and passes it to the saver thread.
   bool AsyncSave();
 
-  // non-blocking version of Sync
-  // This makes a new thread and call Save()
+  // non-blocking version of Load
+  // This makes a new thread and call Load()
   bool AsyncLoad();
 
-  // Waits until syncer finishes.
+  // Waits until syncer and saver finish.
   void WaitForSyncer();
 
+  // Removes the expired entries from LRU and copies the rest into a new
+  // storage, oldest first. Returns nullptr if there is nothing to save.
+  std::unique_ptr<UserHistoryStorage> TakeSnapshot();
+
   // Returns id for RevertEntry
   static uint16_t revert_id();
 
@@ -350,6 +356,8 @@ class UserHistoryPredictor : public PredictorInterface {
   using DicCache = mozc::storage::LruCache<uint32_t, Entry>;
   using DicElement = DicCache::Element;
 
+  class Saver;
+
   bool CheckSyncerAndDelete() const;
 
   // If |entry| is the target of prediction,
@@ -515,6 +523,7 @@ class UserHistoryPredictor : public PredictorInterface {
   mutable std::atomic<bool> updated_;
   std::unique_ptr<DicCache> dic_;
   mutable std::optional<BackgroundFuture<void>> sync_;
+  std::unique_ptr<Saver> saver_;
   const engine::Modules &modules_;
 
   mutable std::atomic<bool> aggressive_bigram_enabled_ = false;
@@ -41,7 +41,9 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/check.h"
+#include "absl/log/log.h"
 #include "absl/random/random.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -194,6 +196,24 @@ class UserHistoryPredictorTest : public testing::TestWithTempUserProfile {
     return predictor->Load(history);
   }
 
+  static bool SaveStorage(UserHistoryPredictor *predictor) {
+    return predictor->Save();
+  }
+
+  static void SetUpdated(UserHistoryPredictor *predictor) {
+    predictor->updated_ = true;
+  }
+
+  static bool HasEntryWithValue(const UserHistoryPredictor &predictor,
+                                absl::string_view value) {
+    for (const auto &elem : *predictor.dic_) {
+      if (elem.value.value() == value) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   static bool IsConnected(const UserHistoryPredictor::Entry &prev,
                           const UserHistoryPredictor::Entry &next) {
     const uint32_t fp =
@@ -4279,6 +4299,90 @@ TEST_F(UserHistoryPredictorTest, 62DayOldEntriesAreDeletedAtSync) {
   EXPECT_TRUE(found_takahashi);
 }
 
+TEST_F(UserHistoryPredictorTest, LearnsWhileSaving) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+
+  Segments segments;
+  ConversionRequest convreq = SetUpInputForConversion(
+      "わたしのなまえはなかのです", &composer_, &segments);
+  AddCandidate("私の名前は中野です", &segments);
+  predictor->Finish(convreq, &segments);
+
+  // The snapshot is written in the background. Learning is not blocked in the
+  // meantime.
+  ASSERT_TRUE(predictor->Sync());
+  segments.Clear();
+  convreq = SetUpInputForConversion("わたしのなまえはたかはしです", &composer_,
+                                    &segments);
+  AddCandidate("私の名前は高橋です", &segments);
+  predictor->Finish(convreq, &segments);
+  WaitForSyncer(predictor);
+
+  segments.Clear();
+  convreq = SetUpInputForPrediction("わたしの", &composer_, &segments);
+  EXPECT_TRUE(predictor->PredictForRequest(convreq, &segments));
+  EXPECT_TRUE(FindCandidateByValue("私の名前は中野です", segments));
+  EXPECT_TRUE(FindCandidateByValue("私の名前は高橋です", segments));
+
+  // Only the entries learned before Sync() are in the file.
+  auto saved_values = [] {
+    UserHistoryStorage history(UserHistoryPredictor::GetUserHistoryFileName());
+    EXPECT_TRUE(history.Load());
+    std::set<std::string> values;
+    for (const UserHistoryPredictor::Entry &entry :
+         history.GetProto().entries()) {
+      values.insert(entry.value());
+    }
+    return values;
+  };
+  EXPECT_TRUE(saved_values().contains("私の名前は中野です"));
+  EXPECT_FALSE(saved_values().contains("私の名前は高橋です"));
+
+  ASSERT_TRUE(predictor->Sync());
+  WaitForSyncer(predictor);
+  EXPECT_TRUE(saved_values().contains("私の名前は高橋です"));
+}
+
+TEST_F(UserHistoryPredictorTest, SavePauseTime) {
+  UserHistoryPredictor *predictor = GetUserHistoryPredictorWithClearedHistory();
+  constexpr int kNumEntries = 10000;
+  const uint64_t now = absl::ToUnixSeconds(absl::Now());
+  UserHistoryPredictor::Entry *prev = nullptr;
+  for (int i = 0; i < kNumEntries; ++i) {
+    UserHistoryPredictor::Entry *entry =
+        prev == nullptr ? InsertEntry(predictor, "きー", "キー")
+                        : AppendEntry(predictor, absl::StrCat("きー", i),
+                                      absl::StrCat("キー", i), prev);
+    entry->set_last_access_time(now);
+    prev = entry;
+  }
+
+  // Sync() only pauses the caller for taking the snapshot, while Save() also
+  // serializes, encrypts and writes it.
+  constexpr int kNumTrials = 5;
+  std::vector<absl::Duration> pauses, saves;
+  for (int i = 0; i < kNumTrials; ++i) {
+    SetUpdated(predictor);
+    absl::Time start = absl::Now();
+    ASSERT_TRUE(predictor->Sync());
+    pauses.push_back(absl::Now() - start);
+    WaitForSyncer(predictor);
+
+    SetUpdated(predictor);
+    start = absl::Now();
+    ASSERT_TRUE(SaveStorage(predictor));
+    saves.push_back(absl::Now() - start);
+  }
+  absl::c_sort(pauses);
+  absl::c_sort(saves);
+  LOG(INFO) << "Save pause at " << kNumEntries
+            << " entries: Sync()=" << pauses[kNumTrials / 2]
+            << " Save()=" << saves[kNumTrials / 2];
+  EXPECT_LT(pauses[kNumTrials / 2], saves[kNumTrials / 2]);
+  EXPECT_EQ(EntrySize(*predictor), kNumEntries);
+  EXPECT_TRUE(HasEntryWithValue(*predictor, "キー1"));
+}
+
 TEST_F(UserHistoryPredictorTest, FutureTimestamp) {
   // Test the case where history has "future" timestamps.
   ScopedClockMock clock(absl::FromUnixSeconds(10000));
@@ -43,7 +43,6 @@
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
-#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/hash.h"
@@ -77,7 +76,17 @@ bool CollocationFilter::Exists(const absl::string_view left,
   if (left.empty() || right.empty()) {
     return false;
   }
-  const uint64_t id = Fingerprint(absl::StrCat(left, right));
+  FingerprintBuilder builder;
+  builder.Append(left);
+  return Exists(builder, right);
+}
+
+bool CollocationFilter::Exists(const FingerprintBuilder &left,
+                               const absl::string_view right) const {
+  if (right.empty()) {
+    return false;
+  }
+  const uint64_t id = FingerprintBuilder(left).Append(right).Finish();
   return filter_.Exists(id);
 }
 
@@ -93,8 +102,11 @@ absl::StatusOr<SuppressionFilter> SuppressionFilter::Create(
 bool SuppressionFilter::Exists(const Segment::Candidate &cand) const {
   // TODO(noriyukit): We should share key generation rule with
   // gen_collocation_suppression_data_main.cc.
-  const uint64_t id =
-      Fingerprint(absl::StrCat(cand.content_value, "\t", cand.content_key));
+  const uint64_t id = FingerprintBuilder()
+                          .Append(cand.content_value)
+                          .Append("\t")
+                          .Append(cand.content_key)
+                          .Finish();
   return filter_.Exists(id);
 }
 
@@ -167,11 +179,38 @@ bool ParseCompound(const absl::string_view value,
   return true;
 }
 
-// A helper function to push back a string view to a vector.
-inline void PushBackStringView(const absl::string_view s,
-                               std::vector<std::string> *v) {
-  v->emplace_back(s.data(), s.size());
-}
+// A list of strings stored back to back in one buffer. Used as the scratch
+// space for the candidate strings so that the buffers are reused across
+// candidates instead of allocating a std::string per string.
+class StringArena {
+ public:
+  void Clear() {
+    buffer_.clear();
+    ends_.clear();
+  }
+
+  size_t size() const { return ends_.size(); }
+
+  absl::string_view operator[](size_t i) const {
+    const size_t begin = i == 0 ? 0 : ends_[i - 1];
+    return absl::string_view(buffer_).substr(begin, ends_[i] - begin);
+  }
+
+  void Add(const absl::string_view s) {
+    buffer_.append(s.data(), s.size());
+    ends_.push_back(buffer_.size());
+  }
+
+  // Adds the concatenation of |a| and |b| as one string.
+  void Add(const absl::string_view a, const absl::string_view b) {
+    buffer_.append(a.data(), a.size());
+    Add(b);
+  }
+
+ private:
+  std::string buffer_;
+  std::vector<size_t> ends_;
+};
 
 // Handles compound such as "本を読む"(one segment)
 // we want to rewrite using it as if it was "<本|を><読む>"
@@ -179,7 +218,7 @@ inline void PushBackStringView(const absl::string_view s,
 void ResolveCompoundSegment(const absl::string_view top_value,
                             const absl::string_view value,
                             const SegmentLookupType type,
-                            std::vector<std::string> *output) {
+                            StringArena *output) {
   // see "http://ja.wikipedia.org/wiki/助詞"
   static constexpr char kPat1[] = "が";
   // "の" was not good...
@@ -214,10 +253,10 @@ void ResolveCompoundSegment(const absl::string_view top_value,
     }
     if (ParseCompound(value, particle, &first_content, &second)) {
       if (type == LEFT) {
-        output->emplace_back(second.data(), second.size());
-        output->emplace_back(absl::StrCat(first_content, particle));
+        output->Add(second);
+        output->Add(first_content, particle);
       } else {
-        output->emplace_back(first_content.data(), first_content.size());
+        output->Add(first_content);
       }
       return;
     }
@@ -226,8 +265,7 @@ void ResolveCompoundSegment(const absl::string_view top_value,
 
 bool IsNaturalContent(const Segment::Candidate &cand,
                       const Segment::Candidate &top_cand,
-                      SegmentLookupType type,
-                      std::vector<std::string> *output) {
+                      SegmentLookupType type, StringArena *output) {
   const std::string &content = cand.content_value;
   const std::string &value = cand.value;
   const std::string &top_content = top_cand.content_value;
@@ -242,15 +280,14 @@ bool IsNaturalContent(const Segment::Candidate &cand,
   }
 
   if (type == LEFT) {
-    output->push_back(value);
+    output->Add(value);
   } else {
-    output->push_back(content);
+    output->Add(content);
     // "舞って" workaround
     // V+"て" is often treated as one compound.
     static constexpr char kPat[] = "て";
     if (absl::EndsWith(content, absl::string_view(kPat, std::size(kPat) - 1))) {
-      PushBackStringView(Util::Utf8SubString(content, 0, content_len - 1),
-                         output);
+      output->Add(Util::Utf8SubString(content, 0, content_len - 1));
     }
   }
 
@@ -317,7 +354,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
         absl::EndsWith(aux_value, kSuffix)) {
       if (type == RIGHT) {
         // "YYいる" in addition to "YY"
-        output->push_back(value);
+        output->Add(value);
       }
       return true;
     }
@@ -326,8 +363,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
         absl::EndsWith(top_aux_value, kSuffix)) {
       if (type == RIGHT) {
         // "YY" in addition to "YYいる"
-        PushBackStringView(Util::Utf8SubString(value, 0, value_len - 2),
-                           output);
+        output->Add(Util::Utf8SubString(value, 0, value_len - 2));
       }
       return true;
     }
@@ -342,7 +378,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
         absl::EndsWith(aux_value, kSuffix)) {
       if (type == RIGHT) {
         // "YYせる" in addition to "YY"
-        output->push_back(value);
+        output->Add(value);
       }
       return true;
     }
@@ -351,8 +387,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
         absl::EndsWith(top_aux_value, kSuffix)) {
       if (type == RIGHT) {
         // "YY" in addition to "YYせる"
-        PushBackStringView(Util::Utf8SubString(value, 0, value_len - 2),
-                           output);
+        output->Add(Util::Utf8SubString(value, 0, value_len - 2));
       }
       return true;
     }
@@ -374,8 +409,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
       }
       if (type == RIGHT) {
         // "YYす" in addition to "YY"
-        PushBackStringView(Util::Utf8SubString(value, 0, value_len - 1),
-                           output);
+        output->Add(Util::Utf8SubString(value, 0, value_len - 1));
       }
       return true;
     }
@@ -389,8 +423,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
     if (aux_value_len == 0 && absl::EndsWith(value, kSuffix)) {
       if (type == RIGHT) {
         // "YY" in addition to "YYる"
-        PushBackStringView(Util::Utf8SubString(value, 0, value_len - 1),
-                           output);
+        output->Add(Util::Utf8SubString(value, 0, value_len - 1));
       }
       return true;
     }
@@ -406,8 +439,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
       if (type == RIGHT) {
         constexpr char kRu[] = "る";
         // "YYする" in addition to "YY"
-        output->push_back(
-            absl::StrCat(value, absl::string_view(kRu, std::size(kRu) - 1)));
+        output->Add(value, absl::string_view(kRu, std::size(kRu) - 1));
       }
       return true;
     }
@@ -424,7 +456,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
             Util::Utf8SubString(content, 0, content_len - 1);
         // XX must be KANJI
         if (Util::IsScriptType(val, Util::KANJI)) {
-          PushBackStringView(val, output);
+          output->Add(val);
         }
       }
       return true;
@@ -471,7 +503,7 @@ bool IsNaturalContent(const Segment::Candidate &cand,
 bool VerifyNaturalContent(const Segment::Candidate &cand,
                           const Segment::Candidate &top_cand,
                           SegmentLookupType type) {
-  std::vector<std::string> nexts;
+  StringArena nexts;
   return IsNaturalContent(cand, top_cand, RIGHT, &nexts);
 }
 
@@ -591,11 +623,17 @@ bool CollocationRewriter::RewriteFromPrevSegment(
     const Segment::Candidate &prev_cand, Segment *seg) const {
   std::string prev;
   CollocationUtil::GetNormalizedScript(prev_cand.value, true, &prev);
+  if (prev.empty()) {
+    return false;
+  }
+  // |prev| is the common prefix of all the collocations checked below.
+  FingerprintBuilder prev_fingerprint;
+  prev_fingerprint.Append(prev);
 
   const size_t i_max = std::min(seg->candidates_size(), kCandidateSize);
 
   // Reuse |curs| and |cur| in the loop as this method is performance critical.
-  std::vector<std::string> curs;
+  StringArena curs;
   std::string cur;
   for (size_t i = 0; i < i_max; ++i) {
     if (seg->candidate(i).cost > seg->candidate(0).cost + kMaxCostDiff) {
@@ -607,15 +645,14 @@ bool CollocationRewriter::RewriteFromPrevSegment(
     if (suppression_filter_.Exists(seg->candidate(i))) {
       continue;
     }
-    curs.clear();
+    curs.Clear();
     if (!IsNaturalContent(seg->candidate(i), seg->candidate(0), RIGHT, &curs)) {
       continue;
     }
 
-    for (int j = 0; j < curs.size(); ++j) {
-      cur.clear();
+    for (size_t j = 0; j < curs.size(); ++j) {
       CollocationUtil::GetNormalizedScript(curs[j], false, &cur);
-      if (collocation_filter_.Exists(prev, cur)) {
+      if (collocation_filter_.Exists(prev_fingerprint, cur)) {
         if (i != 0) {
           MOZC_VLOG(3) << prev << cur << " " << seg->candidate(0).value << "->"
                        << seg->candidate(i).value;
@@ -635,14 +672,19 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
   const size_t i_max = std::min(seg->candidates_size(), kCandidateSize);
   const size_t j_max = std::min(next_seg->candidates_size(), kCandidateSize);
 
-  // Cache the results for the next segment
+  // Cache the results for the next segment. The normalized strings of the
+  // j-th candidate are normalized_nexts[next_begin[j], next_begin[j + 1]).
   std::vector<int> next_seg_ok(j_max);  // Avoiding std::vector<bool>
-  std::vector<std::vector<std::string>> normalized_string(j_max);
+  std::vector<size_t> next_begin(j_max + 1);
+  StringArena normalized_nexts;
 
-  // Reuse |nexts| in the loop as this method is performance critical.
-  std::vector<std::string> nexts;
+  // Reuse |nexts| and |normalized| in the loop as this method is performance
+  // critical.
+  StringArena nexts;
+  std::string normalized;
   for (size_t j = 0; j < j_max; ++j) {
     next_seg_ok[j] = 0;
+    next_begin[j] = normalized_nexts.size();
 
     if (IsName(next_seg->candidate(j))) {
       continue;
@@ -650,23 +692,22 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     if (suppression_filter_.Exists(next_seg->candidate(j))) {
       continue;
     }
-    nexts.clear();
+    nexts.Clear();
     if (!IsNaturalContent(next_seg->candidate(j), next_seg->candidate(0), RIGHT,
                           &nexts)) {
       continue;
     }
 
     next_seg_ok[j] = 1;
-    for (std::vector<std::string>::const_iterator it = nexts.begin();
-         it != nexts.end(); ++it) {
-      normalized_string[j].push_back(std::string());
-      CollocationUtil::GetNormalizedScript(*it, false,
-                                           &normalized_string[j].back());
+    for (size_t k = 0; k < nexts.size(); ++k) {
+      CollocationUtil::GetNormalizedScript(nexts[k], false, &normalized);
+      normalized_nexts.Add(normalized);
     }
   }
+  next_begin[j_max] = normalized_nexts.size();
 
   // Reuse |curs| and |cur| in the loop as this method is performance critical.
-  std::vector<std::string> curs;
+  StringArena curs;
   std::string cur;
   for (size_t i = 0; i < i_max; ++i) {
     if (seg->candidate(i).cost > seg->candidate(0).cost + kMaxCostDiff) {
@@ -678,14 +719,19 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
     if (suppression_filter_.Exists(seg->candidate(i))) {
       continue;
     }
-    curs.clear();
+    curs.Clear();
     if (!IsNaturalContent(seg->candidate(i), seg->candidate(0), LEFT, &curs)) {
       continue;
     }
 
-    for (int k = 0; k < curs.size(); ++k) {
-      cur.clear();
+    for (size_t k = 0; k < curs.size(); ++k) {
       CollocationUtil::GetNormalizedScript(curs[k], true, &cur);
+      if (cur.empty()) {
+        continue;
+      }
+      // |cur| is hashed once and shared by all the next candidates.
+      FingerprintBuilder cur_fingerprint;
+      cur_fingerprint.Append(cur);
       for (size_t j = 0; j < j_max; ++j) {
         if (next_seg->candidate(j).cost >
             next_seg->candidate(0).cost + kMaxCostDiff) {
@@ -695,9 +741,9 @@ bool CollocationRewriter::RewriteUsingNextSegment(Segment *next_seg,
           continue;
         }
 
-        for (int l = 0; l < normalized_string[j].size(); ++l) {
-          const std::string &next = normalized_string[j][l];
-          if (collocation_filter_.Exists(cur, next)) {
+        for (size_t l = next_begin[j]; l < next_begin[j + 1]; ++l) {
+          const absl::string_view next = normalized_nexts[l];
+          if (collocation_filter_.Exists(cur_fingerprint, next)) {
             DCHECK(VerifyNaturalContent(next_seg->candidate(j),
                                         next_seg->candidate(0), RIGHT))
                 << "IsNaturalContent() should not fail here.";
@@ -37,6 +37,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "base/hash.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -57,6 +58,11 @@ class CollocationFilter {
 
   bool Exists(absl::string_view left, absl::string_view right) const;
 
+  // Same as above, but |left| is given as the fingerprint of the left string
+  // so that it's hashed only once when checked against many right strings.
+  // |left| must not be built from an empty string.
+  bool Exists(const FingerprintBuilder &left, absl::string_view right) const;
+
  private:
   storage::ExistenceFilter filter_;
 };
@@ -40,6 +40,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
@@ -366,19 +367,20 @@ int EnvironmentalFilterRewriter::capability(
 
 EnvironmentalFilterRewriter::EnvironmentalFilterRewriter(
     const DataManagerInterface &data_manager) {
-  absl::string_view token_array_data;
-  absl::string_view string_array_data;
-
   // TODO(mozc-team):
   // Currently, this rewriter uses data from emoji_data.tsv, which is for Emoji
   // conversion, as a source of Emoji version information. However,
   // emoji_data.tsv lacks some Emoji, including Emoji with skin-tones and
   // family/couple Emojis. As a future work, the data source should be refined.
-  data_manager.GetEmojiRewriterData(&token_array_data, &string_array_data);
+  data_manager.GetEmojiRewriterData(&emoji_token_array_data_,
+                                    &emoji_string_array_data_);
+}
+
+void EnvironmentalFilterRewriter::InitializeEmojiFinders() const {
   SerializedStringArray string_array;
-  string_array.Set(string_array_data);
-  std::pair<EmojiDataIterator, EmojiDataIterator> range =
-      std::make_pair(begin(token_array_data), end(token_array_data));
+  string_array.Set(emoji_string_array_data_);
+  std::pair<EmojiDataIterator, EmojiDataIterator> range = std::make_pair(
+      begin(emoji_token_array_data_), end(emoji_token_array_data_));
   const absl::flat_hash_map<EmojiVersion, std::vector<std::u32string>>
       version_to_targets = ExtractTargetEmojis(
           {EmojiVersion::E12_1, EmojiVersion::E13_0, EmojiVersion::E13_1,
@@ -398,6 +400,10 @@ bool EnvironmentalFilterRewriter::Rewrite(const ConversionRequest &request,
   const std::vector<AdditionalRenderableCharacterGroup> nonrenderable_groups =
       GetNonrenderableGroups(
           request.request().additional_renderable_character_groups());
+  if (!nonrenderable_groups.empty()) {
+    absl::call_once(emoji_finders_once_,
+                    &EnvironmentalFilterRewriter::InitializeEmojiFinders, this);
+  }
 
   bool modified = false;
   for (Segment &segment : segments->conversion_segments()) {
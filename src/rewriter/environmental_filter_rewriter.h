@@ -56,6 +56,8 @@
 #include <string_view>
 #include <vector>
 
+#include "absl/base/call_once.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "base/text_normalizer.h"
 #include "converter/segments.h"
@@ -109,16 +111,25 @@ class EnvironmentalFilterRewriter : public RewriterInterface {
   void SetNormalizationFlag(TextNormalizer::Flag flag) { flag_ = flag; }
 
  private:
+  // Builds the Emoji version filters from the emoji data.  Called at most
+  // once, when a request first needs any of the filters.
+  void InitializeEmojiFinders() const;
+
   // Controls the normalization behavior.
   TextNormalizer::Flag flag_ = TextNormalizer::kDefault;
 
+  // Emoji data set, which the filters below are built from.
+  absl::string_view emoji_token_array_data_;
+  absl::string_view emoji_string_array_data_;
+
   // Filters for filtering target Emoji versions.
-  CharacterGroupFinder finder_e12_1_;
-  CharacterGroupFinder finder_e13_0_;
-  CharacterGroupFinder finder_e13_1_;
-  CharacterGroupFinder finder_e14_0_;
-  CharacterGroupFinder finder_e15_0_;
-  CharacterGroupFinder finder_e15_1_;
+  mutable absl::once_flag emoji_finders_once_;
+  mutable CharacterGroupFinder finder_e12_1_;
+  mutable CharacterGroupFinder finder_e13_0_;
+  mutable CharacterGroupFinder finder_e13_1_;
+  mutable CharacterGroupFinder finder_e14_0_;
+  mutable CharacterGroupFinder finder_e15_0_;
+  mutable CharacterGroupFinder finder_e15_1_;
 };
 }  // namespace mozc
 #endif  // MOZC_REWRITER_ENVIRONMENTAL_FILTER_REWRITER_H_
@@ -51,11 +51,12 @@ using ::mozc::storage::ExistenceFilterBuilder;
 std::string GenExistenceData(const absl::Span<const std::string> entries,
                              double error_rate) {
   const int n = entries.size();
-  const int m =
-      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(error_rate, n);
+  const int m = ExistenceFilterBuilder::MinBlockedFilterSizeInBytesForErrorRate(
+      error_rate, n);
   LOG(INFO) << "entry: " << n << " err: " << error_rate << " bytes: " << m;
 
-  ExistenceFilterBuilder builder(ExistenceFilterBuilder::CreateOptimal(m, n));
+  ExistenceFilterBuilder builder(
+      ExistenceFilterBuilder::CreateOptimalBlocked(m, n));
 
   for (const std::string &entry : entries) {
     const uint64_t id = Fingerprint(entry);
@@ -77,20 +77,52 @@ def ReadVariant(stream):
   return (variant_types, variant_items)
 
 
+def SplitToGraphemes(value):
+  """Splits a kanji list into kanji, keeping variation selectors."""
+  graphemes = []
+  for char in value:
+    codepoint = ord(char)
+    if graphemes and (0xFE00 <= codepoint <= 0xFE0F or
+                      0xE0100 <= codepoint <= 0xE01EF or
+                      codepoint in (0x3099, 0x309A)):
+      graphemes[-1] += char
+    else:
+      graphemes.append(char)
+  return graphemes
+
+
 def WriteSingleKanji(single_kanji_dic, output_tokens, output_string_array):
   """Writes single kanji list for readings.
 
-  The token output is an array of uint32s, where array[2 * i] and
-  array[2 * i + 1] are the indices of key and value in the string array.
-  See rewriter/single_kanji_rewriter.cc.
+  The string array has the N readings in sorted order, followed by each kanji
+  once.  The token output is an array of uint32s:
+    array[0]: N, the number of readings.
+    array[2 * i + 1], array[2 * i + 2]: the range of kanji of the i-th reading
+        in the kanji list area.
+    array[2 * N + 1], ...: the kanji list area, where each element is the
+        index of a kanji in the string array.
+  See dictionary/single_kanji_dictionary.cc.
   """
-  strings = []
+  strings = [key for (key, _) in single_kanji_dic]
+  kanji_indices = {}
+  ranges = []
+  kanji_list = []
+  for (_, value) in single_kanji_dic:
+    begin = len(kanji_list)
+    for kanji in SplitToGraphemes(value):
+      if kanji not in kanji_indices:
+        kanji_indices[kanji] = len(strings)
+        strings.append(kanji)
+      kanji_list.append(kanji_indices[kanji])
+    ranges.append((begin, len(kanji_list)))
+
   with open(output_tokens, 'wb') as f:
-    for index, (key, value) in enumerate(single_kanji_dic):
-      f.write(struct.pack('<I', 2 * index))
-      f.write(struct.pack('<I', 2 * index + 1))
-      strings.append(key)
-      strings.append(value)
+    f.write(struct.pack('<I', len(ranges)))
+    for (begin, end) in ranges:
+      f.write(struct.pack('<I', begin))
+      f.write(struct.pack('<I', end))
+    for index in kanji_list:
+      f.write(struct.pack('<I', index))
   serialized_string_array_builder.SerializeToFile(strings, output_string_array)
 
 
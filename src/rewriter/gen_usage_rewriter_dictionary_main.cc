@@ -35,13 +35,14 @@
 //    --output_conjugation_suffix=conj_suffix.data
 //    --output_conjugation_index=conj_index.data
 //    --output_usage_item_array=usage_item_array.data
+//    --output_usage_index=usage_index.data
 //    --output_string_array=string_array.data
 //
 // * Prerequisite
 // Little endian is assumed.
 //
 // * Output file format
-// The output data consists of five files:
+// The output data consists of six files:
 //
 // ** String array
 // All the strings (e.g., usage of word) are stored in this array and are
@@ -91,6 +92,13 @@
 // index is the conjugation type of this key value pair, and its conjugation
 // suffix types are retrieved using conjugation suffix index and conjugation
 // suffix array.
+//
+// ** Usage index
+//
+// Minimal perfect hash from the conjugated (key, value) pairs, and from
+// (empty key, conjugated value) pairs, to the usage item and its conjugation
+// suffix.  See rewriter/usage_index.h for the format.  When several items
+// produce the same pair, the last one in the usage item array is used.
 
 #include <algorithm>
 #include <cstddef>
@@ -108,6 +116,7 @@
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -115,6 +124,7 @@
 #include "base/container/serialized_string_array.h"
 #include "base/file_stream.h"
 #include "base/init_mozc.h"
+#include "rewriter/usage_index.h"
 
 ABSL_FLAG(std::string, usage_data_file, "", "usage data file");
 ABSL_FLAG(std::string, cforms_file, "", "cforms file");
@@ -126,6 +136,8 @@ ABSL_FLAG(std::string, output_conjugation_index, "",
           "output conjugation index array");
 ABSL_FLAG(std::string, output_usage_item_array, "",
           "output array of usage items");
+ABSL_FLAG(std::string, output_usage_index, "",
+          "output perfect hash index of usage items");
 ABSL_FLAG(std::string, output_string_array, "", "output string array");
 
 namespace mozc {
@@ -322,6 +334,8 @@ void Convert() {
 
   // Output conjugation suffix data.
   std::vector<int> conjugation_index(conjugation_list.size() + 1);
+  // Pairs of value and key suffixes in the output order.
+  std::vector<std::pair<std::string, std::string>> conjugation_suffixes;
   {
     OutputFileStream ostream(absl::GetFlag(FLAGS_output_conjugation_suffix),
                              std::ios_base::out | std::ios_base::binary);
@@ -334,6 +348,7 @@ void Convert() {
         const uint32_t index = Lookup(string_index, "");
         ostream.write(reinterpret_cast<const char *>(&index), 4);
         ostream.write(reinterpret_cast<const char *>(&index), 4);
+        conjugation_suffixes.emplace_back("", "");
         ++out_count;
       } else {
         using StrPair = std::pair<std::string, std::string>;
@@ -347,6 +362,7 @@ void Convert() {
           const uint32_t key_suffix_index = Lookup(string_index, kv.second);
           ostream.write(reinterpret_cast<const char *>(&value_suffix_index), 4);
           ostream.write(reinterpret_cast<const char *>(&key_suffix_index), 4);
+          conjugation_suffixes.push_back(kv);
           ++out_count;
         }
       }
@@ -380,6 +396,37 @@ void Convert() {
     }
   }
 
+  // Output usage index.
+  {
+    using StrPair = std::pair<std::string, std::string>;
+    absl::btree_map<StrPair, UsageIndex::Slot> slot_map;
+    for (uint32_t i = 0; i < usage_entries.size(); ++i) {
+      const UsageItem &item = usage_entries[i];
+      for (int j = conjugation_index[item.conjugation_id];
+           j < conjugation_index[item.conjugation_id + 1]; ++j) {
+        const auto &[value_suffix, key_suffix] = conjugation_suffixes[j];
+        const uint32_t suffix = static_cast<uint32_t>(j);
+        std::string value = absl::StrCat(item.value, value_suffix);
+        slot_map[StrPair(absl::StrCat(item.key, key_suffix), value)] = {
+            i, suffix};
+        slot_map[StrPair("", std::move(value))] = {
+            i, suffix | UsageIndex::kValueOnly};
+      }
+    }
+    std::vector<StrPair> pairs;
+    std::vector<UsageIndex::Slot> slots;
+    pairs.reserve(slot_map.size());
+    slots.reserve(slot_map.size());
+    for (const auto &[pair, slot] : slot_map) {
+      pairs.push_back(pair);
+      slots.push_back(slot);
+    }
+    const std::string index = UsageIndex::Build(pairs, slots);
+    OutputFileStream ostream(absl::GetFlag(FLAGS_output_usage_index),
+                             std::ios_base::out | std::ios_base::binary);
+    ostream.write(index.data(), index.size());
+  }
+
   // Output string array.
   {
     std::vector<absl::string_view> strs;
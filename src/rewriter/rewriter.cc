@@ -86,7 +86,8 @@ ABSL_FLAG(bool, use_history_rewriter, true, "Use history rewriter or not.");
 namespace mozc {
 
 Rewriter::Rewriter(const engine::Modules &modules,
-                   const ConverterInterface &parent_converter) {
+                   const ConverterInterface &parent_converter,
+                   bool use_history) {
   const DataManagerInterface *data_manager = &modules.GetDataManager();
   const dictionary::DictionaryInterface *dictionary = modules.GetDictionary();
   const dictionary::PosMatcher &pos_matcher = *modules.GetPosMatcher();
@@ -99,7 +100,8 @@ Rewriter::Rewriter(const engine::Modules &modules,
   AddRewriter(std::make_unique<EnglishVariantsRewriter>(pos_matcher));
   AddRewriter(std::make_unique<NumberRewriter>(data_manager));
   AddRewriter(CollocationRewriter::Create(*data_manager));
-  AddRewriter(std::make_unique<SingleKanjiRewriter>(*data_manager));
+  AddRewriter(std::make_unique<SingleKanjiRewriter>(
+      *data_manager, *modules.GetSingleKanjiDictionary()));
   AddRewriter(std::make_unique<IvsVariantsRewriter>());
   AddRewriter(std::make_unique<EmojiRewriter>(*data_manager));
   AddRewriter(EmoticonRewriter::CreateFromDataManager(*data_manager));
@@ -112,7 +114,7 @@ Rewriter::Rewriter(const engine::Modules &modules,
   AddRewriter(std::make_unique<DiceRewriter>());
   AddRewriter(std::make_unique<SmallLetterRewriter>(&parent_converter));
 
-  if (absl::GetFlag(FLAGS_use_history_rewriter)) {
+  if (use_history && absl::GetFlag(FLAGS_use_history_rewriter)) {
     AddRewriter(
         std::make_unique<UserBoundaryHistoryRewriter>(&parent_converter));
     AddRewriter(
@@ -72,6 +72,7 @@
         't13n_promotion_rewriter.cc',
         'transliteration_rewriter.cc',
         'unicode_rewriter.cc',
+        'usage_index.cc',
         'usage_rewriter.cc',
         'user_boundary_history_rewriter.cc',
         'user_dictionary_rewriter.cc',
@@ -39,7 +39,12 @@ namespace mozc {
 class Rewriter : public MergerRewriter {
  public:
   Rewriter(const engine::Modules &modules,
-           const ConverterInterface &parent_converter);
+           const ConverterInterface &parent_converter)
+      : Rewriter(modules, parent_converter, /*use_history=*/true) {}
+  // The history rewriters, which learn into the files of the user profile, are
+  // added only if |use_history| is true.
+  Rewriter(const engine::Modules &modules,
+           const ConverterInterface &parent_converter, bool use_history);
   Rewriter(const Rewriter &) = delete;
   Rewriter &operator=(const Rewriter &) = delete;
 };
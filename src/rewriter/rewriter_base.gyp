@@ -65,6 +65,7 @@
             '<(gen_out_dir)/usage_base_conj_suffix.data',
             '<(gen_out_dir)/usage_conj_index.data',
             '<(gen_out_dir)/usage_conj_suffix.data',
+            '<(gen_out_dir)/usage_index.data',
             '<(gen_out_dir)/usage_item_array.data',
             '<(gen_out_dir)/usage_string_array.data',
           ],
@@ -76,6 +77,7 @@
             '--output_conjugation_suffix=<(gen_out_dir)/usage_conj_suffix.data',
             '--output_conjugation_index=<(gen_out_dir)/usage_conj_index.data',
             '--output_usage_item_array=<(gen_out_dir)/usage_item_array.data',
+            '--output_usage_index=<(gen_out_dir)/usage_index.data',
             '--output_string_array=<(gen_out_dir)/usage_string_array.data',
           ],
         },
@@ -140,6 +142,7 @@
       'toolsets': ['host'],
       'sources': [
         'gen_usage_rewriter_dictionary_main.cc',
+        'usage_index.cc',
       ],
       'dependencies': [
         '<(mozc_oss_src_dir)/base/base.gyp:base',
@@ -63,6 +63,7 @@
         'symbol_rewriter_test.cc',
         't13n_promotion_rewriter_test.cc',
         'unicode_rewriter_test.cc',
+        'usage_index_test.cc',
         'usage_rewriter_test.cc',
         'user_boundary_history_rewriter_test.cc',
         'user_dictionary_rewriter_test.cc',
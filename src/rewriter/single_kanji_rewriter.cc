@@ -33,12 +33,10 @@
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <vector>
 
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
-#include "absl/types/span.h"
 #include "base/strings/assign.h"
 #include "base/vlog.h"
 #include "converter/segments.h"
@@ -102,8 +100,15 @@ void InsertNounPrefix(const PosMatcher &pos_matcher, Segment *segment,
 SingleKanjiRewriter::SingleKanjiRewriter(
     const DataManagerInterface &data_manager)
     : pos_matcher_(data_manager.GetPosMatcherData()),
-      single_kanji_dictionary_(
-          new dictionary::SingleKanjiDictionary(data_manager)) {}
+      owned_single_kanji_dictionary_(
+          std::make_unique<dictionary::SingleKanjiDictionary>(data_manager)),
+      single_kanji_dictionary_(owned_single_kanji_dictionary_.get()) {}
+
+SingleKanjiRewriter::SingleKanjiRewriter(
+    const DataManagerInterface &data_manager,
+    const dictionary::SingleKanjiDictionary &single_kanji_dictionary)
+    : pos_matcher_(data_manager.GetPosMatcherData()),
+      single_kanji_dictionary_(&single_kanji_dictionary) {}
 
 SingleKanjiRewriter::~SingleKanjiRewriter() = default;
 
@@ -137,10 +142,9 @@ bool SingleKanjiRewriter::Rewrite(const ConversionRequest &request,
   for (Segment &segment : conversion_segments) {
     AddDescriptionForExistingCandidates(&segment);
 
-    const std::string &key = segment.key();
-    std::vector<std::string> kanji_list;
-    if (!single_kanji_dictionary_->LookupKanjiEntries(key, use_svs,
-                                                      &kanji_list)) {
+    const dictionary::SingleKanjiDictionary::KanjiList kanji_list =
+        single_kanji_dictionary_->LookupKanjiEntries(segment.key(), use_svs);
+    if (kanji_list.empty()) {
       continue;
     }
     modified |=
@@ -201,7 +205,8 @@ void SingleKanjiRewriter::AddDescriptionForExistingCandidates(
 // Insert SingleKanji into segment.
 bool SingleKanjiRewriter::InsertCandidate(
     bool is_single_segment, uint16_t single_kanji_id,
-    absl::Span<const std::string> kanji_list, Segment *segment) const {
+    const dictionary::SingleKanjiDictionary::KanjiList &kanji_list,
+    Segment *segment) const {
   DCHECK(segment);
   DCHECK(!kanji_list.empty());
   if (segment->candidates_size() == 0) {
@@ -32,10 +32,8 @@
 
 #include <cstdint>
 #include <memory>
-#include <string>
 
 #include "absl/strings/string_view.h"
-#include "absl/types/span.h"
 #include "converter/segments.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -48,6 +46,11 @@ namespace mozc {
 class SingleKanjiRewriter : public RewriterInterface {
  public:
   explicit SingleKanjiRewriter(const DataManagerInterface &data_manager);
+  // Uses |single_kanji_dictionary| shared with the other modules of the
+  // engine, which must outlive this rewriter.
+  SingleKanjiRewriter(
+      const DataManagerInterface &data_manager,
+      const dictionary::SingleKanjiDictionary &single_kanji_dictionary);
   ~SingleKanjiRewriter() override;
 
   int capability(const ConversionRequest &request) const override;
@@ -57,14 +60,18 @@ class SingleKanjiRewriter : public RewriterInterface {
 
  private:
   void AddDescriptionForExistingCandidates(Segment *segment) const;
-  bool InsertCandidate(bool is_single_segment, uint16_t single_kanji_id,
-                       absl::Span<const std::string> kanji_list,
-                       Segment *segment) const;
+  bool InsertCandidate(
+      bool is_single_segment, uint16_t single_kanji_id,
+      const dictionary::SingleKanjiDictionary::KanjiList &kanji_list,
+      Segment *segment) const;
   void FillCandidate(absl::string_view key, absl::string_view value, int cost,
                      uint16_t single_kanji_id, Segment::Candidate *cand) const;
 
   const dictionary::PosMatcher pos_matcher_;
-  std::unique_ptr<dictionary::SingleKanjiDictionary> single_kanji_dictionary_;
+  // Set only if the dictionary is not shared.
+  std::unique_ptr<const dictionary::SingleKanjiDictionary>
+      owned_single_kanji_dictionary_;
+  const dictionary::SingleKanjiDictionary *single_kanji_dictionary_;
 };
 
 }  // namespace mozc
@@ -0,0 +1,194 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/usage_index.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/config.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/hash.h"
+
+namespace mozc {
+namespace {
+
+constexpr size_t kHeaderSize = 2 * sizeof(uint32_t);
+
+template <typename T>
+void AppendArray(absl::Span<const T> array, std::string *output) {
+  output->append(reinterpret_cast<const char *>(array.data()),
+                 array.size() * sizeof(T));
+}
+
+}  // namespace
+
+bool UsageIndex::Init(absl::string_view data) {
+  static_assert(ABSL_IS_LITTLE_ENDIAN);
+  static_assert(sizeof(Slot) == 2 * sizeof(uint32_t));
+
+  displacements_ = {};
+  slots_ = {};
+  if (data.empty()) {
+    return true;
+  }
+  if (data.size() < kHeaderSize ||
+      reinterpret_cast<uintptr_t>(data.data()) % alignof(uint32_t) != 0) {
+    LOG(ERROR) << "Usage index is broken";
+    return false;
+  }
+  uint32_t num_slots, num_buckets;
+  std::memcpy(&num_slots, data.data(), sizeof(uint32_t));
+  std::memcpy(&num_buckets, data.data() + sizeof(uint32_t), sizeof(uint32_t));
+  const size_t expected_size = kHeaderSize + num_buckets * sizeof(int32_t) +
+                               static_cast<size_t>(num_slots) * sizeof(Slot);
+  if (num_buckets == 0 || data.size() != expected_size) {
+    LOG(ERROR) << "Usage index is broken: size=" << data.size()
+               << " num_slots=" << num_slots << " num_buckets=" << num_buckets;
+    return false;
+  }
+  const char *ptr = data.data() + kHeaderSize;
+  displacements_ = absl::MakeConstSpan(
+      reinterpret_cast<const int32_t *>(ptr), num_buckets);
+  ptr += num_buckets * sizeof(int32_t);
+  slots_ =
+      absl::MakeConstSpan(reinterpret_cast<const Slot *>(ptr), num_slots);
+  return true;
+}
+
+const UsageIndex::Slot *UsageIndex::Find(absl::string_view key,
+                                         absl::string_view value) const {
+  if (slots_.empty()) {
+    return nullptr;
+  }
+  const int32_t d =
+      displacements_[Hash(key, value, 0) % displacements_.size()];
+  if (d == 0) {
+    return nullptr;
+  }
+  const size_t pos = d < 0 ? static_cast<size_t>(-(d + 1))
+                           : Hash(key, value, d) % slots_.size();
+  return pos < slots_.size() ? &slots_[pos] : nullptr;
+}
+
+// static
+std::string UsageIndex::Build(
+    absl::Span<const std::pair<std::string, std::string>> pairs,
+    absl::Span<const Slot> slots) {
+  CHECK_EQ(pairs.size(), slots.size());
+  CHECK_LE(pairs.size(), std::numeric_limits<int32_t>::max());
+  const uint32_t num_slots = pairs.size();
+  // Four pairs per bucket on average still keep the search for displacements
+  // short, while the displacements take only one byte per pair.
+  const uint32_t num_buckets = num_slots / 4 + 1;
+
+  std::vector<std::vector<uint32_t>> buckets(num_buckets);
+  for (uint32_t i = 0; i < num_slots; ++i) {
+    buckets[Hash(pairs[i].first, pairs[i].second, 0) % num_buckets].push_back(
+        i);
+  }
+  // Places the largest buckets first while most of the slots are free.
+  std::vector<uint32_t> order(num_buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  std::vector<int32_t> displacements(num_buckets, 0);
+  std::vector<Slot> table(num_slots);
+  std::vector<bool> used(num_slots, false);
+  std::vector<uint32_t> positions;
+  uint32_t next_free = 0;
+  for (const uint32_t b : order) {
+    const std::vector<uint32_t> &bucket = buckets[b];
+    if (bucket.empty()) {
+      break;
+    }
+    if (bucket.size() == 1) {
+      // Single pairs don't need hashing, so they just fill the holes.
+      while (used[next_free]) {
+        ++next_free;
+      }
+      used[next_free] = true;
+      table[next_free] = slots[bucket[0]];
+      displacements[b] = -static_cast<int32_t>(next_free) - 1;
+      continue;
+    }
+    for (int32_t d = 1;; ++d) {
+      CHECK_LT(d, std::numeric_limits<int32_t>::max())
+          << "Cannot find a displacement";
+      positions.clear();
+      for (const uint32_t i : bucket) {
+        const uint32_t pos =
+            Hash(pairs[i].first, pairs[i].second, d) % num_slots;
+        if (used[pos] || std::find(positions.begin(), positions.end(), pos) !=
+                             positions.end()) {
+          break;
+        }
+        positions.push_back(pos);
+      }
+      if (positions.size() != bucket.size()) {
+        continue;
+      }
+      for (size_t j = 0; j < bucket.size(); ++j) {
+        used[positions[j]] = true;
+        table[positions[j]] = slots[bucket[j]];
+      }
+      displacements[b] = d;
+      break;
+    }
+  }
+
+  std::string output;
+  output.reserve(kHeaderSize + num_buckets * sizeof(int32_t) +
+                 num_slots * sizeof(Slot));
+  const uint32_t header[] = {num_slots, num_buckets};
+  AppendArray<uint32_t>(header, &output);
+  AppendArray<int32_t>(displacements, &output);
+  AppendArray<Slot>(table, &output);
+  return output;
+}
+
+// static
+uint32_t UsageIndex::Hash(absl::string_view key, absl::string_view value,
+                          uint32_t seed) {
+  return Fingerprint32WithSeed(value, Fingerprint32WithSeed(key, seed));
+}
+
+}  // namespace mozc
@@ -0,0 +1,94 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_REWRITER_USAGE_INDEX_H_
+#define MOZC_REWRITER_USAGE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+
+// Minimal perfect hash from (key, value) pairs to the conjugated forms of the
+// usage dictionary. The index is built by gen_usage_rewriter_dictionary_main
+// and is queried in place in the data set, so nothing is built at startup.
+//
+// A perfect hash maps every pair to some slot, so the caller has to verify
+// that the slot actually holds the queried pair.
+//
+// Data layout (uint32_t, little endian):
+//
+// | num_slots | num_buckets | displacement[num_buckets] | slot[num_slots] |
+//
+// A pair is hashed with seed 0 to choose its bucket. A positive displacement
+// d places the pair at Hash(key, value, d) % num_slots, a negative one is
+// -(slot + 1) for a bucket of one pair, and zero marks an empty bucket.
+class UsageIndex {
+ public:
+  struct Slot {
+    // Index to the usage item array.
+    uint32_t item;
+    // Index to the conjugation suffix array. kValueOnly is set for the pairs
+    // with an empty key, which are used for the heuristic lookup.
+    uint32_t suffix;
+  };
+  static constexpr uint32_t kValueOnly = 1u << 31;
+
+  UsageIndex() = default;
+
+  // Returns false if `data` is broken, in which case the index is empty.
+  bool Init(absl::string_view data);
+
+  // Returns the only slot that can hold (key, value), or nullptr.
+  const Slot *Find(absl::string_view key, absl::string_view value) const;
+
+  size_t size() const { return slots_.size(); }
+
+  // Builds the index data. `pairs` must be unique and `slots[i]` is stored for
+  // `pairs[i]`.
+  static std::string Build(
+      absl::Span<const std::pair<std::string, std::string>> pairs,
+      absl::Span<const Slot> slots);
+
+  static uint32_t Hash(absl::string_view key, absl::string_view value,
+                       uint32_t seed);
+
+ private:
+  absl::Span<const int32_t> displacements_;
+  absl::Span<const Slot> slots_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_USAGE_INDEX_H_
@@ -0,0 +1,99 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rewriter/usage_index.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(UsageIndexTest, FindsEveryPair) {
+  std::vector<std::pair<std::string, std::string>> pairs;
+  std::vector<UsageIndex::Slot> slots;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    pairs.emplace_back(absl::StrCat("よみ", i), absl::StrCat("読み", i));
+    slots.push_back({i, i % 7});
+    // The same value with an empty key.
+    pairs.emplace_back("", absl::StrCat("読み", i));
+    slots.push_back({i, (i % 7) | UsageIndex::kValueOnly});
+  }
+  const std::string data = UsageIndex::Build(pairs, slots);
+  // Two uint32_t per slot plus about one byte per pair for displacements.
+  EXPECT_LT(data.size(), pairs.size() * 10);
+
+  UsageIndex index;
+  ASSERT_TRUE(index.Init(data));
+  EXPECT_EQ(index.size(), pairs.size());
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    const UsageIndex::Slot *slot = index.Find(pairs[i].first, pairs[i].second);
+    ASSERT_NE(slot, nullptr) << pairs[i].first << " " << pairs[i].second;
+    EXPECT_EQ(slot->item, slots[i].item);
+    EXPECT_EQ(slot->suffix, slots[i].suffix);
+  }
+}
+
+TEST(UsageIndexTest, Empty) {
+  UsageIndex index;
+  ASSERT_TRUE(index.Init(""));
+  EXPECT_EQ(index.Find("よみ", "読み"), nullptr);
+
+  const std::string data = UsageIndex::Build({}, {});
+  ASSERT_TRUE(index.Init(data));
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.Find("よみ", "読み"), nullptr);
+}
+
+TEST(UsageIndexTest, BrokenData) {
+  const std::vector<std::pair<std::string, std::string>> pairs = {
+      {"あう", "会う"}, {"あう", "合う"}, {"", "会う"}};
+  const std::vector<UsageIndex::Slot> slots = {{0, 0}, {1, 0}, {0, 0}};
+  const std::string data = UsageIndex::Build(pairs, slots);
+
+  UsageIndex index;
+  EXPECT_FALSE(index.Init(absl::string_view(data).substr(0, 4)));
+  EXPECT_FALSE(index.Init(absl::string_view(data).substr(0, data.size() - 4)));
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.Find("あう", "会う"), nullptr);
+
+  const std::string extra = data + std::string(8, '\0');
+  EXPECT_FALSE(index.Init(extra));
+  ASSERT_TRUE(index.Init(data));
+  EXPECT_EQ(index.size(), 3);
+}
+
+}  // namespace
+}  // namespace mozc
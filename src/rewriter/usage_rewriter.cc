@@ -33,11 +33,10 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
-#include <utility>
 
 #include "absl/log/check.h"
+#include "absl/log/log.h"
 #include "absl/strings/match.h"
-#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
 #include "base/util.h"
@@ -48,30 +47,42 @@
 #include "dictionary/pos_matcher.h"
 #include "protocol/config.pb.h"
 #include "request/conversion_request.h"
+#include "rewriter/usage_index.h"
 
 namespace mozc {
 
 using ::mozc::dictionary::DictionaryInterface;
 
+namespace {
+
+// Returns true if `str` is `prefix` followed by `suffix`.
+bool IsConcatenation(absl::string_view str, absl::string_view prefix,
+                     absl::string_view suffix) {
+  return str.size() == prefix.size() + suffix.size() &&
+         absl::StartsWith(str, prefix) && absl::EndsWith(str, suffix);
+}
+
+}  // namespace
+
 UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
                              const DictionaryInterface *dictionary)
     : pos_matcher_(data_manager->GetPosMatcherData()),
       dictionary_(dictionary),
       base_conjugation_suffix_(nullptr) {
   absl::string_view base_conjugation_suffix_data;
-  absl::string_view conjugation_suffix_data;
   absl::string_view conjugation_suffix_index_data;
-  absl::string_view usage_items_data;
+  absl::string_view usage_index_data;
   absl::string_view string_array_data;
   data_manager->GetUsageRewriterData(
-      &base_conjugation_suffix_data, &conjugation_suffix_data,
-      &conjugation_suffix_index_data, &usage_items_data, &string_array_data);
+      &base_conjugation_suffix_data, &conjugation_suffix_data_,
+      &conjugation_suffix_index_data, &usage_items_data_, &usage_index_data,
+      &string_array_data);
+  // The index is queried in place, so only its header is read here.
+  if (!index_.Init(usage_index_data)) {
+    LOG(ERROR) << "Usage dictionary is disabled";
+  }
   base_conjugation_suffix_ =
       reinterpret_cast<const uint32_t *>(base_conjugation_suffix_data.data());
-  const uint32_t *conjugation_suffix =
-      reinterpret_cast<const uint32_t *>(conjugation_suffix_data.data());
-  const uint32_t *conjugation_suffix_data_index =
-      reinterpret_cast<const uint32_t *>(conjugation_suffix_index_data.data());
 
   if (SerializedStringArray::VerifyData(string_array_data)) {
     string_array_.Set(string_array_data);
@@ -79,29 +90,38 @@ UsageRewriter::UsageRewriter(const DataManagerInterface *data_manager,
     // \0\0\0\0 is the header value of the data size.
     string_array_.Set({"\0\0\0\0", 4});
   }
+}
 
-  UsageDictItemIterator begin(usage_items_data.data());
-  UsageDictItemIterator end(usage_items_data.data() + usage_items_data.size());
-
-  // TODO(taku): To reduce memory footprint, better to replace it with
-  // binary search over the conjugation_suffix_data directly.
-  for (; begin != end; ++begin) {
-    for (size_t i = conjugation_suffix_data_index[begin.conjugation_id()];
-         i < conjugation_suffix_data_index[begin.conjugation_id() + 1]; ++i) {
-      const absl::string_view key = string_array_[begin.key_index()];
-      const absl::string_view value = string_array_[begin.value_index()];
-      const absl::string_view key_suffix =
-          string_array_[conjugation_suffix[2 * i + 1]];
-      const absl::string_view value_suffix =
-          string_array_[conjugation_suffix[2 * i]];
-      const StrPair key_value1(absl::StrCat(key, key_suffix),
-                               absl::StrCat(value, value_suffix));
-      key_value_usageitem_map_[key_value1] = begin;
+UsageRewriter::UsageDictItemIterator UsageRewriter::FindUsage(
+    absl::string_view key, absl::string_view value) const {
+  const UsageIndex::Slot *slot = index_.Find(key, value);
+  if (slot == nullptr) {
+    return UsageDictItemIterator();
+  }
+  const uint32_t suffix = slot->suffix & ~UsageIndex::kValueOnly;
+  const size_t item_bytes = kUsageItemSize * sizeof(uint32_t);
+  if (slot->item >= usage_items_data_.size() / item_bytes ||
+      suffix >= conjugation_suffix_data_.size() / (2 * sizeof(uint32_t))) {
+    return UsageDictItemIterator();
+  }
 
-      const StrPair key_value2("", key_value1.second);
-      key_value_usageitem_map_[key_value2] = begin;
-    }
+  // The perfect hash maps any pair to some slot, so the pair is verified.
+  const UsageDictItemIterator item(usage_items_data_.data() +
+                                   slot->item * item_bytes);
+  const uint32_t *conjugation_suffix =
+      reinterpret_cast<const uint32_t *>(conjugation_suffix_data_.data());
+  if (!IsConcatenation(value, string_array_[item.value_index()],
+                       string_array_[conjugation_suffix[2 * suffix]])) {
+    return UsageDictItemIterator();
+  }
+  if (slot->suffix & UsageIndex::kValueOnly) {
+    return key.empty() ? item : UsageDictItemIterator();
+  }
+  if (!IsConcatenation(key, string_array_[item.key_index()],
+                       string_array_[conjugation_suffix[2 * suffix + 1]])) {
+    return UsageDictItemIterator();
   }
+  return item;
 }
 
 // static
@@ -157,15 +177,14 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
   }
 
   // key is empty;
-  StrPair key_value("", value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr == key_value_usageitem_map_.end()) {
+  const UsageDictItemIterator item = FindUsage("", value);
+  if (!item.IsValid()) {
     return UsageDictItemIterator();
   }
   // Check result key part is a prefix of the content_key.
-  const absl::string_view key = string_array_[itr->second.key_index()];
+  const absl::string_view key = string_array_[item.key_index()];
   if (absl::StartsWith(candidate.content_key, key)) {
-    return itr->second;
+    return item;
   }
 
   return UsageDictItemIterator();
@@ -173,12 +192,10 @@ UsageRewriter::LookupUnmatchedUsageHeuristically(
 
 UsageRewriter::UsageDictItemIterator UsageRewriter::LookupUsage(
     const Segment::Candidate &candidate) const {
-  const absl::string_view key = candidate.content_key;
-  const absl::string_view value = candidate.content_value;
-  StrPair key_value(key, value);
-  const auto itr = key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
-    return itr->second;
+  const UsageDictItemIterator item =
+      FindUsage(candidate.content_key, candidate.content_value);
+  if (item.IsValid()) {
+    return item;
   }
 
   return LookupUnmatchedUsageHeuristically(candidate);
@@ -205,7 +222,7 @@ bool UsageRewriter::Rewrite(const ConversionRequest &request,
   // dictionary.  Since just the uniqueness in one Segments is sufficient, for
   // usage from the user dictionary, we simply assign sequential numbers larger
   // than the maximum ID of the embedded usage dictionary.
-  int32_t usage_id_for_user_comment = key_value_usageitem_map_.size();
+  int32_t usage_id_for_user_comment = index_.size();
   std::string comment;  // LookupComment rarely returns true.
   for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
     Segment *segment = segments->mutable_conversion_segment(i);
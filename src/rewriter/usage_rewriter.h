@@ -36,9 +36,7 @@
 #include <iterator>
 #include <new>
 #include <string>
-#include <utility>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "base/container/serialized_string_array.h"
 #include "converter/segments.h"
@@ -47,6 +45,7 @@
 #include "dictionary/pos_matcher.h"
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/usage_index.h"
 #include "testing/friend_test.h"
 
 namespace mozc {
@@ -103,17 +102,23 @@ class UsageRewriter : public RewriterInterface {
     const uint32_t *ptr_;
   };
 
-  using StrPair = std::pair<std::string, std::string>;
   static std::string GetKanjiPrefixAndOneHiragana(absl::string_view word);
 
   UsageDictItemIterator LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   UsageDictItemIterator LookupUsage(const Segment::Candidate &candidate) const;
 
-  absl::flat_hash_map<StrPair, UsageDictItemIterator> key_value_usageitem_map_;
+  // Returns the usage item whose conjugated form is (key, value).  For an
+  // empty key, the last item having the conjugated value is returned.
+  UsageDictItemIterator FindUsage(absl::string_view key,
+                                  absl::string_view value) const;
+
+  UsageIndex index_;
   const dictionary::PosMatcher pos_matcher_;
   const dictionary::DictionaryInterface *dictionary_;
   const uint32_t *base_conjugation_suffix_;
+  absl::string_view conjugation_suffix_data_;
+  absl::string_view usage_items_data_;
   SerializedStringArray string_array_;
 
  private:
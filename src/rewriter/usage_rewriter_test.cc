@@ -93,6 +93,7 @@ class TestDataManager : public testing::MockDataManager {
                absl::string_view *conjugation_suffix_data,
                absl::string_view *conjugation_index_data,
                absl::string_view *usage_items_data,
+               absl::string_view *usage_index_data,
                absl::string_view *string_array_data),
               (const, override));
 };
@@ -141,8 +142,8 @@ class UsageRewriterTest : public testing::TestWithTempUserProfile {
 };
 
 TEST_F(UsageRewriterTest, ConstructorTest) {
-  EXPECT_CALL(*test_data_manager_, GetUsageRewriterData(_, _, _, _, _))
-      .WillOnce(SetArgPointee<4>(""));
+  EXPECT_CALL(*test_data_manager_, GetUsageRewriterData(_, _, _, _, _, _))
+      .WillOnce(SetArgPointee<5>(""));
   pos_matcher_.Set(test_data_manager_->GetPosMatcherData());
   user_dictionary_ = std::make_unique<UserDictionary>(
       UserPos::CreateFromDataManager(*test_data_manager_), pos_matcher_,
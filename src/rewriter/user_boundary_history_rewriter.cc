@@ -44,6 +44,7 @@
 #include "absl/strings/string_view.h"
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
+#include "base/startup_profiler.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "converter/converter_interface.h"
@@ -115,6 +116,7 @@ UserBoundaryHistoryRewriter::UserBoundaryHistoryRewriter(
     : parent_converter_(parent_converter),
       storage_(std::make_unique<LruStorage>()) {
   DCHECK(parent_converter_);
+  storage_->set_use_write_ahead_log(true);
   Reload();
 }
 
@@ -199,11 +201,13 @@ bool UserBoundaryHistoryRewriter::Rewrite(const ConversionRequest &request,
 bool UserBoundaryHistoryRewriter::Sync() {
   if (storage_) {
     storage_->DeleteElementsUntouchedFor62Days();
+    storage_->Sync();
   }
   return true;
 }
 
 bool UserBoundaryHistoryRewriter::Reload() {
+  StartupProfiler::ScopedPhase phase("UserBoundaryHistoryRewriter::Reload");
   const std::string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(), kValueSize, kLruSize,
                               kSeedValue)) {
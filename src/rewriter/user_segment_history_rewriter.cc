@@ -50,6 +50,7 @@
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
 #include "base/number_util.h"
+#include "base/startup_profiler.h"
 #include "base/util.h"
 #include "base/vlog.h"
 #include "config/character_form_manager.h"
@@ -486,6 +487,7 @@ UserSegmentHistoryRewriter::UserSegmentHistoryRewriter(
     : storage_(std::make_unique<LruStorage>()),
       pos_matcher_(pos_matcher),
       pos_group_(pos_group) {
+  storage_->set_use_write_ahead_log(true);
   Reload();
 
   CHECK_EQ(sizeof(uint32_t), sizeof(FeatureValue));
@@ -810,11 +812,13 @@ void UserSegmentHistoryRewriter::Finish(const ConversionRequest &request,
 bool UserSegmentHistoryRewriter::Sync() {
   if (storage_) {
     storage_->DeleteElementsUntouchedFor62Days();
+    storage_->Sync();
   }
   return true;
 }
 
 bool UserSegmentHistoryRewriter::Reload() {
+  StartupProfiler::ScopedPhase phase("UserSegmentHistoryRewriter::Reload");
   const std::string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(), kValueSize, kLruSize,
                               kSeedValue)) {
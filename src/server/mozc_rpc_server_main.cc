@@ -27,23 +27,34 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "base/init_mozc.h"
-#include "base/singleton.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
-#include "engine/engine_factory.h"
+#include "base/thread.h"
+#include "base/vlog.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "engine/engine.h"
+#include "engine/modules.h"
 #include "protocol/commands.pb.h"
 #include "session/random_keyevents_generator.h"
 #include "session/session_handler.h"
+#include "session/session_handler_interface.h"
+#include "session/session_handler_pool.h"
 #include "session/session_usage_observer.h"
 
 #ifdef _WIN32
@@ -56,6 +67,7 @@ using ssize_t = SSIZE_T;
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 #endif  // _WIN32
 
@@ -63,23 +75,46 @@ ABSL_FLAG(std::string, host, "localhost", "server host name");
 ABSL_FLAG(bool, server, true, "server mode");
 ABSL_FLAG(bool, client, false, "client mode");
 ABSL_FLAG(int32_t, client_test_size, 100, "client test size");
+ABSL_FLAG(int32_t, client_sessions, 1,
+          "number of sessions sending keys concurrently in client mode");
 ABSL_FLAG(int32_t, port, 8000, "port of RPC server");
 ABSL_FLAG(int32_t, rpc_timeout, 60000, "timeout");
+ABSL_FLAG(int32_t, rpc_threads, 4,
+          "number of threads converting in parallel, each with its own engine. "
+          "Only the sessions on the first one learn the user history.");
 ABSL_FLAG(std::string, user_profile_directory, "", "user profile directory");
 
 namespace mozc {
 
 namespace {
 
-constexpr size_t kMaxRequestSize = 32 * 32 * 8192;
-constexpr size_t kMaxOutputSize = 32 * 32 * 8192;
+constexpr size_t kMaxMessageSize = 32 * 32 * 8192;
 constexpr int kInvalidSocket = -1;
 
-// TODO(taku): timeout should be handled.
-bool Recv(int socket, char *buf, size_t buf_size, int timeout) {
+// Sets the timeout of recv() and send() in milliseconds.
+void SetTimeout(int socket, int timeout) {
+#ifdef _WIN32
+  const DWORD tv = timeout;
+#else   // _WIN32
+  struct timeval tv = {};
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+#endif  // _WIN32
+  ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO,
+               reinterpret_cast<const char *>(&tv), sizeof(tv));
+  ::setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO,
+               reinterpret_cast<const char *>(&tv), sizeof(tv));
+}
+
+// Returns false when the connection is closed or times out.
+bool Recv(int socket, char *buf, size_t buf_size) {
   ssize_t buf_left = buf_size;
   while (buf_left > 0) {
     const ssize_t read_size = ::recv(socket, buf, buf_left, 0);
+    if (read_size == 0) {
+      MOZC_VLOG(1) << "connection is closed by the peer";
+      return false;
+    }
     if (read_size < 0) {
       LOG(ERROR) << "an error occurred during recv()";
       return false;
@@ -90,8 +125,7 @@ bool Recv(int socket, char *buf, size_t buf_size, int timeout) {
   return buf_left == 0;
 }
 
-// TODO(taku): timeout should be handled.
-bool Send(int socket, const char *buf, size_t buf_size, int timeout) {
+bool Send(int socket, const char *buf, size_t buf_size) {
   ssize_t buf_left = buf_size;
   while (buf_left > 0) {
 #if defined(_WIN32)
@@ -112,24 +146,84 @@ bool Send(int socket, const char *buf, size_t buf_size, int timeout) {
   return buf_left == 0;
 }
 
+// A message is sent as its size in the network byte order followed by the
+// serialized protobuf. |buffer| is reused for the messages of a connection.
+template <typename Message>
+bool RecvMessage(int socket, std::string *buffer, Message *message) {
+  uint32_t size = 0;
+  if (!Recv(socket, reinterpret_cast<char *>(&size), sizeof(size))) {
+    return false;
+  }
+  size = ntohl(size);
+  if (size >= kMaxMessageSize) {
+    LOG(ERROR) << "Too large message: " << size;
+    return false;
+  }
+  buffer->resize(size);
+  if (!Recv(socket, buffer->data(), size)) {
+    LOG(ERROR) << "cannot receive body of message.";
+    return false;
+  }
+  if (!message->ParseFromArray(buffer->data(), size)) {
+    LOG(ERROR) << "ParseFromArray failed";
+    return false;
+  }
+  return true;
+}
+
+template <typename Message>
+bool SendMessage(int socket, std::string *buffer, const Message &message) {
+  // The header and the body are sent at once so that the peer doesn't wait
+  // for the delayed ACK of the header.
+  buffer->resize(sizeof(uint32_t));
+  CHECK(message.AppendToString(buffer));
+  const uint32_t size = buffer->size() - sizeof(uint32_t);
+  CHECK_LT(size, kMaxMessageSize);
+  const uint32_t header = htonl(size);
+  std::memcpy(buffer->data(), &header, sizeof(header));
+  return Send(socket, buffer->data(), buffer->size());
+}
+
+// The socket is shut down before it's closed. Once closed, the descriptor
+// can be reused by accept() on another thread.
 void CloseSocket(int client_socket) {
 #ifdef _WIN32
-  ::closesocket(client_socket);
   ::shutdown(client_socket, SD_BOTH);
+  ::closesocket(client_socket);
 #else   // _WIN32
-  ::close(client_socket);
   ::shutdown(client_socket, SHUT_RDWR);
+  ::close(client_socket);
 #endif  // _WIN32
 }
 
 // Standalone RPCServer.
 // TODO(taku): Make a RPC class inherited from IPCInterface.
 // This allows us to reuse client::Session library and SessionServer.
+//
+// Each connection is served by its own thread until the client closes it. The
+// commands are evaluated on --rpc_threads handlers, whose engines share the
+// modules. The first engine owns the user history files of the profile, and
+// the others convert without the user history.
 class RPCServer {
  public:
-  RPCServer()
-      : server_socket_(kInvalidSocket),
-        handler_(new SessionHandler(EngineFactory::Create().value())) {
+  RPCServer() : server_socket_(kInvalidSocket) {
+    constexpr bool kIsMobile = false;
+    auto modules = std::make_shared<engine::Modules>();
+    CHECK_OK(modules->Init(std::make_unique<oss::OssDataManager>()));
+    std::vector<std::unique_ptr<SessionHandlerInterface>> handlers;
+    for (int i = 0; i < std::max(absl::GetFlag(FLAGS_rpc_threads), 1); ++i) {
+      std::unique_ptr<Engine> engine =
+          (i == 0 ? Engine::CreateEngineWithSharedModules(modules, kIsMobile)
+                  : Engine::CreateEngineWithoutUserHistory(modules, kIsMobile))
+              .value();
+      auto handler = std::make_unique<SessionHandler>(std::move(engine));
+      // The observers are not thread-safe.
+      observers_.push_back(std::make_unique<session::SessionUsageObserver>());
+      handler->AddObserver(observers_.back().get());
+      handlers.push_back(std::move(handler));
+    }
+    pool_ = std::make_unique<SessionHandlerPool>(std::move(handlers));
+
     server_socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
 
     CHECK_NE(server_socket_, kInvalidSocket) << "socket failed";
@@ -158,8 +252,6 @@ class RPCServer {
 
     CHECK_GE(::listen(server_socket_, SOMAXCONN), 0) << "listen failed";
     CHECK_NE(server_socket_, 0);
-
-    handler_->AddObserver(Singleton<session::SessionUsageObserver>::get());
   }
 
   ~RPCServer() {
@@ -170,6 +262,7 @@ class RPCServer {
   void Loop() {
     LOG(INFO) << "Start Mozc RPCServer";
 
+    std::vector<BackgroundFuture<void>> connections;
     while (true) {
       const int client_socket = ::accept(server_socket_, nullptr, nullptr);
 
@@ -177,61 +270,40 @@ class RPCServer {
         LOG(ERROR) << "accept failed";
         continue;
       }
-
-      uint32_t request_size = 0;
-      // Receive the size of data.
-      if (!Recv(client_socket, reinterpret_cast<char *>(&request_size),
-                sizeof(request_size), absl::GetFlag(FLAGS_rpc_timeout))) {
-        LOG(ERROR) << "Cannot receive request_size header.";
-        CloseSocket(client_socket);
-        continue;
-      }
-      request_size = ntohl(request_size);
-      CHECK_GT(request_size, 0);
-      CHECK_LT(request_size, kMaxRequestSize);
-
-      // Receive the body of serialized protobuf.
-      std::unique_ptr<char[]> request_str(new char[request_size]);
-      if (!Recv(client_socket, request_str.get(), request_size,
-                absl::GetFlag(FLAGS_rpc_timeout))) {
-        LOG(ERROR) << "cannot receive body of request.";
+      SetTimeout(client_socket, absl::GetFlag(FLAGS_rpc_timeout));
+
+      // Joins the threads of the closed connections.
+      std::erase_if(connections, [](const BackgroundFuture<void> &connection) {
+        return connection.Ready();
+      });
+      connections.emplace_back([this, client_socket] {
+        std::string buffer;
+        ServeConnection(client_socket, &buffer);
         CloseSocket(client_socket);
-        continue;
-      }
+      });
+    }
+  }
 
-      commands::Command command;
-      if (!command.mutable_input()->ParseFromArray(request_str.get(),
-                                                   request_size)) {
-        LOG(ERROR) << "ParseFromArray failed";
-        CloseSocket(client_socket);
-        continue;
+ private:
+  // Evaluates the commands sent to |client_socket| until it's closed.
+  void ServeConnection(int client_socket, std::string *buffer) {
+    commands::Command command;
+    while (RecvMessage(client_socket, buffer, command.mutable_input())) {
+      command.clear_output();
+      if (!pool_->EvalCommand(&command)) {
+        MOZC_VLOG(1) << "EvalCommand failed: " << command.output().error_code();
       }
-
-      CHECK(handler_->EvalCommand(&command));
-
-      std::string output_str;
-      // Return the result.
-      CHECK(command.output().SerializeToString(&output_str));
-
-      uint32_t output_size = output_str.size();
-      CHECK_GT(output_size, 0);
-      CHECK_LT(output_size, kMaxOutputSize);
-      output_size = htonl(output_size);
-
-      if (!Send(client_socket, reinterpret_cast<char *>(&output_size),
-                sizeof(output_size), absl::GetFlag(FLAGS_rpc_timeout)) ||
-          !Send(client_socket, output_str.data(), output_str.size(),
-                absl::GetFlag(FLAGS_rpc_timeout))) {
+      if (!SendMessage(client_socket, buffer, command.output())) {
         LOG(ERROR) << "Cannot send reply.";
+        return;
       }
-
-      CloseSocket(client_socket);
     }
   }
 
- private:
   int server_socket_;
-  std::unique_ptr<SessionHandler> handler_;
+  // The observers must outlive the handlers in |pool_|.
+  std::vector<std::unique_ptr<session::SessionUsageObserver>> observers_;
+  std::unique_ptr<SessionHandlerPool> pool_;
 };
 
 // Standalone RPCClient.
@@ -239,7 +311,16 @@ class RPCServer {
 // This allows us to reuse client::Session library and SessionServer.
 class RPCClient {
  public:
-  RPCClient() : id_(0) {}
+  RPCClient() : socket_(kInvalidSocket), id_(0) {}
+
+  RPCClient(const RPCClient &) = delete;
+  RPCClient &operator=(const RPCClient &) = delete;
+
+  ~RPCClient() {
+    if (socket_ != kInvalidSocket) {
+      CloseSocket(socket_);
+    }
+  }
 
   bool CreateSession() {
     id_ = 0;
@@ -257,14 +338,15 @@ class RPCClient {
   bool DeleteSession() {
     commands::Input input;
     commands::Output output;
-    id_ = 0;
     input.set_type(commands::Input::DELETE_SESSION);
+    input.set_id(id_);
+    id_ = 0;
     return (Call(input, &output) &&
             output.error_code() == commands::Output::SESSION_SUCCESS);
   }
 
   bool SendKey(const mozc::commands::KeyEvent &key,
-               mozc::commands::Output *output) const {
+               mozc::commands::Output *output) {
     if (id_ == 0) {
       return false;
     }
@@ -277,58 +359,126 @@ class RPCClient {
   }
 
  private:
-  bool Call(const commands::Input &input, commands::Output *output) const {
+  bool Connect() {
     struct addrinfo hints = {}, *res;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_family = AF_INET;
 
     const std::string port_str = std::to_string(absl::GetFlag(FLAGS_port));
-    CHECK_EQ(::getaddrinfo(absl::GetFlag(FLAGS_host).c_str(), port_str.c_str(),
-                           &hints, &res),
-             0)
-        << "getaddrinfo failed";
-
-    const int client_socket =
-        ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-    CHECK_NE(client_socket, kInvalidSocket) << "socket failed";
-    CHECK_GE(::connect(client_socket, res->ai_addr, res->ai_addrlen), 0)
-        << "connect failed";
-
-    std::string request_str;
-    CHECK(input.SerializeToString(&request_str));
-    uint32_t request_size = request_str.size();
-    CHECK_GT(request_size, 0);
-    CHECK_LT(request_size, kMaxRequestSize);
-    request_size = htonl(request_size);
-
-    CHECK(Send(client_socket, reinterpret_cast<char *>(&request_size),
-               sizeof(request_size), absl::GetFlag(FLAGS_rpc_timeout)));
-    CHECK(Send(client_socket, request_str.data(), request_str.size(),
-               absl::GetFlag(FLAGS_rpc_timeout)));
-
-    uint32_t output_size = 0;
-    CHECK(Recv(client_socket, reinterpret_cast<char *>(&output_size),
-               sizeof(output_size), absl::GetFlag(FLAGS_rpc_timeout)));
-    output_size = ntohl(output_size);
-    CHECK_GT(output_size, 0);
-    CHECK_LT(output_size, kMaxOutputSize);
-
-    std::unique_ptr<char[]> output_str(new char[output_size]);
-    CHECK(Recv(client_socket, output_str.get(), output_size,
-               absl::GetFlag(FLAGS_rpc_timeout)));
-
-    CHECK(output->ParseFromArray(output_str.get(), output_size));
+    if (::getaddrinfo(absl::GetFlag(FLAGS_host).c_str(), port_str.c_str(),
+                      &hints, &res) != 0) {
+      LOG(ERROR) << "getaddrinfo failed";
+      return false;
+    }
 
+    socket_ = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    CHECK_NE(socket_, kInvalidSocket) << "socket failed";
+    const bool connected =
+        ::connect(socket_, res->ai_addr, res->ai_addrlen) >= 0;
     ::freeaddrinfo(res);
+    if (!connected) {
+      LOG(ERROR) << "connect failed";
+      CloseSocket(socket_);
+      socket_ = kInvalidSocket;
+      return false;
+    }
+    SetTimeout(socket_, absl::GetFlag(FLAGS_rpc_timeout));
+    return true;
+  }
 
-    CloseSocket(client_socket);
-
+  // Sends |input| over the connection kept open across the calls.
+  bool Call(const commands::Input &input, commands::Output *output) {
+    if (socket_ == kInvalidSocket && !Connect()) {
+      return false;
+    }
+    if (!SendMessage(socket_, &buffer_, input) ||
+        !RecvMessage(socket_, &buffer_, output)) {
+      LOG(ERROR) << "RPC failed";
+      CloseSocket(socket_);
+      socket_ = kInvalidSocket;
+      return false;
+    }
     return true;
   }
 
+  int socket_;
+  std::string buffer_;
   uint64_t id_;
 };
 
+// Sends random key sequences from |num_sessions| sessions concurrently, and
+// prints the throughput and the latency percentiles of SendKey. Returns false
+// if any request failed.
+bool RunLoadTest(int num_sessions, int test_size) {
+  std::vector<std::vector<absl::Duration>> latencies(num_sessions);
+  std::vector<int> failures(num_sessions);
+  const absl::Time start = absl::Now();
+  {
+    std::vector<Thread> clients;
+    for (int i = 0; i < num_sessions; ++i) {
+      clients.emplace_back([&latencies, &failures, i, test_size] {
+        RPCClient client;
+        if (!client.CreateSession()) {
+          LOG(ERROR) << "CreateSession failed";
+          ++failures[i];
+          return;
+        }
+        session::RandomKeyEventsGenerator key_events_generator;
+        std::vector<commands::KeyEvent> keys;
+        for (int n = 0; n < test_size; ++n) {
+          key_events_generator.GenerateSequence(&keys);
+          for (const commands::KeyEvent &key : keys) {
+            MOZC_VLOG(1) << "Sending to Server: " << key;
+            commands::Output output;
+            const Stopwatch stopwatch = Stopwatch::StartNew();
+            if (!client.SendKey(key, &output)) {
+              LOG(ERROR) << "SendKey failed";
+              ++failures[i];
+              continue;
+            }
+            latencies[i].push_back(stopwatch.GetElapsed());
+            MOZC_VLOG(1) << "Output of SendKey: " << output;
+          }
+        }
+        if (!client.DeleteSession()) {
+          LOG(ERROR) << "DeleteSession failed";
+          ++failures[i];
+        }
+      });
+    }
+    for (Thread &client : clients) {
+      client.Join();
+    }
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+
+  int num_failures = 0;
+  for (const int session_failures : failures) {
+    num_failures += session_failures;
+  }
+  std::vector<absl::Duration> all;
+  for (const std::vector<absl::Duration> &session_latencies : latencies) {
+    all.insert(all.end(), session_latencies.begin(), session_latencies.end());
+  }
+  std::cout << "sessions: " << num_sessions << std::endl
+            << "failed requests: " << num_failures << std::endl
+            << "keys: " << all.size() << std::endl
+            << "elapsed: " << elapsed << std::endl;
+  if (all.empty()) {
+    return num_failures == 0;
+  }
+  std::sort(all.begin(), all.end());
+  const auto percentile = [&all](size_t p) {
+    return all[(all.size() - 1) * p / 100];
+  };
+  std::cout << "throughput: " << all.size() / absl::ToDoubleSeconds(elapsed)
+            << " keys/s" << std::endl
+            << "latency p50: " << percentile(50) << " p90: " << percentile(90)
+            << " p99: " << percentile(99) << " max: " << all.back()
+            << std::endl;
+  return num_failures == 0;
+}
+
 // Wrapper class for WSAStartup on Windows.
 class ScopedWSAData {
  public:
@@ -361,21 +511,10 @@ int main(int argc, char *argv[]) {
   }
 
   if (absl::GetFlag(FLAGS_client)) {
-    mozc::RPCClient client;
-    CHECK(client.CreateSession());
-    mozc::session::RandomKeyEventsGenerator key_events_generator;
-    for (int n = 0; n < absl::GetFlag(FLAGS_client_test_size); ++n) {
-      std::vector<mozc::commands::KeyEvent> keys;
-      key_events_generator.GenerateSequence(&keys);
-      for (size_t i = 0; i < keys.size(); ++i) {
-        LOG(INFO) << "Sending to Server: " << keys[i];
-        mozc::commands::Output output;
-        CHECK(client.SendKey(keys[i], &output));
-        LOG(INFO) << "Output of SendKey: " << output;
-      }
-    }
-    CHECK(client.DeleteSession());
-    return 0;
+    return mozc::RunLoadTest(std::max(absl::GetFlag(FLAGS_client_sessions), 1),
+                             absl::GetFlag(FLAGS_client_test_size))
+               ? 0
+               : 1;
   } else if (absl::GetFlag(FLAGS_server)) {
     mozc::RPCServer server;
     server.Loop();
@@ -116,6 +116,7 @@
         '<(mozc_oss_src_dir)/base/base.gyp:base',
         '<(mozc_oss_src_dir)/engine/engine.gyp:engine_factory',
         '<(mozc_oss_src_dir)/session/session.gyp:session_handler',
+        '<(mozc_oss_src_dir)/session/session.gyp:session_handler_pool',
         '<(mozc_oss_src_dir)/session/session.gyp:session_server',
         '<(mozc_oss_src_dir)/session/session.gyp:random_keyevents_generator',
       ],
@@ -66,6 +66,16 @@ static constexpr char kOverlayHenkanMuhenkanToImeOnOffKeyMapFile[] =
     "system://overlay_henkan_muhenkan_to_ime_on_off.tsv";
 }  // namespace
 
+bool NormalizedKey::Init(const commands::KeyEvent &key_event) {
+  // Shortcut keys should be available as if CapsLock was not enabled like
+  // other IMEs such as MS-IME or ATOK. b/5627459
+  if (!KeyEventUtil::GetNormalizedKeyInformation(key_event, &key)) {
+    return false;
+  }
+  has_stub = KeyEventUtil::MaybeGetNormalizedKeyStub(key_event, &stub);
+  return true;
+}
+
 // static
 bool KeyMapManager::IsSameKeyMapManagerApplicable(
     const config::Config &old_config, const config::Config &new_config) {
@@ -684,23 +694,31 @@ bool KeyMapManager::GetCommandComposition(
 bool KeyMapManager::GetCommandZeroQuerySuggestion(
     const commands::KeyEvent &key_event,
     PrecompositionState::Commands *command) const {
+  NormalizedKey key;
+  if (!key.Init(key_event)) {
+    return false;
+  }
   // try zero query suggestion rule first
-  if (keymap_zero_query_suggestion_.GetCommand(key_event, command)) {
+  if (keymap_zero_query_suggestion_.GetCommand(key, command)) {
     return true;
   }
   // use precomposition rule
-  return keymap_precomposition_.GetCommand(key_event, command);
+  return keymap_precomposition_.GetCommand(key, command);
 }
 
 bool KeyMapManager::GetCommandSuggestion(
     const commands::KeyEvent &key_event,
     CompositionState::Commands *command) const {
+  NormalizedKey key;
+  if (!key.Init(key_event)) {
+    return false;
+  }
   // try suggestion rule first
-  if (keymap_suggestion_.GetCommand(key_event, command)) {
+  if (keymap_suggestion_.GetCommand(key, command)) {
     return true;
   }
   // use composition rule
-  return keymap_composition_.GetCommand(key_event, command);
+  return keymap_composition_.GetCommand(key, command);
 }
 
 bool KeyMapManager::GetCommandConversion(
@@ -712,12 +730,16 @@ bool KeyMapManager::GetCommandConversion(
 bool KeyMapManager::GetCommandPrediction(
     const commands::KeyEvent &key_event,
     ConversionState::Commands *command) const {
+  NormalizedKey key;
+  if (!key.Init(key_event)) {
+    return false;
+  }
   // try prediction rule first
-  if (keymap_prediction_.GetCommand(key_event, command)) {
+  if (keymap_prediction_.GetCommand(key, command)) {
     return true;
   }
   // use conversion rule
-  return keymap_conversion_.GetCommand(key_event, command);
+  return keymap_conversion_.GetCommand(key, command);
 }
 
 bool KeyMapManager::ParseCommandDirect(
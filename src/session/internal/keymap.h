@@ -198,6 +198,18 @@ struct ConversionState {
   };
 };
 
+// The keys of a key event to look up the keymaps with. They are computed once
+// per key event and shared by the keymaps tried in turn.
+struct NormalizedKey {
+  // Returns false if |key_event| cannot be bound to any command.
+  bool Init(const commands::KeyEvent &key_event);
+
+  KeyInformation key = 0;
+  // The fallback key, e.g. "TextInput" for a printable key.
+  bool has_stub = false;
+  KeyInformation stub = 0;
+};
+
 template <typename T>
 class KeyMap {
  public:
@@ -205,10 +217,16 @@ class KeyMap {
 
   bool GetCommand(const commands::KeyEvent &key_event,
                   CommandsType *command) const;
+  // Same as above for a key event already normalized into |key|.
+  bool GetCommand(const NormalizedKey &key, CommandsType *command) const;
   bool AddRule(const commands::KeyEvent &key_event, CommandsType command);
   void Clear();
 
  private:
+  friend class KeyMapTest;
+
+  bool Find(KeyInformation key, CommandsType *command) const;
+
   using KeyToCommandMap = absl::flat_hash_map<KeyInformation, CommandsType>;
   KeyToCommandMap keymap_;
 };
@@ -289,6 +307,8 @@ class KeyMapManager {
   FRIEND_TEST(KeyMapTest, AddCommand);
   FRIEND_TEST(KeyMapTest, ZeroQuerySuggestion);
   FRIEND_TEST(KeyMapTest, IsReloadConfigRequired);
+  FRIEND_TEST(KeyMapTest, NormalizedKeyMatchesCopiedKeyEvent);
+  FRIEND_TEST(KeyMapTest, LookupBenchmark);
 
   void Reset();
   void InitCommandData();
@@ -373,28 +393,22 @@ class KeyMapManager {
 template <typename T>
 bool KeyMap<T>::GetCommand(const commands::KeyEvent &key_event,
                            CommandsType *command) const {
-  // Shortcut keys should be available as if CapsLock was not enabled like
-  // other IMEs such as MS-IME or ATOK. b/5627459
-  commands::KeyEvent normalized_key_event;
-  KeyEventUtil::NormalizeModifiers(key_event, &normalized_key_event);
-  KeyInformation key;
-  if (!KeyEventUtil::GetKeyInformation(normalized_key_event, &key)) {
-    return false;
-  }
+  NormalizedKey key;
+  return key.Init(key_event) && GetCommand(key, command);
+}
 
+template <typename T>
+bool KeyMap<T>::GetCommand(const NormalizedKey &key,
+                           CommandsType *command) const {
+  return Find(key.key, command) || (key.has_stub && Find(key.stub, command));
+}
+
+template <typename T>
+bool KeyMap<T>::Find(KeyInformation key, CommandsType *command) const {
   if (const auto it = keymap_.find(key); it != keymap_.end()) {
     *command = it->second;
     return true;
   }
-
-  if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key)) {
-    const auto it = keymap_.find(key);
-    if (it != keymap_.end()) {
-      *command = it->second;
-      return true;
-    }
-  }
-
   return false;
 }
 
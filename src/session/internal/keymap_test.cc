@@ -35,13 +35,19 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/log/log.h"
+#include "absl/time/time.h"
 #include "base/config_file_stream.h"
+#include "base/stopwatch.h"
+#include "composer/key_event_util.h"
 #include "composer/key_parser.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/random_keyevents_generator.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 
@@ -60,6 +66,51 @@ class KeyMapTest : public testing::TestWithTempUserProfile {
   bool isInputModeXCommandSupported() const {
     return KeyMapManager::kInputModeXCommandSupported;
   }
+
+  // Looks up |keymap| in the way before NormalizedKey was introduced, which
+  // copies the key event to normalize it.
+  template <typename T>
+  static bool GetCommandByCopy(const KeyMap<T> &keymap,
+                               const commands::KeyEvent &key_event,
+                               typename T::Commands *command) {
+    commands::KeyEvent normalized_key_event;
+    KeyEventUtil::NormalizeModifiers(key_event, &normalized_key_event);
+    KeyInformation key;
+    if (!KeyEventUtil::GetKeyInformation(normalized_key_event, &key)) {
+      return false;
+    }
+    if (const auto it = keymap.keymap_.find(key); it != keymap.keymap_.end()) {
+      *command = it->second;
+      return true;
+    }
+    if (KeyEventUtil::MaybeGetKeyStub(normalized_key_event, &key)) {
+      if (const auto it = keymap.keymap_.find(key);
+          it != keymap.keymap_.end()) {
+        *command = it->second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Key events typed in a session, with some shortcut keys.
+  static std::vector<commands::KeyEvent> GenerateKeyEvents(int num_sequences) {
+    session::RandomKeyEventsGenerator generator;
+    std::vector<commands::KeyEvent> key_events, sequence;
+    for (int i = 0; i < num_sequences; ++i) {
+      generator.GenerateSequence(&sequence);
+      key_events.insert(key_events.end(), sequence.begin(), sequence.end());
+    }
+    for (const char *key :
+         {"Ctrl a", "Ctrl Shift a", "Alt a", "Shift Space", "Ctrl Backspace",
+          "Henkan", "Muhenkan", "Hankaku/Zenkaku", "F6", "Shift Left",
+          "Ctrl Right", "Caps a", "Caps Ctrl a", "LeftShift Enter"}) {
+      commands::KeyEvent key_event;
+      EXPECT_TRUE(KeyParser::ParseKey(key, &key_event)) << key;
+      key_events.push_back(std::move(key_event));
+    }
+    return key_events;
+  }
 };
 
 TEST_F(KeyMapTest, AddRule) {
@@ -748,5 +799,84 @@ TEST_F(KeyMapTest, IsSameKeyMapManagerApplicable) {
   }
 }
 
+TEST_F(KeyMapTest, NormalizedKeyMatchesCopiedKeyEvent) {
+  const std::vector<commands::KeyEvent> key_events = GenerateKeyEvents(10);
+  for (const config::Config::SessionKeymap keymap :
+       {config::Config::MSIME, config::Config::KOTOERI, config::Config::ATOK,
+        config::Config::MOBILE, config::Config::CHROMEOS}) {
+    const KeyMapManager manager(GetDefaultConfig(keymap));
+    for (const commands::KeyEvent &key_event : key_events) {
+      CompositionState::Commands expected_composition, actual_composition;
+      const bool found = GetCommandByCopy(manager.keymap_composition_,
+                                          key_event, &expected_composition);
+      EXPECT_EQ(manager.GetCommandComposition(key_event, &actual_composition),
+                found);
+      if (found) {
+        EXPECT_EQ(actual_composition, expected_composition);
+      }
+
+      CompositionState::Commands expected_suggestion, actual_suggestion;
+      const bool found_suggestion =
+          GetCommandByCopy(manager.keymap_suggestion_, key_event,
+                           &expected_suggestion) ||
+          GetCommandByCopy(manager.keymap_composition_, key_event,
+                           &expected_suggestion);
+      EXPECT_EQ(manager.GetCommandSuggestion(key_event, &actual_suggestion),
+                found_suggestion);
+      if (found_suggestion) {
+        EXPECT_EQ(actual_suggestion, expected_suggestion);
+      }
+
+      ConversionState::Commands expected_prediction, actual_prediction;
+      const bool found_prediction =
+          GetCommandByCopy(manager.keymap_prediction_, key_event,
+                           &expected_prediction) ||
+          GetCommandByCopy(manager.keymap_conversion_, key_event,
+                           &expected_prediction);
+      EXPECT_EQ(manager.GetCommandPrediction(key_event, &actual_prediction),
+                found_prediction);
+      if (found_prediction) {
+        EXPECT_EQ(actual_prediction, expected_prediction);
+      }
+    }
+  }
+}
+
+// Compares the lookup paths. There is no benchmark framework, so the timings
+// are only logged. Run with --gtest_also_run_disabled_tests.
+TEST_F(KeyMapTest, DISABLED_LookupBenchmark) {
+  constexpr int kNumRounds = 20;
+  const std::vector<commands::KeyEvent> key_events = GenerateKeyEvents(100);
+  const KeyMapManager manager(GetDefaultConfig(config::Config::MSIME));
+  const KeyMap<CompositionState> &keymap = manager.keymap_composition_;
+  const int num_lookups = kNumRounds * key_events.size();
+
+  int found_by_copy = 0;
+  Stopwatch stopwatch = Stopwatch::StartNew();
+  for (int i = 0; i < kNumRounds; ++i) {
+    for (const commands::KeyEvent &key_event : key_events) {
+      CompositionState::Commands command;
+      found_by_copy += GetCommandByCopy(keymap, key_event, &command);
+    }
+  }
+  const absl::Duration copy_time = stopwatch.GetElapsed();
+
+  int found = 0;
+  stopwatch.Reset();
+  stopwatch.Start();
+  for (int i = 0; i < kNumRounds; ++i) {
+    for (const commands::KeyEvent &key_event : key_events) {
+      CompositionState::Commands command;
+      found += keymap.GetCommand(key_event, &command);
+    }
+  }
+  const absl::Duration time = stopwatch.GetElapsed();
+
+  LOG(INFO) << num_lookups
+            << " key events, copied key event: " << copy_time / num_lookups
+            << ", normalized key: " << time / num_lookups;
+  EXPECT_EQ(found, found_by_copy);
+}
+
 }  // namespace keymap
 }  // namespace mozc
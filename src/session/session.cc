@@ -194,6 +194,22 @@ commands::CompositionMode ToCompositionMode(
   return mode;
 }
 
+transliteration::TransliterationType ToTransliterationType(
+    const commands::CompositionMode mode) {
+  switch (mode) {
+    case commands::FULL_KATAKANA:
+      return transliteration::FULL_KATAKANA;
+    case commands::HALF_KATAKANA:
+      return transliteration::HALF_KATAKANA;
+    case commands::FULL_ASCII:
+      return transliteration::FULL_ASCII;
+    case commands::HALF_ASCII:
+      return transliteration::HALF_ASCII;
+    default:
+      return transliteration::HIRAGANA;
+  }
+}
+
 ImeContext::State GetEffectiveStateForTestSendKey(const commands::KeyEvent &key,
                                                   ImeContext::State state) {
   if (!key.has_activated()) {
@@ -1483,6 +1499,45 @@ absl::Time Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+bool Session::IsCompactable() const {
+  return (context_->state() == ImeContext::PRECOMPOSITION ||
+          context_->state() == ImeContext::DIRECT) &&
+         context_->composer().Empty();
+}
+
+void Session::SaveCompactState(protocol::CompactSessionState *state) const {
+  DCHECK(IsCompactable());
+  state->set_create_time(absl::ToUnixMicros(context_->create_time()));
+  if (context_->last_command_time() != absl::InfinitePast()) {
+    state->set_last_command_time(
+        absl::ToUnixMicros(context_->last_command_time()));
+  }
+  state->set_direct(context_->state() == ImeContext::DIRECT);
+  state->set_input_mode(ToCompositionMode(context_->composer().GetInputMode()));
+  state->set_comeback_input_mode(
+      ToCompositionMode(context_->composer().GetComebackInputMode()));
+  *state->mutable_capability() = context_->client_capability();
+  *state->mutable_application_info() = context_->application_info();
+}
+
+void Session::RestoreCompactState(const protocol::CompactSessionState &state) {
+  context_->set_create_time(absl::FromUnixMicros(state.create_time()));
+  context_->set_last_command_time(
+      state.has_last_command_time()
+          ? absl::FromUnixMicros(state.last_command_time())
+          : absl::InfinitePast());
+  SetSessionState(state.direct() ? ImeContext::DIRECT
+                                 : ImeContext::PRECOMPOSITION,
+                  context_.get());
+  composer::Composer *composer = context_->mutable_composer();
+  composer->SetInputMode(ToTransliterationType(state.comeback_input_mode()));
+  if (state.input_mode() != state.comeback_input_mode()) {
+    composer->SetTemporaryInputMode(ToTransliterationType(state.input_mode()));
+  }
+  *context_->mutable_client_capability() = state.capability();
+  *context_->mutable_application_info() = state.application_info();
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << command->input();
@@ -52,6 +52,7 @@
         '<(mozc_oss_src_dir)/dictionary/dictionary_base.gyp:pos_matcher',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
+        '<(mozc_oss_src_dir)/protocol/protocol.gyp:state_proto',
         '<(mozc_oss_src_dir)/request/request.gyp:conversion_request',
         '<(mozc_oss_src_dir)/transliteration/transliteration.gyp:transliteration',
         '<(mozc_oss_src_dir)/usage_stats/usage_stats_base.gyp:usage_stats',
@@ -110,6 +111,7 @@
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:config_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:engine_builder_proto',
+        '<(mozc_oss_src_dir)/protocol/protocol.gyp:state_proto',
         '<(mozc_oss_src_dir)/protocol/protocol.gyp:user_dictionary_storage_proto',
         '<(mozc_oss_src_dir)/usage_stats/usage_stats_base.gyp:usage_stats',
         ':session_watch_dog',
@@ -123,6 +125,17 @@
         }],
       ],
     },
+    {
+      'target_name': 'session_handler_pool',
+      'type': 'static_library',
+      'sources': [
+        'session_handler_pool.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/base.gyp:base',
+        '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
+      ],
+    },
     {
       'target_name': 'session_handler_tool',
       'type': 'static_library',
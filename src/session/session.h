@@ -43,6 +43,7 @@
 #include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "protocol/state.pb.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
 #include "session/session_interface.h"
@@ -267,6 +268,16 @@ class Session : public SessionInterface {
 
   const ImeContext &context() const;
 
+  // Returns true if the session has neither composition nor conversion, so
+  // that it can be compacted by SaveCompactState() without losing any state
+  // visible to the user.
+  bool IsCompactable() const;
+
+  // Saves and restores the state kept while the session is compacted. Undo
+  // contexts, conversion history and the last output are not kept.
+  void SaveCompactState(mozc::protocol::CompactSessionState *state) const;
+  void RestoreCompactState(const mozc::protocol::CompactSessionState &state);
+
  private:
   FRIEND_TEST(SessionTest, OutputInitialComposition);
   FRIEND_TEST(SessionTest, IsFullWidthInsertSpace);
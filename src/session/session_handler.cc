@@ -37,14 +37,17 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/random/random.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "base/clock.h"
+#include "base/startup_profiler.h"
 #include "base/stopwatch.h"
 #include "base/version.h"
 #include "base/vlog.h"
@@ -58,6 +61,7 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "protocol/engine_builder.pb.h"
+#include "protocol/state.pb.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "session/common.h"
 #include "session/internal/keymap.h"
@@ -84,6 +88,11 @@ ABSL_FLAG(int32_t, max_session_size, 64,
           "if size of sessions reaches to \"max_session_size\", "
           "oldest session is removed");
 
+// TODO(b/275437228): Convert this to `absl::Duration`.
+ABSL_FLAG(int32_t, compact_session_timeout, 0,
+          "compact a session without composition if it is not accessed for "
+          "\"compact_session_timeout\" sec. 0 disables compaction");
+
 // TODO(b/275437228): Convert this to `absl::Duration`.
 ABSL_FLAG(int32_t, create_session_min_interval, 0,
           "minimum interval (sec) for create session");
@@ -109,9 +118,17 @@ namespace {
 
 using mozc::usage_stats::UsageStats;
 
-bool IsApplicationAlive(const session::Session *session) {
+// Romaji typed by SessionHandler::WarmUp(). "kyouhaiitenki" is converted
+// to multiple segments so that the whole conversion path is exercised.
+constexpr absl::string_view kWarmUpKeys = "kyouhaiitenki";
+
+// Sessions are allowed up to this size so that a server can be shared by many
+// clients. Idle sessions should be compacted with --compact_session_timeout
+// for such a size.
+constexpr int32_t kMaxSessionSize = 8192;
+
+bool IsApplicationAlive(const commands::ApplicationInfo &info) {
 #ifndef MOZC_DISABLE_SESSION_WATCHDOG
-  const commands::ApplicationInfo &info = session->application_info();
   // When the thread/process's current status is unknown, i.e.,
   // if IsThreadAlive/IsProcessAlive functions failed to know the
   // status of the thread/process, return true just in case.
@@ -145,7 +162,7 @@ SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine)
       std::make_unique<user_dictionary::UserDictionarySessionHandler>();
   table_manager_ = std::make_unique<composer::TableManager>();
   request_ = std::make_unique<commands::Request>();
-  config_ = config::ConfigHandler::GetConfig();
+  config_ = config::ConfigHandler::GetSharedConfig();
   key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
 
   if (absl::GetFlag(FLAGS_restricted)) {
@@ -162,8 +179,9 @@ SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine)
     absl::SetFlag(&FLAGS_last_command_timeout, 60);
   }
 
-  // Allow [2..128] sessions.
-  max_session_size_ = std::clamp(absl::GetFlag(FLAGS_max_session_size), 2, 128);
+  // Allow [2..kMaxSessionSize] sessions.
+  max_session_size_ =
+      std::clamp(absl::GetFlag(FLAGS_max_session_size), 2, kMaxSessionSize);
   session_map_ = std::make_unique<SessionMap>(max_session_size_);
 
   if (!engine_) {
@@ -186,40 +204,79 @@ void SessionHandler::StartWatchDog() {
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
 }
 
-void SessionHandler::UpdateSessions(const config::Config &config,
-                                    const commands::Request &request) {
+void SessionHandler::WarmUp() {
+  if (!is_available_) {
+    return;
+  }
+  StartupProfiler::ScopedPhase phase("SessionHandler::WarmUp");
+
+  // The pages of the system dictionary and the connector are already
+  // prefetched by DataManager with MADV_WILLNEED, so they aren't touched here.
+  std::unique_ptr<session::Session> session = NewSession();
+  InitSession(session.get());
+
+  commands::Command command;
+  session->IMEOn(&command);
+  for (const char c : kWarmUpKeys) {
+    command.Clear();
+    command.mutable_input()->mutable_key()->set_key_code(c);
+    session->SendKey(&command);
+  }
+  command.Clear();
+  session->Convert(&command);
+  // The session is discarded without commit.
+}
+
+void SessionHandler::UpdateSessions(
+    std::shared_ptr<const config::Config> config,
+    const commands::Request &request) {
   // Since sessions internally use config_, request_ and key_map_manager_,
   // they are moved to prev_ variables to avoid releasing until sessions switch
   // those values.
-  std::unique_ptr<const config::Config> prev_config = std::move(config_);
-  std::unique_ptr<const commands::Request> prev_request = std::move(request_);
+  std::shared_ptr<const config::Config> prev_config = std::move(config_);
+  std::unique_ptr<const commands::Request> prev_request;
   std::unique_ptr<keymap::KeyMapManager> prev_key_map_manager;
 
-  config_ = std::make_unique<config::Config>(config);
-  request_ = std::make_unique<commands::Request>(request);
+  // Config snapshots are immutable, so the same snapshot means nothing
+  // derived from it needs to be rebuilt.
+  config_ = std::move(config);
+  const bool config_changed = (config_ != prev_config);
+  if (&request != request_.get()) {
+    prev_request = std::move(request_);
+    request_ = std::make_unique<commands::Request>(request);
+  }
   const composer::Table *table = nullptr;
   table = table_manager_->GetTable(*request_, *config_);
 
-  if (!keymap::KeyMapManager::IsSameKeyMapManagerApplicable(*prev_config,
-                                                            *config_)) {
+  if (config_changed && !keymap::KeyMapManager::IsSameKeyMapManagerApplicable(
+                            *prev_config, *config_)) {
     prev_key_map_manager = std::move(key_map_manager_);
     key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
   }
 
   for (SessionElement &element : *session_map_) {
-    std::unique_ptr<session::Session> &session = element.value;
+    std::unique_ptr<session::Session> &session = element.value.session;
     if (!session) {
       continue;
     }
-    session->SetConfig(config_.get());
+    // Setting the config reloads the per-session key event transformer and
+    // composer settings, so it is skipped if the session already uses the
+    // snapshot.
+    if (&session->context().GetConfig() != config_.get()) {
+      session->SetConfig(config_.get());
+    }
     session->SetKeyMapManager(key_map_manager_.get());
-    session->SetRequest(request_.get());
+    if (&session->context().GetRequest() != request_.get()) {
+      session->SetRequest(request_.get());
+    }
     if (table != nullptr) {
       session->SetTable(table);
     }
   }
-  config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
-      *config_);
+  if (config_changed) {
+    config::CharacterFormManager::GetCharacterFormManager()->ReloadConfig(
+        *config_);
+  }
 }
 
 bool SessionHandler::SyncData(commands::Command *command) {
@@ -239,14 +296,14 @@ bool SessionHandler::Shutdown(commands::Command *command) {
 
 bool SessionHandler::Reload(commands::Command *command) {
   MOZC_VLOG(1) << "Reloading server";
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), *request_);
   engine_->Reload();
   return true;
 }
 
 bool SessionHandler::ReloadAndWait(commands::Command *command) {
   MOZC_VLOG(1) << "Reloading server and wait for reloader";
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), *request_);
   engine_->ReloadAndWait();
   return true;
 }
@@ -274,10 +331,12 @@ bool SessionHandler::ClearUnusedUserPrediction(commands::Command *command) {
 
 bool SessionHandler::GetConfig(commands::Command *command) {
   MOZC_VLOG(1) << "Getting config";
-  config::ConfigHandler::GetConfig(command->mutable_output()->mutable_config());
+  std::shared_ptr<const config::Config> config =
+      config::ConfigHandler::GetSharedConfig();
+  *command->mutable_output()->mutable_config() = *config;
   // Ensure the on-memory config is same as the locally stored one
   // because the local data could be changed by sync.
-  UpdateSessions(command->output().config(), *request_);
+  UpdateSessions(std::move(config), *request_);
   return true;
 }
 
@@ -301,7 +360,7 @@ bool SessionHandler::SetRequest(commands::Command *command) {
     LOG(WARNING) << "request is empty";
     return false;
   }
-  UpdateSessions(*config_, command->input().request());
+  UpdateSessions(config_, command->input().request());
   return true;
 }
 
@@ -382,6 +441,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::GET_SERVER_VERSION:
       eval_succeeded = GetServerVersion(command);
       break;
+    case commands::Input::GET_STARTUP_PROFILE:
+      eval_succeeded = GetStartupProfile(command);
+      break;
     default:
       eval_succeeded = false;
   }
@@ -432,35 +494,35 @@ void SessionHandler::MaybeUpdateConfig(commands::Command *command) {
 
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendKey(command);
+  session->SendKey(command);
   MaybeUpdateConfig(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  session::Session *session = GetSession(id);
+  if (session == nullptr) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
-  (*session)->SendCommand(command);
+  session->SendCommand(command);
   MaybeUpdateConfig(command);
   return true;
 }
@@ -491,6 +553,17 @@ bool SessionHandler::GetServerVersion(mozc::commands::Command *command) const {
   return true;
 }
 
+bool SessionHandler::GetStartupProfile(commands::Command *command) const {
+  for (const StartupProfiler::Phase &phase : StartupProfiler::GetPhases()) {
+    commands::Output::StartupPhase *startup_phase =
+        command->mutable_output()->add_startup_phases();
+    startup_phase->set_name(phase.name);
+    startup_phase->set_duration_microsec(
+        absl::ToInt64Microseconds(phase.duration));
+  }
+  return true;
+}
+
 bool SessionHandler::CreateSession(commands::Command *command) {
   // prevent DOS attack
   // don't allow CreateSession in very short period.
@@ -519,7 +592,7 @@ bool SessionHandler::CreateSession(commands::Command *command) {
       return false;
     }
 
-    oldest_element->value.reset();
+    oldest_element->value = SessionEntry();
     session_map_->Erase(oldest_element->key);
     MOZC_VLOG(1) << "Session is FULL, oldest SessionID " << oldest_element->key
                  << " is removed";
@@ -544,14 +617,15 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   const SessionID new_id = CreateNewSessionID();
   SessionElement *element = session_map_->Insert(new_id);
-  element->value = std::move(session);
+  element->value.session = std::move(session);
+  element->value.last_access_time = current_time;
   command->mutable_output()->set_id(new_id);
 
   // The created session has not been fully initialized yet.
   // SetConfig() will complete the initialization by setting information
   // (e.g., config, request, keymap, ...) to all the sessions,
   // including the newly created one.
-  UpdateSessions(*config::ConfigHandler::GetConfig(), *request_);
+  UpdateSessions(config::ConfigHandler::GetSharedConfig(), *request_);
 
   // session is not empty.
   last_session_empty_time_ = absl::InfinitePast();
@@ -605,24 +679,73 @@ bool SessionHandler::Cleanup(commands::Command *command) {
           std::min(absl::Seconds(absl::GetFlag(FLAGS_last_command_timeout)),
                    absl::Seconds(7200)));
 
+  // allow [0..7200] sec. default 0 (disabled)
+  const absl::Duration compact_session_timeout =
+      suspend_time +
+      std::clamp(absl::Seconds(absl::GetFlag(FLAGS_compact_session_timeout)),
+                 absl::ZeroDuration(), absl::Seconds(7200));
+  const bool compaction_enabled =
+      absl::GetFlag(FLAGS_compact_session_timeout) > 0;
+
+  // By default, every session is checked so that the sessions of exited
+  // applications are removed at the next cleanup. With compaction, which is
+  // meant for large session tables, only the sessions which have not been
+  // accessed for the shortest timeout are checked from the tail of the LRU
+  // list, which is ordered by the last access. This keeps the cost
+  // proportional to the number of idle sessions rather than all the sessions,
+  // but a session of an exited application stays until it is idle for that
+  // timeout.
+  absl::Duration min_idle_time = absl::ZeroDuration();
+  if (compaction_enabled) {
+    min_idle_time = std::min(
+        {create_session_timeout, last_command_timeout, compact_session_timeout});
+  }
+
   std::vector<SessionID> remove_ids;
-  for (const SessionElement &element : *session_map_) {
-    const session::Session *session = element.value.get();
-    if (!IsApplicationAlive(session)) {
-      MOZC_VLOG(2) << "Application is not alive. Removing: " << element.key;
-      remove_ids.push_back(element.key);
-    } else if (session->last_command_time() == absl::InfinitePast()) {
+  for (SessionElement *element = session_map_->MutableTail();
+       element != nullptr; element = element->prev) {
+    SessionEntry &entry = element->value;
+    const absl::Duration idle_time = current_time - entry.last_access_time;
+    if (idle_time < min_idle_time) {
+      break;
+    }
+
+    const session::Session *session = entry.session.get();
+    const commands::ApplicationInfo &application_info =
+        session ? session->application_info() : entry.application_info;
+    const absl::Time create_time =
+        session ? session->create_session_time() : entry.create_time;
+    const absl::Time last_command_time =
+        session ? session->last_command_time() : entry.last_command_time;
+
+    if (!IsApplicationAlive(application_info)) {
+      MOZC_VLOG(2) << "Application is not alive. Removing: " << element->key;
+      remove_ids.push_back(element->key);
+      continue;
+    } else if (last_command_time == absl::InfinitePast()) {
       // no command is executed
-      if ((current_time - session->create_session_time()) >=
-          create_session_timeout) {
-        remove_ids.push_back(element.key);
+      if ((current_time - create_time) >= create_session_timeout) {
+        remove_ids.push_back(element->key);
+        continue;
       }
     } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          last_command_timeout) {
-        remove_ids.push_back(element.key);
+      if ((current_time - last_command_time) >= last_command_timeout) {
+        remove_ids.push_back(element->key);
+        continue;
       }
     }
+
+    if (session != nullptr && compaction_enabled &&
+        idle_time >= compact_session_timeout && session->IsCompactable()) {
+      protocol::CompactSessionState compact_state;
+      session->SaveCompactState(&compact_state);
+      compact_state.SerializeToString(&entry.compact_state);
+      entry.application_info = session->application_info();
+      entry.create_time = create_time;
+      entry.last_command_time = last_command_time;
+      entry.session.reset();
+      MOZC_VLOG(2) << "Session is compacted: " << element->key;
+    }
   }
 
   for (size_t i = 0; i < remove_ids.size(); ++i) {
@@ -700,6 +823,43 @@ bool SessionHandler::ReloadSupplementalModel(commands::Command *command) {
   return true;
 }
 
+session::Session *SessionHandler::GetSession(SessionID id) {
+  SessionEntry *entry = session_map_->MutableLookup(id);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  entry->last_access_time = Clock::GetAbslTime();
+  if (entry->session || entry->compact_state.empty()) {
+    return entry->session.get();
+  }
+
+  protocol::CompactSessionState compact_state;
+  if (!compact_state.ParseFromString(entry->compact_state)) {
+    LOG(ERROR) << "Broken compact session: " << id;
+    return nullptr;
+  }
+  entry->session = NewSession();
+  entry->session->RestoreCompactState(compact_state);
+  InitSession(entry->session.get());
+  entry->compact_state = std::string();
+  entry->application_info.Clear();
+  entry->create_time = absl::InfinitePast();
+  entry->last_command_time = absl::InfinitePast();
+  MOZC_VLOG(2) << "Session is restored: " << id;
+  return entry->session.get();
+}
+
+void SessionHandler::InitSession(session::Session *session) {
+  session->SetConfig(config_.get());
+  session->SetKeyMapManager(key_map_manager_.get());
+  session->SetRequest(request_.get());
+  if (const composer::Table *table =
+          table_manager_->GetTable(*request_, *config_);
+      table != nullptr) {
+    session->SetTable(table);
+  }
+}
+
 // Create Random Session ID in order to make the session id unpredictable
 SessionID SessionHandler::CreateNewSessionID() {
   while (true) {
@@ -716,12 +876,12 @@ SessionID SessionHandler::CreateNewSessionID() {
 }
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
-  std::unique_ptr<session::Session> *session = session_map_->MutableLookup(id);
-  if (session == nullptr || !*session) {
+  SessionEntry *entry = session_map_->MutableLookup(id);
+  if (entry == nullptr || (!entry->session && entry->compact_state.empty())) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
-  session->reset();
+  *entry = SessionEntry();
 
   session_map_->Erase(id);  // remove from LRU
 
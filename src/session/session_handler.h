@@ -35,6 +35,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 
 #include "absl/random/random.h"
 #include "absl/strings/string_view.h"
@@ -75,6 +76,10 @@ class SessionHandler : public SessionHandlerInterface {
   // Starts watch dog timer to cleanup sessions.
   void StartWatchDog() override;
 
+  // Converts a short key in a throwaway session. Nothing is committed, so no
+  // user history is learned.
+  void WarmUp() override;
+
   // NewSession returns new Session.
   std::unique_ptr<session::Session> NewSession();
 
@@ -90,11 +95,33 @@ class SessionHandler : public SessionHandlerInterface {
   FRIEND_TEST(SessionHandlerTest, EngineUpdateSuccessfulScenarioTest);
   FRIEND_TEST(SessionHandlerTest, EngineRollbackDataTest);
   FRIEND_TEST(SessionHandlerTest, CheckSpellingTest);
-
-  using SessionMap =
-      mozc::storage::LruCache<SessionID, std::unique_ptr<session::Session>>;
+  FRIEND_TEST(SessionHandlerTest, CompactIdleSessionTest);
+
+  // An idle session is compacted into |compact_state| to bound the memory
+  // used by sessions which are not in use. |session| is null while the session
+  // is compacted.
+  struct SessionEntry {
+    std::unique_ptr<session::Session> session;
+    // Serialized protocol::CompactSessionState.
+    std::string compact_state;
+    absl::Time last_access_time = absl::InfinitePast();
+    // Copied from the session when it is compacted, so that Cleanup() checks
+    // the expiry without parsing |compact_state|.
+    commands::ApplicationInfo application_info;
+    absl::Time create_time = absl::InfinitePast();
+    absl::Time last_command_time = absl::InfinitePast();
+  };
+  using SessionMap = mozc::storage::LruCache<SessionID, SessionEntry>;
   using SessionElement = SessionMap::Element;
 
+  // Returns the session for |id|, restoring it if it is compacted, or nullptr
+  // if there is no such session. The session is moved to the head of the LRU
+  // list.
+  session::Session *GetSession(SessionID id);
+
+  // Sets the current config, request, keymap and table to |session|.
+  void InitSession(session::Session *session);
+
   // Updates the config, if the |command| contains the config.
   void MaybeUpdateConfig(commands::Command *command);
 
@@ -121,8 +148,10 @@ class SessionHandler : public SessionHandlerInterface {
   // Sets the given config, request, and derivative information
   // to all the sessions.
   // Then updates config_ and request_.
+  // Derived data (keymap, character forms, per-session settings) is rebuilt
+  // only if |config| is a different snapshot from config_.
   // This method doesn't reload the sessions.
-  void UpdateSessions(const config::Config &config,
+  void UpdateSessions(std::shared_ptr<const config::Config> config,
                       const commands::Request &request);
 
   bool Cleanup(commands::Command *command);
@@ -132,6 +161,7 @@ class SessionHandler : public SessionHandlerInterface {
   bool CheckSpelling(commands::Command *command);
   bool ReloadSupplementalModel(commands::Command *command);
   bool GetServerVersion(commands::Command *command) const;
+  bool GetStartupProfile(commands::Command *command) const;
 
   // Replaces engine_ with a new instance if it is ready.
   void MaybeReloadEngine(commands::Command *command);
@@ -155,7 +185,7 @@ class SessionHandler : public SessionHandlerInterface {
       user_dictionary_session_handler_;
   std::unique_ptr<composer::TableManager> table_manager_;
   std::unique_ptr<const commands::Request> request_;
-  std::unique_ptr<const config::Config> config_;
+  std::shared_ptr<const config::Config> config_;
   std::unique_ptr<keymap::KeyMapManager> key_map_manager_;
   std::unique_ptr<engine::SupplementalModelInterface> supplemental_model_;
 
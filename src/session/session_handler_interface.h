@@ -55,6 +55,10 @@ class SessionHandlerInterface {
   // Starts watch dog timer to cleanup sessions.
   virtual void StartWatchDog() = 0;
 
+  // Runs a synthetic conversion so that the first real request doesn't pay
+  // for page faults and lazy initialization.
+  virtual void WarmUp() {}
+
   virtual void AddObserver(session::SessionObserverInterface *observer) = 0;
 
   virtual absl::string_view GetDataVersion() const = 0;
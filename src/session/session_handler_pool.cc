@@ -0,0 +1,256 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_handler_pool.h"
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "base/thread.h"
+#include "base/vlog.h"
+#include "protocol/commands.pb.h"
+#include "session/common.h"
+#include "session/session_handler_interface.h"
+
+namespace mozc {
+namespace {
+
+// Commands which write the user history. Only the first handler owns it.
+bool IsUserHistoryCommand(commands::Input::CommandType type) {
+  switch (type) {
+    case commands::Input::SYNC_DATA:
+    case commands::Input::CLEAR_USER_HISTORY:
+    case commands::Input::CLEAR_USER_PREDICTION:
+    case commands::Input::CLEAR_UNUSED_USER_PREDICTION:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Commands which change the state shared by all the sessions of a handler.
+bool IsHandlerWideCommand(commands::Input::CommandType type) {
+  switch (type) {
+    case commands::Input::SET_CONFIG:
+    case commands::Input::SET_REQUEST:
+    case commands::Input::SHUTDOWN:
+    case commands::Input::RELOAD:
+    case commands::Input::RELOAD_AND_WAIT:
+    case commands::Input::CLEANUP:
+    case commands::Input::SEND_ENGINE_RELOAD_REQUEST:
+    case commands::Input::RELOAD_SPELL_CHECKER:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsSessionCommand(commands::Input::CommandType type) {
+  switch (type) {
+    case commands::Input::DELETE_SESSION:
+    case commands::Input::SEND_KEY:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+// Evaluates the commands on a handler one by one in the submitted order.
+class SessionHandlerPool::Worker {
+ public:
+  explicit Worker(std::unique_ptr<SessionHandlerInterface> handler)
+      : handler_(std::move(handler)), thread_([this] { Run(); }) {}
+
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+
+  ~Worker() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    thread_.Join();
+  }
+
+  struct Task {
+    commands::Command *command = nullptr;
+    bool result = false;
+    absl::Notification done;
+  };
+
+  // |task| must outlive the notification of task->done.
+  void Submit(Task *task) {
+    absl::MutexLock lock(&mutex_);
+    tasks_.push_back(task);
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      Task *task = nullptr;
+      {
+        absl::MutexLock lock(
+            &mutex_,
+            absl::Condition(
+                +[](Worker *w) ABSL_EXCLUSIVE_LOCKS_REQUIRED(w->mutex_) {
+                  return w->stopped_ || !w->tasks_.empty();
+                },
+                this));
+        // Submitted tasks are finished before stopping as their callers are
+        // waiting for them.
+        if (tasks_.empty()) {
+          return;
+        }
+        task = tasks_.front();
+        tasks_.pop_front();
+      }
+      task->result = handler_->EvalCommand(task->command);
+      task->done.Notify();
+    }
+  }
+
+  std::unique_ptr<SessionHandlerInterface> handler_;
+  absl::Mutex mutex_;
+  std::deque<Task *> tasks_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  Thread thread_;
+};
+
+SessionHandlerPool::SessionHandlerPool(
+    std::vector<std::unique_ptr<SessionHandlerInterface>> handlers) {
+  CHECK(!handlers.empty());
+  workers_.reserve(handlers.size());
+  for (std::unique_ptr<SessionHandlerInterface> &handler : handlers) {
+    workers_.push_back(std::make_unique<Worker>(std::move(handler)));
+  }
+}
+
+SessionHandlerPool::~SessionHandlerPool() = default;
+
+bool SessionHandlerPool::EvalCommand(commands::Command *command) {
+  const commands::Input::CommandType type = command->input().type();
+
+  if (type == commands::Input::CREATE_SESSION) {
+    const size_t index = next_worker_.fetch_add(1) % workers_.size();
+    const bool result = EvalOn(index, command);
+    const SessionID id = command->output().id();
+    if (!result || id == 0) {
+      return result;
+    }
+    absl::MutexLock lock(&mutex_);
+    // Each handler only knows its own sessions. A collision of the random IDs
+    // is very unlikely, but the older session is not reachable anymore.
+    LOG_IF(WARNING, session_workers_.contains(id))
+        << "Session ID " << id << " is used by two handlers";
+    session_workers_[id] = index;
+    return result;
+  }
+
+  if (IsHandlerWideCommand(type)) {
+    return EvalOnAll(command);
+  }
+
+  if (IsUserHistoryCommand(type) || !IsSessionCommand(type)) {
+    return EvalOn(0, command);
+  }
+
+  const SessionID id = command->input().id();
+  // Unknown sessions are handled by the first handler, which reports the
+  // error as usual.
+  const size_t index = FindWorker(id).value_or(0);
+  const bool result = EvalOn(index, command);
+  // Forgets the session if it has been deleted or evicted by the handler.
+  if (type == commands::Input::DELETE_SESSION ||
+      command->output().error_code() ==
+          commands::Output::SESSION_FAILURE) {
+    absl::MutexLock lock(&mutex_);
+    session_workers_.erase(id);
+  }
+  return result;
+}
+
+bool SessionHandlerPool::EvalOn(size_t index, commands::Command *command) {
+  Worker::Task task;
+  task.command = command;
+  workers_[index]->Submit(&task);
+  task.done.WaitForNotification();
+  return task.result;
+}
+
+bool SessionHandlerPool::EvalOnAll(commands::Command *command) {
+  // The other handlers work on copies of the input so that they run in
+  // parallel with the first one.
+  std::vector<commands::Command> copies(workers_.size() - 1);
+  std::vector<Worker::Task> tasks(workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (i == 0) {
+      tasks[i].command = command;
+    } else {
+      *copies[i - 1].mutable_input() = command->input();
+      tasks[i].command = &copies[i - 1];
+    }
+    workers_[i]->Submit(&tasks[i]);
+  }
+
+  bool result = true;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i].done.WaitForNotification();
+    if (!tasks[i].result) {
+      MOZC_VLOG(1) << "Handler " << i << " failed to evaluate "
+                   << commands::Input::CommandType_Name(
+                          command->input().type());
+      result = false;
+    }
+  }
+  return result;
+}
+
+std::optional<size_t> SessionHandlerPool::FindWorker(SessionID id) const {
+  absl::MutexLock lock(&mutex_);
+  const auto it = session_workers_.find(id);
+  if (it == session_workers_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+}  // namespace mozc
@@ -0,0 +1,118 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Evaluates commands of many clients on several SessionHandlers in parallel.
+
+#ifndef MOZC_SESSION_SESSION_HANDLER_POOL_H_
+#define MOZC_SESSION_SESSION_HANDLER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "protocol/commands.pb.h"
+#include "session/common.h"
+#include "session/session_handler_interface.h"
+
+namespace mozc {
+
+// SessionHandlerPool runs each handler on its own worker thread, so the
+// handlers don't need to be thread-safe, and handlers with independent engines
+// convert in parallel.
+//
+// A session is bound to the handler that created it. Commands of a session
+// run one at a time in the order they are submitted, and commands of sessions
+// on different handlers run in parallel. Commands which change the state of
+// a whole handler (e.g., SET_CONFIG, RELOAD and CLEANUP) run on every handler.
+// The other commands without a session run on the first handler.
+//
+// The first handler owns the user history. The commands which write it
+// (SYNC_DATA and CLEAR_*) run only on the first handler, so the engines of the
+// other handlers must not learn, e.g., they are created by
+// Engine::CreateEngineWithoutUserHistory().
+//
+// Example:
+//   std::shared_ptr<engine::Modules> modules = ...;  // Initialized.
+//   std::vector<std::unique_ptr<SessionHandlerInterface>> handlers;
+//   handlers.push_back(std::make_unique<SessionHandler>(
+//       Engine::CreateEngineWithSharedModules(modules, false).value()));
+//   for (int i = 1; i < 4; ++i) {
+//     handlers.push_back(std::make_unique<SessionHandler>(
+//         Engine::CreateEngineWithoutUserHistory(modules, false).value()));
+//   }
+//   SessionHandlerPool pool(std::move(handlers));
+//   // Can be called from any thread.
+//   pool.EvalCommand(&command);
+class SessionHandlerPool final {
+ public:
+  explicit SessionHandlerPool(
+      std::vector<std::unique_ptr<SessionHandlerInterface>> handlers);
+
+  SessionHandlerPool(const SessionHandlerPool &) = delete;
+  SessionHandlerPool &operator=(const SessionHandlerPool &) = delete;
+
+  // Finishes the submitted commands and stops the worker threads.
+  ~SessionHandlerPool();
+
+  // Evaluates |command| on the handler that owns its session, and blocks until
+  // it finishes. This method is thread-safe.
+  bool EvalCommand(commands::Command *command);
+
+  size_t size() const { return workers_.size(); }
+
+ private:
+  class Worker;
+
+  // Runs |command| on workers_[index] and waits for the result.
+  bool EvalOn(size_t index, commands::Command *command);
+
+  // Runs |command| on all the workers. The output of the first worker is
+  // returned.
+  bool EvalOnAll(commands::Command *command);
+
+  std::optional<size_t> FindWorker(SessionID id) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_ = 0;
+
+  mutable absl::Mutex mutex_;
+  // Index of the worker which owns each session.
+  absl::flat_hash_map<SessionID, size_t> session_workers_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_SESSION_HANDLER_POOL_H_
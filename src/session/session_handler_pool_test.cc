@@ -0,0 +1,378 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "session/session_handler_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "base/thread.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "engine/engine.h"
+#include "engine/modules.h"
+#include "protocol/commands.pb.h"
+#include "session/common.h"
+#include "session/session_handler.h"
+#include "session/session_handler_interface.h"
+#include "session/session_observer_interface.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+
+namespace mozc {
+namespace {
+
+// Counts the handlers running a command at the same time.
+struct Rendezvous {
+  absl::Mutex mutex;
+  int arrived ABSL_GUARDED_BY(mutex) = 0;
+};
+
+// A handler which records the key codes sent to each session. It's not
+// thread-safe, like SessionHandler.
+class FakeSessionHandler : public SessionHandlerInterface {
+ public:
+  FakeSessionHandler(SessionID first_id, Rendezvous *rendezvous, int parties)
+      : next_id_(first_id), rendezvous_(rendezvous), parties_(parties) {}
+
+  bool IsAvailable() const override { return true; }
+
+  bool EvalCommand(commands::Command *command) override {
+    const commands::Input &input = command->input();
+    commands::Output *output = command->mutable_output();
+    output->set_id(input.id());
+    switch (input.type()) {
+      case commands::Input::CREATE_SESSION:
+        output->set_id(next_id_);
+        keys_[next_id_++];
+        return true;
+      case commands::Input::DELETE_SESSION:
+        keys_.erase(input.id());
+        return true;
+      case commands::Input::SEND_KEY: {
+        const auto it = keys_.find(input.id());
+        if (it == keys_.end()) {
+          output->set_error_code(commands::Output::SESSION_FAILURE);
+          return false;
+        }
+        it->second.push_back(input.key().key_code());
+        // Pretends to convert the key for a while.
+        absl::SleepFor(absl::Microseconds(10));
+        return true;
+      }
+      case commands::Input::SEND_COMMAND:
+        WaitForOthers(output);
+        return true;
+      case commands::Input::SET_CONFIG:
+        ++config_updates_;
+        return true;
+      case commands::Input::SYNC_DATA:
+        ++syncs_;
+        return true;
+      default:
+        return true;
+    }
+  }
+
+  void StartWatchDog() override {}
+  void AddObserver(session::SessionObserverInterface *observer) override {}
+  absl::string_view GetDataVersion() const override { return ""; }
+
+  const std::vector<uint32_t> &keys(SessionID id) { return keys_[id]; }
+  int config_updates() const { return config_updates_; }
+  int syncs() const { return syncs_; }
+
+ private:
+  // Waits for the other handlers, which succeeds only when they run the
+  // command in parallel.
+  void WaitForOthers(commands::Output *output) {
+    absl::MutexLock lock(&rendezvous_->mutex);
+    ++rendezvous_->arrived;
+    const bool met = rendezvous_->mutex.AwaitWithTimeout(
+        absl::Condition(
+            +[](FakeSessionHandler *h)
+                 ABSL_EXCLUSIVE_LOCKS_REQUIRED(h->rendezvous_->mutex) {
+                   return h->rendezvous_->arrived >= h->parties_;
+                 },
+            this),
+        absl::Seconds(30));
+    output->set_error_code(met ? commands::Output::SESSION_SUCCESS
+                               : commands::Output::SESSION_FAILURE);
+  }
+
+  SessionID next_id_;
+  absl::flat_hash_map<SessionID, std::vector<uint32_t>> keys_;
+  int config_updates_ = 0;
+  int syncs_ = 0;
+  Rendezvous *rendezvous_;
+  const int parties_;
+};
+
+class SessionHandlerPoolTest : public ::testing::Test {
+ protected:
+  static constexpr int kNumHandlers = 4;
+
+  void SetUp() override {
+    std::vector<std::unique_ptr<SessionHandlerInterface>> handlers;
+    for (int i = 0; i < kNumHandlers; ++i) {
+      auto handler = std::make_unique<FakeSessionHandler>(
+          (i + 1) * 1000, &rendezvous_, kNumHandlers);
+      handlers_.push_back(handler.get());
+      handlers.push_back(std::move(handler));
+    }
+    pool_ = std::make_unique<SessionHandlerPool>(std::move(handlers));
+  }
+
+  SessionID CreateSession() {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    EXPECT_TRUE(pool_->EvalCommand(&command));
+    return command.output().id();
+  }
+
+  bool SendKey(SessionID id, uint32_t key_code) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    command.mutable_input()->set_id(id);
+    command.mutable_input()->mutable_key()->set_key_code(key_code);
+    return pool_->EvalCommand(&command);
+  }
+
+  // Returns the handler which created |id|.
+  FakeSessionHandler *HandlerOf(SessionID id) {
+    return handlers_[id / 1000 - 1];
+  }
+
+  Rendezvous rendezvous_;
+  std::vector<FakeSessionHandler *> handlers_;
+  std::unique_ptr<SessionHandlerPool> pool_;
+};
+
+TEST_F(SessionHandlerPoolTest, SessionsAreSpreadOverHandlers) {
+  EXPECT_EQ(pool_->size(), kNumHandlers);
+  std::vector<SessionID> ids;
+  for (int i = 0; i < kNumHandlers * 2; ++i) {
+    ids.push_back(CreateSession());
+  }
+  for (int i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(HandlerOf(ids[i]), handlers_[i % kNumHandlers]);
+    EXPECT_TRUE(SendKey(ids[i], 'a' + i));
+  }
+  for (int i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(HandlerOf(ids[i])->keys(ids[i]),
+              std::vector<uint32_t>({static_cast<uint32_t>('a' + i)}));
+  }
+}
+
+TEST_F(SessionHandlerPoolTest, KeepsOrderOfEachSession) {
+  constexpr int kNumClients = 8;
+  constexpr uint32_t kNumKeys = 200;
+  std::vector<SessionID> ids;
+  for (int i = 0; i < kNumClients; ++i) {
+    ids.push_back(CreateSession());
+  }
+
+  std::vector<Thread> clients;
+  for (const SessionID id : ids) {
+    clients.emplace_back([this, id] {
+      for (uint32_t key = 0; key < kNumKeys; ++key) {
+        EXPECT_TRUE(SendKey(id, key));
+      }
+    });
+  }
+  for (Thread &client : clients) {
+    client.Join();
+  }
+
+  std::vector<uint32_t> expected;
+  for (uint32_t key = 0; key < kNumKeys; ++key) {
+    expected.push_back(key);
+  }
+  for (const SessionID id : ids) {
+    EXPECT_EQ(HandlerOf(id)->keys(id), expected);
+  }
+}
+
+TEST_F(SessionHandlerPoolTest, HandlersRunInParallel) {
+  std::vector<SessionID> ids;
+  for (int i = 0; i < kNumHandlers; ++i) {
+    ids.push_back(CreateSession());
+  }
+
+  // Each client blocks its own handler until all the handlers are busy. This
+  // would time out if the commands were serialized.
+  std::vector<Thread> clients;
+  std::vector<commands::Output::ErrorCode> errors(kNumHandlers);
+  for (int i = 0; i < kNumHandlers; ++i) {
+    clients.emplace_back([&, i] {
+      commands::Command wait;
+      wait.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+      wait.mutable_input()->set_id(ids[i]);
+      pool_->EvalCommand(&wait);
+      errors[i] = wait.output().error_code();
+    });
+  }
+  for (Thread &client : clients) {
+    client.Join();
+  }
+  for (int i = 0; i < kNumHandlers; ++i) {
+    EXPECT_EQ(errors[i], commands::Output::SESSION_SUCCESS);
+  }
+}
+
+TEST_F(SessionHandlerPoolTest, BroadcastsHandlerWideCommands) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SET_CONFIG);
+  command.mutable_input()->mutable_config();
+  EXPECT_TRUE(pool_->EvalCommand(&command));
+  for (const FakeSessionHandler *handler : handlers_) {
+    EXPECT_EQ(handler->config_updates(), 1);
+  }
+}
+
+TEST_F(SessionHandlerPoolTest, SendsUserHistoryCommandsToFirstHandler) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SYNC_DATA);
+  EXPECT_TRUE(pool_->EvalCommand(&command));
+  EXPECT_EQ(handlers_[0]->syncs(), 1);
+  for (int i = 1; i < kNumHandlers; ++i) {
+    EXPECT_EQ(handlers_[i]->syncs(), 0);
+  }
+}
+
+TEST_F(SessionHandlerPoolTest, ForgetsDeletedSessions) {
+  CreateSession();
+  const SessionID id = CreateSession();
+  ASSERT_NE(HandlerOf(id), handlers_[0]);
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+  command.mutable_input()->set_id(id);
+  EXPECT_TRUE(pool_->EvalCommand(&command));
+
+  // Unknown sessions are sent to the first handler, which reports an error.
+  EXPECT_FALSE(SendKey(id, 'a'));
+}
+
+// Waits in each handler after SEND_KEY until the other handlers get there.
+class RendezvousObserver : public session::SessionObserverInterface {
+ public:
+  RendezvousObserver(Rendezvous *rendezvous, int parties)
+      : rendezvous_(rendezvous), parties_(parties) {}
+
+  void EvalCommandHandler(const commands::Command &command) override {
+    if (command.input().type() != commands::Input::SEND_KEY) {
+      return;
+    }
+    absl::MutexLock lock(&rendezvous_->mutex);
+    ++rendezvous_->arrived;
+    met_ = rendezvous_->mutex.AwaitWithTimeout(
+        absl::Condition(
+            +[](RendezvousObserver *o)
+                 ABSL_EXCLUSIVE_LOCKS_REQUIRED(o->rendezvous_->mutex) {
+                   return o->rendezvous_->arrived >= o->parties_;
+                 },
+            this),
+        absl::Seconds(30));
+  }
+
+  bool met() const { return met_; }
+
+ private:
+  Rendezvous *rendezvous_;
+  const int parties_;
+  bool met_ = false;
+};
+
+class SessionHandlerPoolEngineTest : public testing::TestWithTempUserProfile {
+};
+
+TEST_F(SessionHandlerPoolEngineTest, SessionsOnDifferentEnginesRunInParallel) {
+  constexpr int kNumHandlers = 2;
+  auto modules = std::make_shared<engine::Modules>();
+  ASSERT_OK(modules->Init(std::make_unique<testing::MockDataManager>()));
+
+  // The observers outlive the handlers in the pool.
+  Rendezvous rendezvous;
+  std::vector<std::unique_ptr<RendezvousObserver>> observers;
+  std::vector<std::unique_ptr<SessionHandlerInterface>> handlers;
+  for (int i = 0; i < kNumHandlers; ++i) {
+    // Only the first engine learns the user history.
+    absl::StatusOr<std::unique_ptr<Engine>> engine =
+        i == 0 ? Engine::CreateEngineWithSharedModules(modules,
+                                                       /*is_mobile=*/false)
+               : Engine::CreateEngineWithoutUserHistory(modules,
+                                                        /*is_mobile=*/false);
+    ASSERT_OK(engine);
+    auto handler = std::make_unique<SessionHandler>(*std::move(engine));
+    observers.push_back(
+        std::make_unique<RendezvousObserver>(&rendezvous, kNumHandlers));
+    handler->AddObserver(observers.back().get());
+    handlers.push_back(std::move(handler));
+  }
+  SessionHandlerPool pool(std::move(handlers));
+
+  std::vector<SessionID> ids;
+  for (int i = 0; i < kNumHandlers; ++i) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    ASSERT_TRUE(pool.EvalCommand(&command));
+    ids.push_back(command.output().id());
+  }
+
+  // Each handler converts a key and waits for the other one, which would time
+  // out if the sessions were evaluated one at a time.
+  std::vector<Thread> clients;
+  for (const SessionID id : ids) {
+    clients.emplace_back([&pool, id] {
+      commands::Command command;
+      command.mutable_input()->set_type(commands::Input::SEND_KEY);
+      command.mutable_input()->set_id(id);
+      command.mutable_input()->mutable_key()->set_key_code('a');
+      EXPECT_TRUE(pool.EvalCommand(&command));
+    });
+  }
+  for (Thread &client : clients) {
+    client.Join();
+  }
+  for (const std::unique_ptr<RendezvousObserver> &observer : observers) {
+    EXPECT_TRUE(observer->met());
+  }
+}
+
+}  // namespace
+}  // namespace mozc
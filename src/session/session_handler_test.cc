@@ -48,6 +48,7 @@
 #include "absl/time/time.h"
 #include "base/clock.h"
 #include "base/clock_mock.h"
+#include "base/startup_profiler.h"
 #include "composer/query.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
@@ -76,6 +77,7 @@ ABSL_DECLARE_FLAG(int32_t, max_session_size);
 ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
+ABSL_DECLARE_FLAG(int32_t, compact_session_timeout);
 
 namespace mozc {
 namespace {
@@ -387,6 +389,103 @@ TEST_F(SessionHandlerTest, LastCommandTimeoutTest) {
   Clock::SetClockForUnitTest(nullptr);
 }
 
+TEST_F(SessionHandlerTest, ManySessionsTest) {
+  // More sessions than the former limit of 128 are kept.
+  constexpr int32_t kSessionSize = 200;
+  absl::SetFlag(&FLAGS_max_session_size, kSessionSize);
+  SessionHandler handler(CreateMockDataEngine());
+
+  std::vector<uint64_t> ids;
+  for (int32_t i = 0; i < kSessionSize; ++i) {
+    uint64_t id = 0;
+    ASSERT_TRUE(CreateSession(handler, &id));
+    ids.push_back(id);
+  }
+  for (const uint64_t id : ids) {
+    EXPECT_TRUE(IsGoodSession(handler, id));
+  }
+
+  // The least recently used session is removed.
+  uint64_t id = 0;
+  EXPECT_TRUE(CreateSession(handler, &id));
+  EXPECT_FALSE(IsGoodSession(handler, ids[0]));
+  EXPECT_TRUE(IsGoodSession(handler, ids[1]));
+}
+
+TEST_F(SessionHandlerTest, CompactIdleSessionTest) {
+  constexpr int32_t kCompactTimeout = 60;  // 60 sec
+  absl::SetFlag(&FLAGS_compact_session_timeout, kCompactTimeout);
+  ClockMock clock(absl::FromUnixSeconds(1000));
+  Clock::SetClockForUnitTest(&clock);
+
+  SessionHandler handler(CreateMockDataEngine());
+
+  uint64_t idle_id = 0;
+  uint64_t composing_id = 0;
+  ASSERT_TRUE(CreateSession(handler, &idle_id));
+  ASSERT_TRUE(CreateSession(handler, &composing_id));
+  {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(idle_id);
+    input->set_type(commands::Input::SEND_COMMAND);
+    input->mutable_command()->set_type(
+        commands::SessionCommand::SWITCH_INPUT_MODE);
+    input->mutable_command()->set_composition_mode(commands::FULL_KATAKANA);
+    ASSERT_TRUE(handler.EvalCommand(&command));
+  }
+  {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(composing_id);
+    input->set_type(commands::Input::SEND_KEY);
+    input->mutable_key()->set_key_code('a');
+    ASSERT_TRUE(handler.EvalCommand(&command));
+  }
+
+  clock.Advance(absl::Seconds(kCompactTimeout));
+  EXPECT_TRUE(CleanUp(handler, idle_id));
+
+  // Only the session without composition is compacted.
+  const SessionHandler::SessionEntry *idle_entry =
+      handler.session_map_->LookupWithoutInsert(idle_id);
+  ASSERT_NE(idle_entry, nullptr);
+  EXPECT_EQ(idle_entry->session, nullptr);
+  EXPECT_FALSE(idle_entry->compact_state.empty());
+  // The expiry is checked without decoding |compact_state|.
+  EXPECT_EQ(idle_entry->last_command_time, absl::FromUnixSeconds(1000));
+  const SessionHandler::SessionEntry *composing_entry =
+      handler.session_map_->LookupWithoutInsert(composing_id);
+  ASSERT_NE(composing_entry, nullptr);
+  EXPECT_NE(composing_entry->session, nullptr);
+
+  // The compacted session is restored with its input mode.
+  {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(idle_id);
+    input->set_type(commands::Input::SEND_COMMAND);
+    input->mutable_command()->set_type(commands::SessionCommand::GET_STATUS);
+    ASSERT_TRUE(handler.EvalCommand(&command));
+    EXPECT_EQ(command.output().mode(), commands::FULL_KATAKANA);
+  }
+  EXPECT_NE(idle_entry->session, nullptr);
+  EXPECT_TRUE(idle_entry->compact_state.empty());
+  EXPECT_EQ(&idle_entry->session->context().GetConfig(),
+            handler.config_.get());
+
+  // Compacted sessions are still removed by the timeout.
+  clock.Advance(absl::Seconds(kCompactTimeout));
+  EXPECT_TRUE(CleanUp(handler, idle_id));
+  EXPECT_EQ(idle_entry->session, nullptr);
+  clock.Advance(absl::Seconds(absl::GetFlag(FLAGS_last_command_timeout)));
+  EXPECT_TRUE(CleanUp(handler, idle_id));
+  EXPECT_FALSE(handler.session_map_->HasKey(idle_id));
+  EXPECT_FALSE(handler.session_map_->HasKey(composing_id));
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 TEST_F(SessionHandlerTest, ShutdownTest) {
   SessionHandler handler(CreateMockDataEngine());
 
@@ -799,6 +898,24 @@ TEST_F(SessionHandlerTest, GetServerVersionTest) {
   EXPECT_EQ(command.output().server_version().data_version(), "24.20240101.01");
 }
 
+TEST_F(SessionHandlerTest, GetStartupProfileTest) {
+  StartupProfiler::ResetForTesting();
+  StartupProfiler::Record("Engine::Init", absl::Milliseconds(12));
+  StartupProfiler::Record("UserHistoryPredictor::Load", absl::Milliseconds(3));
+
+  SessionHandler handler(std::make_unique<MockEngine>());
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_STARTUP_PROFILE);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_EQ(command.output().startup_phases_size(), 2);
+  EXPECT_EQ(command.output().startup_phases(0).name(), "Engine::Init");
+  EXPECT_EQ(command.output().startup_phases(0).duration_microsec(), 12000);
+  EXPECT_EQ(command.output().startup_phases(1).name(),
+            "UserHistoryPredictor::Load");
+  EXPECT_EQ(command.output().startup_phases(1).duration_microsec(), 3000);
+  StartupProfiler::ResetForTesting();
+}
+
 TEST_F(SessionHandlerTest, ReloadFromMinimalEngine) {
   std::unique_ptr<Engine> engine = Engine::CreateEngine();
 
@@ -48,6 +48,7 @@ ABSL_DECLARE_FLAG(int32_t, create_session_min_interval);
 ABSL_DECLARE_FLAG(int32_t, watch_dog_interval);
 ABSL_DECLARE_FLAG(int32_t, last_command_timeout);
 ABSL_DECLARE_FLAG(int32_t, last_create_session_timeout);
+ABSL_DECLARE_FLAG(int32_t, compact_session_timeout);
 ABSL_DECLARE_FLAG(bool, restricted);
 
 namespace mozc {
@@ -110,6 +111,8 @@ void SessionHandlerTestBase::SetUp() {
       absl::GetFlag(FLAGS_last_command_timeout);
   flags_last_create_session_timeout_backup_ =
       absl::GetFlag(FLAGS_last_create_session_timeout);
+  flags_compact_session_timeout_backup_ =
+      absl::GetFlag(FLAGS_compact_session_timeout);
   flags_restricted_backup_ = absl::GetFlag(FLAGS_restricted);
 
   ConfigHandler::GetConfig(&config_backup_);
@@ -128,6 +131,8 @@ void SessionHandlerTestBase::TearDown() {
                 flags_last_command_timeout_backup_);
   absl::SetFlag(&FLAGS_last_create_session_timeout,
                 flags_last_create_session_timeout_backup_);
+  absl::SetFlag(&FLAGS_compact_session_timeout,
+                flags_compact_session_timeout_backup_);
   absl::SetFlag(&FLAGS_restricted, flags_restricted_backup_);
 }
 
@@ -36,17 +36,24 @@
 #include <memory>
 #include <string>
 
+#include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "base/startup_profiler.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "engine/engine_factory.h"
+#include "engine/engine_interface.h"
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "protocol/commands.pb.h"
 #include "session/session_handler.h"
 #include "session/session_usage_observer.h"
 
+ABSL_FLAG(bool, warm_up_engine, false,
+          "Run a synthetic conversion at startup");
+
 namespace {
 
 #ifdef _WIN32
@@ -62,6 +69,11 @@ constexpr absl::Duration kTimeOut = absl::Milliseconds(5000);
 constexpr char kSessionName[] = "session";
 constexpr char kEventName[] = "session";
 
+std::unique_ptr<mozc::EngineInterface> CreateEngine() {
+  mozc::StartupProfiler::ScopedPhase phase("EngineFactory::Create");
+  return mozc::EngineFactory::Create().value();
+}
+
 }  // namespace
 
 namespace mozc {
@@ -70,7 +82,7 @@ SessionServer::SessionServer()
     : IPCServer(kSessionName, kNumConnections, kTimeOut),
       usage_observer_(std::make_unique<session::SessionUsageObserver>()),
       session_handler_(
-          std::make_unique<SessionHandler>(EngineFactory::Create().value())) {
+          std::make_unique<SessionHandler>(CreateEngine())) {
   // start session watch dog timer
   session_handler_->StartWatchDog();
   session_handler_->AddObserver(usage_observer_.get());
@@ -80,6 +92,13 @@ SessionServer::SessionServer()
   if (!notifier.Notify()) {
     LOG(WARNING) << "NamedEvent " << kEventName << " is not found";
   }
+
+  // Warm up after the UI is notified so that the UI doesn't wait for it. The
+  // first request waits for the warm-up instead, as the handler is not
+  // thread-safe.
+  if (absl::GetFlag(FLAGS_warm_up_engine)) {
+    warm_up_.emplace([this] { session_handler_->WarmUp(); });
+  }
 }
 
 bool SessionServer::Connected() const {
@@ -93,6 +112,11 @@ bool SessionServer::Process(absl::string_view request, std::string *response) {
     return false;  // shutdown the server if handler doesn't exist
   }
 
+  if (warm_up_.has_value()) {
+    warm_up_->Wait();
+    warm_up_.reset();
+  }
+
   commands::Command command;
   if (!command.mutable_input()->ParseFromArray(request.data(),
                                                request.size())) {
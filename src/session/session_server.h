@@ -33,9 +33,11 @@
 #define MOZC_SESSION_SESSION_SERVER_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "base/thread.h"
 #include "ipc/ipc.h"
 #include "session/session_handler_interface.h"
 #include "session/session_usage_observer.h"
@@ -65,6 +67,9 @@ class SessionServer : public IPCServer {
  private:
   std::unique_ptr<session::SessionUsageObserver> usage_observer_;
   std::unique_ptr<SessionHandlerInterface> session_handler_;
+  // Runs SessionHandler::WarmUp() until the first request. Declared after
+  // session_handler_ so that it's joined before the handler is destroyed.
+  std::optional<BackgroundFuture<void>> warm_up_;
 };
 
 }  // namespace mozc
@@ -42,6 +42,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "base/strings/assign.h"
 #include "base/strings/unicode.h"
 #include "base/vlog.h"
@@ -59,6 +60,7 @@
 #include "protocol/candidates.pb.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "protocol/state.pb.h"
 #include "request/conversion_request.h"
 #include "request/request_test_util.h"
 #include "rewriter/transliteration_rewriter.h"
@@ -10194,5 +10196,43 @@ TEST_F(SessionTest, SetConfig) {
   EXPECT_TRUE(session.undo_contexts_.empty());
 }
 
+TEST_F(SessionTest, CompactState) {
+  MockConverter converter;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+  Session session(&engine);
+  InitSessionToDirect(&session);
+
+  commands::Command command;
+  command.mutable_input()->mutable_key()->set_mode(commands::FULL_KATAKANA);
+  EXPECT_TRUE(session.IMEOn(&command));
+  command.Clear();
+  EXPECT_TRUE(session.IMEOff(&command));
+  commands::ApplicationInfo application_info;
+  application_info.set_process_id(123);
+  session.set_application_info(application_info);
+
+  ASSERT_TRUE(session.IsCompactable());
+  protocol::CompactSessionState state;
+  session.SaveCompactState(&state);
+
+  Session restored(&engine);
+  restored.RestoreCompactState(state);
+  EXPECT_EQ(restored.context().state(), ImeContext::DIRECT);
+  EXPECT_EQ(restored.context().composer().GetInputMode(),
+            transliteration::FULL_KATAKANA);
+  EXPECT_EQ(restored.application_info().process_id(), 123);
+  EXPECT_EQ(absl::ToUnixMicros(restored.create_session_time()),
+            absl::ToUnixMicros(session.create_session_time()));
+  EXPECT_EQ(absl::ToUnixMicros(restored.last_command_time()),
+            absl::ToUnixMicros(session.last_command_time()));
+
+  // A session with composition cannot be compacted.
+  command.Clear();
+  EXPECT_TRUE(restored.IMEOn(&command));
+  SendKey("a", &restored, &command);
+  EXPECT_FALSE(restored.IsCompactable());
+}
+
 }  // namespace session
 }  // namespace mozc
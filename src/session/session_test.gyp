@@ -178,6 +178,22 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'session_handler_pool_test',
+      'type': 'executable',
+      'sources': [
+        'session_handler_pool_test.cc',
+      ],
+      'dependencies': [
+        '<(mozc_oss_src_dir)/base/base.gyp:base',
+        '<(mozc_oss_src_dir)/protocol/protocol.gyp:commands_proto',
+        '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
+        'session.gyp:session_handler_pool',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'session_key_handling_test',
       'type': 'executable',
@@ -212,6 +228,7 @@
         '<(mozc_oss_src_dir)/testing/testing.gyp:gtest_main',
         '<(mozc_oss_src_dir)/testing/testing.gyp:mozctest',
         '<(mozc_oss_src_dir)/testing/testing.gyp:testing_util',
+        'session.gyp:random_keyevents_generator',
         'session.gyp:session',
       ],
       'variables': {
@@ -311,6 +328,7 @@
         # 'session_handler_stress_test',
         'random_keyevents_generator_test',
         'session_converter_test',
+        'session_handler_pool_test',
         'session_handler_test',
         'session_key_handling_test',
         'session_internal_test',
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
@@ -118,7 +119,28 @@ BlockBitmap BlockBitmapBuilder::Build() const {
 
 namespace {
 
+using ::mozc::storage::existence_filter_internal::kBloomBlockBits;
+using ::mozc::storage::existence_filter_internal::kBloomBlockShift;
+using ::mozc::storage::existence_filter_internal::kBloomBlockWords;
+
+// Data format:
+//
+//   classic: size, expected_nelts, num_hashes, bitmap...
+//   blocked: size, expected_nelts, tag, 0 * 13, bitmap...
+//
+// where tag = kBlockedFormatTag | version << 8 | num_hashes. The tag is
+// never a valid classic num_hashes, so readers that only know the classic
+// layout reject blocked data instead of misreading it. The blocked header is
+// padded to 64 bytes so that the bloom blocks are cache line aligned when the
+// data is.
 constexpr uint32_t kHeaderSize = 3;
+constexpr uint32_t kBlockedHeaderSize = 16;
+constexpr uint32_t kBlockedFormatTag = 0x42460000;  // "BF"
+constexpr uint32_t kBlockedFormatTagMask = 0xFFFF0000;
+constexpr uint32_t kBlockedFormatVersion = 1;
+
+// Multiplier to derive the bit positions in a bloom block from a 32-bit hash.
+constexpr uint32_t kGoldenRatio32 = 0x9E3779B9;
 
 absl::StatusOr<ExistenceFilterParams> ReadHeader(
     absl::Span<const uint32_t> buf) {
@@ -131,13 +153,107 @@ absl::StatusOr<ExistenceFilterParams> ReadHeader(
   ExistenceFilterParams params;
   params.size = *it++;
   params.expected_nelts = *it++;
-  params.num_hashes = *it++;
+  const uint32_t tag = *it++;
+  if ((tag & kBlockedFormatTagMask) == kBlockedFormatTag) {
+    if (((tag >> 8) & 0xFF) != kBlockedFormatVersion) {
+      return absl::InvalidArgumentError("Unsupported blocked filter version");
+    }
+    if (buf.size() < kBlockedHeaderSize) {
+      return absl::InvalidArgumentError(
+          "Not enough bufsize: could not read header");
+    }
+    if (params.size == 0 || params.size % kBloomBlockBits != 0) {
+      return absl::InvalidArgumentError("Bad size of blocked filter");
+    }
+    params.layout = ExistenceFilterParams::Layout::kBlocked;
+    params.num_hashes = tag & 0xFF;
+  } else {
+    params.num_hashes = tag;
+  }
   if (params.num_hashes >= 8 || params.num_hashes <= 0) {
     return absl::InvalidArgumentError("Bad number of hashes (header.k)");
   }
   return params;
 }
 
+uint32_t HeaderSize(const ExistenceFilterParams& params) {
+  return params.layout == ExistenceFilterParams::Layout::kBlocked
+             ? kBlockedHeaderSize
+             : kHeaderSize;
+}
+
+// Maps the upper half of |hash| to the index of the first bit of a bloom
+// block. Multiply-shift is used instead of modulo as it is much cheaper.
+inline uint32_t BloomBlockOffset(uint64_t hash, uint32_t num_blocks) {
+  const uint32_t block =
+      (static_cast<uint64_t>(hash >> 32) * num_blocks) >> 32;
+  return block << kBloomBlockShift;
+}
+
+// Computes the bits of |hash| in a bloom block. Each probe takes the top 9
+// bits of the lower half of |hash|, which is then scrambled by
+// multiplication.
+inline void BloomBlockMask(uint64_t hash, int num_hashes,
+                           uint32_t (&mask)[kBloomBlockWords]) {
+  std::fill(std::begin(mask), std::end(mask), 0);
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (int i = 0; i < num_hashes; ++i) {
+    const uint32_t bit = h >> (32 - kBloomBlockShift);
+    mask[bit >> 5] |= static_cast<uint32_t>(1) << (bit & 31);
+    h *= kGoldenRatio32;
+  }
+}
+
+// Returns true if all the bits in |mask| are set in |words|. The loop is
+// branch free so that compilers turn it into a few SIMD and/compare ops.
+inline bool ContainsMask(const uint32_t* words,
+                         const uint32_t (&mask)[kBloomBlockWords]) {
+  uint32_t missing = 0;
+  for (int i = 0; i < kBloomBlockWords; ++i) {
+    missing |= mask[i] & ~words[i];
+  }
+  return missing == 0;
+}
+
+inline void Prefetch(const void* ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#endif  // __GNUC__ || __clang__
+}
+
+// Estimates the false positive rate of a blocked bloom filter. The number of
+// keys in a block follows Poisson(num_elements / num_blocks), and a block
+// with j keys behaves like a classic filter of kBloomBlockBits bits.
+double EstimateBlockedErrorRate(size_t num_blocks, size_t num_elements,
+                                int num_hashes) {
+  const double lambda = static_cast<double>(num_elements) / num_blocks;
+  const double spread = 10 * std::sqrt(lambda) + 10;
+  const size_t begin = static_cast<size_t>(std::max(0.0, lambda - spread));
+  const size_t end = static_cast<size_t>(lambda + spread);
+  const double miss_per_probe = 1.0 - 1.0 / kBloomBlockBits;
+  double rate = 0;
+  for (size_t j = begin; j <= end; ++j) {
+    const double poisson =
+        std::exp(-lambda + j * std::log(lambda) - std::lgamma(j + 1.0));
+    const double bit_set = 1.0 - std::pow(miss_per_probe, num_hashes * j);
+    rate += poisson * std::pow(bit_set, num_hashes);
+  }
+  return rate;
+}
+
+int OptimalBlockedNumHashes(size_t num_blocks, size_t num_elements) {
+  int best_k = 1;
+  double best_rate = EstimateBlockedErrorRate(num_blocks, num_elements, 1);
+  for (int k = 2; k < 8; ++k) {
+    const double rate = EstimateBlockedErrorRate(num_blocks, num_elements, k);
+    if (rate < best_rate) {
+      best_k = k;
+      best_rate = rate;
+    }
+  }
+  return best_k;
+}
+
 constexpr uint32_t BitsToWords(uint32_t bits) {
   uint32_t words = (bits + 31) >> 5;
   if (bits > 0 && words == 0) {
@@ -155,6 +271,9 @@ std::ostream& operator<<(std::ostream& os,
 }
 
 bool ExistenceFilter::Exists(uint64_t hash) const {
+  if (params_.layout == ExistenceFilterParams::Layout::kBlocked) {
+    return ExistsBlocked(hash);
+  }
   for (int i = 0; i < params_.num_hashes; ++i) {
     hash = absl::rotl(hash, 8);
     const uint32_t index = hash % params_.size;
@@ -165,6 +284,41 @@ bool ExistenceFilter::Exists(uint64_t hash) const {
   return true;
 }
 
+bool ExistenceFilter::ExistsBlocked(uint64_t hash) const {
+  const uint32_t* words = rep_.GetWords(
+      BloomBlockOffset(hash, params_.size >> kBloomBlockShift));
+  uint32_t mask[kBloomBlockWords];
+  BloomBlockMask(hash, params_.num_hashes, mask);
+  return ContainsMask(words, mask);
+}
+
+void ExistenceFilter::ExistsMany(absl::Span<const uint64_t> hashes,
+                                 absl::Span<bool> results) const {
+  DCHECK_EQ(hashes.size(), results.size());
+  if (params_.layout != ExistenceFilterParams::Layout::kBlocked) {
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      results[i] = Exists(hashes[i]);
+    }
+    return;
+  }
+
+  constexpr size_t kBatchSize = 8;
+  const uint32_t num_blocks = params_.size >> kBloomBlockShift;
+  const uint32_t* words[kBatchSize];
+  for (size_t begin = 0; begin < hashes.size(); begin += kBatchSize) {
+    const size_t size = std::min(kBatchSize, hashes.size() - begin);
+    for (size_t i = 0; i < size; ++i) {
+      words[i] = rep_.GetWords(BloomBlockOffset(hashes[begin + i], num_blocks));
+      Prefetch(words[i]);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      uint32_t mask[kBloomBlockWords];
+      BloomBlockMask(hashes[begin + i], params_.num_hashes, mask);
+      results[begin + i] = ContainsMask(words[i], mask);
+    }
+  }
+}
+
 absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
     absl::Span<const uint32_t> buf) {
   ExistenceFilterParams params;
@@ -174,7 +328,7 @@ absl::StatusOr<ExistenceFilter> ExistenceFilter::Read(
   } else {
     return absl::InvalidArgumentError("Invalid format: could not read header");
   }
-  buf.remove_prefix(kHeaderSize);
+  buf.remove_prefix(HeaderSize(params));
 
   MOZC_VLOG(1) << "Reading bloom filter with params: " << params;
 
@@ -206,7 +360,34 @@ ExistenceFilterBuilder ExistenceFilterBuilder::CreateOptimal(
   return ExistenceFilterBuilder({m, n, optimal_k});
 }
 
+ExistenceFilterBuilder ExistenceFilterBuilder::CreateOptimalBlocked(
+    size_t size_in_bytes, uint32_t estimated_insertions) {
+  CHECK_LT(size_in_bytes, (1 << 29)) << "Requested size is too big";
+  CHECK_GT(estimated_insertions, 0);
+  const size_t block_bytes = kBloomBlockBits / 8;
+  const uint32_t num_blocks =
+      std::max<size_t>(1, (size_in_bytes + block_bytes - 1) / block_bytes);
+  const int optimal_k =
+      OptimalBlockedNumHashes(num_blocks, estimated_insertions);
+
+  MOZC_VLOG(1) << "optimal_k: " << optimal_k;
+
+  return ExistenceFilterBuilder({num_blocks << kBloomBlockShift,
+                                 estimated_insertions, optimal_k,
+                                 ExistenceFilterParams::Layout::kBlocked});
+}
+
 void ExistenceFilterBuilder::Insert(uint64_t hash) {
+  if (params_.layout == ExistenceFilterParams::Layout::kBlocked) {
+    const uint32_t offset =
+        BloomBlockOffset(hash, params_.size >> kBloomBlockShift);
+    uint32_t h = static_cast<uint32_t>(hash);
+    for (int i = 0; i < params_.num_hashes; ++i) {
+      rep_.Set(offset + (h >> (32 - kBloomBlockShift)));
+      h *= kGoldenRatio32;
+    }
+    return;
+  }
   for (int i = 0; i < params_.num_hashes; ++i) {
     hash = absl::rotl(hash, 8);
     const uint32_t index = hash % params_.size;
@@ -228,9 +409,27 @@ size_t ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
   return static_cast<size_t>(ceil(min_bits / 8));
 }
 
+size_t ExistenceFilterBuilder::MinBlockedFilterSizeInBytesForErrorRate(
+    float error_rate, size_t num_elements) {
+  // Starts from the classic size and grows by ~1% until the estimated error
+  // rate falls below the target.
+  const size_t block_bytes = kBloomBlockBits / 8;
+  size_t num_blocks = std::max<size_t>(
+      1, (MinFilterSizeInBytesForErrorRate(error_rate, num_elements) +
+          block_bytes - 1) /
+             block_bytes);
+  while (true) {
+    const int k = OptimalBlockedNumHashes(num_blocks, num_elements);
+    if (EstimateBlockedErrorRate(num_blocks, num_elements, k) <= error_rate) {
+      return num_blocks * block_bytes;
+    }
+    num_blocks += std::max<size_t>(1, num_blocks / 100);
+  }
+}
+
 std::string ExistenceFilterBuilder::SerializeAsString() {
   const size_t required_bytes =
-      (kHeaderSize + BitsToWords(params_.size)) * sizeof(uint32_t);
+      (HeaderSize(params_) + BitsToWords(params_.size)) * sizeof(uint32_t);
   std::string buf;
   buf.resize(required_bytes);
 
@@ -238,7 +437,16 @@ std::string ExistenceFilterBuilder::SerializeAsString() {
   // write header
   it = StoreUnaligned<uint32_t>(params_.size, it);
   it = StoreUnaligned<uint32_t>(params_.expected_nelts, it);
-  it = StoreUnaligned<uint32_t>(params_.num_hashes, it);
+  if (params_.layout == ExistenceFilterParams::Layout::kBlocked) {
+    it = StoreUnaligned<uint32_t>(
+        kBlockedFormatTag | kBlockedFormatVersion << 8 | params_.num_hashes,
+        it);
+    for (uint32_t i = kHeaderSize; i < kBlockedHeaderSize; ++i) {
+      it = StoreUnaligned<uint32_t>(0, it);
+    }
+  } else {
+    it = StoreUnaligned<uint32_t>(params_.num_hashes, it);
+  }
   // This method is called on data generation and we can call LOG(INFO) here.
   LOG(INFO) << "Header written: " << params_;
 
@@ -52,6 +52,14 @@ inline constexpr int kBlockMask = kBlockBits - 1;
 inline constexpr int kBlockBytes = kBlockBits >> 3;
 inline constexpr int kBlockWords = kBlockBits >> 5;
 
+// Geometry of the blocked Bloom filter layout. All the bits of a key are set
+// in one 512-bit (64-byte, i.e., one cache line) block.
+inline constexpr int kBloomBlockShift = 9;
+inline constexpr int kBloomBlockBits = 1 << kBloomBlockShift;
+inline constexpr int kBloomBlockWords = kBloomBlockBits >> 5;
+static_assert(kBlockBits % kBloomBlockBits == 0,
+              "A bloom block must not straddle BlockBitmap blocks");
+
 // BlockBitmap is an immutable view, directly referencing data given to the
 // constructors.
 class BlockBitmap {
@@ -70,6 +78,14 @@ class BlockBitmap {
     return (blocks_[bindex][windex] >> bitpos) & 1;
   }
 
+  // Returns the pointer to the word containing the bit at |index|. The words
+  // up to the end of the enclosing kBlockBits block are contiguous.
+  inline const uint32_t* GetWords(uint32_t index) const {
+    const uint32_t bindex = index >> kBlockShift;
+    const uint32_t windex = (index & kBlockMask) >> 5;
+    return blocks_[bindex].data() + windex;
+  }
+
  protected:
   // Array of blocks. Each block has kBlockBits region except for last block.
   std::vector<absl::Span<const uint32_t>> blocks_;
@@ -103,17 +119,29 @@ class BlockBitmapBuilder {
 
 // ExistenceFilter parameters.
 struct ExistenceFilterParams {
+  // Bit layout of the filter.
+  enum class Layout {
+    // Each hash value is mapped to anywhere in the bit vector.
+    kClassic,
+    // All the hash values of a key are mapped to one 512-bit block, so a
+    // lookup touches a single cache line. |size| is a multiple of 512.
+    kBlocked,
+  };
+
   template <typename Sink>
   friend void AbslStringify(Sink& sink, const ExistenceFilterParams& params) {
     absl::Format(&sink,
-                 "size: %d bits, estimated insertions: %d, num_hashes: %d",
-                 params.size, params.expected_nelts, params.num_hashes);
+                 "size: %d bits, estimated insertions: %d, num_hashes: %d, "
+                 "layout: %s",
+                 params.size, params.expected_nelts, params.num_hashes,
+                 params.layout == Layout::kBlocked ? "blocked" : "classic");
   }
 
   uint32_t size;            // the number of bits in the bit vector
   uint32_t expected_nelts;  // the number of values that will be stored
   int num_hashes;  // the number of hash values to use per insert/lookup.
                    // num_hashes must be less than 8.
+  Layout layout = Layout::kClassic;
 };
 
 // For Mozc's LOG().
@@ -142,7 +170,17 @@ class ExistenceFilter {
   // It may return some false positives
   bool Exists(uint64_t hash) const;
 
+  // Batch version of Exists(): sets results[i] = Exists(hashes[i]). For the
+  // blocked layout, the blocks of a batch are prefetched before they are
+  // tested, so the memory latencies of the lookups overlap.
+  void ExistsMany(absl::Span<const uint64_t> hashes,
+                  absl::Span<bool> results) const;
+
+  const ExistenceFilterParams& params() const { return params_; }
+
  private:
+  bool ExistsBlocked(uint64_t hash) const;
+
   ExistenceFilterParams params_;
   existence_filter_internal::BlockBitmap rep_;  // points to bitmap
 };
@@ -158,6 +196,12 @@ class ExistenceFilterBuilder {
   static ExistenceFilterBuilder CreateOptimal(size_t size_in_bytes,
                                               uint32_t estimated_insertions);
 
+  // Same as above but for the blocked layout. The size is rounded up to a
+  // multiple of 64 bytes. Use MinBlockedFilterSizeInBytesForErrorRate to
+  // determine the size.
+  static ExistenceFilterBuilder CreateOptimalBlocked(
+      size_t size_in_bytes, uint32_t estimated_insertions);
+
   // Inserts a hash value into the filter
   // We generate 'k' separate internal hash values
   void Insert(uint64_t hash);
@@ -173,6 +217,12 @@ class ExistenceFilterBuilder {
   static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
                                                  size_t num_elements);
 
+  // Same as above but for the blocked layout, whose error rate is slightly
+  // higher than the classic one of the same size because the keys are not
+  // evenly distributed over the blocks.
+  static size_t MinBlockedFilterSizeInBytesForErrorRate(float error_rate,
+                                                        size_t num_elements);
+
  private:
   ExistenceFilterParams params_;
   existence_filter_internal::BlockBitmapBuilder rep_;
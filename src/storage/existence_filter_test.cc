@@ -29,9 +29,11 @@
 
 #include "storage/existence_filter.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -39,7 +41,10 @@
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "base/hash.h"
+#include "base/stopwatch.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 
@@ -157,6 +162,140 @@ TEST(ExistenceFilterTest, InsertAndExistsTest) {
   }
 }
 
+TEST(ExistenceFilterTest, BlockedReadWriteTest) {
+  constexpr int kNumElements = 10000;
+  const size_t num_bytes =
+      ExistenceFilterBuilder::MinBlockedFilterSizeInBytesForErrorRate(
+          0.01, kNumElements);
+  EXPECT_EQ(num_bytes % 64, 0);
+
+  ExistenceFilterBuilder builder =
+      ExistenceFilterBuilder::CreateOptimalBlocked(num_bytes, kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    builder.Insert(Fingerprint(i * 2));
+  }
+  CheckValues(builder.Build(), num_bytes, kNumElements);
+
+  const std::string buf = builder.SerializeAsString();
+  // 64-byte header followed by the blocks.
+  EXPECT_EQ(buf.size(), 64 + num_bytes);
+  const std::vector<uint32_t> aligned_buf = StringToAlignedBuffer(buf);
+  absl::StatusOr<ExistenceFilter> filter = ExistenceFilter::Read(aligned_buf);
+  ASSERT_OK(filter);
+  EXPECT_EQ(filter->params().layout,
+            ExistenceFilterParams::Layout::kBlocked);
+  CheckValues(*filter, num_bytes, kNumElements);
+
+  // Truncated data is rejected.
+  EXPECT_FALSE(
+      ExistenceFilter::Read(absl::MakeConstSpan(aligned_buf).subspan(0, 20))
+          .ok());
+}
+
+TEST(ExistenceFilterTest, BlockedDataIsRejectedAsClassic) {
+  // The third header word of the blocked layout is an invalid number of
+  // hashes for the classic layout.
+  ExistenceFilterBuilder builder =
+      ExistenceFilterBuilder::CreateOptimalBlocked(1024, 100);
+  const std::string buf = builder.SerializeAsString();
+  std::vector<uint32_t> aligned_buf = StringToAlignedBuffer(buf);
+  EXPECT_GE(aligned_buf[2], 8);
+
+  // Unknown versions are rejected.
+  aligned_buf[2] += 1 << 8;
+  EXPECT_FALSE(ExistenceFilter::Read(aligned_buf).ok());
+}
+
+TEST(ExistenceFilterTest, ExistsManyTest) {
+  constexpr int kNumElements = 1000;
+  for (const bool blocked : {false, true}) {
+    ExistenceFilterBuilder builder =
+        blocked ? ExistenceFilterBuilder::CreateOptimalBlocked(1200,
+                                                               kNumElements)
+                : ExistenceFilterBuilder::CreateOptimal(1200, kNumElements);
+    for (int i = 0; i < kNumElements; ++i) {
+      builder.Insert(Fingerprint(i * 2));
+    }
+    const ExistenceFilter filter = builder.Build();
+
+    // Not a multiple of the internal batch size.
+    constexpr int kNumQueries = 2 * kNumElements + 3;
+    std::vector<uint64_t> hashes;
+    for (int i = 0; i < kNumQueries; ++i) {
+      hashes.push_back(Fingerprint(i));
+    }
+    auto results = std::make_unique<bool[]>(kNumQueries);
+    filter.ExistsMany(hashes, absl::MakeSpan(results.get(), kNumQueries));
+    for (int i = 0; i < kNumQueries; ++i) {
+      EXPECT_EQ(results[i], filter.Exists(hashes[i])) << i;
+      if (i % 2 == 0 && i < 2 * kNumElements) {
+        EXPECT_TRUE(results[i]) << i;
+      }
+    }
+  }
+}
+
+// Compares the two layouts at the same target error rate. The lookup times
+// are only logged since they depend on the machine.
+void CompareLayouts(const int num_elements, const int num_queries) {
+  constexpr float kErrorRate = 0.001;
+
+  struct Layout {
+    const char* name;
+    ExistenceFilterBuilder builder;
+  };
+  Layout layouts[] = {
+      {"classic", ExistenceFilterBuilder::CreateOptimal(
+                      ExistenceFilterBuilder::MinFilterSizeInBytesForErrorRate(
+                          kErrorRate, num_elements),
+                      num_elements)},
+      {"blocked",
+       ExistenceFilterBuilder::CreateOptimalBlocked(
+           ExistenceFilterBuilder::MinBlockedFilterSizeInBytesForErrorRate(
+               kErrorRate, num_elements),
+           num_elements)},
+  };
+  std::vector<uint64_t> queries;
+  for (int i = num_elements; i < num_elements + num_queries; ++i) {
+    queries.push_back(Fingerprint(i));
+  }
+  auto results = std::make_unique<bool[]>(num_queries);
+
+  for (Layout& layout : layouts) {
+    for (int i = 0; i < num_elements; ++i) {
+      layout.builder.Insert(Fingerprint(i));
+    }
+    const ExistenceFilter filter = layout.builder.Build();
+
+    int false_positives = 0;
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    for (const uint64_t hash : queries) {
+      false_positives += filter.Exists(hash);
+    }
+    const absl::Duration exists_time = stopwatch.GetElapsed();
+
+    stopwatch.Reset();
+    stopwatch.Start();
+    filter.ExistsMany(queries, absl::MakeSpan(results.get(), num_queries));
+    const absl::Duration exists_many_time = stopwatch.GetElapsed();
+
+    const double rate = static_cast<double>(false_positives) / num_queries;
+    LOG(INFO) << layout.name << ": " << filter.params()
+              << ", error rate: " << rate
+              << ", Exists: " << exists_time / num_queries
+              << ", ExistsMany: " << exists_many_time / num_queries;
+    EXPECT_LT(rate, kErrorRate * 1.5) << layout.name;
+  }
+}
+
+TEST(ExistenceFilterTest, LayoutErrorRates) { CompareLayouts(20000, 100000); }
+
+// Measures the lookup times at a realistic size. Run with
+// --gtest_also_run_disabled_tests.
+TEST(ExistenceFilterTest, DISABLED_CompareLayouts) {
+  CompareLayouts(200000, 1000000);
+}
+
 }  // namespace
 }  // namespace storage
 }  // namespace mozc
@@ -30,24 +30,27 @@
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <ios>
-#include <iterator>
-#include <list>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "base/bits.h"
@@ -57,6 +60,7 @@
 #include "base/hash.h"
 #include "base/mmap.h"
 #include "base/vlog.h"
+#include "storage/lru_storage_log.h"
 
 namespace mozc {
 namespace storage {
@@ -73,6 +77,11 @@ constexpr size_t kFileHeaderSize = 12;
 
 constexpr uint64_t k62DaysInSec = 62 * 24 * 60 * 60;
 
+// Sync() truncates the write-ahead log after this many records, which bounds
+// the replay time at Open(). The records not synced yet are also synced at
+// this many, which bounds the memory for them.
+constexpr size_t kMaxLogRecords = 4096;
+
 uint64_t GetFP(const char *ptr) { return LoadUnaligned<uint64_t>(ptr); }
 
 uint32_t GetTimeStamp(const char *ptr) {
@@ -108,6 +117,81 @@ class CompareByTimeStamp {
   }
 };
 
+// Sorts the item indices by descending timestamp with an LSD radix sort, so
+// that opening a storage takes O(n). Items with the same timestamp keep their
+// order as std::stable_sort with CompareByTimeStamp does.
+void SortByTimeStamp(const char *begin, size_t item_size,
+                     std::vector<uint32_t> *indices) {
+  const size_t n = indices->size();
+  std::vector<uint32_t> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    // Complement the timestamp to sort in descending order.
+    keys[i] = ~GetTimeStamp(begin + (*indices)[i] * item_size);
+  }
+  std::vector<uint32_t> sorted_indices(n), sorted_keys(n);
+  for (int shift = 0; shift < 32; shift += 8) {
+    std::array<size_t, 256> offsets = {};
+    for (const uint32_t key : keys) {
+      ++offsets[(key >> shift) & 0xff];
+    }
+    // Timestamps are close to each other, so the upper digits are often the
+    // same for all the items.
+    if (n == 0 || offsets[(keys[0] >> shift) & 0xff] == n) {
+      continue;
+    }
+    size_t sum = 0;
+    for (size_t &offset : offsets) {
+      const size_t count = offset;
+      offset = sum;
+      sum += count;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      const size_t pos = offsets[(keys[i] >> shift) & 0xff]++;
+      sorted_indices[pos] = (*indices)[i];
+      sorted_keys[pos] = keys[i];
+    }
+    indices->swap(sorted_indices);
+    keys.swap(sorted_keys);
+  }
+}
+
+// Restores the invariants that replaying a write-ahead log over a partially
+// written file may break: fingerprints are unique, and the used items are
+// packed at the front of the file.
+void RepairItems(char *begin, size_t item_size, size_t size) {
+  absl::flat_hash_map<uint64_t, char *> newest;
+  for (size_t i = 0; i < size; ++i) {
+    char *item = begin + i * item_size;
+    if (GetTimeStamp(item) == 0) {
+      std::fill_n(item, item_size, 0);
+      continue;
+    }
+    const auto [it, inserted] = newest.emplace(GetFP(item), item);
+    if (inserted) {
+      continue;
+    }
+    char *dropped = item;
+    if (GetTimeStamp(item) > GetTimeStamp(it->second)) {
+      dropped = it->second;
+      it->second = item;
+    }
+    std::fill_n(dropped, item_size, 0);
+  }
+
+  size_t used = 0;
+  for (size_t i = 0; i < size; ++i) {
+    char *item = begin + i * item_size;
+    if (GetTimeStamp(item) == 0) {
+      continue;
+    }
+    if (i != used) {
+      std::copy_n(item, item_size, begin + used * item_size);
+      std::fill_n(item, item_size, 0);
+    }
+    ++used;
+  }
+}
+
 }  // namespace
 
 std::unique_ptr<LruStorage> LruStorage::Create(const char *filename) {
@@ -178,7 +262,7 @@ bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
 // Reopen file after initializing mapped page.
 bool LruStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.empty() || lru_list_.empty()) {
+  if (mmap_.empty() || used_size_ == 0) {
     return true;
   }
   const size_t offset = sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
@@ -186,9 +270,11 @@ bool LruStorage::Clear() {
     return false;
   }
   std::fill(mmap_.begin() + offset, mmap_.end(), 0);
-  lru_list_.clear();
-  lru_map_.clear();
   Open(mmap_.begin(), mmap_.size());
+  // The cleared items must not come back from the log.
+  if (log_ != nullptr) {
+    return Checkpoint();
+  }
   return true;
 }
 
@@ -253,7 +339,10 @@ bool LruStorage::Merge(const LruStorage &storage) {
     std::fill(new_end, end_, 0);
   }
 
-  return Open(mmap_.begin(), mmap_.size());
+  if (!Open(mmap_.begin(), mmap_.size())) {
+    return false;
+  }
+  return log_ == nullptr || Checkpoint();
 }
 
 bool LruStorage::OpenOrCreate(const char *filename, size_t new_value_size,
@@ -330,7 +419,102 @@ bool LruStorage::Open(const char *filename) {
   }
 
   filename_ = filename;
-  return Open(mmap_.begin(), mmap_.size());
+  const size_t num_replayed = use_write_ahead_log_ ? ReplayLog() : 0;
+  if (!Open(mmap_.begin(), mmap_.size())) {
+    return false;
+  }
+  if (!use_write_ahead_log_) {
+    return true;
+  }
+
+  // The replayed items have to reach the disk before the log is truncated.
+  // Otherwise, the log is left as is to be replayed next time, and the
+  // storage runs without the log.
+  if (num_replayed > 0) {
+    if (absl::Status s = mmap_.Flush(); !s.ok()) {
+      LOG(ERROR) << "Continue without the write-ahead log as " << filename
+                 << " cannot be flushed: " << s;
+      return true;
+    }
+  }
+  log_ = std::make_unique<LruStorageLog>();
+  if (absl::Status s = log_->Open(GetLogFileName(filename), value_size_,
+                                  size_, seed_);
+      !s.ok()) {
+    LOG(ERROR) << "Continue without the write-ahead log: " << s;
+    log_.reset();
+  }
+  return true;
+}
+
+size_t LruStorage::ReplayLog() {
+  if (mmap_.size() < kFileHeaderSize) {
+    return 0;
+  }
+  const char *header = mmap_.begin();
+  const uint32_t value_size = LoadUnalignedAdvance<uint32_t>(header);
+  const uint32_t size = LoadUnalignedAdvance<uint32_t>(header);
+  const uint32_t seed = LoadUnalignedAdvance<uint32_t>(header);
+  const size_t item_size = value_size + kItemHeaderSize;
+  // Open() rejects the file if the size doesn't match.
+  if (size > kMaxLruSize || value_size > kMaxValueSize ||
+      mmap_.size() != kFileHeaderSize + item_size * size) {
+    return 0;
+  }
+
+  char *items = mmap_.begin() + kFileHeaderSize;
+  const size_t num_replayed = LruStorageLog::Replay(
+      GetLogFileName(filename_), value_size, size, seed,
+      [&](uint32_t index, absl::string_view item) {
+        absl::c_copy(item, items + index * item_size);
+      });
+  if (num_replayed > 0) {
+    LOG(INFO) << "Replayed " << num_replayed << " records to " << filename_;
+    RepairItems(items, item_size, size);
+  }
+  return num_replayed;
+}
+
+std::string LruStorage::GetLogFileName(absl::string_view filename) {
+  return absl::StrCat(filename, ".wal");
+}
+
+bool LruStorage::Sync() {
+  if (log_ == nullptr) {
+    return true;
+  }
+  if (log_->num_records() > kMaxLogRecords) {
+    return Checkpoint();
+  }
+  if (absl::Status s = log_->Sync(); !s.ok()) {
+    LOG(ERROR) << "Cannot sync the write-ahead log of " << filename_ << ": "
+               << s;
+    return false;
+  }
+  return true;
+}
+
+bool LruStorage::Checkpoint() {
+  if (absl::Status s = mmap_.Flush(); !s.ok()) {
+    LOG(ERROR) << "Cannot flush " << filename_ << ": " << s;
+    return false;
+  }
+  if (absl::Status s = log_->Reset(); !s.ok()) {
+    LOG(ERROR) << "Cannot truncate the write-ahead log of " << filename_
+               << ": " << s;
+    return false;
+  }
+  return true;
+}
+
+void LruStorage::LogItem(uint32_t index) {
+  if (log_ != nullptr) {
+    log_->Add(index, absl::string_view(GetItem(index), item_size()));
+    // If Sync() fails, it's retried after another kMaxLogRecords records.
+    if (log_->num_buffered_records() % kMaxLogRecords == 0) {
+      Sync();
+    }
+  }
 }
 
 bool LruStorage::Open(char *ptr, size_t ptr_size) {
@@ -361,22 +545,36 @@ bool LruStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  std::vector<char *> ary;
-  for (char *begin = begin_; begin < end_; begin += item_size()) {
-    ary.push_back(begin);
-  }
-  std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
+  prev_.assign(size_, kInvalidIndex);
+  next_.assign(size_, kInvalidIndex);
+  head_ = kInvalidIndex;
+  tail_ = kInvalidIndex;
+  used_size_ = 0;
+  table_.assign(absl::bit_ceil(size_ * 2), Slot());
 
-  lru_list_.clear();
-  lru_map_.clear();
+  std::vector<uint32_t> indices;
   char *next = nullptr;
-  for (size_t i = 0; i < ary.size(); ++i) {
-    if (GetTimeStamp(ary[i]) != 0) {
-      lru_list_.push_back(ary[i]);
-      lru_map_[GetFP(ary[i])] = std::prev(lru_list_.end());
+  for (uint32_t i = 0; i < size_; ++i) {
+    if (GetTimeStamp(GetItem(i)) != 0) {
+      indices.push_back(i);
     } else if (next == nullptr) {
-      next = ary[i];
+      next = GetItem(i);
+    }
+  }
+  SortByTimeStamp(begin_, item_size(), &indices);
+
+  for (const uint32_t index : indices) {
+    const uint64_t fp = GetFP(GetItem(index));
+    table_[FindSlot(fp)] = {index, static_cast<uint32_t>(fp)};
+    // Append to the back of the recency list.
+    prev_[index] = tail_;
+    if (tail_ == kInvalidIndex) {
+      head_ = index;
+    } else {
+      next_[tail_] = index;
     }
+    tail_ = index;
+    ++used_size_;
   }
   next_item_ = (next != nullptr) ? next : end_;
   DCHECK_LE(next_item_, end_);
@@ -391,25 +589,109 @@ void LruStorage::Close() {
   // Perform clean up before closing the file.
   DeleteElementsUntouchedFor62Days();
 
+  if (log_ != nullptr) {
+    Checkpoint();
+    log_.reset();
+  }
   filename_.clear();
   mmap_.Close();
-  lru_list_.clear();
-  lru_map_.clear();
+  prev_.clear();
+  next_.clear();
+  head_ = kInvalidIndex;
+  tail_ = kInvalidIndex;
+  used_size_ = 0;
+  table_.clear();
+}
+
+size_t LruStorage::FindSlot(uint64_t fp) const {
+  DCHECK(absl::has_single_bit(table_.size()));
+  const size_t mask = table_.size() - 1;
+  const uint32_t fp_low = static_cast<uint32_t>(fp);
+  // The table is at most half full, so there is always an empty slot.
+  for (size_t i = fp_low & mask;; i = (i + 1) & mask) {
+    const Slot &slot = table_[i];
+    if (slot.index == kInvalidIndex ||
+        (slot.fp_low == fp_low && GetFP(GetItem(slot.index)) == fp)) {
+      return i;
+    }
+  }
+}
+
+uint32_t LruStorage::FindIndex(uint64_t fp) const {
+  if (table_.empty()) {
+    return kInvalidIndex;
+  }
+  return table_[FindSlot(fp)].index;
+}
+
+void LruStorage::EraseSlot(uint64_t fp) {
+  size_t hole = FindSlot(fp);
+  if (table_[hole].index == kInvalidIndex) {
+    return;
+  }
+  // Backward shift deletion: move the following entries of the probe
+  // sequence into the hole unless that would put them before their home slot.
+  const size_t mask = table_.size() - 1;
+  for (size_t i = (hole + 1) & mask; table_[i].index != kInvalidIndex;
+       i = (i + 1) & mask) {
+    const size_t home = table_[i].fp_low & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      table_[hole] = table_[i];
+      hole = i;
+    }
+  }
+  table_[hole] = Slot();
+}
+
+void LruStorage::PushFront(uint32_t index) {
+  prev_[index] = kInvalidIndex;
+  next_[index] = head_;
+  if (head_ == kInvalidIndex) {
+    tail_ = index;
+  } else {
+    prev_[head_] = index;
+  }
+  head_ = index;
+}
+
+void LruStorage::Unlink(uint32_t index) {
+  const uint32_t prev = prev_[index];
+  const uint32_t next = next_[index];
+  if (prev == kInvalidIndex) {
+    head_ = next;
+  } else {
+    next_[prev] = next;
+  }
+  if (next == kInvalidIndex) {
+    tail_ = prev;
+  } else {
+    prev_[next] = prev;
+  }
+  prev_[index] = kInvalidIndex;
+  next_[index] = kInvalidIndex;
+}
+
+void LruStorage::MoveToFront(uint32_t index) {
+  if (head_ != index) {
+    Unlink(index);
+    PushFront(index);
+  }
 }
 
 const char *LruStorage::Lookup(const absl::string_view key,
                                uint32_t *last_access_time) const {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  const auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t index = FindIndex(fp);
+  if (index == kInvalidIndex) {
     return nullptr;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const char *item = GetItem(index);
+  const uint32_t timestamp = GetTimeStamp(item);
   if (IsOlderThan62Days(timestamp)) {
     return nullptr;
   }
   *last_access_time = timestamp;
-  return GetValue(*it->second);
+  return GetValue(item);
 }
 
 void LruStorage::GetAllValues(std::vector<std::string> *values) const {
@@ -417,69 +699,77 @@ void LruStorage::GetAllValues(std::vector<std::string> *values) const {
   values->clear();
   // Iterate data from the most recently used element to the least recently used
   // element.
-  for (const char *ptr : lru_list_) {
+  for (uint32_t index = head_; index != kInvalidIndex; index = next_[index]) {
+    const char *ptr = GetItem(index);
     const uint32_t timestamp = GetTimeStamp(ptr);
     if (IsOlderThan62Days(timestamp)) {
       break;
     }
     // Default constructor of string is not applicable
     // because value's size() must return value_size_.
-    DCHECK(ptr);
     values->emplace_back(GetValue(ptr), value_size_);
   }
 }
 
 bool LruStorage::Touch(const absl::string_view key) {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t index = FindIndex(fp);
+  if (index == kInvalidIndex) {
     return false;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const uint32_t timestamp = GetTimeStamp(GetItem(index));
   if (IsOlderThan62Days(timestamp)) {
     return false;
   }
-  Update(*it->second);
-  // Move the node pointed to by it->second to the front.
-  lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  Update(GetItem(index));
+  LogItem(index);
+  MoveToFront(index);
   return true;
 }
 
 bool LruStorage::Insert(const absl::string_view key, const char *value) {
-  if (value == nullptr) {
+  if (value == nullptr || table_.empty()) {
     return false;
   }
   const uint64_t fp = FingerprintWithSeed(key, seed_);
+  const size_t slot = FindSlot(fp);
 
   // If the data corresponding to |key| already exists in LRU, update it.
-  {
-    auto it = lru_map_.find(fp);
-    if (it != lru_map_.end()) {
-      // Overwrite the data pointed to by it->second and move it to the front.
-      Update(*it->second, fp, value, value_size_);
-      lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
-      return true;
-    }
+  if (const uint32_t index = table_[slot].index; index != kInvalidIndex) {
+    // Overwrite the data and move it to the front.
+    Update(GetItem(index), fp, value, value_size_);
+    LogItem(index);
+    MoveToFront(index);
+    return true;
   }
 
   // If the LRU is full or we run out of the mmap region, drop the least
   // recently used element (actually, the least recently used element is
   // overwritten with new data).
-  if (lru_map_.size() >= size_ || next_item_ == end_) {
-    auto it = std::prev(lru_list_.end());  // Least recently used data.
-    const uint64_t old_fp = GetFP(*it);
-    lru_map_.erase(old_fp);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it);  // Move to front.
-    Update(*it, fp, value, value_size_);
-    lru_map_[fp] = it;
+  if (used_size_ >= size_ || next_item_ == end_) {
+    const uint32_t index = tail_;  // Least recently used data.
+    if (index == kInvalidIndex) {
+      LOG(ERROR) << "No item to overwrite (broken?)";
+      return false;
+    }
+    EraseSlot(GetFP(GetItem(index)));
+    MoveToFront(index);
+    Update(GetItem(index), fp, value, value_size_);
+    LogItem(index);
+    // EraseSlot() may have moved the entries, so find the slot again.
+    table_[FindSlot(fp)] = {index, static_cast<uint32_t>(fp)};
     return true;
   }
 
   // A new item can be assigned in the mmap region.
   if (next_item_ < end_) {
+    const uint32_t index =
+        static_cast<uint32_t>((next_item_ - begin_) / item_size());
     Update(next_item_, fp, value, value_size_);
-    lru_list_.push_front(next_item_);
-    lru_map_[fp] = lru_list_.begin();
+    LogItem(index);
+    PushFront(index);
+    table_[slot] = {index, static_cast<uint32_t>(fp)};
+    ++used_size_;
     // Advance next_item_ for next item.
     next_item_ += item_size();
     DCHECK_LE(next_item_, end_);
@@ -492,10 +782,11 @@ bool LruStorage::Insert(const absl::string_view key, const char *value) {
 
 bool LruStorage::TryInsert(const absl::string_view key, const char *value) {
   const uint64_t fp = FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it != lru_map_.end()) {
-    Update(*it->second, fp, value, value_size_);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  const uint32_t index = FindIndex(fp);
+  if (index != kInvalidIndex) {
+    Update(GetItem(index), fp, value, value_size_);
+    LogItem(index);
+    MoveToFront(index);
   }
   return true;
 }
@@ -506,40 +797,55 @@ bool LruStorage::Delete(const absl::string_view key) {
 }
 
 bool LruStorage::Delete(uint64_t fp) {
-  auto it = lru_map_.find(fp);
-  return (it == lru_map_.end() || Delete(fp, it->second));
-}
-
-bool LruStorage::Delete(std::list<char *>::iterator it) {
-  return (it == lru_list_.end() || Delete(GetFP(*it), it));
+  const uint32_t index = FindIndex(fp);
+  return (index == kInvalidIndex || DeleteIndex(index));
 }
 
-bool LruStorage::Delete(uint64_t fp, std::list<char *>::iterator it) {
+bool LruStorage::DeleteIndex(uint32_t index) {
   // Determine the last element in the mmap region.
   if (next_item_ < begin_ + item_size()) {
     LOG(ERROR) << "next_item_ points to invalid location (broken?)";
     return false;
   }
   next_item_ -= item_size();
+  const uint32_t last =
+      static_cast<uint32_t>((next_item_ - begin_) / item_size());
 
-  // Backup the location of mmap region to which another element will be moved.
-  char *deleted_item_pos = *it;
-
-  // Erase the LRU structure for (fp, it).
-  lru_map_.erase(fp);
-  lru_list_.erase(it);
+  // Erase the LRU structure for the element.
+  EraseSlot(GetFP(GetItem(index)));
+  Unlink(index);
+  --used_size_;
 
-  if (next_item_ != deleted_item_pos) {
+  if (last != index) {
     // Move the region for the last element to the deleted location.  Then,
-    // update the LRU structure for the moved element (the pointer to mmap
-    // region in the list node is updated.)
-    std::copy_n(next_item_, item_size(), deleted_item_pos);
-    const uint64_t fp = GetFP(next_item_);
-    *lru_map_[fp] = deleted_item_pos;
+    // update the LRU structure for the moved element.
+    std::copy_n(next_item_, item_size(), GetItem(index));
+    LogItem(index);
+    const size_t slot = FindSlot(GetFP(next_item_));
+    if (table_[slot].index == last) {
+      table_[slot].index = index;
+      const uint32_t prev = prev_[last];
+      const uint32_t next = next_[last];
+      prev_[index] = prev;
+      next_[index] = next;
+      if (prev == kInvalidIndex) {
+        head_ = index;
+      } else {
+        next_[prev] = index;
+      }
+      if (next == kInvalidIndex) {
+        tail_ = index;
+      } else {
+        prev_[next] = index;
+      }
+      prev_[last] = kInvalidIndex;
+      next_[last] = kInvalidIndex;
+    }
   }
 
   // Clear the region for the next_item_.
   std::fill_n(next_item_, item_size(), 0);
+  LogItem(last);
 
   return true;
 }
@@ -549,13 +855,12 @@ int LruStorage::DeleteElementsBefore(uint32_t timestamp) {
     return 0;
   }
   int num_deleted = 0;
-  while (!lru_list_.empty()) {
-    auto it = std::prev(lru_list_.end());
-    const uint32_t last_access_time = GetTimeStamp(*it);
+  while (tail_ != kInvalidIndex) {
+    const uint32_t last_access_time = GetTimeStamp(GetItem(tail_));
     if (last_access_time >= timestamp) {
       break;
     }
-    if (Delete(it)) {
+    if (DeleteIndex(tail_)) {
       ++num_deleted;
       continue;
     }
@@ -583,6 +888,7 @@ void LruStorage::Write(size_t i, uint64_t fp, const absl::string_view value,
   } else {
     LOG(ERROR) << "value size is not " << value_size_ << " byte.";
   }
+  LogItem(static_cast<uint32_t>(i));
 }
 
 void LruStorage::Read(size_t i, uint64_t *fp, std::string *value,
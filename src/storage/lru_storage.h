@@ -32,14 +32,13 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "base/mmap.h"
+#include "storage/lru_storage_log.h"
 
 namespace mozc {
 namespace storage {
@@ -60,6 +59,21 @@ class LruStorage {
   bool OpenOrCreate(const char *filename, size_t new_value_size,
                     size_t new_size, uint32_t new_seed);
 
+  // Makes Open() and OpenOrCreate() keep a write-ahead log in
+  // GetLogFileName(filename). Open() replays the log, so the updates up to
+  // the last Sync() survive a crash or a power loss. When the file is broken
+  // and recreated by OpenOrCreate(), the logged items are recovered as well.
+  // Must be called before opening.
+  void set_use_write_ahead_log(bool use) { use_write_ahead_log_ = use; }
+
+  // Makes the updates durable. With the write-ahead log, this appends the
+  // updates since the last call to the log with one fsync, and flushes the
+  // file and truncates the log once the log is long. Otherwise this does
+  // nothing.
+  bool Sync();
+
+  static std::string GetLogFileName(absl::string_view filename);
+
   // Looks up elements by key.
   const char *Lookup(absl::string_view key, uint32_t *last_access_time) const;
   const char *Lookup(absl::string_view key) const {
@@ -121,7 +135,7 @@ class LruStorage {
   size_t size() const { return size_; }
 
   // Returns the number of items in LRU.
-  size_t used_size() const { return lru_list_.size(); }
+  size_t used_size() const { return used_size_; }
 
   // Returns the seed used for fingerprinting.
   uint32_t seed() const { return seed_; }
@@ -154,18 +168,53 @@ class LruStorage {
   // The byte length used to store fingerprint and timestamp for each item.
   // * 8 bytes for fingerprint
   // * 4 bytes for timestamp.
-  static constexpr size_t kItemHeaderSize = 12;
+  static constexpr size_t kItemHeaderSize = LruStorageLog::kItemHeaderSize;
 
  private:
+  // Null index for the recency list and the fingerprint table.
+  static constexpr uint32_t kInvalidIndex = 0xffffffff;
+
+  // A slot of the open addressing table from fingerprint to item index.
+  // `fp_low` is the lower half of the fingerprint. It gives the home slot and
+  // lets most probes skip reading the item from the mapped file.
+  struct Slot {
+    uint32_t index = kInvalidIndex;
+    uint32_t fp_low = 0;
+  };
+
   // Initializes this LRU from memory buffer.
   bool Open(char *ptr, size_t ptr_size);
 
-  // Deletes the element from |fp| or |it|.
+  char *GetItem(uint32_t index) const { return begin_ + index * item_size(); }
+
+  // Returns the slot of `fp` in `table_`, or the empty slot where it would
+  // be inserted.
+  size_t FindSlot(uint64_t fp) const;
+
+  // Returns the index of the item for `fp`, or kInvalidIndex.
+  uint32_t FindIndex(uint64_t fp) const;
+
+  // Removes `fp` from `table_`.
+  void EraseSlot(uint64_t fp);
+
+  // Operations on the recency list.
+  void PushFront(uint32_t index);
+  void Unlink(uint32_t index);
+  void MoveToFront(uint32_t index);
+
+  // Deletes the element from |fp| or |index|.
   bool Delete(uint64_t fp);
-  bool Delete(std::list<char *>::iterator it);
+  bool DeleteIndex(uint32_t index);
+
+  // Records the current bytes of the item in the write-ahead log.
+  void LogItem(uint32_t index);
+
+  // Applies the write-ahead log to the mapped file and returns the number of
+  // applied records.
+  size_t ReplayLog();
 
-  // Actual implementation of Delete() methods.
-  bool Delete(uint64_t fp, std::list<char *>::iterator it);
+  // Flushes the mapped file and truncates the write-ahead log.
+  bool Checkpoint();
 
   size_t value_size_ = 0;
   size_t size_ = 0;
@@ -174,9 +223,19 @@ class LruStorage {
   char *begin_ = nullptr;
   char *end_ = nullptr;
   std::string filename_;
-  std::list<char *> lru_list_;  // Front is the most recently used data.
-  absl::flat_hash_map<uint64_t, std::list<char *>::iterator> lru_map_;
+  // Doubly linked recency list over item indices. `head_` is the most
+  // recently used item.
+  std::vector<uint32_t> prev_;
+  std::vector<uint32_t> next_;
+  uint32_t head_ = kInvalidIndex;
+  uint32_t tail_ = kInvalidIndex;
+  size_t used_size_ = 0;
+  // Linear probing table with at least twice as many slots as `size_`.
+  std::vector<Slot> table_;
   Mmap mmap_;
+  bool use_write_ahead_log_ = false;
+  // Non-null while the file is opened with the write-ahead log.
+  std::unique_ptr<LruStorageLog> log_;
 };
 
 }  // namespace storage
@@ -0,0 +1,272 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "storage/lru_storage_log.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "base/bits.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+
+#include "base/win32/wide_char.h"
+#else  // _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+namespace mozc {
+namespace storage {
+namespace {
+
+constexpr uint32_t kMagic = 0x574c5a4d;  // "MZLW"
+
+// Index (4 bytes) and checksum (4 bytes) around the item.
+constexpr size_t kRecordOverhead = 8;
+
+std::string MakeHeader(uint32_t value_size, uint32_t size, uint32_t seed) {
+  std::string header(LruStorageLog::kHeaderSize, '\0');
+  char *ptr = header.data();
+  ptr = StoreUnaligned<uint32_t>(kMagic, ptr);
+  ptr = StoreUnaligned<uint32_t>(value_size, ptr);
+  ptr = StoreUnaligned<uint32_t>(size, ptr);
+  StoreUnaligned<uint32_t>(seed, ptr);
+  return header;
+}
+
+#ifdef _WIN32
+
+int OpenForWrite(const std::string &filename) {
+  int fd = -1;
+  if (_wsopen_s(&fd, win32::Utf8ToWide(filename).c_str(),
+                _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _SH_DENYNO,
+                _S_IREAD | _S_IWRITE) != 0) {
+    return -1;
+  }
+  return fd;
+}
+
+int WriteFd(int fd, const char *data, size_t size) {
+  return _write(fd, data, static_cast<unsigned int>(size));
+}
+
+int SyncFd(int fd) { return _commit(fd); }
+
+int TruncateFd(int fd, size_t size) {
+  if (_chsize_s(fd, size) != 0 || _lseeki64(fd, size, SEEK_SET) == -1) {
+    return -1;
+  }
+  return 0;
+}
+
+int CloseFd(int fd) { return _close(fd); }
+
+#else  // _WIN32
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif  // O_BINARY
+
+int OpenForWrite(const std::string &filename) {
+  return ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY,
+                0600);
+}
+
+ssize_t WriteFd(int fd, const char *data, size_t size) {
+  return ::write(fd, data, size);
+}
+
+int SyncFd(int fd) { return ::fsync(fd); }
+
+int TruncateFd(int fd, size_t size) {
+  if (::ftruncate(fd, size) == -1 || ::lseek(fd, size, SEEK_SET) == -1) {
+    return -1;
+  }
+  return 0;
+}
+
+int CloseFd(int fd) { return ::close(fd); }
+
+#endif  // _WIN32
+
+}  // namespace
+
+absl::Status LruStorageLog::Open(const std::string &filename,
+                                 uint32_t value_size, uint32_t size,
+                                 uint32_t seed) {
+  Close();
+  fd_ = OpenForWrite(filename);
+  if (fd_ == -1) {
+    return absl::ErrnoToStatus(
+        errno, absl::StrFormat("Cannot open %s for writing", filename));
+  }
+  if (absl::Status s = WriteAll(MakeHeader(value_size, size, seed)); !s.ok()) {
+    Close();
+    return s;
+  }
+  if (SyncFd(fd_) == -1) {
+    const int err = errno;
+    Close();
+    return absl::ErrnoToStatus(err, "fsync failed");
+  }
+  synced_size_ = kHeaderSize;
+  return absl::OkStatus();
+}
+
+void LruStorageLog::Close() {
+  if (fd_ != -1) {
+    CloseFd(fd_);
+    fd_ = -1;
+  }
+  num_records_ = 0;
+  num_buffered_records_ = 0;
+  buffer_.clear();
+  synced_size_ = 0;
+  torn_ = false;
+}
+
+size_t LruStorageLog::Replay(
+    const std::string &filename, uint32_t value_size, uint32_t size,
+    uint32_t seed,
+    absl::FunctionRef<void(uint32_t index, absl::string_view item)> apply) {
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(filename);
+  if (!contents.ok()) {
+    return 0;
+  }
+  absl::string_view data = *contents;
+  if (!absl::StartsWith(data, MakeHeader(value_size, size, seed))) {
+    return 0;
+  }
+  data.remove_prefix(kHeaderSize);
+
+  const size_t item_size = kItemHeaderSize + value_size;
+  const size_t record_size = item_size + kRecordOverhead;
+  size_t num_records = 0;
+  for (; data.size() >= record_size; data.remove_prefix(record_size)) {
+    const absl::string_view body = data.substr(0, 4 + item_size);
+    const uint32_t checksum = LoadUnaligned<uint32_t>(data.data() + body.size());
+    const uint32_t index = LoadUnaligned<uint32_t>(body.data());
+    if (checksum != Fingerprint32(body) || index >= size) {
+      break;
+    }
+    apply(index, body.substr(4));
+    ++num_records;
+  }
+  return num_records;
+}
+
+void LruStorageLog::Add(uint32_t index, absl::string_view item) {
+  if (fd_ == -1) {
+    return;
+  }
+  const size_t begin = buffer_.size();
+  buffer_.resize(begin + 4);
+  StoreUnaligned<uint32_t>(index, buffer_.data() + begin);
+  buffer_.append(item.data(), item.size());
+  const uint32_t checksum =
+      Fingerprint32(absl::string_view(buffer_).substr(begin));
+  buffer_.resize(buffer_.size() + 4);
+  StoreUnaligned<uint32_t>(checksum, buffer_.data() + buffer_.size() - 4);
+  ++num_records_;
+  ++num_buffered_records_;
+}
+
+absl::Status LruStorageLog::Sync() {
+  if (fd_ == -1 || buffer_.empty()) {
+    return absl::OkStatus();
+  }
+  if (torn_) {
+    if (TruncateFd(fd_, synced_size_) == -1) {
+      return absl::ErrnoToStatus(errno, "Cannot truncate the log");
+    }
+    torn_ = false;
+  }
+  absl::Status s = WriteAll(buffer_);
+  if (s.ok() && SyncFd(fd_) == -1) {
+    s = absl::ErrnoToStatus(errno, "fsync failed");
+  }
+  if (!s.ok()) {
+    torn_ = true;
+    return s;
+  }
+  synced_size_ += buffer_.size();
+  buffer_.clear();
+  num_buffered_records_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status LruStorageLog::Reset() {
+  if (fd_ == -1) {
+    return absl::OkStatus();
+  }
+  buffer_.clear();
+  num_records_ = 0;
+  num_buffered_records_ = 0;
+  // The storage image has all the records, so they can be dropped even if the
+  // truncation is retried by the next Sync().
+  synced_size_ = kHeaderSize;
+  torn_ = TruncateFd(fd_, kHeaderSize) == -1 || SyncFd(fd_) == -1;
+  if (torn_) {
+    return absl::ErrnoToStatus(errno, "Cannot truncate the log");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status LruStorageLog::WriteAll(absl::string_view data) {
+  while (!data.empty()) {
+    const auto written = WriteFd(fd_, data.data(), data.size());
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return absl::ErrnoToStatus(errno, "Cannot write to the log");
+    }
+    data.remove_prefix(written);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace storage
+}  // namespace mozc
@@ -0,0 +1,117 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_STORAGE_LRU_STORAGE_LOG_H_
+#define MOZC_STORAGE_LRU_STORAGE_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace storage {
+
+// An append-only write-ahead log of the item updates of LruStorage.
+//
+// A record holds the index and the new bytes of one item, followed by a
+// checksum of both. Records are buffered in memory and appended by Sync()
+// with one fsync, so the cost of durability doesn't depend on how many items
+// were updated since the last Sync(). Once the storage image is flushed to
+// the disk, Reset() truncates the log.
+class LruStorageLog {
+ public:
+  LruStorageLog() = default;
+  LruStorageLog(const LruStorageLog &) = delete;
+  LruStorageLog &operator=(const LruStorageLog &) = delete;
+  ~LruStorageLog() { Close(); }
+
+  // Creates an empty log at `filename` for a storage of the given format.
+  // The existing file is truncated.
+  absl::Status Open(const std::string &filename, uint32_t value_size,
+                    uint32_t size, uint32_t seed);
+  void Close();
+
+  // Calls `apply` for each record of `filename` in order, and returns the
+  // number of applied records. Replay stops at the first record with a wrong
+  // checksum, which is the torn tail of an interrupted append. A log written
+  // for a different storage format has no records.
+  static size_t Replay(
+      const std::string &filename, uint32_t value_size, uint32_t size,
+      uint32_t seed,
+      absl::FunctionRef<void(uint32_t index, absl::string_view item)> apply);
+
+  // Buffers a record. `item` must be `value_size` + kItemHeaderSize bytes
+  // long.
+  void Add(uint32_t index, absl::string_view item);
+
+  // Appends the buffered records and waits for them to reach the disk. If this
+  // fails, the records stay buffered, and the next call first truncates the
+  // log back to the last synced record so that a partially written record
+  // doesn't hide the retried ones from Replay().
+  absl::Status Sync();
+
+  // Drops all the records including the buffered ones.
+  absl::Status Reset();
+
+  // Returns the number of records since the last Reset(), including the
+  // buffered ones.
+  size_t num_records() const { return num_records_; }
+
+  // Returns the number of records not synced yet.
+  size_t num_buffered_records() const { return num_buffered_records_; }
+
+  // The byte length of the file header: magic, value size, LRU capacity and
+  // fingerprint seed.
+  static constexpr size_t kHeaderSize = 16;
+
+  // The byte length of the item header of LruStorage: fingerprint (8 bytes)
+  // and timestamp (4 bytes).
+  static constexpr size_t kItemHeaderSize = 12;
+
+ private:
+  absl::Status WriteAll(absl::string_view data);
+
+  int fd_ = -1;
+  size_t num_records_ = 0;
+  size_t num_buffered_records_ = 0;
+  std::string buffer_;
+  // The file size up to the last synced record.
+  size_t synced_size_ = 0;
+  // True if the file may have bytes after `synced_size_`.
+  bool torn_ = false;
+};
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_LRU_STORAGE_LOG_H_
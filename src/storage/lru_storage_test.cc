@@ -35,27 +35,44 @@
 #include <functional>
 #include <iterator>
 #include <limits>
+#include <list>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/check.h"
+#include "absl/log/log.h"
 #include "absl/random/random.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "base/clock_mock.h"
 #include "base/file/temp_dir.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/random.h"
 #include "storage/lru_cache.h"
+#include "storage/lru_storage_log.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/resource.h>
+#endif  // _WIN32
+
 namespace mozc {
 namespace storage {
 namespace {
 
+using ::testing::ElementsAre;
+
 constexpr uint32_t kSeed = 0x76fef;  // Seed for fingerprint.
 
 void RunTest(LruStorage *storage, uint32_t size) {
@@ -557,5 +574,384 @@ TEST_F(LruStorageTest, OldDataAreNotLookedUp) {
   EXPECT_TRUE(storage.Touch("4444"));
 }
 
+TEST_F(LruStorageTest, RandomOperationsKeepRecencyOrder) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 100;
+  TempFile file(testing::MakeTempFileOrDie());
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(file.path().c_str(), kValueSize,
+                                   kNumElements, kSeed));
+
+  // The front is the most recently used key.
+  std::list<std::string> expected;
+  auto move_to_front = [&expected](const std::string &key) {
+    expected.remove(key);
+    expected.push_front(key);
+  };
+  auto get_expected_values = [&expected]() {
+    std::vector<std::string> values;
+    for (const std::string &key : expected) {
+      values.push_back(key.substr(0, kValueSize));
+    }
+    return values;
+  };
+
+  absl::BitGen gen;
+  for (int i = 0; i < 10000; ++i) {
+    // Distinct timestamps make the order after reopening unambiguous.
+    clock->Advance(absl::Seconds(1));
+    const std::string key = absl::StrFormat("%04d", absl::Uniform(gen, 0, 300));
+    const bool exists = absl::c_linear_search(expected, key);
+    switch (absl::Uniform(gen, 0, 4)) {
+      case 0:
+        EXPECT_EQ(storage.Touch(key), exists);
+        if (exists) {
+          move_to_front(key);
+        }
+        break;
+      case 1:
+        EXPECT_TRUE(storage.Delete(key));
+        expected.remove(key);
+        break;
+      default:
+        EXPECT_TRUE(storage.Insert(key, key.data()));
+        move_to_front(key);
+        if (expected.size() > kNumElements) {
+          expected.pop_back();
+        }
+        break;
+    }
+    ASSERT_EQ(storage.used_size(), expected.size());
+    EXPECT_EQ(storage.LookupAsString(key),
+              absl::c_linear_search(expected, key) ? absl::string_view(key)
+                                                   : absl::string_view());
+  }
+
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_EQ(values, get_expected_values());
+
+  // Reopening restores the same order from the timestamps.
+  storage.Close();
+  ASSERT_TRUE(storage.Open(file.path().c_str()));
+  storage.GetAllValues(&values);
+  EXPECT_EQ(values, get_expected_values());
+  for (const std::string &key : expected) {
+    EXPECT_EQ(storage.LookupAsString(key), key);
+  }
+}
+
+// Simulates a power loss after the given Sync(): the file loses the updates
+// since `image` was taken, and the log keeps what was synced.
+class LruStorageLogTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kValueSize = 4;
+  static constexpr size_t kNumElements = 16;
+
+  void SetUp() override {
+    log_file_ = std::make_unique<TempFile>(
+        LruStorage::GetLogFileName(file_.path()));
+  }
+
+  std::unique_ptr<LruStorage> OpenStorage() {
+    auto storage = std::make_unique<LruStorage>();
+    storage->set_use_write_ahead_log(true);
+    EXPECT_TRUE(storage->OpenOrCreate(file_.path().c_str(), kValueSize,
+                                      kNumElements, kSeed));
+    return storage;
+  }
+
+  std::string ReadFile(const std::string &path) {
+    absl::StatusOr<std::string> contents = FileUtil::GetContents(path);
+    EXPECT_OK(contents);
+    return contents.value_or("");
+  }
+
+  // Closes `storage` and restores the file and the log to the given contents.
+  void Crash(std::unique_ptr<LruStorage> storage, absl::string_view image,
+             absl::string_view log) {
+    storage.reset();
+    ASSERT_OK(FileUtil::SetContents(file_.path(), image));
+    ASSERT_OK(FileUtil::SetContents(log_file_->path(), log));
+  }
+
+  TempFile file_{testing::MakeTempFileOrDie()};
+  std::unique_ptr<TempFile> log_file_;
+};
+
+TEST_F(LruStorageLogTest, ReplaysSyncedUpdates) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  ASSERT_TRUE(storage->Insert("1111", "aaaa"));
+  ASSERT_TRUE(storage->Sync());
+  const std::string image = ReadFile(file_.path());
+
+  clock->Advance(absl::Seconds(1));
+  ASSERT_TRUE(storage->Insert("2222", "bbbb"));
+  clock->Advance(absl::Seconds(1));
+  ASSERT_TRUE(storage->Insert("3333", "cccc"));
+  ASSERT_TRUE(storage->Delete("1111"));
+  ASSERT_TRUE(storage->Sync());
+  const std::string log = ReadFile(log_file_->path());
+
+  // Not synced.
+  ASSERT_TRUE(storage->Insert("4444", "dddd"));
+
+  Crash(std::move(storage), image, log);
+  storage = OpenStorage();
+  EXPECT_EQ(storage->used_size(), 2);
+  EXPECT_EQ(storage->Lookup("1111"), nullptr);
+  EXPECT_EQ(storage->LookupAsString("2222"), "bbbb");
+  EXPECT_EQ(storage->LookupAsString("3333"), "cccc");
+  EXPECT_EQ(storage->Lookup("4444"), nullptr);
+  std::vector<std::string> values;
+  storage->GetAllValues(&values);
+  EXPECT_THAT(values, ElementsAre("cccc", "bbbb"));
+
+  // The replayed records are applied to the file and the log is truncated.
+  EXPECT_EQ(ReadFile(log_file_->path()).size(), LruStorageLog::kHeaderSize);
+}
+
+TEST_F(LruStorageLogTest, IgnoresTornTail) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  const std::string image = ReadFile(file_.path());
+  ASSERT_TRUE(storage->Insert("1111", "aaaa"));
+  ASSERT_TRUE(storage->Sync());
+  ASSERT_TRUE(storage->Insert("2222", "bbbb"));
+  ASSERT_TRUE(storage->Sync());
+  std::string log = ReadFile(log_file_->path());
+
+  // Cut the last record in the middle.
+  log.resize(log.size() - 3);
+  Crash(std::move(storage), image, log);
+  storage = OpenStorage();
+  EXPECT_EQ(storage->used_size(), 1);
+  EXPECT_EQ(storage->LookupAsString("1111"), "aaaa");
+
+  // Corrupt the only record.
+  const std::string image2 = ReadFile(file_.path());
+  ASSERT_TRUE(storage->Insert("3333", "cccc"));
+  ASSERT_TRUE(storage->Sync());
+  log = ReadFile(log_file_->path());
+  log[LruStorageLog::kHeaderSize + 6] ^= 1;
+  Crash(std::move(storage), image2, log);
+  storage = OpenStorage();
+  EXPECT_EQ(storage->Lookup("3333"), nullptr);
+}
+
+TEST_F(LruStorageLogTest, RepairsFileWithUnsyncedUpdates) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  ASSERT_TRUE(storage->Insert("1111", "aaaa"));
+  ASSERT_TRUE(storage->Insert("2222", "bbbb"));
+  ASSERT_TRUE(storage->Delete("1111"));
+  ASSERT_TRUE(storage->Sync());
+  const std::string log = ReadFile(log_file_->path());
+
+  // The file has reached the disk with updates that are not in the log.
+  // Replaying the deletion leaves a hole before "4444".
+  clock->Advance(absl::Seconds(1));
+  ASSERT_TRUE(storage->Insert("3333", "cccc"));
+  clock->Advance(absl::Seconds(1));
+  ASSERT_TRUE(storage->Insert("4444", "dddd"));
+  const std::string image = ReadFile(file_.path());
+
+  Crash(std::move(storage), image, log);
+  storage = OpenStorage();
+  std::vector<std::string> values;
+  storage->GetAllValues(&values);
+  EXPECT_THAT(values, ElementsAre("dddd", "bbbb"));
+
+  // The storage stays consistent for further updates.
+  for (int i = 0; i < 100; ++i) {
+    clock->Advance(absl::Seconds(1));
+    ASSERT_TRUE(storage->Insert(absl::StrFormat("%04d", i), "abcd"));
+    ASSERT_TRUE(storage->Delete(absl::StrFormat("%04d", i / 2)));
+  }
+  EXPECT_EQ(storage->used_size(), kNumElements);
+  storage->GetAllValues(&values);
+  EXPECT_EQ(values.size(), kNumElements);
+}
+
+TEST_F(LruStorageLogTest, RecoversBrokenFile) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  ASSERT_TRUE(storage->Insert("1111", "aaaa"));
+  ASSERT_TRUE(storage->Insert("2222", "bbbb"));
+  ASSERT_TRUE(storage->Sync());
+  const std::string log = ReadFile(log_file_->path());
+
+  // A file of a wrong size is recreated by OpenOrCreate().
+  Crash(std::move(storage), "broken", log);
+  storage = OpenStorage();
+  EXPECT_EQ(storage->LookupAsString("1111"), "aaaa");
+  EXPECT_EQ(storage->LookupAsString("2222"), "bbbb");
+}
+
+TEST_F(LruStorageLogTest, ClearIsDurable) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  const std::string image = ReadFile(file_.path());
+  ASSERT_TRUE(storage->Insert("1111", "aaaa"));
+  ASSERT_TRUE(storage->Sync());
+  ASSERT_TRUE(storage->Clear());
+  const std::string log = ReadFile(log_file_->path());
+
+  Crash(std::move(storage), image, log);
+  storage = OpenStorage();
+  EXPECT_EQ(storage->used_size(), 0);
+}
+
+TEST_F(LruStorageLogTest, SyncTruncatesLongLog) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  for (int i = 0; i < 5000; ++i) {
+    clock->Advance(absl::Seconds(1));
+    ASSERT_TRUE(storage->Insert(absl::StrFormat("%04d", i), "abcd"));
+  }
+  ASSERT_TRUE(storage->Sync());
+  EXPECT_EQ(ReadFile(log_file_->path()).size(), LruStorageLog::kHeaderSize);
+
+  ASSERT_TRUE(storage->Touch("4999"));
+  ASSERT_TRUE(storage->Sync());
+  EXPECT_GT(ReadFile(log_file_->path()).size(), LruStorageLog::kHeaderSize);
+
+  // Closing also truncates the log.
+  storage.reset();
+  EXPECT_EQ(ReadFile(log_file_->path()).size(), LruStorageLog::kHeaderSize);
+}
+
+TEST_F(LruStorageLogTest, SyncsLongBuffer) {
+  ScopedClockMock clock(absl::FromUnixSeconds(1000000));
+  std::unique_ptr<LruStorage> storage = OpenStorage();
+  // The records are synced without Sync() before the buffer gets long.
+  for (int i = 0; i < 5000; ++i) {
+    clock->Advance(absl::Seconds(1));
+    ASSERT_TRUE(storage->Insert(absl::StrFormat("%04d", i), "abcd"));
+  }
+  EXPECT_GT(ReadFile(log_file_->path()).size(), LruStorageLog::kHeaderSize);
+}
+
+#ifndef _WIN32
+TEST_F(LruStorageLogTest, RetriesTornAppend) {
+  constexpr size_t kItemSize = LruStorageLog::kItemHeaderSize + kValueSize;
+  LruStorageLog log;
+  ASSERT_OK(log.Open(log_file_->path(), kValueSize, kNumElements, kSeed));
+  const std::string item1(kItemSize, '1'), item2(kItemSize, '2');
+  log.Add(0, item1);
+  ASSERT_OK(log.Sync());
+  const size_t synced_size = ReadFile(log_file_->path()).size();
+
+  // Makes the append stop in the middle of the second record.
+  struct sigaction ignore = {}, old_action;
+  ignore.sa_handler = SIG_IGN;
+  ASSERT_EQ(sigaction(SIGXFSZ, &ignore, &old_action), 0);
+  struct rlimit old_limit;
+  ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+  struct rlimit limit = old_limit;
+  limit.rlim_cur = synced_size + kItemSize + 8 + kItemSize / 2;
+  ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+  log.Add(1, item1);
+  log.Add(2, item2);
+  const absl::Status status = log.Sync();
+  ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &old_limit), 0);
+  ASSERT_EQ(sigaction(SIGXFSZ, &old_action, nullptr), 0);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(ReadFile(log_file_->path()).size(), limit.rlim_cur);
+
+  // The retry overwrites the torn record, so that all the records replay.
+  log.Add(3, item2);
+  ASSERT_OK(log.Sync());
+  std::vector<uint32_t> indices;
+  EXPECT_EQ(LruStorageLog::Replay(
+                log_file_->path(), kValueSize, kNumElements, kSeed,
+                [&](uint32_t index, absl::string_view item) {
+                  indices.push_back(index);
+                  EXPECT_EQ(item, index < 2 ? item1 : item2);
+                }),
+            4);
+  EXPECT_THAT(indices, ElementsAre(0, 1, 2, 3));
+}
+#endif  // _WIN32
+
+class LruStorageLatencyTest : public ::testing::TestWithParam<uint32_t> {};
+
+TEST_P(LruStorageLatencyTest, OpenLookupInsert) {
+  constexpr absl::Time kNow = absl::FromUnixSeconds(1700000000);
+  ScopedClockMock clock(kNow);
+  constexpr size_t kValueSize = 4;
+  const uint32_t num_elements = GetParam();
+  TempFile file(testing::MakeTempFileOrDie());
+  ASSERT_TRUE(LruStorage::CreateStorageFile(file.path().c_str(), kValueSize,
+                                            num_elements, kSeed));
+
+  std::vector<std::string> keys;
+  std::vector<uint32_t> ages;
+  for (uint32_t i = 0; i < num_elements; ++i) {
+    keys.push_back(absl::StrFormat("%07d", i));
+    ages.push_back(i);
+  }
+  absl::BitGen gen;
+  std::shuffle(ages.begin(), ages.end(), gen);
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.path().c_str()));
+    for (uint32_t i = 0; i < num_elements; ++i) {
+      storage.Write(i, FingerprintWithSeed(keys[i], kSeed),
+                    absl::string_view(keys[i]).substr(0, kValueSize),
+                    absl::ToUnixSeconds(kNow) - ages[i]);
+    }
+  }
+  std::vector<std::string> new_keys;
+  for (uint32_t i = 0; i < num_elements; ++i) {
+    new_keys.push_back(absl::StrFormat("new%07d", i));
+  }
+
+  // Stopwatch follows the mocked clock, so measure with absl::Now().
+  LruStorage storage;
+  absl::Time start = absl::Now();
+  ASSERT_TRUE(storage.Open(file.path().c_str()));
+  const absl::Duration open_time = absl::Now() - start;
+  EXPECT_EQ(storage.used_size(), num_elements);
+
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  ASSERT_EQ(values.size(), num_elements);
+  const size_t newest = absl::c_find(ages, 0) - ages.begin();
+  EXPECT_EQ(values.front(), keys[newest].substr(0, kValueSize));
+
+  start = absl::Now();
+  size_t found = 0;
+  for (const std::string &key : keys) {
+    found += storage.Lookup(key) != nullptr;
+  }
+  const absl::Duration lookup_time = (absl::Now() - start) / num_elements;
+  EXPECT_EQ(found, num_elements);
+
+  // Every insertion evicts the least recently used item.
+  start = absl::Now();
+  for (const std::string &key : new_keys) {
+    storage.Insert(key, "abcd");
+  }
+  const absl::Duration insert_time = (absl::Now() - start) / num_elements;
+  EXPECT_EQ(storage.used_size(), num_elements);
+  EXPECT_EQ(storage.Lookup(keys[0]), nullptr);
+  EXPECT_EQ(storage.LookupAsString(new_keys[0]), "abcd");
+
+  LOG(INFO) << "size=" << num_elements << " Open: " << open_time
+            << " Lookup: " << lookup_time << " Insert: " << insert_time;
+}
+
+INSTANTIATE_TEST_SUITE_P(SmallSize, LruStorageLatencyTest,
+                         ::testing::Values(1000));
+
+// Logs the latency for the real sizes when run with
+// --gtest_also_run_disabled_tests. 20000 is the size of the user segment
+// history, and 1000000 is the maximum size that LruStorage accepts.
+INSTANTIATE_TEST_SUITE_P(DISABLED_MaxSizes, LruStorageLatencyTest,
+                         ::testing::Values(20000, 1000000));
+
 }  // namespace storage
 }  // namespace mozc
@@ -29,19 +29,29 @@
 
 #include "storage/registry.h"
 
+#include <array>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/log/log.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "base/file_util.h"
 #include "base/port.h"
 #include "base/singleton.h"
 #include "base/system_util.h"
+#include "base/thread.h"
 #include "base/vlog.h"
 #include "storage/storage_interface.h"
 #include "storage/tiny_storage.h"
@@ -50,8 +60,22 @@ namespace mozc {
 namespace storage {
 namespace {
 
+// Guards the backing storage. Lookups hitting the write-behind buffer and all
+// Inserts/Erases never take this lock.
 ABSL_CONST_INIT absl::Mutex g_mutex(absl::kConstInit);
 
+// The number of shards of the write-behind buffer. Must be a power of two.
+constexpr size_t kNumShards = 16;
+
+// The pending writes are merged into the storage and synced to the disk at
+// most this interval after the first pending write.
+constexpr absl::Duration kFlushInterval = absl::Seconds(30);
+
+// The maximum number of keys pending in one shard. A write of a new key to a
+// full shard is merged into the storage synchronously instead, so that its
+// result is known. All the shards together hold as many keys as TinyStorage.
+constexpr size_t kMaxPendingWritesPerShard = 1024 / kNumShards;
+
 constexpr absl::string_view RegistryFileName() {
   if constexpr (TargetIsWindows()) {
     return "registry.db";
@@ -60,13 +84,45 @@ constexpr absl::string_view RegistryFileName() {
   }
 }
 
+// Holds the pending writes which are not merged into the storage yet.
+// std::nullopt represents an erased key.
+struct ABSL_CACHELINE_ALIGNED Shard {
+  absl::Mutex mutex;
+  absl::flat_hash_map<std::string, std::optional<std::string>> pending
+      ABSL_GUARDED_BY(mutex);
+};
+
 class StorageInitializer {
  public:
-  StorageInitializer() { SetStorage(TinyStorage::New()); }
+  // Singleton<StorageInitializer>::get() may or may not be called with
+  // g_mutex held, so the analysis cannot be applied here.
+  StorageInitializer() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    SetStorage(TinyStorage::New());
+  }
 
-  StorageInterface *GetStorage() const { return storage_.get(); }
+  ~StorageInitializer() {
+    {
+      absl::MutexLock l(&flusher_mutex_);
+      if (flusher_.has_value()) {
+        stop_.Notify();
+        flusher_->Join();
+      }
+    }
+    absl::MutexLock l(&g_mutex);
+    FlushPendingWrites();
+    storage_->Sync();
+  }
+
+  StorageInterface *GetStorage() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_mutex) {
+    return storage_.get();
+  }
 
-  void SetStorage(std::unique_ptr<StorageInterface> storage) {
+  void SetStorage(std::unique_ptr<StorageInterface> storage)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_mutex) {
+    // Pending writes belong to the old storage.
+    if (storage_ != nullptr) {
+      FlushPendingWrites();
+    }
     storage_ = std::move(storage);
     if (!storage_->Open(FileUtil::JoinPath(
             SystemUtil::GetUserProfileDirectory(), RegistryFileName()))) {
@@ -74,25 +130,166 @@ class StorageInitializer {
     }
   }
 
+  // Returns std::nullopt if |key| has no pending write. Otherwise returns
+  // the pending value, which is std::nullopt when |key| is pending erasure.
+  std::optional<std::optional<std::string>> LookupPending(
+      const std::string &key) {
+    Shard &shard = GetShard(key);
+    absl::MutexLock l(&shard.mutex);
+    const auto it = shard.pending.find(key);
+    if (it == shard.pending.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // Inserts |key| into the storage. The write is usually only added to the
+  // shard, and is merged into the storage later. If the shard is full, the
+  // write is merged immediately and the result of the storage is returned.
+  bool Insert(const std::string &key, const std::string &value) {
+    bool added = false;
+    {
+      Shard &shard = GetShard(key);
+      absl::MutexLock l(&shard.mutex);
+      if (shard.pending.size() < kMaxPendingWritesPerShard ||
+          shard.pending.contains(key)) {
+        shard.pending.insert_or_assign(key, value);
+        added = true;
+      }
+    }
+    if (added) {
+      StartFlusherOnce();
+      return true;
+    }
+    absl::MutexLock l(&g_mutex);
+    FlushPendingWrites();
+    return storage_->Insert(key, value);
+  }
+
+  // Erases |key|. Returns false if |key| is neither pending nor stored. The
+  // key is checked and erased under the same shard lock, so concurrent
+  // Erase() calls for the same key succeed only once.
+  bool Erase(const std::string &key) {
+    Shard &shard = GetShard(key);
+    {
+      absl::MutexLock l(&shard.mutex);
+      if (EraseIfPending(shard, key)) {
+        return true;
+      }
+    }
+    {
+      // The storage lock must be taken before the shard lock.
+      absl::MutexLock storage_lock(&g_mutex);
+      absl::MutexLock l(&shard.mutex);
+      if (!EraseIfPending(shard, key)) {
+        std::string unused;
+        if (shard.pending.contains(key) || !storage_->Lookup(key, &unused)) {
+          MOZC_VLOG(2) << "cannot erase key: " << key;
+          return false;
+        }
+        shard.pending.insert_or_assign(key, std::nullopt);
+      }
+    }
+    StartFlusherOnce();
+    return true;
+  }
+
+  // Merges all the pending writes into the storage. Returns false if the
+  // storage rejected some of them.
+  bool FlushPendingWrites() ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_mutex) {
+    bool result = true;
+    for (Shard &shard : shards_) {
+      absl::flat_hash_map<std::string, std::optional<std::string>> pending;
+      {
+        // The storage lock is held while the shard is swapped out so that
+        // Lookup() never observes a value neither pending nor stored.
+        absl::MutexLock l(&shard.mutex);
+        pending.swap(shard.pending);
+      }
+      for (auto &[key, value] : pending) {
+        if (value.has_value()) {
+          if (!storage_->Insert(key, *value)) {
+            LOG(WARNING) << "cannot insert: " << key;
+            result = false;
+          }
+        } else {
+          storage_->Erase(key);
+        }
+      }
+    }
+    return result;
+  }
+
+  void DiscardPendingWrites() ABSL_EXCLUSIVE_LOCKS_REQUIRED(g_mutex) {
+    for (Shard &shard : shards_) {
+      absl::MutexLock l(&shard.mutex);
+      shard.pending.clear();
+    }
+  }
+
  private:
-  std::unique_ptr<StorageInterface> storage_;
+  Shard &GetShard(const std::string &key) {
+    return shards_[absl::Hash<std::string>{}(key) & (kNumShards - 1)];
+  }
+
+  // Marks |key| erased if it has a pending value. Returns false if |key| has
+  // no pending write or is already pending erasure.
+  static bool EraseIfPending(Shard &shard, const std::string &key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex) {
+    const auto it = shard.pending.find(key);
+    if (it == shard.pending.end() || !it->second.has_value()) {
+      return false;
+    }
+    it->second = std::nullopt;
+    return true;
+  }
+
+  void StartFlusherOnce() {
+    absl::MutexLock l(&flusher_mutex_);
+    if (!flusher_.has_value()) {
+      flusher_.emplace([this] { FlusherMain(); });
+    }
+  }
+
+  void FlusherMain() {
+    while (!stop_.WaitForNotificationWithTimeout(kFlushInterval)) {
+      absl::MutexLock l(&g_mutex);
+      FlushPendingWrites();
+      // TinyStorage rewrites the file with an atomic rename only when the
+      // contents were modified.
+      if (!storage_->Sync()) {
+        LOG(ERROR) << "cannot sync registry";
+      }
+    }
+    MOZC_VLOG(1) << "Registry flusher stopped";
+  }
+
+  std::unique_ptr<StorageInterface> storage_ ABSL_GUARDED_BY(g_mutex);
+  std::array<Shard, kNumShards> shards_;
+
+  absl::Mutex flusher_mutex_;
+  std::optional<Thread> flusher_ ABSL_GUARDED_BY(flusher_mutex_);
+  absl::Notification stop_;
 };
 }  // namespace
 
 bool Registry::Erase(const std::string &key) {
-  absl::MutexLock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Erase(key);
+  return Singleton<StorageInitializer>::get()->Erase(key);
 }
 
 bool Registry::Sync() {
   absl::MutexLock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Sync();
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  const bool flushed = initializer->FlushPendingWrites();
+  return initializer->GetStorage()->Sync() && flushed;
 }
 
 // clear internal keys and values
 bool Registry::Clear() {
   absl::MutexLock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Clear();
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  initializer->DiscardPendingWrites();
+  return initializer->GetStorage()->Clear();
 }
 
 void Registry::SetStorage(std::unique_ptr<StorageInterface> handler) {
@@ -102,14 +299,21 @@ void Registry::SetStorage(std::unique_ptr<StorageInterface> handler) {
 }
 
 bool Registry::LookupInternal(const std::string &key, std::string *value) {
-  absl::MutexLock l(&g_mutex);  // just for safe
-  return Singleton<StorageInitializer>::get()->GetStorage()->Lookup(key, value);
+  StorageInitializer *initializer = Singleton<StorageInitializer>::get();
+  if (auto pending = initializer->LookupPending(key); pending.has_value()) {
+    if (!pending->has_value()) {
+      return false;  // erased
+    }
+    *value = *std::move(*pending);
+    return true;
+  }
+  absl::MutexLock l(&g_mutex);
+  return initializer->GetStorage()->Lookup(key, value);
 }
 
 bool Registry::InsertInternal(const std::string &key,
                               const std::string &value) {
-  absl::MutexLock l(&g_mutex);
-  return Singleton<StorageInitializer>::get()->GetStorage()->Insert(key, value);
+  return Singleton<StorageInitializer>::get()->Insert(key, value);
 }
 }  // namespace storage
 }  // namespace mozc
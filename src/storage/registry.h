@@ -43,8 +43,13 @@ namespace storage {
 
 // The idea of Registry module is the same as Windows Registry.
 // You can use it for saving small data like timestamp, auth_token.
-// DO NOT USE it to save big data or data which are frequently updated.
-// Lookup() and Insert() do process-wide global lock and it may be slow.
+// DO NOT USE it to save big data.
+// Insert() and Erase() are write-behind: they only update a sharded in-memory
+// buffer, which is merged into the storage and synced to the disk by a
+// background thread at bounded intervals, or by Sync(). When the buffer is
+// full, Insert() merges it into the storage synchronously. Lookup() and
+// Erase() take the process-wide storage lock only when the key has no pending
+// write.
 // All methods are thread-safe.
 //
 // TODO(taku): Currently, Registry won't guarantee that two processes
@@ -89,7 +94,9 @@ class Registry {
   }
 
   // insert key and data
-  // It is not guaranteed that the data is synced to the disk
+  // It is not guaranteed that the data is synced to the disk.
+  // Errors of the underlying storage for buffered writes are reported by
+  // Sync().
   template <typename T>
   static bool Insert(const std::string &key, const T &value) {
     std::string tmp(reinterpret_cast<const char *>(&value), sizeof(value));
@@ -109,7 +116,7 @@ class Registry {
     return Insert<uint8_t>(key, tmp);
   }
 
-  // Syncing the data into disk
+  // Merges the pending writes into the storage and syncs the data into disk.
   static bool Sync();
 
   // Erase key
@@ -29,9 +29,19 @@
 
 #include "storage/registry.h"
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "base/file_util.h"
+#include "base/port.h"
+#include "base/system_util.h"
+#include "base/thread.h"
+#include "storage/storage_interface.h"
+#include "storage/tiny_storage.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 
@@ -39,7 +49,11 @@ namespace mozc {
 namespace storage {
 namespace {
 
-class RegistryTest : public testing::TestWithTempUserProfile {};
+class RegistryTest : public testing::TestWithTempUserProfile {
+ protected:
+  // Rebinds the registry to the temporary user profile of each test.
+  void SetUp() override { Registry::SetStorage(TinyStorage::New()); }
+};
 
 TEST_F(RegistryTest, TinyStorageTest) {
   {
@@ -91,6 +105,98 @@ TEST_F(RegistryTest, TinyStorageTest) {
   }
 }
 
+TEST_F(RegistryTest, WriteBehind) {
+  EXPECT_TRUE(Registry::Insert("key", std::string("value1")));
+  EXPECT_TRUE(Registry::Insert("key", std::string("value2")));
+  std::string value;
+  EXPECT_TRUE(Registry::Lookup("key", &value));
+  EXPECT_EQ(value, "value2");
+
+  EXPECT_TRUE(Registry::Erase("key"));
+  EXPECT_FALSE(Registry::Lookup("key", &value));
+  EXPECT_FALSE(Registry::Erase("key"));
+
+  EXPECT_TRUE(Registry::Insert("key", std::string("value3")));
+  EXPECT_TRUE(Registry::Sync());
+  EXPECT_TRUE(Registry::Lookup("key", &value));
+  EXPECT_EQ(value, "value3");
+
+  // The pending writes are visible in the file after Sync().
+  const std::string filename =
+      FileUtil::JoinPath(SystemUtil::GetUserProfileDirectory(),
+                         TargetIsWindows() ? "registry.db" : ".registry.db");
+  std::unique_ptr<StorageInterface> storage = TinyStorage::Create(filename);
+  ASSERT_NE(storage, nullptr);
+  EXPECT_TRUE(storage->Lookup("key", &value));
+  EXPECT_EQ(value, "value3");
+
+  EXPECT_TRUE(Registry::Clear());
+  EXPECT_FALSE(Registry::Lookup("key", &value));
+}
+
+TEST_F(RegistryTest, InsertReportsStorageErrors) {
+  // TinyStorage holds at most 1024 keys. Once the buffer is full, the
+  // rejected writes are reported by Insert().
+  int failures = 0;
+  for (uint32_t i = 0; i < 2048; ++i) {
+    if (!Registry::Insert(absl::StrCat("key", i), i)) {
+      ++failures;
+    }
+  }
+  EXPECT_GT(failures, 0);
+  EXPECT_TRUE(Registry::Clear());
+}
+
+TEST_F(RegistryTest, ConcurrentErase) {
+  constexpr int kNumThreads = 4;
+  for (const bool synced : {false, true}) {
+    SCOPED_TRACE(synced);
+    ASSERT_TRUE(Registry::Insert("key", std::string("value")));
+    if (synced) {
+      ASSERT_TRUE(Registry::Sync());
+    }
+    std::atomic<int> erased = 0;
+    std::vector<Thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&erased] {
+        if (Registry::Erase("key")) {
+          ++erased;
+        }
+      });
+    }
+    for (Thread &thread : threads) {
+      thread.Join();
+    }
+    EXPECT_EQ(erased, 1);
+  }
+  EXPECT_TRUE(Registry::Clear());
+}
+
+TEST_F(RegistryTest, ConcurrentInsert) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumKeys = 100;
+  std::vector<Thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i] {
+      for (uint32_t j = 0; j < kNumKeys; ++j) {
+        EXPECT_TRUE(Registry::Insert(absl::StrCat("key", i, "_", j), j));
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_TRUE(Registry::Sync());
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (uint32_t j = 0; j < kNumKeys; ++j) {
+      uint32_t value = 0;
+      EXPECT_TRUE(Registry::Lookup(absl::StrCat("key", i, "_", j), &value));
+      EXPECT_EQ(value, j);
+    }
+  }
+  EXPECT_TRUE(Registry::Clear());
+}
+
 }  // namespace
 }  // namespace storage
 }  // namespace mozc
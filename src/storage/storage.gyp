@@ -37,6 +37,7 @@
         'encrypted_string_storage.cc',
         'existence_filter.cc',
         'lru_storage.cc',
+        'lru_storage_log.cc',
         'registry.cc',
         'tiny_storage.cc',
       ],
@@ -54,10 +54,8 @@ namespace {
 
 // Prints a greeting message when a process starts.
 void PrintGreetingMessage() {
-  config::Config config;
-  config::ConfigHandler::GetConfig(&config);
   absl::string_view preedit_method = "unknown";
-  switch (config.preedit_method()) {
+  switch (config::ConfigHandler::GetSharedConfig()->preedit_method()) {
     case config::Config::ROMAN:
       preedit_method = "roman";
       break;
@@ -84,6 +84,7 @@
         'mozc_engine_factory.cc',
         'mozc_state.cc',
         'mozc_client_pool.cc',
+        'key_event_queue.cc',
       ],
       'dependencies': [
         '<@(fcitx_dependencies)',
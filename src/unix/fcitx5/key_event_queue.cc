@@ -0,0 +1,155 @@
+// Copyright 2012~2013, Weng Xuetian <wengxt@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "unix/fcitx5/key_event_queue.h"
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
+#include "base/vlog.h"
+#include "client/client_interface.h"
+#include "protocol/commands.pb.h"
+
+namespace fcitx {
+
+KeyEventQueue::KeyEventQueue(mozc::client::ClientInterface *client,
+                             Dispatcher dispatcher)
+    : client_(client),
+      dispatcher_(std::move(dispatcher)),
+      self_(std::make_shared<KeyEventQueue *>(this)),
+      thread_([this] { Run(); }) {}
+
+KeyEventQueue::~KeyEventQueue() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+  }
+  thread_.Join();
+}
+
+void KeyEventQueue::Push(const void *owner, mozc::commands::KeyEvent event,
+                         mozc::commands::Context context, Handler handler) {
+  absl::MutexLock lock(&mutex_);
+  requests_.push_back(
+      {owner, std::move(event), std::move(context), std::move(handler)});
+}
+
+void KeyEventQueue::Flush() {
+  {
+    absl::MutexLock lock(
+        &mutex_,
+        absl::Condition(
+            +[](KeyEventQueue *q) ABSL_EXCLUSIVE_LOCKS_REQUIRED(q->mutex_) {
+              return q->requests_.empty() && !q->running_;
+            },
+            this));
+  }
+  Deliver();
+}
+
+void KeyEventQueue::Run() {
+  while (true) {
+    Request request;
+    {
+      absl::MutexLock lock(
+          &mutex_,
+          absl::Condition(
+              +[](KeyEventQueue *q) ABSL_EXCLUSIVE_LOCKS_REQUIRED(q->mutex_) {
+                return q->stopped_ || !q->requests_.empty();
+              },
+              this));
+      if (stopped_) {
+        return;
+      }
+      request = std::move(requests_.front());
+      requests_.pop_front();
+      running_ = true;
+    }
+
+    Reply reply = {request.owner, false, {}, std::move(request.handler)};
+    // EnsureConnection() restarts the server if needed, which may take a
+    // while. That's fine here as it only delays the replies.
+    reply.ok = client_->EnsureConnection() &&
+               client_->SendKeyWithContext(request.event, request.context,
+                                           &reply.output);
+    if (!reply.ok) {
+      MOZC_VLOG(1) << "SendKey failed";
+    }
+
+    bool schedule = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      replies_.push_back(std::move(reply));
+      running_ = false;
+      schedule = !scheduled_;
+      scheduled_ = true;
+    }
+    // Replies arriving before the event loop runs the task are handled by the
+    // same task.
+    if (schedule) {
+      dispatcher_([self = std::weak_ptr<KeyEventQueue *>(self_)] {
+        if (auto queue = self.lock()) {
+          (*queue)->Deliver();
+        }
+      });
+    }
+  }
+}
+
+void KeyEventQueue::Deliver() {
+  // A handler may delete this queue, e.g., by releasing the client.
+  const std::weak_ptr<KeyEventQueue *> self = self_;
+  while (!self.expired()) {
+    Reply reply;
+    bool more = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (replies_.empty()) {
+        scheduled_ = false;
+        return;
+      }
+      reply = std::move(replies_.front());
+      replies_.pop_front();
+      for (const Reply &next : replies_) {
+        if (next.owner == reply.owner) {
+          more = true;
+          break;
+        }
+      }
+    }
+    // Handlers may call Flush() and thus Deliver() recursively. Taking one
+    // reply at a time keeps them in order.
+    reply.handler(reply.ok, reply.output, more);
+  }
+}
+
+}  // namespace fcitx
@@ -0,0 +1,122 @@
+// Copyright 2012~2013, Weng Xuetian <wengxt@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef UNIX_FCITX5_KEY_EVENT_QUEUE_H_
+#define UNIX_FCITX5_KEY_EVENT_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "base/thread.h"
+#include "client/client_interface.h"
+#include "protocol/commands.pb.h"
+
+namespace fcitx {
+
+// Sends key events to mozc_server on a worker thread, so that a slow
+// conversion or a restarting server doesn't block the event loop of fcitx.
+//
+// Replies are handed back to the event loop through `Dispatcher` and their
+// handlers run there in the order the keys were pushed. Replies which are
+// ready by the time the event loop picks them up are handled together, and
+// the handler is told whether more replies for the same owner follow so that
+// it can skip redrawing the UI in between.
+//
+// Each key is still sent as its own request, as the IPC protocol carries one
+// key per Input. The queue only moves the round trips off the event loop.
+//
+// The client must not talk to the server from anyone else while keys are in
+// flight. Call Flush() before sending it a request directly.
+class KeyEventQueue {
+ public:
+  // Runs the given task on the event loop. Must be thread-safe.
+  using Dispatcher = std::function<void(std::function<void()>)>;
+  // `ok` is false if the IPC failed. `more` is true if the reply of a later
+  // key of the same owner is handled right after this one.
+  using Handler = std::function<void(
+      bool ok, const mozc::commands::Output &output, bool more)>;
+
+  KeyEventQueue(mozc::client::ClientInterface *client, Dispatcher dispatcher);
+
+  KeyEventQueue(const KeyEventQueue &) = delete;
+  KeyEventQueue &operator=(const KeyEventQueue &) = delete;
+
+  // Waits for the key in flight. The handlers of the keys not handled yet are
+  // discarded.
+  ~KeyEventQueue();
+
+  // Queues `event` and returns immediately. `owner` identifies the input
+  // context the key belongs to.
+  void Push(const void *owner, mozc::commands::KeyEvent event,
+            mozc::commands::Context context, Handler handler);
+
+  // Blocks until all the queued keys are sent, and runs their handlers. Must
+  // be called on the event loop.
+  void Flush();
+
+ private:
+  struct Request {
+    const void *owner;
+    mozc::commands::KeyEvent event;
+    mozc::commands::Context context;
+    Handler handler;
+  };
+  struct Reply {
+    const void *owner;
+    bool ok;
+    mozc::commands::Output output;
+    Handler handler;
+  };
+
+  void Run();
+  // Runs the handlers of the replies received so far.
+  void Deliver();
+
+  mozc::client::ClientInterface *client_;
+  const Dispatcher dispatcher_;
+  // Expires on destruction, so that a task still waiting on the event loop
+  // doesn't touch a deleted queue.
+  std::shared_ptr<KeyEventQueue *> self_;
+
+  absl::Mutex mutex_;
+  std::deque<Request> requests_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Reply> replies_ ABSL_GUARDED_BY(mutex_);
+  bool running_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // True while a Deliver() task is waiting on the event loop.
+  bool scheduled_ ABSL_GUARDED_BY(mutex_) = false;
+  mozc::Thread thread_;
+};
+
+}  // namespace fcitx
+
+#endif  // UNIX_FCITX5_KEY_EVENT_QUEUE_H_
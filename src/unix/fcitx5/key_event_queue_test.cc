@@ -0,0 +1,361 @@
+// Copyright 2012~2013, Weng Xuetian <wengxt@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "unix/fcitx5/key_event_queue.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/version.h"
+#include "client/client.h"
+#include "client/client_interface.h"
+#include "ipc/ipc.h"
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+
+namespace fcitx {
+namespace {
+
+using ::mozc::commands::Input;
+using ::mozc::commands::KeyEvent;
+using ::mozc::commands::Output;
+
+// Fake mozc_server. Every key takes `latency` to be answered, and nothing is
+// answered while the server is blocked.
+class FakeServer {
+ public:
+  void set_latency(absl::Duration latency) {
+    absl::MutexLock lock(&mutex_);
+    latency_ = latency;
+  }
+
+  void set_fail(bool fail) {
+    absl::MutexLock lock(&mutex_);
+    fail_ = fail;
+  }
+
+  void Block() {
+    absl::MutexLock lock(&mutex_);
+    blocked_ = true;
+  }
+
+  void Unblock() {
+    absl::MutexLock lock(&mutex_);
+    blocked_ = false;
+  }
+
+  // Waits until `num_keys` keys are answered in total.
+  void WaitForKeys(int num_keys) {
+    absl::MutexLock lock(&mutex_);
+    while (num_keys_ < num_keys) {
+      answered_.Wait(&mutex_);
+    }
+  }
+
+  bool Call(const std::string &request, std::string *response) {
+    Input input;
+    if (!input.ParseFromString(request)) {
+      return false;
+    }
+    absl::Duration latency;
+    {
+      absl::MutexLock lock(
+          &mutex_,
+          absl::Condition(
+              +[](FakeServer *s) ABSL_EXCLUSIVE_LOCKS_REQUIRED(s->mutex_) {
+                return !s->blocked_;
+              },
+              this));
+      if (fail_) {
+        return false;
+      }
+      latency = latency_;
+    }
+    Output output;
+    output.set_id(1);
+    if (input.type() == Input::SEND_KEY) {
+      absl::SleepFor(latency);
+      // Consumes everything but '!'.
+      output.set_consumed(input.key().key_code() != '!');
+      *output.mutable_key() = input.key();
+      absl::MutexLock lock(&mutex_);
+      ++num_keys_;
+      answered_.SignalAll();
+    }
+    return output.SerializeToString(response);
+  }
+
+ private:
+  absl::Mutex mutex_;
+  absl::CondVar answered_;
+  absl::Duration latency_ ABSL_GUARDED_BY(mutex_) = absl::ZeroDuration();
+  bool fail_ ABSL_GUARDED_BY(mutex_) = false;
+  bool blocked_ ABSL_GUARDED_BY(mutex_) = false;
+  int num_keys_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+class FakeIPCClient : public mozc::IPCClientInterface {
+ public:
+  explicit FakeIPCClient(FakeServer *server) : server_(server) {}
+
+  bool Connected() const override { return true; }
+  bool Call(const std::string &request, std::string *response,
+            absl::Duration timeout) override {
+    return server_->Call(request, response);
+  }
+  uint32_t GetServerProtocolVersion() const override {
+    return mozc::IPC_PROTOCOL_VERSION;
+  }
+  const std::string &GetServerProductVersion() const override {
+    return version_;
+  }
+  uint32_t GetServerProcessId() const override { return 0; }
+  mozc::IPCErrorType GetLastIPCError() const override {
+    return mozc::IPC_NO_ERROR;
+  }
+
+ private:
+  FakeServer *server_;
+  const std::string version_ = mozc::Version::GetMozcVersion();
+};
+
+class FakeIPCClientFactory : public mozc::IPCClientFactoryInterface {
+ public:
+  explicit FakeIPCClientFactory(FakeServer *server) : server_(server) {}
+
+  std::unique_ptr<mozc::IPCClientInterface> NewClient(
+      const std::string &name, const std::string &path_name) override {
+    return std::make_unique<FakeIPCClient>(server_);
+  }
+  std::unique_ptr<mozc::IPCClientInterface> NewClient(
+      const std::string &name) override {
+    return std::make_unique<FakeIPCClient>(server_);
+  }
+
+ private:
+  FakeServer *server_;
+};
+
+class FakeServerLauncher : public mozc::client::ServerLauncherInterface {
+ public:
+  bool StartServer(mozc::client::ClientInterface *client) override {
+    return true;
+  }
+  bool ForceTerminateServer(absl::string_view name) override { return true; }
+  bool WaitServer(uint32_t pid) override { return true; }
+  void OnFatal(ServerErrorType type) override {}
+  void set_server_program(absl::string_view server_program) override {}
+  const std::string &server_program() const override { return program_; }
+  void set_restricted(bool restricted) override {}
+  void set_suppress_error_dialog(bool suppress) override {}
+
+ private:
+  const std::string program_;
+};
+
+// Stands for the event loop of fcitx. Tasks run only when the test says so.
+class FakeEventLoop {
+ public:
+  KeyEventQueue::Dispatcher dispatcher() {
+    return [this](std::function<void()> task) {
+      absl::MutexLock lock(&mutex_);
+      tasks_.push_back(std::move(task));
+      ++num_tasks_;
+    };
+  }
+
+  // Runs the tasks dispatched so far.
+  void Run() {
+    std::vector<std::function<void()>> tasks;
+    {
+      absl::MutexLock lock(&mutex_);
+      tasks.swap(tasks_);
+    }
+    for (auto &task : tasks) {
+      task();
+    }
+  }
+
+  int num_tasks() {
+    absl::MutexLock lock(&mutex_);
+    return num_tasks_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::function<void()>> tasks_ ABSL_GUARDED_BY(mutex_);
+  int num_tasks_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+struct Handled {
+  bool ok;
+  bool consumed;
+  uint32_t key_code;
+  bool more;
+};
+
+class KeyEventQueueTest : public mozc::testing::TestWithTempUserProfile {
+ protected:
+  void SetUp() override {
+    client_ = std::make_unique<mozc::client::Client>();
+    client_->SetIPCClientFactory(&factory_);
+    client_->SetServerLauncher(std::make_unique<FakeServerLauncher>());
+    queue_ =
+        std::make_unique<KeyEventQueue>(client_.get(), loop_.dispatcher());
+  }
+
+  void TearDown() override {
+    queue_.reset();
+    client_.reset();
+  }
+
+  void Push(uint32_t key_code, const void *owner = nullptr) {
+    KeyEvent event;
+    event.set_key_code(key_code);
+    queue_->Push(owner, event, {},
+                 [this](bool ok, const Output &output, bool more) {
+                   handled_.push_back({ok, output.consumed(),
+                                       output.key().key_code(), more});
+                 });
+  }
+
+  FakeServer server_;
+  FakeIPCClientFactory factory_{&server_};
+  FakeEventLoop loop_;
+  std::unique_ptr<mozc::client::Client> client_;
+  std::unique_ptr<KeyEventQueue> queue_;
+  std::vector<Handled> handled_;
+};
+
+TEST_F(KeyEventQueueTest, PushDoesNotWaitForServer) {
+  server_.set_latency(absl::Milliseconds(200));
+  const absl::Time start = absl::Now();
+  for (char c : std::string("abcde")) {
+    Push(c);
+  }
+  EXPECT_LT(absl::Now() - start, absl::Milliseconds(200));
+  EXPECT_TRUE(handled_.empty());
+
+  queue_->Flush();
+  ASSERT_EQ(handled_.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(handled_[i].ok);
+    EXPECT_TRUE(handled_[i].consumed);
+    EXPECT_EQ(handled_[i].key_code, "abcde"[i]);
+  }
+}
+
+TEST_F(KeyEventQueueTest, HandlesRepliesOnEventLoopInOrder) {
+  server_.set_latency(absl::Milliseconds(5));
+  const std::string keys = "a!b!c";
+  for (char c : keys) {
+    Push(c);
+  }
+  server_.WaitForKeys(keys.size());
+  // Handlers run only on the event loop.
+  while (handled_.size() < keys.size()) {
+    loop_.Run();
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  ASSERT_EQ(handled_.size(), keys.size());
+  for (int i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(handled_[i].key_code, keys[i]);
+    EXPECT_EQ(handled_[i].consumed, keys[i] != '!');
+  }
+}
+
+TEST_F(KeyEventQueueTest, CoalescesRepliesUnderLoad) {
+  server_.Block();
+  for (char c : std::string("abcde")) {
+    Push(c);
+  }
+  server_.Unblock();
+  server_.WaitForKeys(5);
+  queue_->Flush();
+
+  // The event loop was busy while the replies arrived. They are handled by a
+  // single task, and only the last one needs to redraw.
+  EXPECT_EQ(loop_.num_tasks(), 1);
+  ASSERT_EQ(handled_.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(handled_[i].key_code, "abcde"[i]);
+    EXPECT_EQ(handled_[i].more, i < 4);
+  }
+
+  // The task left on the event loop has nothing to do.
+  loop_.Run();
+  EXPECT_EQ(handled_.size(), 5);
+}
+
+TEST_F(KeyEventQueueTest, MoreIsPerOwner) {
+  int owner1 = 0, owner2 = 0;
+  server_.Block();
+  Push('a', &owner1);
+  Push('b', &owner2);
+  Push('c', &owner1);
+  server_.Unblock();
+  queue_->Flush();
+
+  ASSERT_EQ(handled_.size(), 3);
+  EXPECT_TRUE(handled_[0].more);
+  EXPECT_FALSE(handled_[1].more);
+  EXPECT_FALSE(handled_[2].more);
+}
+
+TEST_F(KeyEventQueueTest, ReportsFailure) {
+  server_.set_fail(true);
+  Push('a');
+  queue_->Flush();
+  ASSERT_EQ(handled_.size(), 1);
+  EXPECT_FALSE(handled_[0].ok);
+}
+
+TEST_F(KeyEventQueueTest, DropsRepliesAfterDestruction) {
+  Push('a');
+  server_.WaitForKeys(1);
+  while (loop_.num_tasks() == 0) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  queue_.reset();
+  loop_.Run();
+  EXPECT_TRUE(handled_.empty());
+}
+
+}  // namespace
+}  // namespace fcitx
@@ -38,7 +38,9 @@
 #include <cassert>
 #include <memory>
 #include <string>
+#include <utility>
 
+#include "unix/fcitx5/key_event_queue.h"
 #include "unix/fcitx5/mozc_connection.h"
 
 namespace fcitx {
@@ -62,6 +64,12 @@ void MozcClientPool::setPolicy(PropertyPropagatePolicy policy) {
   policy_ = policy;
 }
 
+void MozcClientPool::setKeyEventDispatcher(
+    KeyEventQueue::Dispatcher dispatcher) {
+  assert(clients_.empty());
+  keyEventDispatcher_ = std::move(dispatcher);
+}
+
 std::string uuidKey(InputContext *ic) {
   std::string key = "u:";
   for (auto v : ic->uuid()) {
@@ -105,6 +113,10 @@ void MozcClientPool::registerClient(const std::string &key,
   assert(!key.empty());
   client->pool_ = this;
   client->client_ = connection_->CreateClient();
+  if (keyEventDispatcher_) {
+    client->keyEventQueue_ = std::make_unique<KeyEventQueue>(
+        client->client_.get(), keyEventDispatcher_);
+  }
   client->key_ = key;
   auto [_, success] = clients_.emplace(key, client);
   FCITX_UNUSED(success);
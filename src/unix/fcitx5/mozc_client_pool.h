@@ -38,6 +38,7 @@
 #include <unordered_map>
 
 #include "client/client_interface.h"
+#include "unix/fcitx5/key_event_queue.h"
 #include "unix/fcitx5/mozc_connection.h"
 
 namespace fcitx {
@@ -56,9 +57,14 @@ class MozcClientHolder {
 
   mozc::client::ClientInterface *client() const { return client_.get(); }
 
+  // Returns nullptr unless key events are sent asynchronously.
+  KeyEventQueue *keyEventQueue() const { return keyEventQueue_.get(); }
+
  private:
   MozcClientPool *pool_;
   std::unique_ptr<mozc::client::ClientInterface> client_;
+  // Declared after client_, as it uses the client until destroyed.
+  std::unique_ptr<KeyEventQueue> keyEventQueue_;
   std::string key_;
 };
 
@@ -72,6 +78,12 @@ class MozcClientPool {
   void setPolicy(PropertyPropagatePolicy policy);
   PropertyPropagatePolicy policy() const { return policy_; }
 
+  // Makes the clients send key events asynchronously and hand the replies back
+  // through `dispatcher`, or synchronously if it is empty. Like setPolicy(),
+  // this must not be called while clients are in use.
+  void setKeyEventDispatcher(KeyEventQueue::Dispatcher dispatcher);
+  bool asyncKeyEvent() const { return static_cast<bool>(keyEventDispatcher_); }
+
   std::shared_ptr<MozcClientHolder> requestClient(InputContext *ic);
 
   MozcConnection *connection() const { return connection_; }
@@ -82,6 +94,7 @@ class MozcClientPool {
   void unregisterClient(const std::string &key);
   MozcConnection *connection_;
   PropertyPropagatePolicy policy_;
+  KeyEventQueue::Dispatcher keyEventDispatcher_;
   std::unordered_map<std::string, std::weak_ptr<MozcClientHolder>> clients_;
 };
 
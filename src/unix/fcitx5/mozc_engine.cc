@@ -38,8 +38,10 @@
 #include <fcitx/userinterfacemanager.h>
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "base/init_mozc.h"
 #include "base/process.h"
@@ -315,7 +317,8 @@ void MozcEngine::compositionModeUpdated(InputContext *ic) {
 AddonInstance *MozcEngine::clipboardAddon() { return clipboard(); }
 
 void MozcEngine::ResetClientPool() {
-  if (pool_->policy() != GetSharedStatePolicy()) {
+  if (pool_->policy() != GetSharedStatePolicy() ||
+      pool_->asyncKeyEvent() != *config_.asyncKeyEvent) {
     instance_->inputContextManager().foreach ([this](InputContext *ic) {
       if (auto *state = this->mozcState(ic)) {
         state->ReleaseClient();
@@ -323,6 +326,15 @@ void MozcEngine::ResetClientPool() {
       return true;
     });
     pool_->setPolicy(GetSharedStatePolicy());
+    if (*config_.asyncKeyEvent) {
+      pool_->setKeyEventDispatcher(
+          [dispatcher = &instance_->eventDispatcher()](
+              std::function<void()> task) {
+            dispatcher->schedule(std::move(task));
+          });
+    } else {
+      pool_->setKeyEventDispatcher(nullptr);
+    }
   }
 }
 
@@ -95,6 +95,9 @@ FCITX_CONFIGURATION(
         this, "PreeditCursorPositionAtBeginning",
         _("Fix embedded preedit cursor at the beginning of the preedit"),
         false};
+    Option<bool> asyncKeyEvent{
+        this, "AsyncKeyEvent",
+        _("Process keys without waiting for the conversion server"), false};
     Option<Key> expand{this, "ExpandKey", _("Hotkey to expand usage"),
                        Key("Control+Alt+H")};
 
@@ -68,7 +68,7 @@ MozcState::MozcState(InputContext* ic, MozcEngine* engine)
   // mozc::Logging::SetVerboseLevel(1);
   MOZC_VLOG(1) << "MozcState created.";
 
-  if (GetClient()->EnsureConnection()) {
+  if (GetSyncedClient()->EnsureConnection()) {
     UpdatePreeditMethod();
   }
 
@@ -86,7 +86,7 @@ MozcState::~MozcState() { MOZC_VLOG(1) << "MozcState destroyed."; }
 
 void MozcState::UpdatePreeditMethod() {
   mozc::config::Config config;
-  if (!GetClient()->GetConfig(&config)) {
+  if (!GetSyncedClient()->GetConfig(&config)) {
     LOG(ERROR) << "GetConfig failed";
     return;
   }
@@ -120,7 +120,7 @@ bool MozcState::TrySendKeyEvent(InputContext* ic,
 
   // Call EnsureConnection just in case MozcState::MozcConnection() fails
   // to establish the server connection.
-  auto* client = GetClient();
+  auto* client = GetSyncedClient();
   if (!client->EnsureConnection()) {
     *out_error = "EnsureConnection failed";
     MOZC_VLOG(1) << "EnsureConnection failed";
@@ -133,16 +133,8 @@ bool MozcState::TrySendKeyEvent(InputContext* ic,
     return false;  // not consumed.
   }
 
-  mozc::commands::Context context;
-  SurroundingTextInfo surrounding_text_info;
-  if (GetSurroundingText(ic, &surrounding_text_info,
-                         engine_->clipboardAddon())) {
-    context.set_preceding_text(surrounding_text_info.preceding_text);
-    context.set_following_text(surrounding_text_info.following_text);
-  }
-
   MOZC_VLOG(1) << "TrySendKeyEvent: " << event.DebugString();
-  if (!client->SendKeyWithContext(event, context, out)) {
+  if (!client->SendKeyWithContext(event, GetContext(), out)) {
     *out_error = "SendKey failed";
     MOZC_VLOG(1) << "ERROR";
     return false;
@@ -151,6 +143,17 @@ bool MozcState::TrySendKeyEvent(InputContext* ic,
   return true;
 }
 
+mozc::commands::Context MozcState::GetContext() const {
+  mozc::commands::Context context;
+  SurroundingTextInfo surrounding_text_info;
+  if (GetSurroundingText(ic_, &surrounding_text_info,
+                         engine_->clipboardAddon())) {
+    context.set_preceding_text(surrounding_text_info.preceding_text);
+    context.set_following_text(surrounding_text_info.following_text);
+  }
+  return context;
+}
+
 bool MozcState::TrySendClick(int32_t unique_id, mozc::commands::Output* out,
                              std::string* out_error) const {
   DCHECK(out);
@@ -194,7 +197,7 @@ bool MozcState::TrySendRawCommand(const mozc::commands::SessionCommand& command,
                                   mozc::commands::Output* out,
                                   std::string* out_error) const {
   MOZC_VLOG(1) << "TrySendRawCommand: " << command.DebugString();
-  if (!GetClient()->SendCommand(command, out)) {
+  if (!GetSyncedClient()->SendCommand(command, out)) {
     *out_error = "SendCommand failed";
     MOZC_VLOG(1) << "ERROR";
     return false;
@@ -255,6 +258,11 @@ bool MozcState::ProcessKeyEvent(KeySym sym, uint32_t keycode, KeyStates state,
     }
   } while (false);
 
+  if (auto* queue = GetClientHolder()->keyEventQueue()) {
+    return QueueKeyEvent(queue, event, Key(sym, state, keycode), is_key_up,
+                         compose.value_or(""));
+  }
+
   std::string error;
   mozc::commands::Output raw_response;
   if (!TrySendKeyEvent(ic_, event, &raw_response, &error)) {
@@ -270,6 +278,90 @@ bool MozcState::ProcessKeyEvent(KeySym sym, uint32_t keycode, KeyStates state,
   return ParseResponse(raw_response);
 }
 
+bool MozcState::QueueKeyEvent(KeyEventQueue* queue,
+                              const mozc::commands::KeyEvent& event,
+                              const Key& key, bool is_key_up,
+                              std::string compose) {
+  // The mode is known only when no key is in flight. Otherwise let the server
+  // decide, which doesn't consume the key in DIRECT mode either.
+  if (composition_mode_ == mozc::commands::DIRECT && pending_keys_.empty() &&
+      !GetClient()->IsDirectModeCommand(event)) {
+    MOZC_VLOG(1) << "In DIRECT mode. Not consumed.";
+    return false;
+  }
+
+  // Printable keys are shown right away, until the server replies with the
+  // actual preedit.
+  std::string predicted;
+  if (composition_mode_ != mozc::commands::DIRECT && !is_key_up &&
+      event.modifier_keys_size() == 0 && !event.has_special_key()) {
+    if (!compose.empty()) {
+      predicted = compose;
+    } else if (event.has_key_string()) {
+      predicted = event.key_string();
+    } else if (event.has_key_code()) {
+      predicted = utf8::UCS4ToUTF8(event.key_code());
+    }
+  }
+  pending_keys_.push_back(std::move(predicted));
+
+  // The surrounding text doesn't include the results of the keys in flight
+  // yet. It is only a hint for the conversion anyway.
+  MOZC_VLOG(1) << "QueueKeyEvent: " << event.DebugString();
+  queue->Push(ic_, event, GetContext(),
+              [engine = engine_, ref = ic_->watch(), key, is_key_up,
+               compose = std::move(compose)](
+                  bool ok, const mozc::commands::Output& raw_response,
+                  bool more) {
+                if (auto* ic = ref.get()) {
+                  engine->mozcState(ic)->OnKeyEventReply(
+                      ok, raw_response, key, is_key_up, compose, more);
+                }
+              });
+  if (!pending_keys_.back().empty()) {
+    DrawAll();
+  }
+  return true;
+}
+
+void MozcState::OnKeyEventReply(bool ok,
+                                const mozc::commands::Output& raw_response,
+                                const Key& key, bool is_key_up,
+                                const std::string& compose, bool more) {
+  if (!pending_keys_.empty()) {
+    pending_keys_.pop_front();
+  }
+  if (!ok) {
+    MOZC_VLOG(1) << "SendKey failed";
+    if (!compose.empty()) {
+      ic_->commitString(compose);
+      Reset();
+      return;
+    }
+    ic_->forwardKey(key, is_key_up);
+    if (!more) {
+      DrawAll();
+    }
+    return;
+  }
+  MOZC_VLOG(1) << "OK: " << raw_response.DebugString();
+  if (!ParseResponse(raw_response, /*draw=*/!more)) {
+    ic_->forwardKey(key, is_key_up);
+  }
+}
+
+std::string MozcState::PredictedText() const {
+  // Stops at the first key of unknown effect, e.g., a conversion.
+  std::string text;
+  for (const std::string& key : pending_keys_) {
+    if (key.empty()) {
+      break;
+    }
+    text += key;
+  }
+  return text;
+}
+
 // This function is called from SCIM framework when users click the candidate
 // window.
 void MozcState::SelectCandidate(int32_t id) {
@@ -345,7 +437,8 @@ void MozcState::FocusOut(const InputContextEvent& event) {
   engine_->instance()->resetCompose(ic_);
 }
 
-bool MozcState::ParseResponse(const mozc::commands::Output& raw_response) {
+bool MozcState::ParseResponse(const mozc::commands::Output& raw_response,
+                              bool draw) {
   auto oldMode = composition_mode_;
   ClearAll();
   const bool consumed = engine_->parser()->ParseResponse(raw_response, ic_);
@@ -353,6 +446,9 @@ bool MozcState::ParseResponse(const mozc::commands::Output& raw_response) {
     MOZC_VLOG(1) << "The input was not consumed by Mozc.";
   }
   OpenUrl();
+  if (!draw) {
+    return consumed;
+  }
   DrawAll();
   if (oldMode != composition_mode_ && aux_.empty() && preedit_.empty() &&
       !ic_->inputPanel().candidateList()) {
@@ -405,8 +501,12 @@ void MozcState::DrawAll() {
     aux += aux_;
     aux += "]";
   }
+  Text preedit = preedit_;
+  if (const std::string predicted = PredictedText(); !predicted.empty()) {
+    preedit.append(predicted, TextFormatFlag::Underline);
+    preedit.setCursor(preedit.textLength());
+  }
   if (ic_->capabilityFlags().test(CapabilityFlag::Preedit)) {
-    Text preedit = preedit_;
     if (*engine_->config().preeditCursorPositionAtBeginning) {
       preedit.setCursor(0);
     }
@@ -415,7 +515,6 @@ void MozcState::DrawAll() {
       ic_->inputPanel().setAuxUp(Text(aux));
     }
   } else {
-    Text preedit = preedit_;
     if (!preedit.empty()) {
       preedit.append(" ");
       preedit.append(aux);
@@ -465,13 +564,33 @@ void MozcState::DisplayUsage() {
   ic_->updateUserInterface(UserInterfaceComponent::InputPanel);
 }
 
-mozc::client::ClientInterface* MozcState::GetClient() const {
+MozcClientHolder* MozcState::GetClientHolder() const {
   if (!client_holder_) {
     client_holder_ = engine_->pool()->requestClient(ic_);
   }
-  return client_holder_->client();
+  return client_holder_.get();
 }
 
-void MozcState::ReleaseClient() { client_holder_.reset(); }
+mozc::client::ClientInterface* MozcState::GetClient() const {
+  return GetClientHolder()->client();
+}
+
+mozc::client::ClientInterface* MozcState::GetSyncedClient() const {
+  auto* holder = GetClientHolder();
+  // The keys in flight go first, and the client can't be shared with the
+  // queue.
+  if (auto* queue = holder->keyEventQueue()) {
+    queue->Flush();
+  }
+  return holder->client();
+}
+
+void MozcState::ReleaseClient() {
+  if (client_holder_ && client_holder_->keyEventQueue()) {
+    client_holder_->keyEventQueue()->Flush();
+  }
+  client_holder_.reset();
+  pending_keys_.clear();
+}
 
 }  // namespace fcitx
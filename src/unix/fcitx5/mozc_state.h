@@ -36,12 +36,14 @@
 #include <fcitx/text.h>
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 
 #include "client/client_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "unix/fcitx5/key_event_queue.h"
 #include "unix/fcitx5/mozc_client_pool.h"
 
 namespace fcitx {
@@ -96,6 +98,9 @@ class MozcState : public InputContextProperty {
     return composition_mode_;
   }
 
+  // Returns the client without waiting for the keys in flight. Only calls
+  // which don't talk to the server, e.g., IsDirectModeCommand() and
+  // LaunchToolWithProtoBuf(), may be made on it.
   mozc::client::ClientInterface *GetClient() const;
   void ReleaseClient();
 
@@ -134,9 +139,34 @@ class MozcState : public InputContextProperty {
                          mozc::commands::Output *out,
                          std::string *out_error) const;
 
+  // Returns the surrounding text to be sent with a key event.
+  mozc::commands::Context GetContext() const;
+
+  // Queues the key event to be sent asynchronously. Returns whether the key is
+  // taken.
+  bool QueueKeyEvent(KeyEventQueue *queue,
+                     const mozc::commands::KeyEvent &event, const Key &key,
+                     bool is_key_up, std::string compose);
+
+  // Applies the reply to a key queued by QueueKeyEvent(). `more` is true if
+  // the reply to the next key follows immediately.
+  void OnKeyEventReply(bool ok, const mozc::commands::Output &raw_response,
+                       const Key &key, bool is_key_up,
+                       const std::string &compose, bool more);
+
+  // Returns the text the queued keys are expected to add to the preedit.
+  std::string PredictedText() const;
+
+  MozcClientHolder *GetClientHolder() const;
+
+  // Returns the client after the keys in flight are sent and handled, so that
+  // a request to the server follows them.
+  mozc::client::ClientInterface *GetSyncedClient() const;
+
   // Parses the response from mozc_server. Returns whether the server consumes
-  // the input or not (true means 'consumed').
-  bool ParseResponse(const mozc::commands::Output &raw_response);
+  // the input or not (true means 'consumed'). Redraws the UI if 'draw' is true.
+  bool ParseResponse(const mozc::commands::Output &raw_response,
+                     bool draw = true);
 
   void ClearAll();
   void DrawPreeditInfo();
@@ -148,6 +178,9 @@ class MozcState : public InputContextProperty {
   InputContext *ic_;
   MozcEngine *engine_;
   mutable std::shared_ptr<MozcClientHolder> client_holder_;
+  // Keys sent asynchronously and not replied yet. Each holds the text the key
+  // is expected to insert, or is empty if it can't be predicted.
+  std::deque<std::string> pending_keys_;
 
   mozc::commands::CompositionMode composition_mode_ = mozc::commands::HIRAGANA;
   mozc::config::Config::PreeditMethod preedit_method_ =